@@ -483,6 +483,17 @@ class Database : public runtime::ObjectRef {
    */
   TVM_DLL static Database JSONDatabase(String path_workload, String path_tuning_record,
                                        bool allow_missing, String mod_eq_name = "structural");
+  /*!
+   * \brief Create a database backed by a binary file, which is mapped into memory and opens
+   * without parsing the workloads and tuning records. Only the queried ones are deserialized.
+   * The committed workloads and records are appended to a log next to the file, which is merged
+   * into the file when the database is saved or when the log grows large.
+   * \param path The path to the binary database file.
+   * \param allow_missing Whether to start with an empty database when the given path is not found.
+   * \param mod_eq_name A string to specify the module equality testing and hashing method.
+   */
+  TVM_DLL static Database BinaryDatabase(String path, bool allow_missing,
+                                         String mod_eq_name = "structural");
   /*!
    * \brief A database composed of multiple databases, allowing users to guide IR rewriting using
    * combined knowledge of those databases. To each query, it returns the best record among all the
@@ -103,6 +103,55 @@ class StructuralHash : public BaseValueHash {
   TVM_DLL uint64_t operator()(const ObjectRef& key) const;
 };
 
+/*!
+ * \brief An opt-in cache of structural hash values, keyed by the identity of the hashed objects.
+ *
+ *  Within a scope of the cache on a thread, StructuralHash memoizes the hash value of each
+ *  function or expression it is called on, so hashing an unchanged one again is a lookup. These
+ *  kinds are immutable once built; other objects, IRModule in particular, are mutated in place
+ *  and are never cached.
+ *
+ *  The entries are keyed by the address of the object and hold a reference to it until the scope
+ *  exits. So the address of a cached object is not reused by another one, and CopyOnWrite on it
+ *  copies it instead of mutating it in place, at the cost of keeping the hashed objects alive for
+ *  the duration of the scope. Each scope only sees the entries inserted in it, which is why the
+ *  scopes are meant to span a single pass, see "ir.enable_structural_hash_cache".
+ *
+ *  Only the hash value of the object passed to StructuralHash is memoized. The hash value of a
+ *  subtree depends on the variables and graph nodes visited before it, so it is not reusable.
+ */
+class StructuralHashCache {
+ public:
+  /*! \brief The variants of the hash value of an object. */
+  enum Flag : uint32_t {
+    kMapFreeVars = 1,
+    kIgnoreNDArray = 2,
+  };
+  /*! \brief Enter a scope of the cache on the current thread. The scopes can be nested. */
+  TVM_DLL static void EnterScope();
+  /*!
+   * \brief Exit a scope of the cache. The entries of the scope are dropped, along with the
+   *  references they hold.
+   */
+  TVM_DLL static void ExitScope();
+  /*!
+   * \brief Look up the hash value of an object in the cache of the current thread.
+   * \param object The object.
+   * \param flags The variant of the hash value, a combination of Flag.
+   * \param hashed_value The hash value, set on a hit.
+   * \return Whether the hash value is in the cache, which is never the case outside of a scope.
+   */
+  TVM_DLL static bool Lookup(const ObjectRef& object, uint32_t flags, uint64_t* hashed_value);
+  /*!
+   * \brief Insert the hash value of an object into the cache of the current thread, if it is in
+   *  a scope.
+   * \param object The object.
+   * \param flags The variant of the hash value, a combination of Flag.
+   * \param hashed_value The hash value.
+   */
+  TVM_DLL static void Insert(const ObjectRef& object, uint32_t flags, uint64_t hashed_value);
+};
+
 /*!
  * \brief A Reducer class to reduce the structural hash value.
  *
@@ -99,7 +99,7 @@ enum class DiscoAction : int32_t {
 };
 
 /*! \brief Converts the enum class `DiscoAction` to string */
-inline std::string DiscoAction2String(DiscoAction action) {
+inline const char* DiscoAction2String(DiscoAction action) {
   switch (action) {
     case DiscoAction::kShutDown:
       return "kShutDown";
@@ -276,11 +276,15 @@ class Session : public ObjectRef {
    * When `worker-id` is 0, it shuts down the process pool; Otherwise, it retursn a tuple
    * (read_fd, writefd) used to communicate with the corresponding worker.
    * \param entrypoint The entrypoint of DiscoWorker main worker function.
+   * \param channel How the controler sends messages to the workers after the pipes are set up:
+   * "pipe" keeps the pipes, and "shm" moves the messages to ring buffers in shared memory, which
+   * saves the system calls of the pipes where POSIX shared memory is available.
    * \note Worker-0 is always co-located with the controler as a separate thread, and therefore
    * worker-0 does not exist in the process pool.
    */
   TVM_DLL static Session ProcessSession(int num_workers, int num_groups,
-                                        String process_pool_creator, String entrypoint);
+                                        String process_pool_creator, String entrypoint,
+                                        String channel = "pipe");
 
   TVM_DEFINE_MUTABLE_NOTNULLABLE_OBJECT_REF_METHODS(Session, ObjectRef, SessionObj);
 };
@@ -55,6 +55,36 @@ struct Buffer {
   AllocatorType alloc_type;
 };
 
+/*! \brief The statistics of an allocator. */
+struct AllocatorStats {
+  /*! \brief The bytes of the live buffers. */
+  size_t allocated_bytes{0};
+  /*! \brief The bytes reserved from the device, including the cached free blocks. */
+  size_t reserved_bytes{0};
+  /*! \brief The bytes of the cached free blocks. */
+  size_t free_bytes{0};
+  /*! \brief The size of the largest cached free block. */
+  size_t largest_free_block{0};
+  /*! \brief The peak of allocated_bytes. */
+  size_t peak_allocated_bytes{0};
+  /*! \brief The peak of reserved_bytes. */
+  size_t peak_reserved_bytes{0};
+  /*! \brief The number of allocations served by the cached blocks. */
+  uint64_t num_hits{0};
+  /*! \brief The number of allocations that allocated from the device. */
+  uint64_t num_misses{0};
+  /*! \brief The number of cached device allocations released to the device. */
+  uint64_t num_released_segments{0};
+
+  /*!
+   * \return The fraction of the cached free bytes that are outside the largest free block,
+   *  0 when all the free memory is contiguous.
+   */
+  double Fragmentation() const {
+    return free_bytes == 0 ? 0.0 : 1.0 - static_cast<double>(largest_free_block) / free_bytes;
+  }
+};
+
 class Allocator {
  public:
   explicit Allocator(AllocatorType type) : type_(type) {}
@@ -117,6 +147,11 @@ class Allocator {
    *  \return The amount of memory currently allocated.
    */
   TVM_DLL virtual size_t UsedMemory() const = 0;
+  /*! \brief The statistics of the allocator.
+   *  \return The statistics, allocators that do not cache report UsedMemory() as both the
+   *  allocated and the reserved bytes.
+   */
+  TVM_DLL virtual AllocatorStats Stats() const;
 
  protected:
   /*! \brief Check if the given memory scope is allowed to allocate by the allocator. */
@@ -198,6 +233,7 @@ class Storage : public ObjectRef {
 }  // namespace memory
 
 using memory::Allocator;
+using memory::AllocatorStats;
 using memory::AllocatorType;
 using memory::MemoryManager;
 using memory::StorageObj;
@@ -326,6 +326,21 @@ class MetricCollector : public ObjectRef {
   TVM_DEFINE_MUTABLE_OBJECT_REF_METHODS(MetricCollector, ObjectRef, MetricCollectorNode);
 };
 
+/*! \brief Construct a metric collector that reads the hardware performance
+ * counters of the CPU through the Linux `perf_event_open` interface, without
+ * depending on PAPI.
+ *
+ * The counters are summed over all the threads of the process, including the
+ * workers of the thread pool. When both cycles and instructions are counted,
+ * `ReportNode::AsTable` shows the instructions per cycle (IPC) as well.
+ *
+ * \param metrics The names of the events to count, as listed by `perf list`,
+ * e.g. "cycles", "instructions", "LLC-load-misses", "branch-misses",
+ * "task-clock" or "page-faults". If empty, the cycles, instructions, LLC load
+ * misses and branch misses are counted.
+ */
+TVM_DLL MetricCollector CreatePerfEventMetricCollector(Array<String> metrics);
+
 /*! Information about a single function or operator call. */
 struct CallFrame {
   /*! Device on which the call was made */
@@ -23,10 +23,13 @@
 #ifndef TVM_RUNTIME_RELAX_VM_EXECUTABLE_H_
 #define TVM_RUNTIME_RELAX_VM_EXECUTABLE_H_
 
+#include <tvm/runtime/container/shape_tuple.h>
+#include <tvm/runtime/ndarray.h>
 #include <tvm/runtime/object.h>
 #include <tvm/runtime/packed_func.h>
 #include <tvm/runtime/registry.h>
 
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -37,7 +40,7 @@
 // NOTE: this file only changes if we change relax vm format
 // for example if relax vm format do not change in 0.15, this should remain as 0.14
 // if it changes in 0.16, we will change it to 0.16
-#define RELAX_VM_VERSION "0.14"
+#define RELAX_VM_VERSION "0.21"
 
 namespace tvm {
 namespace runtime {
@@ -148,6 +151,19 @@ class VMExecutable : public runtime::ModuleNode {
    * \return The loaded executable, in the form of a `runtime::Module`.
    */
   static Module LoadFromFile(const String& file_name);
+  /*!
+   * \brief Get a constant, loading it on first use if it is a lazy constant.
+   * \param index The index of the constant in the constant pool.
+   * \return The constant.
+   */
+  TVMRetValue GetConstant(Index index);
+  /*!
+   * \brief Check whether a constant is an NDArray which is loaded from the serialized executable
+   *  on first use. Its entry in the constant pool is null until GetConstant loads it.
+   * \param index The index of the constant in the constant pool.
+   * \return Whether the constant is lazy.
+   */
+  bool IsLazyConstant(Index index) const { return lazy_constants_.count(index) != 0; }
 
   /*! \brief The virtual machine's function table. */
   std::vector<VMFuncInfo> func_table;
@@ -172,6 +188,35 @@ class VMExecutable : public runtime::ModuleNode {
   TVM_MODULE_VTABLE_END();
 
  private:
+  /*! \brief An NDArray constant in the serialized executable, which is loaded on first use. */
+  struct LazyConstant {
+    /*! \brief The shape. */
+    ShapeTuple shape;
+    /*! \brief The data type. */
+    DLDataType dtype;
+    /*! \brief The offset of the data in the serialized executable. */
+    uint64_t byte_offset;
+  };
+  /*!
+   * \brief Serialize the executable.
+   * \return The serialized executable.
+   */
+  std::string SaveToBytes();
+  /*!
+   * \brief Load an executable from its serialized form.
+   * \param storage The object owning the serialized executable, which is kept by the executable
+   *  until all the lazy constants are loaded.
+   * \param data The serialized executable.
+   * \param size The size of the serialized executable.
+   * \return The loaded executable.
+   */
+  static Module Load(ObjectRef storage, const char* data, size_t size);
+  /*!
+   * \brief Load a lazy constant on the CPU.
+   * \param constant The lazy constant.
+   * \return The NDArray.
+   */
+  NDArray LoadLazyConstant(const LazyConstant& constant) const;
   /*!
    * \brief Save the globals.
    * \param strm The input stream.
@@ -181,7 +226,7 @@ class VMExecutable : public runtime::ModuleNode {
    * \brief Save the constant pool.
    * \param strm The input stream.
    */
-  void SaveConstantSection(dmlc::Stream* strm);
+  void SaveConstantSection(dmlc::SeekStream* strm);
   /*!
    * \brief Save the instructions.
    * \param strm The input stream.
@@ -198,10 +243,11 @@ class VMExecutable : public runtime::ModuleNode {
    */
   void LoadGlobalSection(dmlc::Stream* strm);
   /*!
-   * \brief Load the constant pool.
+   * \brief Load the constant pool. The NDArrays are lazy constants.
    * \param strm The input stream.
+   * \param stream_size The size of the serialized executable.
    */
-  void LoadConstantSection(dmlc::Stream* strm);
+  void LoadConstantSection(dmlc::SeekStream* strm, size_t stream_size);
   /*!
    * \brief Load the instructions.
    * \param strm The input stream.
@@ -212,6 +258,17 @@ class VMExecutable : public runtime::ModuleNode {
    * \param strm The input stream.
    */
   void LoadPackedFuncNames(dmlc::Stream* strm);
+
+  /*! \brief The lazy constants, by their index in the constant pool. */
+  std::unordered_map<Index, LazyConstant> lazy_constants_;
+  /*! \brief The object owning the serialized executable, a MappedFile or a String. */
+  ObjectRef constant_storage_;
+  /*! \brief The serialized executable, which the lazy constants are loaded from. */
+  const char* constant_data_{nullptr};
+  /*! \brief The number of the lazy constants which are not loaded yet. */
+  size_t num_unloaded_constants_{0};
+  /*! \brief The mutex guarding the loading of the lazy constants. */
+  std::mutex constant_mutex_;
 };
 
 }  // namespace relax_vm
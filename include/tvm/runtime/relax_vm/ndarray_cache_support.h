@@ -47,6 +47,15 @@ struct NDArrayCacheMetadata {
        */
       TVM_DLL NDArray Load(Device device, const std::string* raw_data,
                            Optional<NDArray>* staging_buffer = nullptr) const;
+      /*!
+       * \brief Load the parameter from the raw data of its shard.
+       * \param device The device to load the parameter onto.
+       * \param raw_data The start of the raw data of the shard.
+       * \param staging_buffer The buffer to be used to avoid extra OpenCL copies. Pass in a nullptr
+       * in other cases
+       */
+      TVM_DLL NDArray Load(Device device, const char* raw_data,
+                           Optional<NDArray>* staging_buffer = nullptr) const;
 
       /*! \brief Name of the parameter */
       std::string name;
@@ -68,6 +77,16 @@ struct NDArrayCacheMetadata {
                                 std::string* raw_data_buffer,    //
                                 Optional<NDArray>* staging_buffer = nullptr) const;
 
+    /*!
+     * \brief Load a FileRecord by mapping the file into memory rather than reading it into a
+     * buffer. On CPU, the raw parameters whose data is aligned to kAllocAlignment alias the
+     * mapped pages, which stay mapped as long as such a parameter is alive. The other parameters
+     * are copied from the mapping.
+     */
+    TVM_DLL Array<NDArray> LoadMapped(Device device,                   //
+                                      const std::string& path_prefix,  //
+                                      Optional<NDArray>* staging_buffer = nullptr) const;
+
     /*! \brief Relative path to the bin file */
     std::string data_path;
     /*! \brief Format of the file */
@@ -135,6 +135,10 @@ TVM_DLL void ResetThreadPool();
 
 /*!
  * \brief Configuring the CPU affinity mode for the working threads.
+ *
+ * \note The configuration only applies to the calling thread, which then launches
+ *  its parallel jobs on a thread pool of its own instead of the one shared by
+ *  all the threads.
  * \param mode The preferred CPU type (1 = big, -1 = little, -2 = kSpecifyOneCorePerThread,
  *  -3 = kSpecifyThreadShareAllCore).
  * \param nthreads The number of threads to use (0 = use all).
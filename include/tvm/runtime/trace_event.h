@@ -0,0 +1,164 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file tvm/runtime/trace_event.h
+ * \brief A recorder of timeline events of the runtime, written in the Chrome trace format.
+ *
+ *  Unlike the Profiler, which aggregates the calls into a report, the trace keeps every event
+ *  with its thread and timestamps, so that stalls and overlaps can be seen in a viewer such as
+ *  Perfetto or chrome://tracing. Each thread appends its events to its own buffer without
+ *  locking, and checking whether tracing is enabled is a single relaxed atomic load.
+ */
+#ifndef TVM_RUNTIME_TRACE_EVENT_H_
+#define TVM_RUNTIME_TRACE_EVENT_H_
+
+#include <tvm/runtime/c_runtime_api.h>
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace tvm {
+namespace runtime {
+namespace profiling {
+
+namespace detail {
+/*! \brief Whether the trace events are being recorded. */
+TVM_DLL extern std::atomic<bool> trace_enabled;
+}  // namespace detail
+
+/*! \return Whether the trace events are being recorded. */
+inline bool TraceEnabled() { return detail::trace_enabled.load(std::memory_order_relaxed); }
+
+/*! \brief Start recording trace events, discarding the events recorded before. */
+TVM_DLL void StartTrace();
+
+/*! \brief Stop recording trace events. The recorded events are kept until the next start. */
+TVM_DLL void StopTrace();
+
+/*!
+ * \brief Write the events recorded since the last start in the Chrome trace JSON format.
+ *  It can be called while recording, to write the events recorded so far.
+ * \param os The stream to write to.
+ */
+TVM_DLL void WriteTrace(std::ostream& os);
+
+/*! \return The monotonic time of the trace, in nanoseconds. */
+TVM_DLL int64_t TraceNow();
+
+/*!
+ * \brief Record a complete event, which spans a duration on the calling thread.
+ * \param category The category of the event, which must be a string literal.
+ * \param name The name of the event.
+ * \param begin_ns The begin time from TraceNow.
+ * \param end_ns The end time from TraceNow.
+ * \param arg_name The name of an integer argument of the event, or nullptr if there is none.
+ *  It must be a string literal.
+ * \param arg_value The value of the argument.
+ */
+TVM_DLL void RecordTraceComplete(const char* category, std::string name, int64_t begin_ns,
+                                 int64_t end_ns, const char* arg_name = nullptr,
+                                 int64_t arg_value = 0);
+
+/*!
+ * \brief Record a sample of a counter, such as the bytes allocated by an allocator.
+ * \param category The category of the counter, which must be a string literal.
+ * \param name The name of the counter.
+ * \param value The value of the counter.
+ */
+TVM_DLL void RecordTraceCounter(const char* category, std::string name, int64_t value);
+
+/*!
+ * \brief Record a sample of a counter, whose name is only copied if tracing is enabled.
+ * \param category The category of the counter, which must be a string literal.
+ * \param name The name of the counter.
+ * \param value The value of the counter.
+ */
+inline void RecordTraceCounter(const char* category, const char* name, int64_t value) {
+  if (TraceEnabled()) {
+    RecordTraceCounter(category, std::string(name), value);
+  }
+}
+
+/*!
+ * \brief Name the calling thread in the trace, e.g. "thread pool worker 3".
+ *  It takes effect even if tracing is not enabled yet.
+ * \param name The name of the thread.
+ */
+TVM_DLL void SetTraceThreadName(std::string name);
+
+/*!
+ * \brief Record a complete event spanning the lifetime of the scope, if tracing is enabled when
+ *  the scope is entered.
+ */
+class TraceScope {
+ public:
+  /*!
+   * \param category The category of the event, which must be a string literal.
+   * \param name The name of the event, which is only copied if tracing is enabled.
+   * \param arg_name The name of an integer argument of the event, or nullptr if there is none.
+   * \param arg_value The value of the argument.
+   */
+  TraceScope(const char* category, const std::string& name, const char* arg_name = nullptr,
+             int64_t arg_value = 0) {
+    if (TraceEnabled()) {
+      category_ = category;
+      name_ = name;
+      arg_name_ = arg_name;
+      arg_value_ = arg_value;
+      begin_ns_ = TraceNow();
+    }
+  }
+  TraceScope(const char* category, const char* name, const char* arg_name = nullptr,
+             int64_t arg_value = 0) {
+    if (TraceEnabled()) {
+      category_ = category;
+      name_ = name;
+      arg_name_ = arg_name;
+      arg_value_ = arg_value;
+      begin_ns_ = TraceNow();
+    }
+  }
+  ~TraceScope() {
+    if (begin_ns_ >= 0) {
+      RecordTraceComplete(category_, std::move(name_), begin_ns_, TraceNow(), arg_name_,
+                          arg_value_);
+    }
+  }
+  TraceScope(const TraceScope& other) = delete;
+  TraceScope(TraceScope&& other) = delete;
+  TraceScope& operator=(const TraceScope& other) = delete;
+  TraceScope& operator=(TraceScope&& other) = delete;
+
+ private:
+  const char* category_{nullptr};
+  std::string name_;
+  const char* arg_name_{nullptr};
+  int64_t arg_value_{0};
+  /*! \brief The begin time, or -1 if tracing was disabled when the scope was entered. */
+  int64_t begin_ns_{-1};
+};
+
+}  // namespace profiling
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_TRACE_EVENT_H_
@@ -25,6 +25,7 @@
 #define TVM_SUPPORT_PARALLEL_FOR_H_
 
 #include <tvm/runtime/c_runtime_api.h>
+#include <tvm/support/task_pool.h>
 
 #include <functional>
 #include <vector>
@@ -61,8 +62,9 @@ TVM_DLL std::vector<std::vector<int>> rr_partitioner(int begin, int end, int ste
  * \param step The traversal step to the index.
  * \param partitioner A partition function to split tasks to different threads. Use Round-robin
  * partitioner by default.
- * \note 1. Currently do not support nested parallel_for; 2. The order of execution in each thread
- * is not guaranteed, the for loop task should be thread independent and thread safe.
+ * \note 1. The partitions run on the process-wide TaskPool, and the loop can be nested in
+ * another parallel loop; 2. The order of execution in each thread is not guaranteed, the for
+ * loop task should be thread independent and thread safe.
  */
 TVM_DLL void parallel_for(int begin, int end, const std::function<void(int)>& f, int step = 1,
                           const PartitionerFuncType partitioner = rr_partitioner);
@@ -82,11 +84,16 @@ TVM_DLL void parallel_for(int begin, int end, const std::function<void(int)>& f,
  * \param end The end index of this parallel loop (exclusive).
  * \param num_threads The number of threads to be used.
  * \param f The task function to be executed. Takes the thread index and the task index as
- * input with no output.
- * \note `step` support is left for future work.
+ * input with no output. The thread index is in [0, num_threads) and is unique among the
+ * threads running the loop at the same time.
+ * \param token If given, the tasks not started yet are skipped once the token is cancelled.
+ * \note The calling thread runs the loop together with up to `num_threads - 1` threads of the
+ * process-wide TaskPool, so the loop can be nested in another parallel loop. When an error is
+ * thrown, the tasks not started yet are skipped. `step` support is left for future work.
  */
 TVM_DLL void parallel_for_dynamic(int begin, int end, int num_threads,
-                                  const std::function<void(int thread_id, int task_id)>& f);
+                                  const std::function<void(int thread_id, int task_id)>& f,
+                                  const CancellationToken* token = nullptr);
 }  // namespace support
 }  // namespace tvm
 
@@ -0,0 +1,112 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file task_pool.h
+ * \brief A persistent pool of threads for the compiler-side parallel loops.
+ */
+#ifndef TVM_SUPPORT_TASK_POOL_H_
+#define TVM_SUPPORT_TASK_POOL_H_
+
+#include <tvm/runtime/c_runtime_api.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace tvm {
+namespace support {
+
+/*!
+ * \brief A flag shared between the code that cancels a group of tasks and the tasks.
+ *  Copies of a token refer to the same flag.
+ */
+class CancellationToken {
+ public:
+  CancellationToken() : cancelled_(std::make_shared<std::atomic<bool>>(false)) {}
+  /*! \brief Request the cancellation. */
+  void Cancel() const { cancelled_->store(true, std::memory_order_release); }
+  /*! \return Whether the cancellation has been requested. */
+  bool IsCancelled() const { return cancelled_->load(std::memory_order_acquire); }
+
+ private:
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+/*!
+ * \brief A pool of threads that lives as long as the process, so that parallel loops in the
+ *  compiler do not pay for thread creation on every call.
+ *
+ *  Jobs are run in FIFO order. A thread waiting on work it has submitted must keep making
+ *  progress on its own, which is what the parallel loops in parallel_for.h do: the calling
+ *  thread always takes part in the loop, so loops can be nested in pool threads.
+ */
+class TaskPool {
+ public:
+  /*!
+   * \brief Create a pool.
+   * \param num_threads The number of threads in the pool.
+   */
+  TVM_DLL explicit TaskPool(int num_threads);
+  TVM_DLL ~TaskPool();
+
+  /*!
+   * \return The pool shared by the whole process, created on first use with one thread per
+   *  hardware thread. A forked child process gets a pool of its own.
+   */
+  TVM_DLL static TaskPool* Global();
+
+  /*! \return The number of threads in the pool. */
+  int NumThreads() const { return static_cast<int>(threads_.size()); }
+
+  /*! \return Whether the calling thread belongs to this pool. */
+  TVM_DLL bool IsPoolThread() const;
+
+  /*!
+   * \brief Run a job on a pool thread.
+   * \param job The job to run. It must not throw.
+   */
+  TVM_DLL void Enqueue(std::function<void()> job);
+
+ private:
+  /*! \brief The main loop of a pool thread. */
+  void RunWorker();
+
+  /*! \brief The threads. */
+  std::vector<std::thread> threads_;
+  /*! \brief The pending jobs. */
+  std::deque<std::function<void()>> jobs_;
+  /*! \brief Protects jobs_ and exit_. */
+  std::mutex mutex_;
+  /*! \brief Signals new jobs and exit. */
+  std::condition_variable cv_;
+  /*! \brief Whether the threads should exit. */
+  bool exit_{false};
+};
+
+}  // namespace support
+}  // namespace tvm
+
+#endif  // TVM_SUPPORT_TASK_POOL_H_
@@ -205,6 +205,15 @@ def tvm_callback_cuda_compile(code, target):  # pylint: disable=unused-argument
     return ptx
 
 
+@tvm._ffi.register_func
+def tvm_callback_cuda_compile_version(target):
+    """The version of nvcc and the architecture that tvm_callback_cuda_compile compiles for,
+    which the compile cache keys the compiled code on. A replacement of
+    tvm_callback_cuda_compile must replace this too, or its code is cached with the wrong key."""
+    version = ".".join(str(field) for field in get_cuda_version())
+    return f"nvcc {version} compute_{get_target_compute_version(target)}"
+
+
 @tvm._ffi.register_func("tvm_callback_libdevice_path")
 def find_libdevice_path(arch):
     """Utility function to find libdevice
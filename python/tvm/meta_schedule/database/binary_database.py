@@ -0,0 +1,163 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""A database backed by a binary file that is mapped into memory"""
+import json
+from typing import Optional
+
+from tvm._ffi import register_object
+
+from .. import _ffi_api
+from .database import Database, Workload
+from .json_database import JSONDatabase
+
+
+@register_object("meta_schedule.BinaryDatabase")
+class BinaryDatabase(Database):
+    """Database class backed by a binary file. The file is mapped into memory when the database
+    is created, and only the workloads and tuning records being queried are deserialized, so a
+    large tuning log is ready to use right away. The committed workloads and tuning records are
+    appended to a log next to the file, "<path>.log", so they are never lost. The log is merged
+    into the file by `save`, and automatically once it holds a few thousand tuning records.
+
+    Parameters
+    ----------
+    path : str
+        The path to the binary database file.
+    module_equality : Optional[str]
+        A string to specify the module equality testing and hashing method.
+        It must be one of the followings:
+          - "structural": Use StructuralEqual/Hash
+          - "ignore-ndarray": Same as "structural", but ignore ndarray raw data during
+                              equality testing and hashing.
+          - "anchor-block": Apply equality testing and hashing on the anchor block extracted from a
+                            given module. The "ignore-ndarray" varint is used for the extracted
+                            blocks or in case no anchor block is found.
+                            For the definition of the anchor block, see tir/analysis/analysis.py.
+        The file stores the structural hashes of its workloads, so it must be opened with the
+        module equality it is saved with.
+    """
+
+    path: str
+    module_equality: str
+
+    def __init__(
+        self,
+        path: str,
+        *,
+        allow_missing: bool = True,
+        module_equality: str = "structural",
+    ) -> None:
+        """Constructor.
+
+        Parameters
+        ----------
+        path : str
+            The path to the binary database file.
+        allow_missing : bool
+            Whether to start with an empty database when the given path is not found.
+        """
+        self.__init_handle_by_constructor__(
+            _ffi_api.DatabaseBinaryDatabase,  # type: ignore # pylint: disable=no-member
+            path,
+            allow_missing,
+            module_equality,
+        )
+
+    def save(self, path: Optional[str] = None) -> None:
+        """Write the tuning records of the database to a binary database file.
+
+        Parameters
+        ----------
+        path : Optional[str]
+            The path to the file, which is replaced atomically. Defaults to the file this
+            database is opened from, in which case its log is merged into the file and cleared.
+        """
+        _ffi_api.DatabaseBinaryDatabaseSave(  # type: ignore # pylint: disable=no-member
+            self, self.path if path is None else path
+        )
+
+    @staticmethod
+    def from_json(
+        path_workload: str,
+        path_tuning_record: str,
+        path: str,
+        module_equality: str = "structural",
+    ) -> "BinaryDatabase":
+        """Convert a JSON database to a binary database file.
+
+        Parameters
+        ----------
+        path_workload : str
+            The path to the workload table of the JSON database.
+        path_tuning_record : str
+            The path to the tuning record table of the JSON database.
+        path : str
+            The path to the binary database file to write.
+        module_equality : str
+            The module equality testing and hashing method.
+
+        Returns
+        -------
+        database : BinaryDatabase
+            The binary database opened from the written file.
+        """
+        json_database = JSONDatabase(
+            path_workload,
+            path_tuning_record,
+            allow_missing=False,
+            module_equality=module_equality,
+        )
+        # An empty database, which is not opened from any file
+        database = BinaryDatabase("", module_equality=module_equality)
+        # Copy the workloads without any tuning records too
+        with open(path_workload, encoding="utf-8") as file:
+            for line in file:
+                if line.strip():
+                    database.commit_workload(Workload.from_json(json.loads(line)).mod)
+        for record in json_database.get_all_tuning_records():
+            database.commit_tuning_record(record)
+        database.save(path)
+        return BinaryDatabase(path, allow_missing=False, module_equality=module_equality)
+
+    def to_json(self, path_workload: str, path_tuning_record: str) -> JSONDatabase:
+        """Append the tuning records of the database to a JSON database.
+
+        Parameters
+        ----------
+        path_workload : str
+            The path to the workload table of the JSON database.
+        path_tuning_record : str
+            The path to the tuning record table of the JSON database.
+
+        Returns
+        -------
+        database : JSONDatabase
+            The JSON database with the tuning records.
+        """
+        json_database = JSONDatabase(
+            path_workload,
+            path_tuning_record,
+            allow_missing=True,
+            module_equality=self.module_equality,
+        )
+        committed = set()
+        for record in self.get_all_tuning_records():
+            if record.workload not in committed:
+                json_database.commit_workload(record.workload.mod)
+                committed.add(record.workload)
+            json_database.commit_tuning_record(record)
+        return json_database
@@ -506,6 +506,7 @@ class TIRPagedKVCache(PagedKVCache):  # pylint: disable=too-few-public-methods
         dtype: str,
         target: Target,
         name: str = "paged_kv_cache",
+        page_dtype: Optional[str] = None,
     ) -> None:
         """Create a paged KV cache object with TIR kernels.
 
@@ -552,8 +553,20 @@ class TIRPagedKVCache(PagedKVCache):  # pylint: disable=too-few-public-methods
             Whether to enable disaggregation in the KV cache.
         target : Target
             The target to build the model to.
+        page_dtype : Optional[str]
+            "int8" or "float8_e4m3fn" to store the KV cache pages quantized, with a float32 scale
+            per page and KV head, or None to store them in `dtype`.
+            Quantized pages are only supported for MHA on CPU for now.
         """
 
+        if page_dtype is not None and (str(target.kind) != "llvm" or attn_kind != "mha"):
+            raise ValueError("Quantized KV cache pages are only supported for MHA on CPU for now.")
+        if page_dtype is None:
+            transpose_append = _kv_cache_transpose_append(num_key_value_heads, qk_head_dim, dtype)
+        else:
+            transpose_append = _kv_cache_transpose_append_quantized(
+                num_key_value_heads, qk_head_dim, dtype, page_dtype
+            )
         bb = rx.BlockBuilder.current()
         args = [
             rx.ShapeExpr(
@@ -581,7 +594,7 @@ class TIRPagedKVCache(PagedKVCache):  # pylint: disable=too-few-public-methods
             rx.op.zeros((), dtype),
             # pylint: disable=line-too-long
             # fmt: off
-            bb.add_func(_kv_cache_transpose_append(num_key_value_heads, qk_head_dim, dtype), "kv_cache_transpose_append"),
+            bb.add_func(transpose_append, "kv_cache_transpose_append"),
             bb.add_func(_kv_cache_transpose_append_mla(qk_head_dim, dtype), "kv_cache_transpose_append_mla"),
             # fmt: on
             # pylint: enable=line-too-long
@@ -592,23 +605,33 @@ class TIRPagedKVCache(PagedKVCache):  # pylint: disable=too-few-public-methods
                 raise ValueError("MLA is not supported in TIR kernels for now.")
             # pylint: disable=line-too-long
             # fmt: off
+            if page_dtype is None:
+                copy_single_page = _copy_single_page_cpu(num_key_value_heads, page_size, qk_head_dim, dtype)
+                debug_get_kv = _kv_cache_debug_get_kv(num_hidden_layers, num_key_value_heads, qk_head_dim, dtype)
+                compact_kv_copy = _compact_kv_copy_cpu(num_key_value_heads, qk_head_dim, dtype)
+            else:
+                copy_single_page = _copy_single_page_quantized_cpu(num_key_value_heads, page_size, qk_head_dim, page_dtype)
+                debug_get_kv = _kv_cache_debug_get_kv_quantized(num_hidden_layers, num_key_value_heads, qk_head_dim, dtype, page_dtype)
+                compact_kv_copy = _compact_kv_copy_quantized_cpu(num_key_value_heads, qk_head_dim, page_dtype)
             args.extend(
                 [
                     rx.Tuple([rx.StringImm("tir"), bb.add_func(_attention_prefill_ragged_cpu(num_key_value_heads, num_attention_heads, qk_head_dim, v_head_dim, dtype, rope_scaling), "tir_attention_prefill_ragged_cpu")]),
-                    rx.Tuple([rx.StringImm("tir"), bb.add_func(_attention_prefill_cpu(num_key_value_heads, num_attention_heads, qk_head_dim, dtype, False, rope_scaling), "tir_attention_prefill_cpu")]),
-                    rx.Tuple([rx.StringImm("tir"), bb.add_func(_attention_decode_cpu(num_key_value_heads, num_attention_heads, qk_head_dim, dtype, False, rope_scaling), "tir_attention_decode_cpu")]),
-                    rx.Tuple([rx.StringImm("tir"), bb.add_func(_attention_prefill_cpu(num_key_value_heads, num_attention_heads, qk_head_dim, dtype, True, rope_scaling), "tir_attention_prefill_cpu_sliding_window")]),
-                    rx.Tuple([rx.StringImm("tir"), bb.add_func(_attention_decode_cpu(num_key_value_heads, num_attention_heads, qk_head_dim, dtype, True, rope_scaling), "tir_attention_decode_cpu_sliding_window")]),
+                    rx.Tuple([rx.StringImm("tir"), bb.add_func(_attention_prefill_cpu(num_key_value_heads, num_attention_heads, qk_head_dim, dtype, False, rope_scaling, page_dtype=page_dtype), "tir_attention_prefill_cpu")]),
+                    rx.Tuple([rx.StringImm("tir"), bb.add_func(_attention_decode_cpu(num_key_value_heads, num_attention_heads, qk_head_dim, dtype, False, rope_scaling, page_dtype=page_dtype), "tir_attention_decode_cpu")]),
+                    rx.Tuple([rx.StringImm("tir"), bb.add_func(_attention_prefill_cpu(num_key_value_heads, num_attention_heads, qk_head_dim, dtype, True, rope_scaling, page_dtype=page_dtype), "tir_attention_prefill_cpu_sliding_window")]),
+                    rx.Tuple([rx.StringImm("tir"), bb.add_func(_attention_decode_cpu(num_key_value_heads, num_attention_heads, qk_head_dim, dtype, True, rope_scaling, page_dtype=page_dtype), "tir_attention_decode_cpu_sliding_window")]),
                     rx.Tuple([rx.StringImm("tir"), bb.add_func(tree_attn_cpu(num_key_value_heads, num_attention_heads, qk_head_dim, dtype, rope_scaling), "tir_attention_prefill_with_tree_mask_cpu")]),
-                    rx.Tuple([rx.StringImm("tir"), bb.add_func(tree_attn_with_paged_kv_cache_cpu(num_key_value_heads, num_attention_heads, qk_head_dim, dtype, rope_scaling), "tir_attention_prefill_with_tree_mask_with_paged_kv_cache_cpu")]),
+                    rx.Tuple([rx.StringImm("tir"), bb.add_func(tree_attn_with_paged_kv_cache_cpu(num_key_value_heads, num_attention_heads, qk_head_dim, dtype, rope_scaling, page_dtype), "tir_attention_prefill_with_tree_mask_with_paged_kv_cache_cpu")]),
                     rx.Tuple([]),  # f_mla_prefill
                     rx.Tuple([bb.add_func(_merge_state_inplace_cpu(dtype), "tir_attention_merge_state_cpu")]),
                     bb.add_func(llama_rope_with_position_map(rope_theta, rope_scale, qk_head_dim, num_attention_heads, num_key_value_heads, dtype, rope_scaling, rotary_dim), "tir_split_rotary"),
-                    bb.add_func(_copy_single_page_cpu(num_key_value_heads, page_size, qk_head_dim, dtype), "kv_cache_copy_single_page_cpu"),
-                    bb.add_func(_kv_cache_debug_get_kv(num_hidden_layers, num_key_value_heads, qk_head_dim, dtype), "kv_cache_debug_get_kv"),
-                    bb.add_func(_compact_kv_copy_cpu(num_key_value_heads, qk_head_dim, dtype), "kv_cache_compact_kv_copy_cpu"),
+                    bb.add_func(copy_single_page, "kv_cache_copy_single_page_cpu"),
+                    bb.add_func(debug_get_kv, "kv_cache_debug_get_kv"),
+                    bb.add_func(compact_kv_copy, "kv_cache_compact_kv_copy_cpu"),
                 ]
             )
+            if page_dtype is not None:
+                args.append(rx.op.zeros((), page_dtype))
             # fmt: on
             # pylint: enable=line-too-long
         else:
@@ -706,6 +729,69 @@ def _kv_cache_transpose_append(num_key_value_heads, head_dim, dtype, page_size:
     return tir_kv_cache_transpose_append
 
 
+def _kv_cache_transpose_append_quantized(
+    num_key_value_heads, head_dim, dtype, page_dtype, page_size: int = 16
+):
+    """Return the TIR function that quantizes and appends new k/v data to PagedKVCache.
+
+    Each head of the k/v data in a page is stored divided by a scale, which is the largest
+    magnitude in it over the largest magnitude of `page_dtype`. When an appended token raises
+    the scale, the tokens already in the page are requantized to the new scale.
+    """
+    quant_max = _page_quant_max(page_dtype)
+
+    # pylint: disable=line-too-long
+    # fmt: off
+    @T.prim_func
+    def tir_kv_cache_transpose_append_quantized(
+        var_pages: T.handle,
+        var_page_scales: T.handle,
+        var_k_data: T.handle,
+        var_v_data: T.handle,
+        var_position_map: T.handle,
+    ):
+        T.func_attr({"tir.noalias": T.bool(True)})
+        ntoken = T.SizeVar("num_tokens_excluding_cache", "int64")
+        num_pages = T.int64()
+        pages_elem_offset = T.int64()
+        position_map_elem_offset = T.int32()
+        pages = T.match_buffer(var_pages, (num_pages, 2, num_key_value_heads, page_size, head_dim), page_dtype, elem_offset=pages_elem_offset)
+        page_scales = T.match_buffer(var_page_scales, (num_pages, 2, num_key_value_heads), "float32")
+        k_data = T.match_buffer(var_k_data, (ntoken, num_key_value_heads, head_dim), dtype)
+        v_data = T.match_buffer(var_v_data, (ntoken, num_key_value_heads, head_dim), dtype)
+        position_map = T.match_buffer(
+            var_position_map, (ntoken,), "int32", elem_offset=position_map_elem_offset
+        )
+        # The tokens are appended in order, since a later token may rescale the page of an earlier one.
+        with T.block("quantize_append"):
+            max_abs = T.alloc_buffer((1,), "float32")
+            scale = T.alloc_buffer((1,), "float32")
+            for global_pos, kv, h in T.grid(ntoken, 2, num_key_value_heads):
+                if position_map[global_pos] != T.int32(-1):
+                    position: T.int32 = position_map[global_pos]  # type: ignore
+                    page_no: T.int32 = T.floordiv(position, page_size)  # type: ignore
+                    page_offset: T.int32 = T.floormod(position, page_size)  # type: ignore
+                    max_abs[0] = T.float32(0)
+                    for f in T.serial(head_dim):
+                        max_abs[0] = T.max(max_abs[0], T.abs(T.if_then_else(kv == 0, k_data[global_pos, h, f], v_data[global_pos, h, f]).astype("float32")))
+                    # The scale of a page being written from its first slot is stale.
+                    prev_scale: T.float32 = T.if_then_else(page_offset == 0, T.float32(0), page_scales[page_no, kv, h])  # type: ignore
+                    scale[0] = T.max(prev_scale, max_abs[0] / quant_max)
+                    if scale[0] > prev_scale:
+                        for row, f in T.grid(page_offset, head_dim):
+                            pages[page_no, kv, h, row, f] = _quantize_page_value(pages[page_no, kv, h, row, f].astype("float32") * (prev_scale / scale[0]), page_dtype)
+                    page_scales[page_no, kv, h] = scale[0]
+                    for f in T.serial(head_dim):
+                        pages[page_no, kv, h, page_offset, f] = _quantize_page_value(
+                            T.if_then_else(scale[0] > 0, T.if_then_else(kv == 0, k_data[global_pos, h, f], v_data[global_pos, h, f]).astype("float32") / scale[0], T.float32(0)),
+                            page_dtype,
+                        )
+    # fmt: on
+    # pylint: enable=line-too-long
+
+    return tir_kv_cache_transpose_append_quantized
+
+
 def _kv_cache_transpose_append_mla(d_qk: int, dtype, page_size: int = 16):
     """Return the TIR function that appends new compressed KV data to PagedKVCache for MLA."""
 
@@ -780,6 +866,50 @@ def _kv_cache_debug_get_kv(num_hidden_layers, num_key_value_heads, head_dim, dty
     return tir_kv_cache_debug_get_kv
 
 
+def _kv_cache_debug_get_kv_quantized(
+    num_hidden_layers, num_key_value_heads, head_dim, dtype, page_dtype
+):
+    """Return the TIR function that fetches and dequantizes the k/v data on given positions and
+    layer."""
+
+    # pylint: disable=line-too-long
+    # fmt: off
+    @T.prim_func
+    def tir_kv_cache_debug_get_kv_quantized(
+        var_pages: T.handle,
+        var_page_scales: T.handle,
+        var_position_map: T.handle,
+        var_k_data: T.handle,
+        var_v_data: T.handle,
+        layer_id: T.int64,
+    ):
+        T.func_attr({"tir.noalias": T.bool(True)})
+        seqlen = T.SizeVar("num_tokens_including_cache", "int64")
+        page_size = T.SizeVar("page_size", "int64")
+        num_pages = T.int64()
+        pages_elem_offset = T.int64()
+        position_map_elem_offset = T.int64()
+        pages = T.match_buffer(var_pages, (num_pages, 2, num_key_value_heads, page_size, head_dim), page_dtype, elem_offset=pages_elem_offset)
+        page_scales = T.match_buffer(var_page_scales, (num_pages, 2, num_key_value_heads), "float32")
+        position_map = T.match_buffer(
+            var_position_map, (seqlen,), "int32", elem_offset=position_map_elem_offset
+        )
+        k_data = T.match_buffer(var_k_data, (num_hidden_layers, seqlen, num_key_value_heads, head_dim), dtype)
+        v_data = T.match_buffer(var_v_data, (num_hidden_layers, seqlen, num_key_value_heads, head_dim), dtype)
+        for p, h, d in T.grid(seqlen, num_key_value_heads, head_dim):
+            with T.block("copy0"):
+                vp, vh, vd = T.axis.remap("SSS", [p, h, d])
+                T.reads(position_map[vp], pages[position_map[vp] // page_size, 0:2, vh, position_map[vp] % page_size, vd], page_scales[position_map[vp] // page_size, 0:2, vh])
+                T.writes(k_data[layer_id, vp, vh, vd], v_data[layer_id, vp, vh, vd])
+                position: T.int32 = position_map[vp] # type: ignore[name-defined]
+                k_data[layer_id, vp, vh, vd] = (pages[T.floordiv(position, page_size), 0, vh, T.floormod(position, page_size), vd].astype("float32") * page_scales[T.floordiv(position, page_size), 0, vh]).astype(dtype)
+                v_data[layer_id, vp, vh, vd] = (pages[T.floordiv(position, page_size), 1, vh, T.floormod(position, page_size), vd].astype("float32") * page_scales[T.floordiv(position, page_size), 1, vh]).astype(dtype)
+    # fmt: on
+    # pylint: enable=line-too-long
+
+    return tir_kv_cache_debug_get_kv_quantized
+
+
 def _kv_cache_debug_get_kv_mla(num_hidden_layers, d_qk, dtype):
     """Return the TIR function that fetches the k/v data on given positions and layer."""
 
@@ -885,14 +1015,58 @@ def _get_seq_offset(pos, seq_id, length_info, sliding_window):
     )
 
 
+def _page_quant_max(page_dtype: str) -> float:
+    """The largest magnitude of a quantized KV cache page dtype."""
+    return 127.0 if page_dtype == "int8" else 448.0
+
+
+def _quantize_page_value(value: tir.PrimExpr, page_dtype: str) -> tir.PrimExpr:
+    """Convert a float32 value within the range of a quantized KV cache page dtype to it."""
+    if page_dtype == "int8":
+        return T.Cast("int8", T.round(value))
+    return T.Cast(page_dtype, value)
+
+
+def _dequantize_page_value(
+    value: tir.PrimExpr,
+    page_scales: T.Buffer,
+    scale_indices: Tuple[tir.PrimExpr, ...],
+    page_dtype: Optional[str],
+) -> tir.PrimExpr:
+    """Dequantize a value loaded from the KV cache pages if they are quantized, where
+    `scale_indices` are the page, k/v and head indices of the value."""
+    if page_dtype is None:
+        return value
+    return value.astype("float32") * page_scales[scale_indices]
+
+
+def _remove_page_scales_param(func: tir.PrimFunc, page_dtype: Optional[str]) -> tir.PrimFunc:
+    """Remove the unused page scales parameter of an attention kernel when the KV cache pages are
+    not quantized, as the KV cache only passes the page scales of quantized pages."""
+    if page_dtype is not None:
+        return func
+    params = [param for param in func.params if param.name != "var_page_scales"]
+    buffer_map = {param: func.buffer_map[param] for param in params if param in func.buffer_map}
+    return tir.PrimFunc(params, func.body, func.ret_type, buffer_map, func.attrs)
+
+
 def _attention_prefill_cpu(
-    h_kv, h_q, d, dtype, sliding_window: bool, rope_scaling: Dict[str, Any], page_size: int = 16
+    h_kv,
+    h_q,
+    d,
+    dtype,
+    sliding_window: bool,
+    rope_scaling: Dict[str, Any],
+    page_size: int = 16,
+    page_dtype: Optional[str] = None,
 ):
     global_symbol = "batch_prefill_paged_kv_cpu"
     if sliding_window:
         global_symbol += "_sliding_window"
 
     group_size = h_q // h_kv
+    # Quantized K is dequantized after RoPE, which is linear, so RoPE is computed in float32.
+    k_rope_dtype = dtype if page_dtype is None else "float32"
     # pylint: disable=line-too-long,too-many-branches
     # fmt: off
     @T.prim_func
@@ -900,6 +1074,7 @@ def _attention_prefill_cpu(
         var_q: T.handle, # [total_len, h_q, d]
         var_q_indptr: T.handle, # [batch_size + 1]
         var_pages: T.handle, # [max_num_pages, 2, h_kv, page_size, d]
+        var_page_scales: T.handle, # [max_num_pages, 2, h_kv], only when the pages are quantized
         var_page_indptr: T.handle, # [batch_size + 1]
         var_page_values: T.handle, # [nnz_pages]
         var_length_info: T.handle, # [b] when sliding window = False, or otherwise [3, b]
@@ -927,7 +1102,8 @@ def _attention_prefill_cpu(
 
         q = T.match_buffer(var_q, (total_len, h_q, d), dtype)
         q_indptr = T.match_buffer(var_q_indptr, (batch_size + 1,), "int32", elem_offset=q_indptr_elem_offset)
-        pages = T.match_buffer(var_pages, (max_num_pages, 2, h_kv, page_size, d), dtype)
+        pages = T.match_buffer(var_pages, (max_num_pages, 2, h_kv, page_size, d), page_dtype or dtype)
+        page_scales = T.match_buffer(var_page_scales, (max_num_pages, 2, h_kv), "float32")
         page_indptr = T.match_buffer(var_page_indptr, (batch_size + 1,), "int32", elem_offset=page_indptr_elem_offset)
         page_values = T.match_buffer(var_page_values, (nnz_pages,), "int32", elem_offset=page_values_elem_offset)
         k_rope_pos_offset = T.match_buffer(var_k_rope_pos_offset, (batch_size,), "int32", elem_offset=k_rope_pos_offset_elem_offset)
@@ -997,10 +1173,10 @@ def _attention_prefill_cpu(
                                 for d_idx in T.serial(d):
                                     K_local[d_idx] = T.if_then_else(
                                         rotary_mode == 1,
-                                        _rope(pages, k_rope_pos_offset[b_idx] + row_idx, d, rope_theta, rope_scale, (page_no, 0, h_qo // group_size, page_offset, d_idx), dtype, rope_scaling),
-                                        pages[page_no, 0, h_qo // group_size, page_offset, d_idx]
+                                        _dequantize_page_value(_rope(pages, k_rope_pos_offset[b_idx] + row_idx, d, rope_theta, rope_scale, (page_no, 0, h_qo // group_size, page_offset, d_idx), k_rope_dtype, rope_scaling), page_scales, (page_no, 0, h_qo // group_size), page_dtype),
+                                        _dequantize_page_value(pages[page_no, 0, h_qo // group_size, page_offset, d_idx], page_scales, (page_no, 0, h_qo // group_size), page_dtype)
                                     )
-                                    V_local[d_idx] = pages[page_no, 1, h_qo // group_size, page_offset, d_idx]
+                                    V_local[d_idx] = _dequantize_page_value(pages[page_no, 1, h_qo // group_size, page_offset, d_idx], page_scales, (page_no, 1, h_qo // group_size), page_dtype)
 
                                 # Compute S
                                 # Q[i] * K[i] * sm_scale
@@ -1037,7 +1213,7 @@ def _attention_prefill_cpu(
                             O_local[d_idx] = O_local[d_idx] /d_val[0]
                             output[curl_q, h_qo, d_idx] = O_local[d_idx]
                         lse[curl_q, h_qo] = m_val[0] + T.log2(d_val[0])
-    return batch_prefill_paged_kv_cpu
+    return _remove_page_scales_param(batch_prefill_paged_kv_cpu, page_dtype)
 
 
 def _get_prefill_kernel_config(h_kv, h_q, d, dtype, target: Target):
@@ -1494,11 +1670,13 @@ def _attention_decode_cpu(
     sliding_window: bool,
     rope_scaling: Dict[str, Any],
     page_size: int = 16,
+    page_dtype: Optional[str] = None,
 ):
     H_qo = num_qo_heads
     H_kv = num_kv_heads
     D = head_dim
     group_size = num_qo_heads // num_kv_heads
+    k_rope_dtype = qkv_dtype if page_dtype is None else "float32"
 
     global_symbol = "batch_decode_paged_kv_cpu"
     if sliding_window:
@@ -1510,6 +1688,7 @@ def _attention_decode_cpu(
     def batch_decode_paged_kv(
         Q_handle: T.handle,
         pages_handle: T.handle,
+        var_page_scales: T.handle,  # only when the pages are quantized
         page_table_indptr_handle: T.handle,
         page_table_values_handle: T.handle,
         var_length_info: T.handle,  # [b] when sliding window = False, or otherwise [3, b]
@@ -1533,7 +1712,8 @@ def _attention_decode_cpu(
         length_info_elem_offset = T.int32(is_size_var=True)
 
         Q = T.match_buffer(Q_handle, (B, H_qo, D), qkv_dtype)
-        pages = T.match_buffer(pages_handle, (max_num_pages, 2, H_kv, page_size, D), qkv_dtype)
+        pages = T.match_buffer(pages_handle, (max_num_pages, 2, H_kv, page_size, D), page_dtype or qkv_dtype)
+        page_scales = T.match_buffer(var_page_scales, (max_num_pages, 2, H_kv), "float32")
         page_table_indptr = T.match_buffer(
             page_table_indptr_handle, (B + 1,), "int32", elem_offset=page_indptr_elem_offset
         )
@@ -1607,8 +1787,8 @@ def _attention_decode_cpu(
                         for d in T.serial(D):
                             K_local[d] = T.if_then_else(
                                 rotary_mode == 1,
-                                _rope(pages, k_rope_pos_offset[b] + row_idx, head_dim, rope_theta, rope_scale, (page_no, 0, h_qo // group_size, page_offset, d), qkv_dtype, rope_scaling),
-                                pages[page_no, 0, h_qo // group_size, page_offset, d],
+                                _dequantize_page_value(_rope(pages, k_rope_pos_offset[b] + row_idx, head_dim, rope_theta, rope_scale, (page_no, 0, h_qo // group_size, page_offset, d), k_rope_dtype, rope_scaling), page_scales, (page_no, 0, h_qo // group_size), page_dtype),
+                                _dequantize_page_value(pages[page_no, 0, h_qo // group_size, page_offset, d], page_scales, (page_no, 0, h_qo // group_size), page_dtype),
                             )
                         S_val[0] = 0.0
                         for d in T.serial(D):
@@ -1627,7 +1807,7 @@ def _attention_decode_cpu(
 
                         m_val[0] = new_m[0]
                         for d in T.serial(D):
-                            V_local[d] = pages[page_no, 1, h_qo // group_size, page_offset, d]
+                            V_local[d] = _dequantize_page_value(pages[page_no, 1, h_qo // group_size, page_offset, d], page_scales, (page_no, 1, h_qo // group_size), page_dtype)
 
                         factor[0] = T.exp2(S_val[0] - m_val[0])
                         for d in T.serial(D):
@@ -1639,7 +1819,7 @@ def _attention_decode_cpu(
     # fmt: on
     # pylint: enable=line-too-long
 
-    return batch_decode_paged_kv
+    return _remove_page_scales_param(batch_decode_paged_kv, page_dtype)
 
 
 def _attention_decode(
@@ -3045,6 +3225,31 @@ def _copy_single_page_cpu(num_heads, page_size, head_dim, dtype):
     return copy_single_page_cpu
 
 
+def _copy_single_page_quantized_cpu(num_heads, page_size, head_dim, page_dtype):
+    @T.prim_func
+    def copy_single_page_quantized_cpu(
+        var_pages: T.handle,
+        var_page_scales: T.handle,
+        src_page_id: T.int64,
+        tgt_page_id: T.int64,
+        copy_length: T.int64,
+    ):
+        T.func_attr({"tir.is_scheduled": 1})
+        num_pages = T.int32()
+        pages = T.match_buffer(
+            var_pages, (num_pages, 2, num_heads, page_size, head_dim), page_dtype
+        )
+        page_scales = T.match_buffer(var_page_scales, (num_pages, 2, num_heads), "float32")
+
+        with T.block("root"):
+            for kv, h in T.grid(2, num_heads):
+                page_scales[tgt_page_id, kv, h] = page_scales[src_page_id, kv, h]
+                for p, d in T.grid(copy_length, head_dim):
+                    pages[tgt_page_id, kv, h, p, d] = pages[src_page_id, kv, h, p, d]
+
+    return copy_single_page_quantized_cpu
+
+
 def _compact_kv_copy(num_heads, head_dim, dtype, target: Target, page_size: int = 16):
     tx = get_max_num_threads_per_block(target)
 
@@ -3149,3 +3354,66 @@ def _compact_kv_copy_cpu(num_heads, head_dim, dtype, page_size: int = 16):
                             ]
 
     return compact_kv_copy_cpu
+
+
+def _compact_kv_copy_quantized_cpu(num_heads, head_dim, page_dtype, page_size: int = 16):
+    @T.prim_func
+    def compact_kv_copy_quantized_cpu(
+        var_pages: T.handle,
+        var_page_scales: T.handle,
+        var_copy_length_indptr: T.handle,
+        var_copy_src_dst_pos: T.handle,
+        batch_size: T.int32,
+    ):
+        T.func_attr({"tir.is_scheduled": 1})
+        num_pages = T.int32()
+        total_copy_length = T.int32()
+        copy_length_indptr_elem_offset = T.int32()
+        copy_src_dst_pos_elem_offset = T.int32()
+        pages = T.match_buffer(
+            var_pages, (num_pages, 2, num_heads, page_size, head_dim), page_dtype
+        )
+        page_scales = T.match_buffer(var_page_scales, (num_pages, 2, num_heads), "float32")
+        copy_length_indptr = T.match_buffer(
+            var_copy_length_indptr,
+            (batch_size + 1,),
+            "int32",
+            elem_offset=copy_length_indptr_elem_offset,
+        )
+        copy_src_dst_pos = T.match_buffer(
+            var_copy_src_dst_pos,
+            (2, total_copy_length),
+            "int32",
+            elem_offset=copy_src_dst_pos_elem_offset,
+        )
+
+        with T.block("root"):
+            for b, kv, h in T.grid(batch_size, 2, num_heads):
+                for i in T.serial(copy_length_indptr[b + 1] - copy_length_indptr[b]):
+                    src_pos: T.int32 = copy_src_dst_pos[0, copy_length_indptr[b] + i]
+                    dst_pos: T.int32 = copy_src_dst_pos[1, copy_length_indptr[b] + i]
+                    src_scale: T.float32 = page_scales[src_pos // page_size, kv, h]
+                    dst_scale: T.float32 = page_scales[dst_pos // page_size, kv, h]
+                    scale: T.float32 = T.max(src_scale, dst_scale)
+                    if scale > dst_scale:
+                        # Rescale the whole destination page, as its later slots may be copied
+                        # from afterwards.
+                        for row, d in T.grid(page_size, head_dim):
+                            pages[dst_pos // page_size, kv, h, row, d] = _quantize_page_value(
+                                pages[dst_pos // page_size, kv, h, row, d].astype("float32")
+                                * (dst_scale / scale),
+                                page_dtype,
+                            )
+                        page_scales[dst_pos // page_size, kv, h] = scale
+                    for d in T.serial(head_dim):
+                        pages[dst_pos // page_size, kv, h, dst_pos % page_size, d] = (
+                            _quantize_page_value(
+                                pages[src_pos // page_size, kv, h, src_pos % page_size, d].astype(
+                                    "float32"
+                                )
+                                * T.if_then_else(scale > 0, src_scale / scale, T.float32(0)),
+                                page_dtype,
+                            )
+                        )
+
+    return compact_kv_copy_quantized_cpu
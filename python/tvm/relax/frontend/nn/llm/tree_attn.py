@@ -19,7 +19,7 @@
 """Operators for tree attention."""
 
 import math
-from typing import Any, Dict, Tuple
+from typing import Any, Dict, Optional, Tuple
 
 from tvm import tir
 from tvm.runtime import DataType
@@ -652,7 +652,9 @@ def tree_attn(
     return sch.mod["main"].with_attr("tir.is_scheduled", 1)
 
 
-def tree_attn_with_paged_kv_cache_cpu(h_kv, h_q, d, dtype, rope_scaling: Dict[str, Any]):
+def tree_attn_with_paged_kv_cache_cpu(
+    h_kv, h_q, d, dtype, rope_scaling: Dict[str, Any], page_dtype: Optional[str] = None
+):
     """Generate tree attention kernel for batched tree attention with paged key-value cache.
 
     Parameters
@@ -665,8 +667,10 @@ def tree_attn_with_paged_kv_cache_cpu(h_kv, h_q, d, dtype, rope_scaling: Dict[st
         Hidden dimension.
     dtype : str
         Data type.
-    target : Target
-        The target device.
+    rope_scaling : Dict[str, Any]
+        The RoPE scaling config.
+    page_dtype : Optional[str]
+        The dtype of quantized KV cache pages, or None if the pages are not quantized.
 
     Returns
     -------
@@ -674,11 +678,18 @@ def tree_attn_with_paged_kv_cache_cpu(h_kv, h_q, d, dtype, rope_scaling: Dict[st
         The generated IR module.
     """
     # pylint: disable=import-outside-toplevel
-    from .kv_cache import _declare_length_info, _get_kv_chunk_len, _get_seq_offset
+    from .kv_cache import (
+        _declare_length_info,
+        _dequantize_page_value,
+        _get_kv_chunk_len,
+        _get_seq_offset,
+        _remove_page_scales_param,
+    )
 
     global_symbol = "tree_attn_paged_kv_cpu"
     sliding_window = False
     group_size = h_q // h_kv
+    k_rope_dtype = dtype if page_dtype is None else "float32"
     # pylint: disable=line-too-long,too-many-branches
     # fmt: off
     @T.prim_func(check_well_formed=False)
@@ -686,6 +697,7 @@ def tree_attn_with_paged_kv_cache_cpu(h_kv, h_q, d, dtype, rope_scaling: Dict[st
         var_q: T.handle, # [total_len, h_q, d]
         var_q_indptr: T.handle, # [batch_size + 1]
         var_pages: T.handle, # [max_num_pages, 2, h_kv, page_size, d]
+        var_page_scales: T.handle, # [max_num_pages, 2, h_kv], only when the pages are quantized
         var_page_indptr: T.handle, # [batch_size + 1]
         var_page_values: T.handle, # [nnz_pages]
         var_length_info: T.handle, # [b] when sliding window = False, or otherwise [3, b]
@@ -716,7 +728,8 @@ def tree_attn_with_paged_kv_cache_cpu(h_kv, h_q, d, dtype, rope_scaling: Dict[st
 
         q = T.match_buffer(var_q, (total_len, h_q, d), dtype)
         q_indptr = T.match_buffer(var_q_indptr, (batch_size + 1,), "int32", elem_offset=q_indptr_elem_offset)
-        pages = T.match_buffer(var_pages, (max_num_pages, 2, h_kv, 16, d), dtype)
+        pages = T.match_buffer(var_pages, (max_num_pages, 2, h_kv, 16, d), page_dtype or dtype)
+        page_scales = T.match_buffer(var_page_scales, (max_num_pages, 2, h_kv), "float32")
         page_indptr = T.match_buffer(var_page_indptr, (batch_size + 1,), "int32", elem_offset=page_indptr_elem_offset)
         page_values = T.match_buffer(var_page_values, (nnz_pages,), "int32", elem_offset=page_values_elem_offset)
         k_rope_pos_offset = T.match_buffer(var_k_rope_pos_offset, (batch_size,), "int32", elem_offset=k_rope_pos_offset_elem_offset)
@@ -800,10 +813,10 @@ def tree_attn_with_paged_kv_cache_cpu(h_kv, h_q, d, dtype, rope_scaling: Dict[st
                                 for d_idx in T.serial(d):
                                     K_local[d_idx] = T.if_then_else(
                                         rotary_mode == 1,
-                                        _rope(pages, k_rope_pos_offset[b_idx] + row_idx, d, rope_theta, rope_scale, (page_no, 0, h_qo // group_size, page_offset, d_idx), dtype, rope_scaling),
-                                        pages[page_no, 0, h_qo // group_size, page_offset, d_idx]
+                                        _dequantize_page_value(_rope(pages, k_rope_pos_offset[b_idx] + row_idx, d, rope_theta, rope_scale, (page_no, 0, h_qo // group_size, page_offset, d_idx), k_rope_dtype, rope_scaling), page_scales, (page_no, 0, h_qo // group_size), page_dtype),
+                                        _dequantize_page_value(pages[page_no, 0, h_qo // group_size, page_offset, d_idx], page_scales, (page_no, 0, h_qo // group_size), page_dtype)
                                     )
-                                    V_local[d_idx] = pages[page_no, 1, h_qo // group_size, page_offset, d_idx]
+                                    V_local[d_idx] = _dequantize_page_value(pages[page_no, 1, h_qo // group_size, page_offset, d_idx], page_scales, (page_no, 1, h_qo // group_size), page_dtype)
 
                                 # Compute S
                                 S_val[0] = 0.0
@@ -843,7 +856,7 @@ def tree_attn_with_paged_kv_cache_cpu(h_kv, h_q, d, dtype, rope_scaling: Dict[st
                             O_local[d_idx] = O_local[d_idx] /d_val[0]
                             output[curl_q, h_qo, d_idx] = O_local[d_idx]
                         lse[curl_q, h_qo] = m_val[0] + T.log2(d_val[0])
-    return tree_attn_paged_kv_cpu
+    return _remove_page_scales_param(tree_attn_paged_kv_cpu, page_dtype)
 
 
 def tree_attn_with_paged_kv_cache(
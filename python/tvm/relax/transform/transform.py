@@ -531,6 +531,20 @@ def StaticPlanBlockMemory() -> tvm.ir.transform.Pass:
     signature will have upper bound 1024. And we will use 1024 as its value
     during memory planning.
 
+    A tensor whose size is still symbolic after applying the upper bounds
+    reuses a storage of a different symbolic size when the size of the storage
+    is provably no less than its own. Annotating the non-negative TIR vars of
+    the function signature, as in
+    :code:`R.func_attr({"tir_non_negative_var": ["n"]})`, helps with such proofs.
+
+    By default, the pass reuses whole storages of the same dtype. With the pass
+    config option :code:`"relax.StaticPlanBlockMemory.planner"` set to
+    :code:`"arena"`, the constant-size tensors of each binding block are instead
+    packed by their lifetimes into a single storage at byte offsets, regardless
+    of their dtypes. The runtime folds these offsets into the data pointers on
+    CPU, CUDA, ROCm and Hexagon. Kernels on other devices reject tensors with a
+    byte offset, so the arena planner is only for those devices.
+
     Returns
     -------
     ret : tvm.ir.transform.Pass
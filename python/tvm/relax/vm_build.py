@@ -64,7 +64,7 @@ def _vmcodegen(
     mod: IRModule
         The input IRModule to be built.
 
-    exec_mode: {"bytecode", "compiled"}
+    exec_mode: {"bytecode", "compiled", "compiled_direct_tensors"}
         The execution mode.
 
     Return
@@ -76,7 +76,9 @@ def _vmcodegen(
     if exec_mode == "bytecode":
         return _ffi_api.VMCodeGen(builder, mod)  # type:ignore
     if exec_mode == "compiled":
-        return _ffi_api.VMTIRCodeGen(builder, mod)  # type: ignore
+        return _ffi_api.VMTIRCodeGen(builder, mod, False)  # type: ignore
+    if exec_mode == "compiled_direct_tensors":
+        return _ffi_api.VMTIRCodeGen(builder, mod, True)  # type: ignore
     raise ValueError(f"Unknown exec_mode {exec_mode}")
 
 
@@ -203,8 +205,11 @@ def build(
     tir_pipelinie : str = "default"
         The TIR compilation pipeline to use.
 
-    exec_mode: {"bytecode", "compiled"}
-        The execution mode.
+    exec_mode: {"bytecode", "compiled", "compiled_direct_tensors"}
+        The execution mode. "compiled" lowers each Relax function into a host TIR function.
+        "compiled_direct_tensors" does so too, and reads the tensor arguments of the calls to
+        the PrimFuncs of the module straight from the registers rather than through the runtime
+        API of the register list. The calls still go through the packed calling convention.
 
     system_lib: Optional[bool]
         Whether to build system lib that is being packed statically and
@@ -72,6 +72,57 @@ class RPCSession(object):
         """
         return self._sess.get_function(name)
 
+    def submit(self, name, *args):
+        """Send a call to a function of the session without waiting for it to return.
+
+        Many calls can be in flight over the session at the same time, which hides the
+        round trip latency of each of them. The calls are run by the remote in order.
+
+        Parameters
+        ----------
+        name : str
+            The name of the function.
+
+        args : list
+            The arguments of the call.
+
+        Returns
+        -------
+        wait : Function
+            A function that waits for the call and returns its return value, or raises its
+            error.
+
+        Examples
+        --------
+        .. code-block:: python
+
+            waits = [remote.submit("tvm.rpc.server.upload", path, blob) for path, blob in files]
+            for wait in waits:
+                wait()
+        """
+        return _ffi_api.SubmitRemoteCall(self._sess, name, *args)
+
+    def set_transfer_options(self, compression="none", dedup=False):
+        """Set how the tensors are copied to and from the remote.
+
+        The options are only used when the server supports them, otherwise the raw bytes
+        are sent like before.
+
+        Parameters
+        ----------
+        compression : str
+            The codec that the copies are compressed with, "none" or "lz4". The blocks
+            that do not get smaller are sent uncompressed.
+
+        dedup : bool
+            Whether to skip sending the blocks of tensors that the server has already
+            received in this session, e.g. when the same parameters are uploaded again.
+            The server keeps the received blocks in a cache, whose size is set by the
+            TVM_RPC_TRANSFER_CACHE_BYTES environment variable of the server, 256MB by
+            default.
+        """
+        _ffi_api.SetTransferOptions(self._sess, compression, dedup)
+
     def device(self, dev_type, dev_id=0):
         """Construct a remote device.
 
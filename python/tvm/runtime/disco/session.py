@@ -319,11 +319,12 @@ class Session(Object):
             - nccl
             - rccl
             - mpi
+            - shm, which communicates through shared memory between CPU workers on one host
 
         *device_ids : int
             The device IDs to be used by the underlying communication library.
         """
-        assert ccl in ("nccl", "rccl"), f"Unsupported CCL backend: {ccl}"
+        assert ccl in ("nccl", "rccl", "shm"), f"Unsupported CCL backend: {ccl}"
         _ffi_api.SessionInitCCL(self, ccl, ShapeTuple(device_ids))  # type: ignore # pylint: disable=no-member
         self._clear_ipc_memory_pool()
 
@@ -537,10 +538,31 @@ class ThreadedSession(Session):
 
 @register_object("runtime.disco.ProcessSession")
 class ProcessSession(Session):
-    """A Disco session backed by pipe-based multi-processing."""
+    """A Disco session backed by pipe-based multi-processing.
+
+    Parameters
+    ----------
+    num_workers : int
+        The number of workers.
+
+    num_groups : int
+        The number of worker groups.
+
+    entrypoint : str
+        The module run by each worker process.
+
+    channel : str
+        How the controller sends messages to the workers: "pipe" to use the pipes to the worker
+        processes, or "shm" to use ring buffers in shared memory instead, which avoids the system
+        calls of the pipes on the critical path of each step.
+    """
 
     def __init__(
-        self, num_workers: int, num_groups: int = 1, entrypoint: str = "tvm.exec.disco_worker"
+        self,
+        num_workers: int,
+        num_groups: int = 1,
+        entrypoint: str = "tvm.exec.disco_worker",
+        channel: str = "pipe",
     ) -> None:
         self.__init_handle_by_constructor__(
             _ffi_api.SessionProcess,  # type: ignore # pylint: disable=no-member
@@ -548,6 +570,7 @@ class ProcessSession(Session):
             num_groups,
             "runtime.disco.create_process_pool",
             entrypoint,
+            channel,
         )
         self._configure_structlog()
 
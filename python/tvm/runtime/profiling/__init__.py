@@ -270,6 +270,67 @@ def profile_function(mod, dev, collectors, func_name=None, warmup_iters=10):
     )
 
 
+def start_trace():
+    """Start recording a timeline of the runtime, discarding the events recorded before.
+
+    The timeline has the calls of the Relax VM, the tasks of the thread pool, the device
+    allocations and copies, and the Disco messages, on the threads they run on.
+
+    Example
+    -------
+
+    .. code-block: python
+
+        tvm.runtime.profiling.start_trace()
+        vm["main"](*args)
+        tvm.runtime.profiling.stop_trace()
+        tvm.runtime.profiling.write_trace("trace.json")
+    """
+    _ffi_api.StartTrace()
+
+
+def stop_trace():
+    """Stop recording the timeline. The recorded events are kept until the next start."""
+    _ffi_api.StopTrace()
+
+
+def write_trace(path: str):
+    """Write the timeline recorded since the last start as a Chrome trace, which can be opened
+    in Perfetto or chrome://tracing. It can be called while recording.
+
+    Only the events of the current process are written. The Disco workers in other processes
+    write their own traces, which can be loaded together since the events are tagged by the
+    process IDs.
+
+    Parameters
+    ----------
+    path: str
+        The path of the JSON file to write.
+    """
+    _ffi_api.WriteTrace(path)
+
+
+@_ffi.register_object("runtime.profiling.PerfEventMetricCollector")
+class PerfEventMetricCollector(MetricCollector):
+    """Collects the hardware performance counters of the CPU with the Linux perf_event
+    interface, without depending on PAPI. The counts are summed over all the threads of the
+    process, including the workers of the thread pool.
+    """
+
+    def __init__(self, metrics: Optional[Sequence[str]] = None):
+        """
+        Parameters
+        ----------
+        metrics : Optional[Sequence[str]]
+            The events to count, named as in `perf list`, e.g. "cycles", "instructions",
+            "LLC-load-misses", "branch-misses" or "task-clock". By default the cycles,
+            instructions, LLC load misses and branch misses are counted, and the report table
+            shows the instructions per cycle.
+        """
+        metrics = [] if metrics is None else list(metrics)
+        self.__init_handle_by_constructor__(_ffi_api.PerfEventMetricCollector, metrics)
+
+
 # We only enable this class when TVM is build with PAPI support
 if _ffi.get_global_func("runtime.profiling.PAPIMetricCollector", allow_missing=True) is not None:
 
@@ -40,6 +40,23 @@ def build_module(mod, target):
     return _ffi_api.Build(mod, target)
 
 
+def compile_cache_stats():
+    """Get the statistics of the compile cache, which is enabled by the pass config option
+    "target.compile_cache_dir".
+
+    Returns
+    -------
+    stats : Dict[str, int]
+        The number of "hits" and "misses" of the cache in this process.
+    """
+    return {key: int(value) for key, value in _ffi_api.CompileCacheStats().items()}
+
+
+def reset_compile_cache_stats():
+    """Reset the statistics of the compile cache."""
+    _ffi_api.ResetCompileCacheStats()
+
+
 def target_has_features(cpu_features, target=None):
     """Check CPU features for the target's `-mtriple` and `-mcpu` and `-mattr`.
 
@@ -46,6 +46,7 @@ using tvm::runtime::TVMArgs;
 using tvm::runtime::TVMRetValue;
 
 TVM_REGISTER_PASS_CONFIG_OPTION("testing.immutable_module", Bool);
+TVM_REGISTER_PASS_CONFIG_OPTION("ir.enable_structural_hash_cache", Bool);
 
 struct PassContextThreadLocalEntry {
   /*! \brief The default pass context. */
@@ -305,6 +306,18 @@ IRModule Pass::operator()(IRModule mod, const PassContext& pass_ctx) const {
                << " with opt level: " << pass_info->opt_level;
     return mod;
   }
+  // The structural hash cache keeps the hashed functions alive until its scope exits, so the scope
+  // is a single pass.
+  struct HashCacheScope {
+    explicit HashCacheScope(bool enabled) : enabled(enabled) {
+      if (enabled) StructuralHashCache::EnterScope();
+    }
+    ~HashCacheScope() {
+      if (enabled) StructuralHashCache::ExitScope();
+    }
+    bool enabled;
+  } hash_cache_scope(
+      pass_ctx->GetConfig<Bool>("ir.enable_structural_hash_cache", Bool(false)).value());
   IRModule ret;
   if (pass_ctx->GetConfig<Bool>("testing.immutable_module", Bool(false)).value()) {
     ret = Pass::AssertImmutableModule(mod, node, pass_ctx);
@@ -317,11 +330,12 @@ IRModule Pass::operator()(IRModule mod, const PassContext& pass_ctx) const {
 
 IRModule Pass::AssertImmutableModule(const IRModule& mod, const PassNode* node,
                                      const PassContext& pass_ctx) {
-  size_t before_pass_hash = tvm::StructuralHash()(mod);
+  // Hash without the structural hash cache, which can't tell that a function is mutated in place.
+  size_t before_pass_hash = SHashHandlerDefault().Hash(mod, false);
   ObjectPtr<Object> module_ptr = ObjectRef::GetDataPtr<Object>(mod);
   IRModule copy_mod = IRModule(module_ptr);
   IRModule ret = node->operator()(mod, pass_ctx);
-  size_t after_pass_hash = tvm::StructuralHash()(copy_mod);
+  size_t after_pass_hash = SHashHandlerDefault().Hash(copy_mod, false);
   if (before_pass_hash != after_pass_hash) {
     // The chance of getting a hash conflict between a module and the same module but mutated
     // must be very low.
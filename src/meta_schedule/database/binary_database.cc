@@ -0,0 +1,601 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../../runtime/file_utils.h"
+#include "../module_equality.h"
+#include "../utils.h"
+
+namespace tvm {
+namespace meta_schedule {
+
+/*!
+ * \brief The layout of a binary database file, in native byte order:
+ *
+ *   BinaryDatabaseHeader
+ *   BinaryDatabaseWorkload[num_workloads], sorted by the structural hash
+ *   BinaryDatabaseRecord[num_records], grouped by workload, each group starting with the valid
+ *     records sorted by mean run time
+ *   The JSON strings of the module equality name, the workloads and the tuning records
+ *
+ * The JSON strings are the lines of the JSON database, so the file opens without parsing
+ * anything, and only the workloads and records being queried are deserialized.
+ */
+struct BinaryDatabaseHeader {
+  /*! \brief The magic number, "TVMMSDB1" */
+  uint64_t magic;
+  /*! \brief The number of workloads */
+  uint64_t num_workloads;
+  /*! \brief The number of tuning records */
+  uint64_t num_records;
+  /*! \brief The offset of the name of the module equality */
+  uint64_t mod_eq_offset;
+  /*! \brief The length of the name of the module equality */
+  uint64_t mod_eq_nbytes;
+};
+
+/*! \brief An entry of the workload table in the binary database file. */
+struct BinaryDatabaseWorkload {
+  /*! \brief The structural hash of the workload */
+  uint64_t shash;
+  /*! \brief The offset of the JSON string of the workload */
+  uint64_t offset;
+  /*! \brief The length of the JSON string of the workload */
+  uint64_t nbytes;
+  /*! \brief The first record of the workload in the record table */
+  uint64_t record_begin;
+  /*! \brief The number of valid records of the workload */
+  uint64_t num_valid;
+  /*! \brief The end of the records of the workload in the record table */
+  uint64_t record_end;
+};
+
+/*! \brief An entry of the record table in the binary database file. */
+struct BinaryDatabaseRecord {
+  /*! \brief The offset of the JSON string of the tuning record */
+  uint64_t offset;
+  /*! \brief The length of the JSON string of the tuning record */
+  uint64_t nbytes;
+  /*! \brief The mean run time of the tuning record */
+  double mean_run_secs;
+};
+
+static_assert(std::is_trivially_copyable_v<BinaryDatabaseHeader> &&
+                  std::is_trivially_copyable_v<BinaryDatabaseWorkload> &&
+                  std::is_trivially_copyable_v<BinaryDatabaseRecord>,
+              "The entries of the binary database are copied as raw bytes");
+
+constexpr uint64_t kBinaryDatabaseMagic = 0x314244534D4D5654;  // "TVMMSDB1" in little endian
+
+/*!
+ * \brief A database backed by a binary file, which is mapped into memory and queried without
+ * loading it.
+ *
+ * Committed workloads and records are kept in memory, and appended to a log next to the file,
+ * "<path>.log", so that they survive the database. The log is replayed when the database is
+ * opened, and merged into the binary file, i.e. compacted, by `Save` or once it holds
+ * kMaxLogRecords records. A line of the log is either [workload], which gives the workload the
+ * next id of the log, or [workload id, tuning record].
+ */
+class BinaryDatabaseNode : public DatabaseNode {
+ public:
+  using THashCode = WorkloadNode::THashCode;
+
+  /*! \brief The number of records in the log that triggers a compaction. */
+  static constexpr int64_t kMaxLogRecords = 4096;
+
+  explicit BinaryDatabaseNode(String mod_eq_name = "structural")
+      : DatabaseNode(mod_eq_name), module_equality(mod_eq_name) {}
+
+  /*! \brief The path to the binary database file */
+  String path;
+  /*! \brief The name of the module equality, which the stored hashes depend on */
+  String module_equality;
+
+  void VisitAttrs(tvm::AttrVisitor* v) {
+    v->Visit("path", &path);
+    v->Visit("module_equality", &module_equality);
+    // `file_` is not visited
+    // `workloads_` is not visited
+    // `committed_` is not visited
+    // `log_` is not visited
+  }
+
+  static constexpr const char* _type_key = "meta_schedule.BinaryDatabase";
+  TVM_DECLARE_FINAL_OBJECT_INFO(BinaryDatabaseNode, DatabaseNode);
+
+ public:
+  /*! \brief Map the file into memory and check its header. */
+  void Open(const std::string& file_path) {
+    file_ = runtime::MappedFile::Open(file_path);
+    const runtime::MappedFileObj* file = file_.value().get();
+    CHECK_GE(file->size(), sizeof(BinaryDatabaseHeader))
+        << "ValueError: Not a binary database: " << file_path;
+    BinaryDatabaseHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    CHECK_EQ(header.magic, kBinaryDatabaseMagic)
+        << "ValueError: Not a binary database: " << file_path;
+    // Check every entry once, so that the lookups can trust the tables
+    uint64_t size = file->size() - sizeof(header);
+    CHECK(header.num_workloads <= size / sizeof(BinaryDatabaseWorkload) &&
+          header.num_records <= (size - header.num_workloads * sizeof(BinaryDatabaseWorkload)) /
+                                    sizeof(BinaryDatabaseRecord) &&
+          InFile(header.mod_eq_offset, header.mod_eq_nbytes, file->size()))
+        << "ValueError: The binary database is truncated: " << file_path;
+    std::string mod_eq_name(file->data() + header.mod_eq_offset, header.mod_eq_nbytes);
+    CHECK_EQ(mod_eq_name, std::string(module_equality))
+        << "ValueError: The binary database " << file_path << " is hashed with module equality \""
+        << mod_eq_name << "\", but the database is opened with \"" << module_equality << "\"";
+    data_ = file->data();
+    num_file_workloads_ = header.num_workloads;
+    num_file_records_ = header.num_records;
+    for (size_t i = 0; i < num_file_workloads_; ++i) {
+      BinaryDatabaseWorkload entry = GetWorkloadEntry(i);
+      CHECK(InFile(entry.offset, entry.nbytes, file->size()) &&
+            entry.record_begin <= entry.record_end && entry.record_end <= num_file_records_ &&
+            entry.num_valid <= entry.record_end - entry.record_begin)
+          << "ValueError: The binary database is corrupted, at workload " << i << ": " << file_path;
+    }
+    for (size_t i = 0; i < num_file_records_; ++i) {
+      BinaryDatabaseRecord entry = GetRecordEntry(i);
+      CHECK(InFile(entry.offset, entry.nbytes, file->size()))
+          << "ValueError: The binary database is corrupted, at record " << i << ": " << file_path;
+    }
+    workloads_.assign(num_file_workloads_, Workload{nullptr});
+    committed_.assign(num_file_workloads_, CommittedRecords());
+    log_ids_.assign(num_file_workloads_, -1);
+    num_committed_records_ = 0;
+  }
+
+  /*! \return The path to the log of the database. */
+  std::string LogPath() const { return std::string(path) + ".log"; }
+
+  /*! \brief Replay the log of the database, if any. The log is appended to from then on. */
+  void OpenLog() {
+    std::string log_path = LogPath();
+    std::ifstream is(log_path, std::ifstream::binary);
+    if (!is.good()) {
+      return;
+    }
+    std::string content((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+    is.close();
+    // The workload of each id of the log
+    std::vector<int64_t> indices;
+    size_t begin = 0;
+    for (size_t end; (end = content.find('\n', begin)) != std::string::npos; begin = end + 1) {
+      Array<ObjectRef> line = Downcast<Array<ObjectRef>>(
+          JSONLoads(std::string(content.data() + begin, end - begin)));
+      if (line.size() == 1) {
+        Workload workload = Workload::FromJSON(line[0]);
+        int64_t index = FindWorkload(workload->shash, workload->mod);
+        if (index < 0) {
+          index = AddWorkload(workload);
+        }
+        log_ids_[index] = indices.size();
+        indices.push_back(index);
+      } else {
+        CHECK_EQ(line.size(), 2) << "ValueError: Not a line of a binary database log: " << log_path;
+        int64_t id = Downcast<runtime::Int>(line[0]);
+        CHECK(0 <= id && id < static_cast<int64_t>(indices.size()))
+            << "ValueError: Unknown workload " << id << " in the log: " << log_path;
+        int64_t index = indices[id];
+        AddRecord(index, TuningRecord::FromJSON(line[1], LoadWorkload(index)));
+        ++num_log_records_;
+      }
+    }
+    if (begin != content.size()) {
+      // Drop the partial line of an interrupted append
+      LOG(WARNING) << "Dropping the incomplete last line of the log: " << log_path;
+      std::ofstream os(log_path, std::ofstream::binary | std::ofstream::trunc);
+      os.write(content.data(), begin);
+      CHECK(os.good()) << "ValueError: Cannot write to the file: " << log_path;
+    }
+    num_log_workloads_ = indices.size();
+  }
+
+  bool HasWorkload(const IRModule& mod) final {
+    THashCode shash = GetModuleEquality().Hash(mod);
+    std::lock_guard<std::mutex> lock(mutex_);
+    return FindWorkload(shash, mod) >= 0;
+  }
+
+  Workload CommitWorkload(const IRModule& mod) final {
+    THashCode shash = GetModuleEquality().Hash(mod);
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t index = FindWorkload(shash, mod);
+    if (index < 0) {
+      index = AddWorkload(Workload(mod, shash));
+      LogWorkload(index);
+    }
+    return workloads_[index];
+  }
+
+  void CommitTuningRecord(const TuningRecord& record) final {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Workload& workload = record->workload;
+    int64_t index = FindWorkload(workload->shash, workload->mod);
+    if (index < 0) {
+      index = AddWorkload(workload);
+    }
+    AddRecord(index, record);
+    if (!path.empty()) {
+      LogWorkload(index);
+      AppendLog(JSONDumps(Array<ObjectRef>{Integer(log_ids_[index]), record->AsJSON()}));
+      if (++num_log_records_ >= kMaxLogRecords) {
+        SaveLocked(path);
+      }
+    }
+  }
+
+  Array<TuningRecord> GetTopK(const Workload& workload, int top_k) final {
+    CHECK_GE(top_k, 0) << "ValueError: top_k must be non-negative";
+    if (top_k == 0) {
+      return {};
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t index = FindWorkload(workload->shash, workload->mod);
+    if (index < 0) {
+      return {};
+    }
+    // Merge the valid records in the file with the committed ones, both sorted by mean run time
+    uint64_t file_begin = 0, file_end = 0;
+    if (index < static_cast<int64_t>(num_file_workloads_)) {
+      BinaryDatabaseWorkload entry = GetWorkloadEntry(index);
+      file_begin = entry.record_begin;
+      file_end = entry.record_begin + entry.num_valid;
+    }
+    const auto& committed = committed_[index].valid;
+    auto committed_it = committed.begin();
+    Array<TuningRecord> results;
+    while (results.size() < static_cast<size_t>(top_k)) {
+      bool has_file = file_begin < file_end;
+      bool has_committed = committed_it != committed.end();
+      if (!has_file && !has_committed) {
+        break;
+      }
+      bool take_file = has_file;
+      if (has_file && has_committed) {
+        double committed_secs =
+            SortTuningRecordByMeanRunSecs::Mean((*committed_it)->run_secs.value_or({}));
+        take_file = GetRecordEntry(file_begin).mean_run_secs <= committed_secs;
+      }
+      if (take_file) {
+        results.push_back(LoadRecord(GetRecordEntry(file_begin++), workloads_[index]));
+      } else {
+        results.push_back(*committed_it);
+        ++committed_it;
+      }
+    }
+    return results;
+  }
+
+  Array<TuningRecord> GetAllTuningRecords() final {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<TuningRecord> results;
+    results.reserve(num_file_records_ + num_committed_records_);
+    for (size_t i = 0; i < num_file_workloads_; ++i) {
+      BinaryDatabaseWorkload entry = GetWorkloadEntry(i);
+      Workload workload = LoadWorkload(i);
+      for (uint64_t j = entry.record_begin; j < entry.record_end; ++j) {
+        results.push_back(LoadRecord(GetRecordEntry(j), workload));
+      }
+    }
+    for (const CommittedRecords& committed : committed_) {
+      results.insert(results.end(), committed.all.begin(), committed.all.end());
+    }
+    std::stable_sort(results.begin(), results.end(), SortTuningRecordByMeanRunSecs());
+    return results;
+  }
+
+  int64_t Size() final {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_file_records_ + num_committed_records_;
+  }
+
+  /*!
+   * \brief Write the records in the file and the committed ones to a binary database file. The
+   * file is replaced atomically, so it can be the file this database is reading from, in which
+   * case the database reopens it and clears its log.
+   * \param file_path The path to the file.
+   */
+  void Save(const std::string& file_path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SaveLocked(file_path);
+  }
+
+ private:
+  /*! \brief The tuning records committed to a workload since the file was opened. */
+  struct CommittedRecords {
+    /*! \brief All the records, in the order of commit */
+    std::vector<TuningRecord> all;
+    /*! \brief The valid records sorted by mean run time */
+    std::multiset<TuningRecord, SortTuningRecordByMeanRunSecs> valid;
+  };
+
+  void SaveLocked(const std::string& file_path) {
+    std::vector<std::pair<THashCode, size_t>> order;
+    order.reserve(workloads_.size());
+    for (size_t i = 0; i < workloads_.size(); ++i) {
+      THashCode shash = i < num_file_workloads_ ? GetWorkloadEntry(i).shash : workloads_[i]->shash;
+      order.emplace_back(shash, i);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    std::vector<BinaryDatabaseWorkload> workload_table;
+    std::vector<BinaryDatabaseRecord> record_table;
+    std::string blob;
+    // The offsets are relative to the blob until the size of the tables is known
+    auto append_blob = [&blob](const char* data, size_t nbytes) {
+      uint64_t offset = blob.size();
+      blob.append(data, nbytes);
+      return offset;
+    };
+    uint64_t mod_eq_offset = append_blob(module_equality.data(), module_equality.size());
+    for (const auto& [shash, i] : order) {
+      BinaryDatabaseWorkload entry;
+      entry.shash = shash;
+      if (i < num_file_workloads_) {
+        BinaryDatabaseWorkload file_entry = GetWorkloadEntry(i);
+        entry.nbytes = file_entry.nbytes;
+        entry.offset = append_blob(data_ + file_entry.offset, file_entry.nbytes);
+      } else {
+        std::string json = JSONDumps(workloads_[i]->AsJSON());
+        entry.nbytes = json.size();
+        entry.offset = append_blob(json.data(), json.size());
+      }
+      // Gather the records as (mean run time, JSON string), valid ones first
+      std::vector<std::pair<double, std::string>> valid, invalid;
+      if (i < num_file_workloads_) {
+        BinaryDatabaseWorkload file_entry = GetWorkloadEntry(i);
+        for (uint64_t j = file_entry.record_begin; j < file_entry.record_end; ++j) {
+          BinaryDatabaseRecord record = GetRecordEntry(j);
+          auto& dst = j < file_entry.record_begin + file_entry.num_valid ? valid : invalid;
+          dst.emplace_back(record.mean_run_secs,
+                           std::string(data_ + record.offset, record.nbytes));
+        }
+      }
+      for (const TuningRecord& record : committed_[i].all) {
+        auto& dst = record->IsValid() ? valid : invalid;
+        dst.emplace_back(SortTuningRecordByMeanRunSecs::Mean(record->run_secs.value_or({})),
+                         JSONDumps(record->AsJSON()));
+      }
+      std::stable_sort(valid.begin(), valid.end(),
+                       [](const auto& a, const auto& b) { return a.first < b.first; });
+      entry.record_begin = record_table.size();
+      entry.num_valid = valid.size();
+      for (const auto* records : {&valid, &invalid}) {
+        for (const auto& [mean_run_secs, json] : *records) {
+          BinaryDatabaseRecord record;
+          record.nbytes = json.size();
+          record.offset = append_blob(json.data(), json.size());
+          record.mean_run_secs = mean_run_secs;
+          record_table.push_back(record);
+        }
+      }
+      entry.record_end = record_table.size();
+      workload_table.push_back(entry);
+    }
+    BinaryDatabaseHeader header;
+    header.magic = kBinaryDatabaseMagic;
+    header.num_workloads = workload_table.size();
+    header.num_records = record_table.size();
+    uint64_t blob_offset = sizeof(header) +
+                           workload_table.size() * sizeof(BinaryDatabaseWorkload) +
+                           record_table.size() * sizeof(BinaryDatabaseRecord);
+    header.mod_eq_offset = blob_offset + mod_eq_offset;
+    header.mod_eq_nbytes = module_equality.size();
+    for (BinaryDatabaseWorkload& entry : workload_table) {
+      entry.offset += blob_offset;
+    }
+    for (BinaryDatabaseRecord& entry : record_table) {
+      entry.offset += blob_offset;
+    }
+    std::string tmp_path = file_path + ".tmp";
+    {
+      std::ofstream os(tmp_path, std::ofstream::binary);
+      CHECK(os.good()) << "ValueError: Cannot open the file to write: " << tmp_path;
+      os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      os.write(reinterpret_cast<const char*>(workload_table.data()),
+               workload_table.size() * sizeof(BinaryDatabaseWorkload));
+      os.write(reinterpret_cast<const char*>(record_table.data()),
+               record_table.size() * sizeof(BinaryDatabaseRecord));
+      os.write(blob.data(), blob.size());
+      CHECK(os.good()) << "ValueError: Cannot write to the file: " << tmp_path;
+    }
+    CHECK_EQ(std::rename(tmp_path.c_str(), file_path.c_str()), 0)
+        << "ValueError: Cannot replace the file: " << file_path;
+    if (file_path == std::string(path)) {
+      // Everything is in the file now, start over from it with an empty log
+      Open(file_path);
+      log_.close();
+      std::remove(LogPath().c_str());
+      num_log_workloads_ = 0;
+      num_log_records_ = 0;
+    }
+  }
+
+  /*! \return Whether the range of bytes is within a file of the given size. */
+  static bool InFile(uint64_t offset, uint64_t nbytes, uint64_t size) {
+    return offset <= size && nbytes <= size - offset;
+  }
+
+  /*! \brief Append a line to the log, flushing it right away. */
+  void AppendLog(const std::string& line) {
+    if (!log_.is_open()) {
+      log_.open(LogPath(), std::ofstream::binary | std::ofstream::app);
+      CHECK(log_.good()) << "ValueError: Cannot open the file to write: " << LogPath();
+    }
+    log_ << line << '\n';
+    log_.flush();
+    CHECK(log_.good()) << "ValueError: Cannot write to the file: " << LogPath();
+  }
+
+  /*! \brief Give the workload an id in the log, if it has none yet. */
+  void LogWorkload(int64_t index) {
+    if (path.empty() || log_ids_[index] >= 0) {
+      return;
+    }
+    AppendLog(JSONDumps(Array<ObjectRef>{LoadWorkload(index)->AsJSON()}));
+    log_ids_[index] = num_log_workloads_++;
+  }
+
+  void AddRecord(int64_t index, const TuningRecord& record) {
+    CommittedRecords& committed = committed_[index];
+    committed.all.push_back(record);
+    if (record->IsValid()) {
+      committed.valid.insert(record);
+    }
+    ++num_committed_records_;
+  }
+
+  BinaryDatabaseWorkload GetWorkloadEntry(size_t index) const {
+    BinaryDatabaseWorkload entry;
+    std::memcpy(&entry, data_ + sizeof(BinaryDatabaseHeader) + index * sizeof(entry),
+                sizeof(entry));
+    return entry;
+  }
+
+  BinaryDatabaseRecord GetRecordEntry(size_t index) const {
+    BinaryDatabaseRecord entry;
+    std::memcpy(&entry,
+                data_ + sizeof(BinaryDatabaseHeader) +
+                    num_file_workloads_ * sizeof(BinaryDatabaseWorkload) + index * sizeof(entry),
+                sizeof(entry));
+    return entry;
+  }
+
+  /*! \brief Deserialize a workload in the file, if not yet. */
+  const Workload& LoadWorkload(size_t index) {
+    Workload& workload = workloads_[index];
+    if (!workload.defined()) {
+      BinaryDatabaseWorkload entry = GetWorkloadEntry(index);
+      workload = Workload::FromJSON(JSONLoads(std::string(data_ + entry.offset, entry.nbytes)));
+      // The table is sorted by the stored hash, which is the one to look the workload up with
+      ObjectPtr<WorkloadNode> n = make_object<WorkloadNode>(*workload.get());
+      n->shash = entry.shash;
+      workload = Workload(n);
+    }
+    return workload;
+  }
+
+  TuningRecord LoadRecord(const BinaryDatabaseRecord& entry, const Workload& workload) const {
+    return TuningRecord::FromJSON(JSONLoads(std::string(data_ + entry.offset, entry.nbytes)),
+                                  workload);
+  }
+
+  /*! \return The index of the workload, or -1 if it is not in the database. */
+  int64_t FindWorkload(THashCode shash, const IRModule& mod) {
+    // Binary search the workload table for the workloads of the same hash
+    size_t lo = 0, hi = num_file_workloads_;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (GetWorkloadEntry(mid).shash < shash) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    for (size_t i = lo; i < num_file_workloads_ && GetWorkloadEntry(i).shash == shash; ++i) {
+      const Workload& workload = LoadWorkload(i);
+      if (workload->mod.same_as(mod) || GetModuleEquality().Equal(workload->mod, mod)) {
+        return i;
+      }
+    }
+    for (size_t i = num_file_workloads_; i < workloads_.size(); ++i) {
+      const Workload& workload = workloads_[i];
+      if (workload->shash == shash &&
+          (workload->mod.same_as(mod) || GetModuleEquality().Equal(workload->mod, mod))) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
+  int64_t AddWorkload(const Workload& workload) {
+    workloads_.push_back(workload);
+    committed_.emplace_back();
+    log_ids_.push_back(-1);
+    return workloads_.size() - 1;
+  }
+
+  /*! \brief The mapped file */
+  Optional<runtime::MappedFile> file_{NullOpt};
+  /*! \brief The content of the mapped file */
+  const char* data_{nullptr};
+  /*! \brief The number of workloads in the file */
+  size_t num_file_workloads_{0};
+  /*! \brief The number of tuning records in the file */
+  size_t num_file_records_{0};
+  /*! \brief The workloads in the file, deserialized on demand, followed by the committed ones */
+  std::vector<Workload> workloads_;
+  /*! \brief The records committed to each workload */
+  std::vector<CommittedRecords> committed_;
+  /*! \brief The number of committed records */
+  int64_t num_committed_records_{0};
+  /*! \brief The id of each workload in the log, -1 if it is not in the log */
+  std::vector<int64_t> log_ids_;
+  /*! \brief The number of workloads in the log */
+  int64_t num_log_workloads_{0};
+  /*! \brief The number of tuning records in the log */
+  int64_t num_log_records_{0};
+  /*! \brief The log, opened on the first append */
+  std::ofstream log_;
+  /*! \brief Guards the deserialized workloads and the committed records */
+  std::mutex mutex_;
+};
+
+Database Database::BinaryDatabase(String path, bool allow_missing, String mod_eq_name) {
+  ObjectPtr<BinaryDatabaseNode> n = make_object<BinaryDatabaseNode>(mod_eq_name);
+  n->path = path;
+  if (std::ifstream(path).good()) {
+    n->Open(path);
+  } else {
+    // The file may not be written yet, with everything still in the log
+    CHECK(allow_missing || std::ifstream(n->LogPath()).good())
+        << "ValueError: File doesn't exist: " << path;
+  }
+  if (!path.empty()) {
+    n->OpenLog();
+  }
+  return Database(n);
+}
+
+TVM_REGISTER_NODE_TYPE(BinaryDatabaseNode);
+TVM_REGISTER_GLOBAL("meta_schedule.DatabaseBinaryDatabase")
+    .set_body_typed(Database::BinaryDatabase);
+TVM_REGISTER_GLOBAL("meta_schedule.DatabaseBinaryDatabaseSave")
+    .set_body_typed([](Database db, String path) {
+      BinaryDatabaseNode* n = const_cast<BinaryDatabaseNode*>(db.as<BinaryDatabaseNode>());
+      CHECK(n != nullptr) << "TypeError: Expect a BinaryDatabase, but gets: " << db->GetTypeKey();
+      n->Save(path);
+    });
+
+}  // namespace meta_schedule
+}  // namespace tvm
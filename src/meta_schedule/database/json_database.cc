@@ -16,7 +16,10 @@
  * specific language governing permissions and limitations
  * under the License.
  */
+#include <fstream>
+#include <memory>
 #include <set>
+#include <shared_mutex>
 #include <thread>
 #include <unordered_map>
 
@@ -26,6 +29,32 @@
 namespace tvm {
 namespace meta_schedule {
 
+/*!
+ * \brief Appends lines to a json file. The file is opened on the first line appended, so that a
+ * database that is only read never opens its files for writing.
+ */
+class JSONFileAppender {
+ public:
+  explicit JSONFileAppender(std::string path) : path_(std::move(path)) {}
+
+  /*! \brief Append a line to the file and flush it, so that a crash loses no committed line. */
+  void Append(const std::string& line) {
+    if (!os_.is_open()) {
+      os_.open(path_, std::ofstream::app);
+      CHECK(os_.good()) << "ValueError: Cannot open the file to write: " << path_;
+    }
+    os_ << line << '\n';
+    os_.flush();
+    CHECK(os_.good()) << "ValueError: Cannot write to the file: " << path_;
+  }
+
+ private:
+  /*! \brief The path to the json file */
+  std::string path_;
+  /*! \brief The file, opened in append mode on the first line appended */
+  std::ofstream os_;
+};
+
 /*!
  * \brief Read lines from a json file.
  * \param path The path to the json file.
@@ -80,12 +109,21 @@ class JSONDatabaseNode : public DatabaseNode {
   std::unordered_map<Workload, int, WorkloadHash, WorkloadEqual> workloads2idx_;
   /*! \brief All the tuning records in the database */
   std::multiset<TuningRecord, SortTuningRecordByMeanRunSecs> tuning_records_;
+  /*! \brief The valid tuning records of each workload, indexed by the workload index */
+  std::vector<std::multiset<TuningRecord, SortTuningRecordByMeanRunSecs>> valid_records_;
+  /*! \brief The appender of the workload table */
+  std::unique_ptr<JSONFileAppender> workload_appender_;
+  /*! \brief The appender of the tuning record table */
+  std::unique_ptr<JSONFileAppender> tuning_record_appender_;
+  /*! \brief Shared by the queries, and held exclusively by the commits */
+  std::shared_mutex mutex_;
 
   void VisitAttrs(tvm::AttrVisitor* v) {
     v->Visit("path_workload", &path_workload);
     v->Visit("path_tuning_record", &path_tuning_record);
     // `workloads2idx_` is not visited
     // `tuning_records_` is not visited
+    // `valid_records_` is not visited
   }
 
   static constexpr const char* _type_key = "meta_schedule.JSONDatabase";
@@ -93,30 +131,39 @@ class JSONDatabaseNode : public DatabaseNode {
 
  public:
   bool HasWorkload(const IRModule& mod) {
-    return workloads2idx_.find(Workload(mod, GetModuleEquality().Hash(mod))) !=
-           workloads2idx_.end();
+    Workload workload(mod, GetModuleEquality().Hash(mod));
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return workloads2idx_.find(workload) != workloads2idx_.end();
   }
 
   Workload CommitWorkload(const IRModule& mod) {
+    Workload new_workload(mod, GetModuleEquality().Hash(mod));
+    std::unique_lock<std::shared_mutex> lock(mutex_);
     // Try to insert `mod` into `workloads_`
-    auto [it, inserted] =
-        this->workloads2idx_.emplace(Workload(mod, GetModuleEquality().Hash(mod)), -1);
+    auto [it, inserted] = this->workloads2idx_.emplace(new_workload, -1);
     Workload workload = it->first;
-    // If `mod` is new in `workloads2idx_`, append it to the workload file
+    // If `mod` is new in `workloads2idx_`, append it to `path_workload`
     if (inserted) {
-      it->second = static_cast<int>(this->workloads2idx_.size()) - 1;
-      JSONFileAppendLine(this->path_workload, JSONDumps(workload->AsJSON()));
+      // The index is the line in the workload file, which may have duplicate workloads
+      it->second = static_cast<int>(this->valid_records_.size());
+      this->valid_records_.emplace_back();
+      this->workload_appender_->Append(JSONDumps(workload->AsJSON()));
     }
     return it->first;
   }
 
   void CommitTuningRecord(const TuningRecord& record) {
+    bool is_valid = record->IsValid();
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    int workload_index = this->workloads2idx_.at(record->workload);
     this->tuning_records_.insert(record);
-    JSONFileAppendLine(this->path_tuning_record,
-                       JSONDumps(Array<ObjectRef>{
-                           /*workload_index=*/Integer(this->workloads2idx_.at(record->workload)),
-                           /*tuning_record=*/record->AsJSON()  //
-                       }));
+    if (is_valid) {
+      this->valid_records_[workload_index].insert(record);
+    }
+    this->tuning_record_appender_->Append(JSONDumps(Array<ObjectRef>{
+        /*workload_index=*/Integer(workload_index),
+        /*tuning_record=*/record->AsJSON()  //
+    }));
   }
 
   Array<TuningRecord> GetTopK(const Workload& workload, int top_k) {
@@ -124,34 +171,37 @@ class JSONDatabaseNode : public DatabaseNode {
     if (top_k == 0) {
       return {};
     }
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = this->workloads2idx_.find(workload);
+    if (it == this->workloads2idx_.end()) {
+      return {};
+    }
+    const auto& records = this->valid_records_[it->second];
     Array<TuningRecord> results;
-    results.reserve(top_k);
-    for (const TuningRecord& record : this->tuning_records_) {
-      auto run_secs = record->run_secs;
-      if (!record->IsValid()) {
-        continue;
-      }
-      if (record->workload.same_as(workload) ||
-          WorkloadEqual(GetModuleEquality())(record->workload, workload)) {
-        results.push_back(record);
-        if (results.size() == static_cast<size_t>(top_k)) {
-          break;
-        }
+    results.reserve(std::min(records.size(), static_cast<size_t>(top_k)));
+    for (const TuningRecord& record : records) {
+      if (results.size() == static_cast<size_t>(top_k)) {
+        break;
       }
+      results.push_back(record);
     }
     return results;
   }
 
   Array<TuningRecord> GetAllTuningRecords() {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
     Array<TuningRecord> results;
-    results.reserve(Size());
+    results.reserve(tuning_records_.size());
     for (const TuningRecord& record : this->tuning_records_) {
       results.push_back(record);
     }
     return results;
   }
 
-  int64_t Size() { return tuning_records_.size(); }
+  int64_t Size() {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return tuning_records_.size();
+  }
 };
 
 Database Database::JSONDatabase(String path_workload, String path_tuning_record, bool allow_missing,
@@ -160,11 +210,13 @@ Database Database::JSONDatabase(String path_workload, String path_tuning_record,
   ObjectPtr<JSONDatabaseNode> n = make_object<JSONDatabaseNode>(mod_eq_name);
   // Load `n->workloads2idx_` from `path_workload`
   std::vector<Workload> workloads;
+  std::vector<int> first_indices;
   {
     std::vector<ObjectRef> json_objs = JSONFileReadLines(path_workload, num_threads, allow_missing);
     int n_objs = json_objs.size();
     n->workloads2idx_.reserve(n_objs);
     workloads.reserve(n_objs);
+    first_indices.reserve(n_objs);
     for (int i = 0; i < n_objs; ++i) {
       Workload workload = Workload::FromJSON(json_objs[i]);
       auto recalc_hash = n->GetModuleEquality().Hash(workload->mod);
@@ -175,9 +227,12 @@ Database Database::JSONDatabase(String path_workload, String path_tuning_record,
         wkl->shash = recalc_hash;
         workload = Workload(wkl);
       }
-      n->workloads2idx_.emplace(workload, i);
+      // Duplicate workloads share the index of their first line
+      auto [it, inserted] = n->workloads2idx_.emplace(workload, i);
       workloads.push_back(workload);
+      first_indices.push_back(it->second);
     }
+    n->valid_records_.resize(n_objs);
   }
   // Load `n->tuning_records_` from `path_tuning_record`
   {
@@ -185,6 +240,8 @@ Database Database::JSONDatabase(String path_workload, String path_tuning_record,
         JSONFileReadLines(path_tuning_record, num_threads, allow_missing);
     std::vector<TuningRecord> records;
     records.resize(json_objs.size(), TuningRecord{nullptr});
+    std::vector<int64_t> workload_indices(json_objs.size(), -1);
+    std::vector<char> is_valid(json_objs.size(), 0);
     support::parallel_for_dynamic(
         0, json_objs.size(), num_threads, [&](int thread_id, int task_id) {
           const ObjectRef& json_obj = json_objs[task_id];
@@ -196,6 +253,8 @@ Database Database::JSONDatabase(String path_workload, String path_tuning_record,
             ICHECK(workload_index >= 0 && static_cast<size_t>(workload_index) < workloads.size());
             workload = workloads[workload_index];
             records[task_id] = TuningRecord::FromJSON(arr->at(1), workload);
+            workload_indices[task_id] = first_indices[workload_index];
+            is_valid[task_id] = records[task_id]->IsValid();
           } catch (std::runtime_error& e) {
             LOG(FATAL) << "ValueError: Unable to parse TuningRecord, on line " << (task_id + 1)
                        << " of file " << path_tuning_record << ". The workload is:\n"
@@ -205,12 +264,17 @@ Database Database::JSONDatabase(String path_workload, String path_tuning_record,
                        << e.what();
           }
         });
-    for (const TuningRecord& record : records) {
-      n->tuning_records_.insert(record);
+    for (size_t i = 0; i < records.size(); ++i) {
+      n->tuning_records_.insert(records[i]);
+      if (is_valid[i]) {
+        n->valid_records_[workload_indices[i]].insert(records[i]);
+      }
     }
   }
   n->path_workload = path_workload;
   n->path_tuning_record = path_tuning_record;
+  n->workload_appender_ = std::make_unique<JSONFileAppender>(path_workload);
+  n->tuning_record_appender_ = std::make_unique<JSONFileAppender>(path_tuning_record);
   return Database(n);
 }
 
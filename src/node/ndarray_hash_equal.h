@@ -29,6 +29,9 @@ class SHashReducer;
 
 /*! \brief A custom hash handler that ignores NDArray raw data. */
 class SHashHandlerIgnoreNDArray : public SHashHandlerDefault {
+ public:
+  uint64_t Hash(const ObjectRef& object, bool map_free_vars) override;
+
  protected:
   void DispatchSHash(const ObjectRef& object, bool map_free_vars) override;
 };
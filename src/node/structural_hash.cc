@@ -20,6 +20,8 @@
  * \file src/node/structural_hash.cc
  */
 #include <dmlc/memory_io.h>
+#include <dmlc/thread_local.h>
+#include <tvm/ir/expr.h>
 #include <tvm/node/functor.h>
 #include <tvm/node/node.h>
 #include <tvm/node/object_path.h>
@@ -31,6 +33,8 @@
 
 #include <algorithm>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "../support/base64.h"
 #include "../support/str_escape.h"
@@ -287,14 +291,100 @@ void SHashHandlerDefault::DispatchSHash(const ObjectRef& key, bool map_free_vars
   impl->DispatchSHash(key, map_free_vars);
 }
 
+/*! \brief The structural hash cache of a thread. */
+struct StructuralHashCacheEntry {
+  /*! \brief The cached hash values of an object. */
+  struct Value {
+    /*!
+     * \brief The object, held so that its address is not reused and it is copied rather than
+     *  mutated in place while it is cached.
+     */
+    ObjectRef object;
+    /*! \brief The hash value of each variant, valid if the bit of the variant is set in `mask`. */
+    uint64_t hashed_values[4];
+    /*! \brief The bitmask of the cached variants. */
+    uint32_t mask{0};
+  };
+  /*! \brief The cached hash values of each scope entered on the thread, innermost last. */
+  std::vector<std::unordered_map<const Object*, Value>> scopes;
+
+  /*! \brief Whether the hash value of the object can be cached, see StructuralHashCache. */
+  bool Cacheable(const ObjectRef& object) const {
+    return !scopes.empty() && object.defined() && object->IsInstance<BaseExprNode>();
+  }
+};
+
+/*! \brief Thread local store to hold the structural hash cache. */
+typedef dmlc::ThreadLocalStore<StructuralHashCacheEntry> StructuralHashCacheThreadLocalStore;
+
+void StructuralHashCache::EnterScope() {
+  StructuralHashCacheThreadLocalStore::Get()->scopes.emplace_back();
+}
+
+void StructuralHashCache::ExitScope() {
+  StructuralHashCacheEntry* entry = StructuralHashCacheThreadLocalStore::Get();
+  ICHECK(!entry->scopes.empty()) << "Exiting a structural hash cache scope that is not entered";
+  entry->scopes.pop_back();
+}
+
+bool StructuralHashCache::Lookup(const ObjectRef& object, uint32_t flags, uint64_t* hashed_value) {
+  StructuralHashCacheEntry* entry = StructuralHashCacheThreadLocalStore::Get();
+  if (!entry->Cacheable(object)) {
+    return false;
+  }
+  const auto& values = entry->scopes.back();
+  auto it = values.find(object.get());
+  if (it == values.end() || !(it->second.mask & (1U << flags))) {
+    return false;
+  }
+  *hashed_value = it->second.hashed_values[flags];
+  return true;
+}
+
+void StructuralHashCache::Insert(const ObjectRef& object, uint32_t flags, uint64_t hashed_value) {
+  StructuralHashCacheEntry* entry = StructuralHashCacheThreadLocalStore::Get();
+  if (!entry->Cacheable(object)) {
+    return;
+  }
+  StructuralHashCacheEntry::Value& value = entry->scopes.back()[object.get()];
+  value.object = object;
+  value.hashed_values[flags] = hashed_value;
+  value.mask |= 1U << flags;
+}
+
+/*!
+ * \brief Hash an object as the root, through the structural hash cache.
+ * \param object The object.
+ * \param flags The variant of the hash value, a combination of StructuralHashCache::Flag.
+ * \param fhash The function computing the hash value on a cache miss.
+ */
+template <typename FHash>
+uint64_t HashThroughCache(const ObjectRef& object, uint32_t flags, FHash fhash) {
+  uint64_t hashed_value;
+  if (!StructuralHashCache::Lookup(object, flags, &hashed_value)) {
+    hashed_value = fhash();
+    StructuralHashCache::Insert(object, flags, hashed_value);
+  }
+  return hashed_value;
+}
+
 TVM_REGISTER_GLOBAL("node.StructuralHash")
     .set_body_typed([](const ObjectRef& object, bool map_free_vars) -> int64_t {
-      uint64_t hashed_value = SHashHandlerDefault().Hash(object, map_free_vars);
+      uint32_t flags = map_free_vars ? StructuralHashCache::kMapFreeVars : 0;
+      uint64_t hashed_value = HashThroughCache(
+          object, flags, [&]() { return SHashHandlerDefault().Hash(object, map_free_vars); });
       return static_cast<int64_t>(hashed_value);
     });
 
 uint64_t StructuralHash::operator()(const ObjectRef& object) const {
-  return SHashHandlerDefault().Hash(object, false);
+  return HashThroughCache(object, 0, [&]() { return SHashHandlerDefault().Hash(object, false); });
+}
+
+uint64_t SHashHandlerIgnoreNDArray::Hash(const ObjectRef& object, bool map_free_vars) {
+  uint32_t flags = StructuralHashCache::kIgnoreNDArray |
+                   (map_free_vars ? StructuralHashCache::kMapFreeVars : 0);
+  return HashThroughCache(
+      object, flags, [&]() { return SHashHandlerDefault::Hash(object, map_free_vars); });
 }
 
 void SHashHandlerIgnoreNDArray::DispatchSHash(const ObjectRef& object, bool map_free_vars) {
@@ -51,17 +51,17 @@ using vm::VMFuncInfo;
  */
 class CodeGenVMTIR : public ExprFunctor<Optional<PrimExpr>(const Expr&)> {
  public:
-  explicit CodeGenVMTIR(relax::ExecBuilder builder, IRModule ctx_mod)
-      : builder_(builder), ctx_mod_(ctx_mod) {
+  explicit CodeGenVMTIR(relax::ExecBuilder builder, IRModule ctx_mod, bool direct_tensor_args)
+      : builder_(builder), ctx_mod_(ctx_mod), direct_tensor_args_(direct_tensor_args) {
     system_lib_prefix_ = ctx_mod_->GetAttr<String>(tvm::attr::kSystemLibPrefix);
   }
 
-  static IRModule Run(relax::ExecBuilder builder, IRModule mod) {
+  static IRModule Run(relax::ExecBuilder builder, IRModule mod, bool direct_tensor_args) {
     // create a new copy
     IRModule res_mod = mod;
     res_mod.CopyOnWrite();
 
-    CodeGenVMTIR codegen(builder, mod);
+    CodeGenVMTIR codegen(builder, mod, direct_tensor_args);
     // Remove relax function and turn into TIR func.
     for (auto& p : mod->functions) {
       if (auto* func = p.second.as<FunctionNode>()) {
@@ -99,6 +99,23 @@ class CodeGenVMTIR : public ExprFunctor<Optional<PrimExpr>(const Expr&)> {
                      {func_anylist_handle_, ConstInt32(slot)});
   }
 
+  /*!
+   * \brief Read the handle of the tensor held by an item of an anylist.
+   * \param anylist_item The anylist_getitem call of the item.
+   * \return The handle, which is the content of the TVMValue at the start of the TVMRetValue
+   *         backing the item, or NullOpt if the expression is not an anylist item.
+   */
+  static Optional<PrimExpr> AnyListTensorHandle(const PrimExpr& anylist_item) {
+    const auto* call = anylist_item.as<tir::CallNode>();
+    if (call == nullptr || !call->op.same_as(tir::builtin::anylist_getitem())) return NullOpt;
+    const auto* slot = call->args[1].as<IntImmNode>();
+    if (slot == nullptr) return NullOpt;
+    // A TVMRetValue is a TVMValue followed by the type code, which spans two TVMValues.
+    return tir::Call(DataType::Handle(), tir::builtin::tvm_struct_get(),
+                     {call->args[0], ConstInt32(slot->value * 2),
+                      ConstInt32(tir::builtin::kTVMValueContent)});
+  }
+
   void EmitStmt(tir::Stmt stmt) {
     ICHECK(!stmt_stack_.empty());
     stmt_stack_.back().emplace_back(stmt);
@@ -458,6 +475,9 @@ class CodeGenVMTIR : public ExprFunctor<Optional<PrimExpr>(const Expr&)> {
       // primfunc in the same module.
       // use cpacked to directly invoke without named based lookup
       if (Optional<tir::PrimFunc> prim_func = LookupPrimFunc(symbol.value())) {
+        if (direct_tensor_args_ && prim_func.value()->params.size() == args.size()) {
+          args = DirectTensorArgs(prim_func.value(), call_node->args, args);
+        }
         this->EmitCallCPacked(prim_func.value(), args, dst_reg);
       } else {
         this->EmitCallPacked(symbol.value(), args, dst_reg);
@@ -474,6 +494,30 @@ class CodeGenVMTIR : public ExprFunctor<Optional<PrimExpr>(const Expr&)> {
     }
   }
 
+  /*!
+   * \brief Pass the tensor arguments of a PrimFunc call as the DLTensor handles read from the
+   *        registers and the constants, rather than through the runtime anylist API.
+   * \param prim_func The callee.
+   * \param relax_args The relax arguments of the call.
+   * \param args The arguments of the call.
+   * \return The updated arguments.
+   */
+  Array<PrimExpr> DirectTensorArgs(const tir::PrimFunc& prim_func, const Array<Expr>& relax_args,
+                                   Array<PrimExpr> args) {
+    for (size_t i = 0; i < args.size(); ++i) {
+      // A tensor is always an NDArray, whose handle the PrimFunc accepts as a DLTensor.
+      if (!GetStructInfo(relax_args[i]).as<TensorStructInfoNode>() ||
+          !prim_func->params[i].dtype().is_handle() ||
+          !prim_func->buffer_map.count(prim_func->params[i])) {
+        continue;
+      }
+      if (Optional<PrimExpr> handle = AnyListTensorHandle(args[i])) {
+        args.Set(i, handle.value());
+      }
+    }
+    return args;
+  }
+
   template <typename FLambda>
   tir::Stmt WithNewScope(const FLambda& callback) {
     stmt_stack_.push_back({});
@@ -513,6 +557,8 @@ class CodeGenVMTIR : public ExprFunctor<Optional<PrimExpr>(const Expr&)> {
   IRModule ctx_mod_;
   /*! \brief system lib prefix */
   Optional<String> system_lib_prefix_;
+  /*! \brief Whether to pass the tensor arguments of the PrimFunc calls directly. */
+  bool direct_tensor_args_;
   /*! \brief Cache ops that need to be frequently used later to reduce lookup overhead. */
   const Op& alloc_storage_op_ = Op::Get("relax.vm.alloc_storage");
   const Op& alloc_tensor_op_ = Op::Get("relax.vm.alloc_tensor");
@@ -527,10 +573,12 @@ class CodeGenVMTIR : public ExprFunctor<Optional<PrimExpr>(const Expr&)> {
  *
  * \param exec_builder Builder to collect executables.
  * \param mod Input module.
+ * \param direct_tensor_args Whether to pass the tensor arguments of the calls to the PrimFuncs
+ *        of the module directly from the registers ("compiled_direct_tensors" exec mode).
  * \return Extra TIR module created.
  */
-IRModule VMTIRCodeGen(ExecBuilder exec_builder, IRModule mod) {
-  return CodeGenVMTIR::Run(exec_builder, mod);
+IRModule VMTIRCodeGen(ExecBuilder exec_builder, IRModule mod, bool direct_tensor_args) {
+  return CodeGenVMTIR::Run(exec_builder, mod, direct_tensor_args);
 }
 
 TVM_REGISTER_GLOBAL("relax.VMTIRCodeGen").set_body_typed(VMTIRCodeGen);
@@ -37,6 +37,17 @@
  * for this alloc_tensor. Otherwise, we decide to allocate a storage for the
  * alloc_tensor.
  *
+ * Alternatively, with the pass config option
+ * "relax.StaticPlanBlockMemory.planner" set to "arena", the constant-size
+ * tokens of the global scope are not reused as a whole. Instead, we collect
+ * the lifetime interval of each of them, in the order of the bindings, and
+ * pack all the tokens of a binding block into one byte arena by offset, so
+ * that tensors of different dtypes can share bytes as well. The tokens are
+ * placed from the largest to the smallest, each into the smallest gap between
+ * the tokens whose lifetimes overlap with it. The other tokens are still
+ * planned by the pool above. The runtime turns the offsets into data pointers
+ * only on the devices whose buffers are addresses, such as CPU and CUDA.
+ *
  * The third stage is IR rewrite. Based on the decision made in the second
  * stage, we insert memory alloc_storage, alloc_tensor.
  *
@@ -64,14 +75,22 @@
  * It means the maximum value of variable that names "n" in the function
  * signature will have upper bound 1024. And we will use 1024 as its value
  * during memory planning.
+ *
+ * A token whose size is still symbolic after applying the upper bounds
+ * reuses a storage of a different symbolic size when the size of the storage
+ * is provably no less than its own. The attribute "tir_non_negative_var",
+ * which lists the names of the TIR vars in the function signature that are
+ * non-negative, helps with such proofs.
  */
 #include <tvm/arith/analyzer.h>
 #include <tvm/relax/analysis.h>
 #include <tvm/relax/expr_functor.h>
 #include <tvm/relax/nested_msg.h>
 #include <tvm/relax/transform.h>
+#include <tvm/runtime/device_api.h>
 #include <tvm/tir/stmt_functor.h>
 
+#include <algorithm>
 #include <map>
 #include <set>
 #include <vector>
@@ -184,20 +203,33 @@ class TokenAllocator1D {
 
     int64_t size = prototype->const_bytes();
     if (size == -1) {
-      // Handle the case where the prototype token has dynamic size. Currently it requires the
-      // symbolic size to be the same as the prototype token in order to reuse the storage.
+      // Handle the case where the prototype token has dynamic size. We reuse a token of the same
+      // symbolic size if there is one. Otherwise, we reuse the smallest token whose symbolic size
+      // is provably no less than the prototype's, under the upper bounds and the non-negativity
+      // of the TIR variables annotated on the function. The symbolic sizes are never enlarged.
       auto [begin, end] = pool.equal_range(size);
-      for (; begin != end; ++begin) {
-        StorageToken available_token = begin->second;
-        if (analyzer_->CanProveEqual(prototype->bytes, available_token->bytes)) {
-          ICHECK_EQ(available_token->ref_counter, 0)
-              << "Available tokens are expected to have 0 reference.";
-          available_token->ref_counter = prototype->ref_counter;
-          pool.erase(begin);
-          return available_token;
+      auto best = end;
+      for (auto it = begin; it != end; ++it) {
+        const PrimExpr& available_bytes = it->second->bytes;
+        if (analyzer_->CanProveEqual(prototype->bytes, available_bytes)) {
+          best = it;
+          break;
+        }
+        if (analyzer_->CanProveGreaterEqual(available_bytes - prototype->bytes, 0) &&
+            (best == end ||
+             analyzer_->CanProveGreaterEqual(best->second->bytes - available_bytes, 0))) {
+          best = it;
         }
       }
-      return NullOpt;
+      if (best == end) {
+        return NullOpt;
+      }
+      StorageToken available_token = best->second;
+      ICHECK_EQ(available_token->ref_counter, 0)
+          << "Available tokens are expected to have 0 reference.";
+      available_token->ref_counter = prototype->ref_counter;
+      pool.erase(best);
+      return available_token;
     }
     // Step 2. Get the range of memory blocks in [size / match_range_, size * match_range_)
     auto begin = pool.lower_bound(size / match_range_);
@@ -701,8 +733,8 @@ class StorageAllocatorInit : public StorageAllocatorBaseVisitor {
 class StorageAllocator : public StorageAllocatorBaseVisitor {
  public:
   explicit StorageAllocator(std::unordered_map<const ExprNode*, Tokens> token_map,
-                            arith::Analyzer* analyzer)
-      : allocator_(analyzer) {
+                            arith::Analyzer* analyzer, bool use_arena)
+      : allocator_(analyzer), use_arena_(use_arena) {
     this->token_map_ = std::move(token_map);
   }
 
@@ -715,6 +747,7 @@ class StorageAllocator : public StorageAllocatorBaseVisitor {
       // Clear the allocator to make the planning of different functions independent.
       allocator_.Clear();
       this->VisitExpr_(func);
+      this->PackArenas();
     }
   }
 
@@ -723,6 +756,11 @@ class StorageAllocator : public StorageAllocatorBaseVisitor {
    * underlying storage token that it is using.
    */
   std::unordered_map<const ExprNode*, StorageToken> alloc_tensor2token;
+  /*!
+   * \brief The byte offset of each `builtin.alloc_tensor` in the storage of its token,
+   * for the ones that are planned into an arena.
+   */
+  std::unordered_map<const ExprNode*, int64_t> alloc_tensor2offset;
   /*! \brief The mapping from each binding block to the storage tokens that are create inside. */
   std::unordered_map<const BindingBlockNode*, std::vector<const StorageTokenNode*>> block2tokens;
 
@@ -741,6 +779,7 @@ class StorageAllocator : public StorageAllocatorBaseVisitor {
 
   void VisitBinding_(const VarBindingNode* binding, const CallNode* call) final {
     static const Op& alloc_tensor_op = Op::Get("relax.builtin.alloc_tensor");
+    ++binding_index_;
     if (call->op == alloc_tensor_op) {
       auto it = token_map_.find(call);
       ICHECK(it != token_map_.end());
@@ -751,7 +790,9 @@ class StorageAllocator : public StorageAllocatorBaseVisitor {
         return;
       }
       ICHECK(it->second.IsLeaf());
-      StorageToken new_token = this->RequestReuseOrAlloc(it->second.LeafValue());
+      StorageToken new_token = this->UseArena(it->second.LeafValue())
+                                   ? this->AllocInArena(it->second.LeafValue(), call)
+                                   : this->RequestReuseOrAlloc(it->second.LeafValue());
 
       // Record that this alloc_tensor is using the token.
       alloc_tensor2token.insert({call, new_token});
@@ -811,17 +852,149 @@ class StorageAllocator : public StorageAllocatorBaseVisitor {
     ICHECK_GE(token->ref_counter, 0);
 
     if (token->ref_counter == 0) {
-      allocator_.Release(token);
+      auto it_interval = arena_interval_index_.find(token.get());
+      if (it_interval != arena_interval_index_.end()) {
+        // Tokens in an arena are never reused as a whole. Their lifetimes end here.
+        arena_intervals_[it_interval->second].end = binding_index_;
+      } else {
+        allocator_.Release(token);
+      }
       auto it = token2cur_tensor_.find(token.get());
       ICHECK(it != token2cur_tensor_.end());
       token2cur_tensor_.erase(it);
     }
   }
 
+  /*! \brief The lifetime of a token in an arena, in the indices of the bindings. */
+  struct ArenaInterval {
+    /*! \brief The token. */
+    StorageToken token;
+    /*! \brief The alloc_tensor that uses the token. */
+    const CallNode* call;
+    /*! \brief The block where the token is allocated and released. */
+    const BindingBlockNode* block;
+    /*! \brief The binding that allocates the token. */
+    int start;
+    /*! \brief The last binding that uses the token. */
+    int end;
+  };
+
+  /*! \brief Check if the token of an alloc_tensor is to be planned into an arena. */
+  bool UseArena(const StorageToken& prototype) const {
+    return use_arena_ && prototype->ref_counter > 0 && prototype->const_bytes() != -1 &&
+           prototype->storage_scope == "global";
+  }
+
+  /*!
+   * \brief Allocate a token that is to be planned into the arena of the current block,
+   * starting its lifetime at the current binding.
+   */
+  StorageToken AllocInArena(StorageToken prototype, const CallNode* call) {
+    ICHECK(!block_stack_.empty());
+    StorageToken token = allocator_.Alloc(prototype, this->n_storage_++);
+    arena_interval_index_[token.get()] = arena_intervals_.size();
+    arena_intervals_.push_back({token, call, block_stack_.back(), binding_index_, binding_index_});
+    return token;
+  }
+
+  /*!
+   * \brief Pack the tokens in the arenas of the function that was just visited, and make their
+   * alloc_tensors use the arenas at the packed offsets.
+   */
+  void PackArenas() {
+    // Group the tokens by their blocks, in the order of the blocks.
+    std::vector<const BindingBlockNode*> blocks;
+    std::unordered_map<const BindingBlockNode*, std::vector<const ArenaInterval*>> block2intervals;
+    for (const ArenaInterval& interval : arena_intervals_) {
+      std::vector<const ArenaInterval*>& intervals = block2intervals[interval.block];
+      if (intervals.empty()) {
+        blocks.push_back(interval.block);
+      }
+      intervals.push_back(&interval);
+    }
+    for (const BindingBlockNode* block : blocks) {
+      std::vector<const ArenaInterval*>& intervals = block2intervals[block];
+      std::vector<int64_t> offsets = PackIntervals(intervals);
+      int64_t arena_bytes = 0;
+      for (size_t i = 0; i < intervals.size(); ++i) {
+        arena_bytes = std::max(arena_bytes, offsets[i] + intervals[i]->token->const_bytes());
+      }
+      StorageToken arena({tir::make_const(DataType::Int(64), arena_bytes)}, DataType::UInt(8),
+                         "global");
+      arena->storage_id = this->n_storage_++;
+      for (size_t i = 0; i < intervals.size(); ++i) {
+        alloc_tensor2token.at(intervals[i]->call) = arena;
+        alloc_tensor2offset[intervals[i]->call] = offsets[i];
+      }
+    }
+    arena_intervals_.clear();
+    arena_interval_index_.clear();
+  }
+
+  /*!
+   * \brief Assign the byte offsets of tokens, such that the tokens whose lifetimes overlap do
+   * not overlap in the arena.
+   * \details The tokens are placed from the largest to the smallest. Each is placed into the
+   * smallest gap between the placed tokens that are alive at the same time, that fits it, or
+   * after all of them when there is no such gap.
+   * \param intervals The lifetime intervals of the tokens.
+   * \return The byte offsets of the tokens, which are aligned to kAllocAlignment.
+   */
+  static std::vector<int64_t> PackIntervals(const std::vector<const ArenaInterval*>& intervals) {
+    auto aligned_bytes = [](const ArenaInterval* interval) {
+      int64_t bytes = interval->token->const_bytes();
+      return (bytes + runtime::kAllocAlignment - 1) / runtime::kAllocAlignment *
+             runtime::kAllocAlignment;
+    };
+    std::vector<size_t> order(intervals.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+      return aligned_bytes(intervals[lhs]) > aligned_bytes(intervals[rhs]);
+    });
+
+    std::vector<int64_t> offsets(intervals.size(), -1);
+    std::vector<size_t> placed;
+    for (size_t i : order) {
+      int64_t bytes = aligned_bytes(intervals[i]);
+      // The placed tokens that are alive together with this one, by their offsets.
+      std::vector<std::pair<int64_t, int64_t>> conflicts;
+      for (size_t j : placed) {
+        if (intervals[j]->start <= intervals[i]->end && intervals[i]->start <= intervals[j]->end) {
+          conflicts.emplace_back(offsets[j], offsets[j] + aligned_bytes(intervals[j]));
+        }
+      }
+      std::sort(conflicts.begin(), conflicts.end());
+      int64_t best_offset = -1;
+      int64_t best_gap = std::numeric_limits<int64_t>::max();
+      int64_t gap_begin = 0;
+      for (const auto& [begin, end] : conflicts) {
+        int64_t gap = begin - gap_begin;
+        if (gap >= bytes && gap < best_gap) {
+          best_offset = gap_begin;
+          best_gap = gap;
+        }
+        gap_begin = std::max(gap_begin, end);
+      }
+      offsets[i] = best_offset != -1 ? best_offset : gap_begin;
+      placed.push_back(i);
+    }
+    return offsets;
+  }
+
   /*! \brief Number of allocated storages. */
   int n_storage_{0};
   /*! \brief The 1D memory allocator. */
   TokenAllocator1D allocator_;
+  /*! \brief A boolean indicating whether to plan constant-size tokens into arenas. */
+  bool use_arena_;
+  /*! \brief The index of the binding being visited. */
+  int binding_index_{0};
+  /*! \brief The lifetimes of the tokens in the arenas of the function being visited. */
+  std::vector<ArenaInterval> arena_intervals_;
+  /*! \brief The mapping from each token in an arena to the index of its lifetime. */
+  std::unordered_map<const StorageTokenNode*, size_t> arena_interval_index_;
   /*! \brief The mapping from each token to the tensors that are currently using it. */
   std::unordered_map<const StorageTokenNode*, std::vector<Var>> token2cur_tensor_;
 };
@@ -836,10 +1009,12 @@ class StorageAllocationRewriter : public ExprMutator {
  public:
   explicit StorageAllocationRewriter(
       IRModule mod, std::unordered_map<const ExprNode*, StorageToken> alloc_tensor2token,
+      std::unordered_map<const ExprNode*, int64_t> alloc_tensor2offset,
       std::unordered_map<const BindingBlockNode*, std::vector<const StorageTokenNode*>>
           block2tokens)
       : ExprMutator(std::move(mod)),
         alloc_tensor2token_(std::move(alloc_tensor2token)),
+        alloc_tensor2offset_(std::move(alloc_tensor2offset)),
         block2tokens_(std::move(block2tokens)) {}
 
   IRModule Rewrite() {
@@ -901,7 +1076,9 @@ class StorageAllocationRewriter : public ExprMutator {
       }
 
       // And always create a `memory.alloc_tensor` for the old `builtin.alloc_tensor`.
-      PrimValue offset = PrimValue::Int64(0);
+      auto it_offset = alloc_tensor2offset_.find(call);
+      PrimValue offset =
+          PrimValue::Int64(it_offset != alloc_tensor2offset_.end() ? it_offset->second : 0);
       DataType dtype = sinfo->dtype;
       return Call(mem_alloc_tensor, {storage_var, offset, sinfo->shape.value(), DataTypeImm(dtype)},
                   Attrs());
@@ -952,33 +1129,46 @@ class StorageAllocationRewriter : public ExprMutator {
    its corresponding underlying storage token that it is using.
    */
   std::unordered_map<const ExprNode*, StorageToken> alloc_tensor2token_;
+  /*! \brief The byte offset of each `builtin.alloc_tensor` that is planned into an arena. */
+  std::unordered_map<const ExprNode*, int64_t> alloc_tensor2offset_;
   /*! \brief The mapping from each binding block to the storage tokens that are create inside. */
   std::unordered_map<const BindingBlockNode*, std::vector<const StorageTokenNode*>> block2tokens_;
   /*! \brief The mapping from each token to its corresponding storage var in each function. */
   std::unordered_map<const StorageTokenNode*, Var> token2storage_var_;
 };
 
-IRModule StaticPlanBlockMemory(IRModule mod) {
+IRModule StaticPlanBlockMemory(IRModule mod, bool use_arena) {
   arith::Analyzer ana;
 
   // Step 1. Initialize.
   std::unordered_map<const ExprNode*, Tokens> token_map =
       StorageAllocatorInit::Initialize(mod, &ana);
   // Step 2. Collect the memory allocation info.
-  StorageAllocator allocator(std::move(token_map), &ana);
+  StorageAllocator allocator(std::move(token_map), &ana, use_arena);
   allocator.Allocate(mod);
   // Step 3. Rewrite the function.
   StorageAllocationRewriter rewriter(std::move(mod),  //
                                      std::move(allocator.alloc_tensor2token),
+                                     std::move(allocator.alloc_tensor2offset),
                                      std::move(allocator.block2tokens));
   return rewriter.Rewrite();
 }
 
 namespace transform {
 
+TVM_REGISTER_PASS_CONFIG_OPTION("relax.StaticPlanBlockMemory.planner", String);
+
 Pass StaticPlanBlockMemory() {
   runtime::TypedPackedFunc<IRModule(IRModule, PassContext)> pass_func =
-      [=](IRModule m, PassContext pc) { return relax::StaticPlanBlockMemory(std::move(m)); };
+      [=](IRModule m, PassContext pc) {
+        String planner =
+            pc->GetConfig<String>("relax.StaticPlanBlockMemory.planner").value_or("pool");
+        CHECK(planner == "pool" || planner == "arena")
+            << "ValueError: The planner of StaticPlanBlockMemory should be \"pool\" or "
+               "\"arena\", but got "
+            << planner;
+        return relax::StaticPlanBlockMemory(std::move(m), planner == "arena");
+      };
   return CreateModulePass(pass_func, /*opt_level=*/0, "StaticPlanBlockMemory", {});
 }
 
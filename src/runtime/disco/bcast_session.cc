@@ -21,6 +21,7 @@
 #include <tvm/runtime/disco/session.h>
 #include <tvm/runtime/packed_func.h>
 #include <tvm/runtime/registry.h>
+#include <tvm/runtime/trace_event.h>
 
 #include <sstream>
 
@@ -35,6 +36,7 @@ struct BcastSessionObj::Internal {
     TVMValue values[kNumArgs];
     int type_codes[kNumArgs];
     PackArgs(values, type_codes, static_cast<int>(action), reg_id, std::forward<Args>(args)...);
+    profiling::TraceScope trace_scope("disco", DiscoAction2String(action), "reg_id", reg_id);
     self->BroadcastPacked(TVMArgs(values, type_codes, kNumArgs));
   }
 
@@ -76,6 +78,7 @@ void BcastSessionObj::InitCCL(String ccl, IntTuple device_ids) {
 }
 
 void BcastSessionObj::SyncWorker(int worker_id) {
+  profiling::TraceScope trace_scope("disco", "sync worker", "worker_id", worker_id);
   BcastSessionObj::Internal::BroadcastUnpacked(this, DiscoAction::kSyncWorker, worker_id);
   TVMArgs args = this->RecvReplyPacked(worker_id);
   ICHECK_EQ(args.size(), 2);
@@ -115,7 +118,10 @@ DRef BcastSessionObj::CallWithPacked(const TVMArgs& args) {
       LOG(FATAL) << "CallWithPacked() does not support " << cnt << " argument(s):" << os.str();
     }
   }
-  this->BroadcastPacked(TVMArgs(values, type_codes, num_args));
+  {
+    profiling::TraceScope trace_scope("disco", "kCallPacked", "reg_id", reg_id);
+    this->BroadcastPacked(TVMArgs(values, type_codes, num_args));
+  }
   return BcastSessionObj::Internal::MakeDRef(reg_id, GetRef<Session>(this));
 }
 
@@ -112,6 +112,11 @@ class CUDAIPCMemoryAllocator final : public memory::PooledAllocator {
     return data_ptr;
   }
 
+  bool AllowSplit(Device dev) const final {
+    // The IPC memory objects are looked up by the pointers from DeviceAllocDataSpace.
+    return false;
+  }
+
   void DeviceFreeDataSpace(Device dev, void* ptr) final {
     ICHECK(dev.device_type == kDLCUDA);
     CUDA_CALL(cudaSetDevice(dev.device_id));
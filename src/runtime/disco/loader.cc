@@ -157,8 +157,8 @@ class ShardLoaderObj : public Object {
   std::unordered_map<std::string, int> param_name_to_index_;
   /*! \brief The current file opened to load weights in it */
   mutable const FileRecord* current_file_;
-  /*! \brief The context of the current file to be loaded from */
-  mutable std::string current_file_stream_;
+  /*! \brief The current file mapped into memory to load weights from */
+  mutable MappedFile current_file_mapping_;
 
  private:
   /*! \brief Load the i-th parameter without post-processing
@@ -252,9 +252,11 @@ NDArray ShardLoaderObj::LoadParamOnWorker0(int weight_index) const {
     if (file != current_file_) {
       current_file_ = file;
       std::string file_name = GetSiblingPath(this->metadata_.path, file->data_path);
-      LoadBinaryFromFile(file_name, &this->current_file_stream_);
+      current_file_mapping_ = MappedFile::Open(file_name);
+      current_file_mapping_->Advise(0, current_file_mapping_->size(),
+                                    MappedFileObj::Advice::kSequential);
     }
-    return param->Load(device, &this->current_file_stream_);
+    return param->Load(device, this->current_file_mapping_->data());
   };
 
   if (worker_id == 0) {
@@ -299,9 +301,11 @@ NDArray ShardLoaderObj::LoadDirect(int weight_index) const {
   if (file != current_file_) {
     current_file_ = file;
     std::string file_name = GetSiblingPath(this->metadata_.path, file->data_path);
-    LoadBinaryFromFile(file_name, &this->current_file_stream_);
+    current_file_mapping_ = MappedFile::Open(file_name);
+    current_file_mapping_->Advise(0, current_file_mapping_->size(),
+                                  MappedFileObj::Advice::kSequential);
   }
-  return param->Load(device, &this->current_file_stream_);
+  return param->Load(device, this->current_file_mapping_->data());
 }
 
 NDArray ShardLoaderObj::Load(int weight_index) const {
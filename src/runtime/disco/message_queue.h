@@ -40,6 +40,20 @@ class DiscoStreamMessageQueue : private dmlc::Stream,
     CommitSendAndNotifyEnqueue();
   }
 
+  /*!
+   * \brief Serialize a message without sending it, e.g. to broadcast it with SendSerialized to
+   * the queues of many workers while serializing it only once.
+   */
+  std::string Serialize(const TVMArgs& args) {
+    RPCReference::ReturnPackedSeq(args.values, args.type_codes, args.num_args, this);
+    std::string packet;
+    packet.swap(write_buffer_);
+    return packet;
+  }
+
+  /*! \brief Send a message serialized by Serialize. */
+  void SendSerialized(const std::string& packet) { stream_->Write(packet.data(), packet.size()); }
+
   TVMArgs Recv() {
     bool is_implicit_shutdown = DequeueNextPacket();
     TVMValue* values = nullptr;
@@ -24,15 +24,23 @@
 
 #include <memory>
 #include <sstream>
+#include <string>
 #include <utility>
 #include <vector>
 
+#ifdef TVM_DISCO_SHM_ENABLED
+#include <poll.h>
+#endif
+
 #include "../../support/pipe.h"
 #include "../minrpc/rpc_reference.h"
 #include "./bcast_session.h"
 #include "./disco_worker_thread.h"
 #include "./message_queue.h"
 #include "./protocol.h"
+#ifdef TVM_DISCO_SHM_ENABLED
+#include "./shm/shm_channel.h"
+#endif
 
 namespace tvm {
 namespace runtime {
@@ -40,28 +48,96 @@ namespace runtime {
 class DiscoProcessChannel final : public DiscoChannel {
  public:
   DiscoProcessChannel(int64_t controler_to_worker_fd, int64_t worker_to_controler_fd)
-      : controller_to_worker_pipe_(controler_to_worker_fd),
+      : controler_to_worker_fd_(controler_to_worker_fd),
+        worker_to_controler_fd_(worker_to_controler_fd),
+        controller_to_worker_pipe_(controler_to_worker_fd),
         worker_to_controller_pipe_(worker_to_controler_fd),
-        controler_to_worker_(&controller_to_worker_pipe_),
-        worker_to_controler_(&worker_to_controller_pipe_) {}
+        controler_to_worker_(
+            std::make_unique<DiscoStreamMessageQueue>(&controller_to_worker_pipe_)),
+        worker_to_controler_(
+            std::make_unique<DiscoStreamMessageQueue>(&worker_to_controller_pipe_)) {}
 
   DiscoProcessChannel(DiscoProcessChannel&& other) = delete;
   DiscoProcessChannel(const DiscoProcessChannel& other) = delete;
 
-  void Send(const TVMArgs& args) { controler_to_worker_.Send(args); }
-  TVMArgs Recv() { return controler_to_worker_.Recv(); }
-  void Reply(const TVMArgs& args) { worker_to_controler_.Send(args); }
-  TVMArgs RecvReply() { return worker_to_controler_.Recv(); }
+  void Send(const TVMArgs& args) { controler_to_worker_->Send(args); }
+  TVMArgs Recv() { return controler_to_worker_->Recv(); }
+  void Reply(const TVMArgs& args) { worker_to_controler_->Send(args); }
+  TVMArgs RecvReply() { return worker_to_controler_->Recv(); }
+
+  std::string Serialize(const TVMArgs& args) { return controler_to_worker_->Serialize(args); }
+  void SendSerialized(const std::string& packet) { controler_to_worker_->SendSerialized(packet); }
+
+  /*!
+   * \brief The first message over the pipes, from the controler, which names the shared memory
+   * segment to move the messages to, or is empty to keep the pipes.
+   */
+  void SendSegmentName(const std::string& name) {
+    uint64_t size = name.size();
+    controller_to_worker_pipe_.Write(&size, sizeof(size));
+    controller_to_worker_pipe_.Write(name.data(), size);
+  }
+
+  std::string RecvSegmentName() {
+    uint64_t size = 0;
+    ICHECK_EQ(controller_to_worker_pipe_.Read(&size, sizeof(size)), sizeof(size))
+        << "The disco controler has exited before the worker started";
+    std::string name(size, '\0');
+    ICHECK_EQ(controller_to_worker_pipe_.Read(name.data(), size), size);
+    return name;
+  }
+
+#ifdef TVM_DISCO_SHM_ENABLED
+  /*!
+   * \brief Move the messages from the pipes to the rings of a shared memory segment. The worker
+   * acknowledges that it has mapped the segment, after which the controler may unlink it.
+   * \param segment The segment.
+   * \param is_controler Whether this is the controler end of the channel.
+   */
+  void AttachSegment(std::unique_ptr<ShmChannelSegment> segment, bool is_controler) {
+    if (is_controler) {
+      char ack = 0;
+      ICHECK_EQ(worker_to_controller_pipe_.Read(&ack, 1), 1)
+          << "A disco worker has exited before attaching to its shared memory channel";
+    } else {
+      char ack = 1;
+      worker_to_controller_pipe_.Write(&ack, 1);
+    }
+    // Nothing is sent over the pipes anymore, so the one we read from becomes readable or hangs
+    // up only when the peer exits.
+    int fd = static_cast<int>(is_controler ? worker_to_controler_fd_ : controler_to_worker_fd_);
+    auto peer_alive = [fd]() {
+      struct pollfd pfd = {fd, POLLIN, 0};
+      return poll(&pfd, 1, 0) == 0;
+    };
+    controller_to_worker_stream_ =
+        std::make_unique<ShmRingStream>(segment->controller_to_worker(), peer_alive);
+    worker_to_controller_stream_ =
+        std::make_unique<ShmRingStream>(segment->worker_to_controller(), peer_alive);
+    controler_to_worker_ =
+        std::make_unique<DiscoStreamMessageQueue>(controller_to_worker_stream_.get());
+    worker_to_controler_ =
+        std::make_unique<DiscoStreamMessageQueue>(worker_to_controller_stream_.get());
+    segment_ = std::move(segment);
+  }
+
+  std::unique_ptr<ShmChannelSegment> segment_;
+  std::unique_ptr<ShmRingStream> controller_to_worker_stream_;
+  std::unique_ptr<ShmRingStream> worker_to_controller_stream_;
+#endif
 
+  int64_t controler_to_worker_fd_;
+  int64_t worker_to_controler_fd_;
   support::Pipe controller_to_worker_pipe_;
   support::Pipe worker_to_controller_pipe_;
-  DiscoStreamMessageQueue controler_to_worker_;
-  DiscoStreamMessageQueue worker_to_controler_;
+  std::unique_ptr<DiscoStreamMessageQueue> controler_to_worker_;
+  std::unique_ptr<DiscoStreamMessageQueue> worker_to_controler_;
 };
 
 class ProcessSessionObj final : public BcastSessionObj {
  public:
-  explicit ProcessSessionObj(int num_workers, int num_groups, PackedFunc process_pool)
+  explicit ProcessSessionObj(int num_workers, int num_groups, PackedFunc process_pool,
+                             const std::string& channel)
       : process_pool_(process_pool),
         worker_0_(
             std::make_unique<DiscoWorkerThread>(0, num_workers, num_groups, &worker_zero_data_)) {
@@ -79,6 +155,25 @@ class ProcessSessionObj final : public BcastSessionObj {
     for (int i = 0; i < num_workers - 1; ++i) {
       workers_.emplace_back(std::make_unique<DiscoProcessChannel>(write_fds[i], read_fds[i]));
     }
+    if (channel == "pipe") {
+      for (std::unique_ptr<DiscoProcessChannel>& worker : workers_) {
+        worker->SendSegmentName("");
+      }
+      return;
+    }
+#ifdef TVM_DISCO_SHM_ENABLED
+    // Name the segments to all workers first, so that they attach to them concurrently.
+    std::vector<std::unique_ptr<ShmChannelSegment>> segments;
+    for (std::unique_ptr<DiscoProcessChannel>& worker : workers_) {
+      segments.push_back(ShmChannelSegment::Create(kShmChannelCapacity));
+      worker->SendSegmentName(segments.back()->memory()->name());
+    }
+    for (int i = 0; i < num_workers - 1; ++i) {
+      SharedMemory* memory = segments[i]->memory();
+      workers_[i]->AttachSegment(std::move(segments[i]), /*is_controler=*/true);
+      memory->Unlink();
+    }
+#endif
   }
 
   void Kill() {
@@ -143,8 +238,12 @@ class ProcessSessionObj final : public BcastSessionObj {
 
   void BroadcastPacked(const TVMArgs& args) final {
     worker_0_->channel->Send(args);
+    if (workers_.empty()) {
+      return;
+    }
+    std::string packet = workers_[0]->Serialize(args);
     for (std::unique_ptr<DiscoProcessChannel>& channel : workers_) {
-      channel->Send(args);
+      channel->SendSerialized(packet);
     }
   }
 
@@ -170,6 +269,9 @@ class ProcessSessionObj final : public BcastSessionObj {
     return workers_.at(worker_id - 1).get();
   }
 
+  /*! \brief The capacity of the ring of each direction of a shared memory channel. */
+  static constexpr size_t kShmChannelCapacity = 1 << 20;
+
   PackedFunc process_pool_;
   std::unique_ptr<DiscoWorkerThread> worker_0_;
   std::vector<std::unique_ptr<DiscoProcessChannel>> workers_;
@@ -182,14 +284,20 @@ TVM_REGISTER_OBJECT_TYPE(DiscoDebugObject);
 TVM_REGISTER_OBJECT_TYPE(ProcessSessionObj);
 
 Session Session::ProcessSession(int num_workers, int num_group, String process_pool_creator,
-                                String entrypoint) {
+                                String entrypoint, String channel) {
   CHECK_EQ(num_workers % num_group, 0)
       << "The number of workers should be divisible by the number of worker group.";
+  CHECK(channel == "pipe" || channel == "shm")
+      << "ValueError: Unknown channel " << channel << ", which should be \"pipe\" or \"shm\".";
+#ifndef TVM_DISCO_SHM_ENABLED
+  CHECK(channel != "shm") << "ValueError: The shared memory channel is not supported on this "
+                             "platform. Please use the \"pipe\" channel instead.";
+#endif
   const PackedFunc* pf = Registry::Get(process_pool_creator);
   CHECK(pf) << "ValueError: Cannot find function " << process_pool_creator
             << " in the registry. Please check if it is registered.";
   PackedFunc process_pool = (*pf)(num_workers, num_group, entrypoint);
-  auto n = make_object<ProcessSessionObj>(num_workers, num_group, process_pool);
+  auto n = make_object<ProcessSessionObj>(num_workers, num_group, process_pool, channel);
   return Session(n);
 }
 
@@ -198,6 +306,14 @@ void WorkerProcess(int worker_id, int num_workers, int num_group, int64_t read_f
   CHECK_EQ(num_workers % num_group, 0)
       << "The number of workers should be divisible by the number of worker group.";
   DiscoProcessChannel channel(read_fd, write_fd);
+  std::string segment_name = channel.RecvSegmentName();
+  if (!segment_name.empty()) {
+#ifdef TVM_DISCO_SHM_ENABLED
+    channel.AttachSegment(ShmChannelSegment::Open(segment_name), /*is_controler=*/false);
+#else
+    LOG(FATAL) << "The shared memory channel is not supported on this platform";
+#endif
+  }
   DiscoWorker worker(worker_id, num_workers, num_group, nullptr, &channel);
   worker.MainLoop();
 }
@@ -0,0 +1,120 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "./shared_memory.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tvm/runtime/logging.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+#include "../../../support/process_id.h"
+
+namespace tvm {
+namespace runtime {
+
+std::unique_ptr<SharedMemory> SharedMemory::Create(const std::string& prefix, size_t nbytes) {
+  static std::atomic<int> counter{0};
+  std::ostringstream os;
+  os << "/" << prefix << "-" << support::GetProcessId() << "-" << counter++;
+  std::string name = os.str();
+  // A segment left behind by a crashed process with the same pid is stale.
+  shm_unlink(name.c_str());
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  CHECK_NE(fd, -1) << "Cannot create the shared memory segment " << name << ": "
+                   << strerror(errno);
+  if (ftruncate(fd, nbytes) != 0) {
+    int err = errno;
+    close(fd);
+    shm_unlink(name.c_str());
+    LOG(FATAL) << "Cannot allocate " << nbytes << " bytes for the shared memory segment " << name
+               << ": " << strerror(err);
+  }
+  void* data = mmap(nullptr, nbytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  int err = errno;
+  close(fd);
+  if (data == MAP_FAILED) {
+    shm_unlink(name.c_str());
+    LOG(FATAL) << "Cannot map the shared memory segment " << name << ": " << strerror(err);
+  }
+  return std::unique_ptr<SharedMemory>(new SharedMemory(name, static_cast<char*>(data), nbytes));
+}
+
+std::unique_ptr<SharedMemory> SharedMemory::Open(const std::string& name) {
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  CHECK_NE(fd, -1) << "Cannot open the shared memory segment " << name << ": " << strerror(errno);
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0) << "Cannot stat the shared memory segment " << name;
+  void* data = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  int err = errno;
+  close(fd);
+  CHECK(data != MAP_FAILED) << "Cannot map the shared memory segment " << name << ": "
+                            << strerror(err);
+  return std::unique_ptr<SharedMemory>(
+      new SharedMemory(name, static_cast<char*>(data), st.st_size));
+}
+
+SharedMemory::~SharedMemory() { munmap(data_, size_); }
+
+void SharedMemory::Unlink() { shm_unlink(name_.c_str()); }
+
+#ifdef __linux__
+
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, int64_t timeout_us) {
+  struct timespec timeout;
+  timeout.tv_sec = timeout_us / 1000000;
+  timeout.tv_nsec = (timeout_us % 1000000) * 1000;
+  // Not FUTEX_PRIVATE_FLAG: the word may be shared with another process.
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, &timeout, nullptr,
+          0);
+}
+
+void FutexWake(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr,
+          0);
+}
+
+#else
+
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, int64_t timeout_us) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_us);
+  while (word->load(std::memory_order_acquire) == expected &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+}
+
+void FutexWake(std::atomic<uint32_t>* word) {}
+
+#endif
+
+}  // namespace runtime
+}  // namespace tvm
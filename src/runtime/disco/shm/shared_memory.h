@@ -0,0 +1,100 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file shared_memory.h
+ * \brief Named POSIX shared memory, and the primitives disco uses to synchronize through it.
+ */
+#ifndef TVM_RUNTIME_DISCO_SHM_SHARED_MEMORY_H_
+#define TVM_RUNTIME_DISCO_SHM_SHARED_MEMORY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace tvm {
+namespace runtime {
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+                  std::atomic<uint64_t>::is_always_lock_free,
+              "Disco requires lock-free atomics to synchronize across processes");
+
+/*! \brief A named POSIX shared memory segment, mapped into the current process. */
+class SharedMemory {
+ public:
+  /*!
+   * \brief Create a zero-filled segment, named uniquely by the prefix, the process and a counter.
+   * \param prefix The prefix of the name, e.g. "tvm-disco-shm".
+   * \param nbytes The size of the segment.
+   */
+  static std::unique_ptr<SharedMemory> Create(const std::string& prefix, size_t nbytes);
+  /*! \brief Open a segment created by another process, or by this one. */
+  static std::unique_ptr<SharedMemory> Open(const std::string& name);
+
+  ~SharedMemory();
+  SharedMemory(const SharedMemory&) = delete;
+  SharedMemory& operator=(const SharedMemory&) = delete;
+
+  /*!
+   * \brief Remove the name of the segment. The memory is freed once the last process unmaps it,
+   * so a segment is unlinked as soon as every process has opened it, and not leaked if one dies.
+   */
+  void Unlink();
+
+  const std::string& name() const { return name_; }
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  SharedMemory(std::string name, char* data, size_t size)
+      : name_(std::move(name)), data_(data), size_(size) {}
+
+  std::string name_;
+  char* data_;
+  size_t size_;
+};
+
+/*! \brief The number of polls before a waiting thread starts yielding its core. */
+constexpr int kSharedMemorySpinCount = 1 << 10;
+
+/*! \brief Poll `pred` until it holds, yielding the core after a short spin. */
+template <typename Pred>
+inline void SpinWait(Pred pred) {
+  for (int i = 0; !pred(); ++i) {
+    if (i >= kSharedMemorySpinCount) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+/*!
+ * \brief Sleep while `*word == expected`, until woken by FutexWake or until the timeout.
+ * \note The word may be shared across processes. On platforms without futexes it sleeps briefly.
+ */
+void FutexWait(std::atomic<uint32_t>* word, uint32_t expected, int64_t timeout_us);
+
+/*! \brief Wake all threads sleeping on `word` in FutexWait. */
+void FutexWake(std::atomic<uint32_t>* word);
+
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_DISCO_SHM_SHARED_MEMORY_H_
@@ -0,0 +1,705 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file shm_ccl.cc
+ * \brief A collective communication library over POSIX shared memory, for CPU workers that run
+ * on the same host, either as threads (ThreadedSession) or as processes (ProcessSession).
+ *
+ * The controller creates one shared segment per session. Each worker owns a slot in it, and
+ * every collective moves its data through the slots in chunks of at most the slot size:
+ * a worker copies its chunk into its slot, the workers meet at a barrier, then each worker reads
+ * the slots it needs. Allreduce is a reduce-scatter followed by an allgather over the slots, so
+ * every worker reduces 1/n of each chunk. Point-to-point transfers use a dedicated channel per
+ * ordered pair of workers, so they never interfere with collectives.
+ */
+#include <tvm/runtime/builtin_fp16.h>
+#include <tvm/runtime/disco/builtin.h>
+#include <tvm/runtime/disco/disco_worker.h>
+#include <tvm/runtime/disco/session.h>
+#include <tvm/runtime/registry.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "./shared_memory.h"
+
+namespace tvm {
+namespace runtime {
+namespace shm {
+
+/*! \brief The magic number at the beginning of a segment, "TVMDSHM1" in little endian. */
+constexpr uint64_t kSegmentMagic = 0x314D4853444D5654;
+/*! \brief The bytes of the slot each worker owns for collectives. */
+constexpr int64_t kSlotBytes = 4 << 20;
+/*! \brief The bytes of the channel of each ordered pair of workers. */
+constexpr int64_t kChannelBytes = 1 << 20;
+/*! \brief A sense-reversing barrier that lives in the shared segment. */
+struct alignas(64) Barrier {
+  std::atomic<uint32_t> count{0};
+  std::atomic<uint32_t> generation{0};
+
+  void Wait(uint32_t num_parties) {
+    uint32_t gen = generation.load(std::memory_order_acquire);
+    if (count.fetch_add(1, std::memory_order_acq_rel) + 1 == num_parties) {
+      count.store(0, std::memory_order_relaxed);
+      generation.fetch_add(1, std::memory_order_release);
+    } else {
+      SpinWait([&]() { return generation.load(std::memory_order_acquire) != gen; });
+    }
+  }
+};
+
+/*! \brief The state of a point-to-point channel, counting the chunks posted and consumed. */
+struct alignas(64) ChannelFlags {
+  std::atomic<uint64_t> posted{0};
+  std::atomic<uint64_t> consumed{0};
+};
+
+struct SegmentHeader {
+  uint64_t magic;
+  int64_t num_workers;
+  int64_t slot_bytes;
+  int64_t channel_bytes;
+};
+
+/*!
+ * \brief The layout of a segment: the header, the barriers (the global one first, then one per
+ * worker group), the channel flags, the slots, and the channels.
+ */
+struct SegmentLayout {
+  SegmentLayout(int64_t num_workers, int64_t slot_bytes, int64_t channel_bytes) {
+    barriers = 64;
+    channel_flags = barriers + (num_workers + 1) * sizeof(Barrier);
+    slots = channel_flags + num_workers * num_workers * sizeof(ChannelFlags);
+    channels = slots + num_workers * slot_bytes;
+    total = channels + num_workers * num_workers * channel_bytes;
+  }
+
+  int64_t barriers;
+  int64_t channel_flags;
+  int64_t slots;
+  int64_t channels;
+  int64_t total;
+};
+
+/*! \brief The segment shared by the workers of a session. */
+class ShmSegment {
+ public:
+  /*!
+   * \brief Create and initialize a segment for `num_workers` workers.
+   * \return The segment, whose name is to be opened by the workers.
+   */
+  static std::unique_ptr<SharedMemory> Create(int64_t num_workers) {
+    SegmentLayout layout(num_workers, kSlotBytes, kChannelBytes);
+    std::unique_ptr<SharedMemory> memory = SharedMemory::Create("tvm-disco-shm", layout.total);
+    char* data = memory->data();
+    new (data) SegmentHeader{kSegmentMagic, num_workers, kSlotBytes, kChannelBytes};
+    new (data + layout.barriers) Barrier[num_workers + 1];
+    new (data + layout.channel_flags) ChannelFlags[num_workers * num_workers];
+    return memory;
+  }
+
+  explicit ShmSegment(const std::string& name) : memory_(SharedMemory::Open(name)) {
+    data_ = memory_->data();
+    const SegmentHeader* header = reinterpret_cast<const SegmentHeader*>(data_);
+    CHECK_EQ(header->magic, kSegmentMagic) << "Invalid shared memory segment " << name;
+    num_workers_ = header->num_workers;
+    slot_bytes_ = header->slot_bytes;
+    channel_bytes_ = header->channel_bytes;
+    layout_ = SegmentLayout(num_workers_, slot_bytes_, channel_bytes_);
+    CHECK_EQ(layout_.total, memory_->size()) << "Invalid shared memory segment " << name;
+  }
+
+  int64_t num_workers() const { return num_workers_; }
+  int64_t slot_bytes() const { return slot_bytes_; }
+  int64_t channel_bytes() const { return channel_bytes_; }
+
+  Barrier* barrier(int index) const {
+    return reinterpret_cast<Barrier*>(data_ + layout_.barriers) + index;
+  }
+  ChannelFlags* channel_flags(int sender, int receiver) const {
+    return reinterpret_cast<ChannelFlags*>(data_ + layout_.channel_flags) +
+           sender * num_workers_ + receiver;
+  }
+  char* slot(int worker_id) const { return data_ + layout_.slots + worker_id * slot_bytes_; }
+  char* channel(int sender, int receiver) const {
+    return data_ + layout_.channels + (sender * num_workers_ + receiver) * channel_bytes_;
+  }
+
+ private:
+  std::unique_ptr<SharedMemory> memory_;
+  char* data_;
+  int64_t num_workers_;
+  int64_t slot_bytes_;
+  int64_t channel_bytes_;
+  SegmentLayout layout_{0, 0, 0};
+};
+
+/*! \brief The workers taking part in a collective: either all of them, or the caller's group. */
+struct Team {
+  /*! \brief The worker id of the first member, which is the root of the team. */
+  int begin;
+  /*! \brief The number of members. */
+  int size;
+  /*! \brief The rank of the calling worker in the team. */
+  int rank;
+  /*! \brief The barrier of the team. */
+  Barrier* barrier;
+
+  bool is_root() const { return rank == 0; }
+  void Sync() const { barrier->Wait(size); }
+};
+
+struct ShmCCLContext {
+  std::unique_ptr<ShmSegment> segment = nullptr;
+  DiscoWorker* worker = nullptr;
+
+  static ShmCCLContext* Get() {
+    thread_local static ShmCCLContext ctx;
+    return &ctx;
+  }
+
+  static ShmCCLContext* GetInitialized() {
+    ShmCCLContext* ctx = Get();
+    CHECK(ctx->worker != nullptr) << "The shm CCL is not initialized on this worker";
+    return ctx;
+  }
+
+  Team GetTeam(bool in_group) const {
+    int group_size = worker->num_workers / worker->num_groups;
+    if (!in_group) {
+      return Team{0, worker->num_workers, worker->worker_id, segment->barrier(0)};
+    }
+    int group_id = worker->worker_id / group_size;
+    return Team{group_id * group_size, group_size, worker->worker_id % group_size,
+                segment->barrier(1 + group_id)};
+  }
+};
+
+inline char* GetDataPtr(const NDArray& array) {
+  CHECK(array->device.device_type == kDLCPU)
+      << "ValueError: The shm CCL only supports arrays on CPU, but got an array on "
+      << array->device;
+  return static_cast<char*>(array->data) + array->byte_offset;
+}
+
+inline int64_t GetNumBytes(const NDArray& array) {
+  return array.Shape()->Product() * DataType(array->dtype).bytes();
+}
+
+/*! \brief The range [begin, begin + size) of the `index`-th of `parts` near-equal parts of `n`. */
+inline std::pair<int64_t, int64_t> Partition(int64_t n, int parts, int index) {
+  int64_t base = n / parts;
+  int64_t rem = n % parts;
+  return {index * base + std::min<int64_t>(index, rem), base + (index < rem ? 1 : 0)};
+}
+
+/******** Reduction kernels ********/
+
+struct Float16 {
+  uint16_t bits;
+};
+
+struct BFloat16 {
+  uint16_t bits;
+};
+
+/*! \brief Loads elements of type T into the type reduced in, and stores them back. */
+template <typename T>
+struct Elem {
+  using Acc = T;
+  static Acc Load(T v) { return v; }
+  static T Store(Acc v) { return v; }
+};
+
+template <>
+struct Elem<Float16> {
+  using Acc = float;
+  static float Load(Float16 v) { return __gnu_h2f_ieee(v.bits); }
+  static Float16 Store(float v) { return Float16{__gnu_f2h_ieee(v)}; }
+};
+
+template <>
+struct Elem<BFloat16> {
+  using Acc = float;
+  static float Load(BFloat16 v) {
+    uint32_t bits = static_cast<uint32_t>(v.bits) << 16;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+  }
+  static BFloat16 Store(float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    if ((bits & 0x7FFFFFFF) > 0x7F800000) {
+      return BFloat16{0x7FC0};
+    }
+    // Round to nearest, ties to even.
+    bits += 0x7FFF + ((bits >> 16) & 1);
+    return BFloat16{static_cast<uint16_t>(bits >> 16)};
+  }
+};
+
+struct SumOp {
+  template <typename T>
+  T operator()(T a, T b) const {
+    return a + b;
+  }
+};
+
+struct ProdOp {
+  template <typename T>
+  T operator()(T a, T b) const {
+    return a * b;
+  }
+};
+
+struct MinOp {
+  template <typename T>
+  T operator()(T a, T b) const {
+    return b < a ? b : a;
+  }
+};
+
+struct MaxOp {
+  template <typename T>
+  T operator()(T a, T b) const {
+    return a < b ? b : a;
+  }
+};
+
+/*!
+ * \brief Reduce `inputs` element-wise into `output`, which may alias one of the inputs.
+ * \note The reduction runs over blocks of a local accumulator, so that each pass is a plain loop
+ * over contiguous arrays that the compiler vectorizes.
+ */
+template <typename T, typename Op>
+void ReduceKernel(const std::vector<const void*>& inputs, void* output, int64_t numel,
+                  bool average) {
+  using Acc = typename Elem<T>::Acc;
+  constexpr int64_t kBlock = 1024;
+  Acc acc[kBlock];
+  Op op;
+  for (int64_t begin = 0; begin < numel; begin += kBlock) {
+    int64_t len = std::min(kBlock, numel - begin);
+    const T* first = static_cast<const T*>(inputs[0]) + begin;
+    for (int64_t i = 0; i < len; ++i) {
+      acc[i] = Elem<T>::Load(first[i]);
+    }
+    for (size_t k = 1; k < inputs.size(); ++k) {
+      const T* in = static_cast<const T*>(inputs[k]) + begin;
+      for (int64_t i = 0; i < len; ++i) {
+        acc[i] = op(acc[i], Elem<T>::Load(in[i]));
+      }
+    }
+    if (average) {
+      Acc n = static_cast<Acc>(inputs.size());
+      for (int64_t i = 0; i < len; ++i) {
+        acc[i] = acc[i] / n;
+      }
+    }
+    T* out = static_cast<T*>(output) + begin;
+    for (int64_t i = 0; i < len; ++i) {
+      out[i] = Elem<T>::Store(acc[i]);
+    }
+  }
+}
+
+using ReduceFunc = void (*)(const std::vector<const void*>&, void*, int64_t, bool);
+
+template <typename Op>
+ReduceFunc GetReduceKernel(DataType dtype) {
+  if (dtype == DataType::Float(32)) return ReduceKernel<float, Op>;
+  if (dtype == DataType::Float(16)) return ReduceKernel<Float16, Op>;
+  if (dtype == DataType::BFloat(16)) return ReduceKernel<BFloat16, Op>;
+  if (dtype == DataType::Float(64)) return ReduceKernel<double, Op>;
+  if (dtype == DataType::Int(8)) return ReduceKernel<int8_t, Op>;
+  if (dtype == DataType::Int(16)) return ReduceKernel<int16_t, Op>;
+  if (dtype == DataType::Int(32)) return ReduceKernel<int32_t, Op>;
+  if (dtype == DataType::Int(64)) return ReduceKernel<int64_t, Op>;
+  if (dtype == DataType::UInt(8)) return ReduceKernel<uint8_t, Op>;
+  if (dtype == DataType::UInt(16)) return ReduceKernel<uint16_t, Op>;
+  if (dtype == DataType::UInt(32)) return ReduceKernel<uint32_t, Op>;
+  if (dtype == DataType::UInt(64)) return ReduceKernel<uint64_t, Op>;
+  LOG(FATAL) << "ValueError: The shm CCL cannot allreduce data type " << dtype;
+  throw;
+}
+
+inline ReduceFunc GetReduceKernel(DataType dtype, ReduceKind kind) {
+  switch (kind) {
+    case ReduceKind::kSum:
+    case ReduceKind::kAvg:
+      return GetReduceKernel<SumOp>(dtype);
+    case ReduceKind::kProd:
+      return GetReduceKernel<ProdOp>(dtype);
+    case ReduceKind::kMin:
+      return GetReduceKernel<MinOp>(dtype);
+    case ReduceKind::kMax:
+      return GetReduceKernel<MaxOp>(dtype);
+  }
+  LOG(FATAL) << "ValueError: Unknown ReduceKind: " << static_cast<int>(kind);
+  throw;
+}
+
+/******** Communication ********/
+
+void InitCCL(Session sess, IntTuple device_ids) {
+  DRef func = sess->GetGlobalFunc("runtime.disco.shm.init_ccl_per_worker");
+  DLOG(INFO) << "Initializing shm with devices: " << device_ids;
+  int num_workers = sess->GetNumWorkers();
+  std::unique_ptr<SharedMemory> segment = ShmSegment::Create(num_workers);
+  std::string name = segment->name();
+  // The name is removed once every worker has opened the segment, or if any of them fails to, so
+  // that the segment is never leaked.
+  try {
+    sess->CallPacked(func, device_ids, name);
+    for (int i = 0; i < num_workers; ++i) {
+      sess->SyncWorker(i);
+    }
+  } catch (...) {
+    segment->Unlink();
+    throw;
+  }
+  segment->Unlink();
+}
+
+void InitCCLPerWorker(IntTuple device_ids, std::string segment_name) {
+  ShmCCLContext* ctx = ShmCCLContext::Get();
+  DiscoWorker* worker = DiscoWorker::ThreadLocal();
+  ICHECK(worker != nullptr);
+  CHECK(!ctx->worker) << "Cannot initialize CCL, "
+                      << "the previous thread-global worker still exists, "
+                      << "and has not been destructed";
+  CHECK(worker->default_device.device_type == kDLCPU)
+      << "The shm CCL only supports CPU workers, but the default device of the worker is "
+      << worker->default_device << ".";
+  ctx->segment = std::make_unique<ShmSegment>(segment_name);
+  CHECK_EQ(ctx->segment->num_workers(), worker->num_workers)
+      << "The shared memory segment is created for " << ctx->segment->num_workers()
+      << " workers, but the session has " << worker->num_workers << " workers.";
+  worker->ccl = "shm";
+  ctx->worker = worker;
+}
+
+void AllReduce(NDArray send, ReduceKind reduce_kind, bool in_group, NDArray recv) {
+  DataType dtype(send->dtype);
+  int64_t numel = send.Shape()->Product();
+  CHECK_EQ(numel, recv.Shape()->Product())
+      << "ValueError: The number of elements in buffer `recv` must be the same as buffer `send`, "
+         "but got "
+      << recv.Shape()->Product() << " and " << numel << ".";
+  CHECK(DataType(recv->dtype) == dtype)
+      << "ValueError: The data type of buffer `recv` must be the same as buffer `send`, but got "
+      << DataType(recv->dtype) << " and " << dtype << ".";
+  ReduceFunc reduce = GetReduceKernel(dtype, reduce_kind);
+  ShmCCLContext* ctx = ShmCCLContext::GetInitialized();
+  bool average = reduce_kind == ReduceKind::kAvg;
+  const char* src = GetDataPtr(send);
+  char* dst = GetDataPtr(recv);
+  Team team = ctx->GetTeam(in_group);
+  const ShmSegment& segment = *ctx->segment;
+  int64_t elem_bytes = dtype.bytes();
+  int64_t chunk_numel = segment.slot_bytes() / elem_bytes;
+  std::vector<const void*> inputs(team.size);
+  for (int64_t begin = 0; begin < numel; begin += chunk_numel) {
+    int64_t len = std::min(chunk_numel, numel - begin);
+    char* my_slot = segment.slot(team.begin + team.rank);
+    std::memcpy(my_slot, src + begin * elem_bytes, len * elem_bytes);
+    team.Sync();
+    // Reduce-scatter: each worker reduces its own part of the chunk across all slots, and leaves
+    // the result in that part of its own slot.
+    auto [part_begin, part_len] = Partition(len, team.size, team.rank);
+    for (int k = 0; k < team.size; ++k) {
+      inputs[k] = segment.slot(team.begin + k) + part_begin * elem_bytes;
+    }
+    reduce(inputs, my_slot + part_begin * elem_bytes, part_len, average);
+    team.Sync();
+    // Allgather: collect the reduced parts from the slots of their owners.
+    for (int k = 0; k < team.size; ++k) {
+      auto [begin_k, len_k] = Partition(len, team.size, k);
+      std::memcpy(dst + (begin + begin_k) * elem_bytes,
+                  segment.slot(team.begin + k) + begin_k * elem_bytes, len_k * elem_bytes);
+    }
+    team.Sync();
+  }
+}
+
+void AllGather(NDArray send, bool in_group, NDArray recv) {
+  ShmCCLContext* ctx = ShmCCLContext::GetInitialized();
+  Team team = ctx->GetTeam(in_group);
+  int64_t send_bytes = GetNumBytes(send);
+  CHECK_EQ(send_bytes * team.size, GetNumBytes(recv))
+      << "ValueError: The size of buffer `recv` must be " << team.size
+      << " times the size of buffer `send`, but got " << GetNumBytes(recv) << " and "
+      << send_bytes << " bytes.";
+  const char* src = GetDataPtr(send);
+  char* dst = GetDataPtr(recv);
+  const ShmSegment& segment = *ctx->segment;
+  for (int64_t begin = 0; begin < send_bytes; begin += segment.slot_bytes()) {
+    int64_t len = std::min(segment.slot_bytes(), send_bytes - begin);
+    std::memcpy(segment.slot(team.begin + team.rank), src + begin, len);
+    team.Sync();
+    for (int k = 0; k < team.size; ++k) {
+      std::memcpy(dst + k * send_bytes + begin, segment.slot(team.begin + k), len);
+    }
+    team.Sync();
+  }
+}
+
+void BroadcastFromWorker0(Optional<NDArray> send, bool in_group, NDArray recv) {
+  ShmCCLContext* ctx = ShmCCLContext::GetInitialized();
+  Team team = ctx->GetTeam(in_group);
+  const char* src = nullptr;
+  if (team.is_root()) {
+    CHECK(send.defined());
+    CHECK(send.value().Shape()->Product() == recv.Shape()->Product());
+    src = GetDataPtr(send.value());
+  }
+  char* dst = GetDataPtr(recv);
+  int64_t nbytes = GetNumBytes(recv);
+  const ShmSegment& segment = *ctx->segment;
+  char* root_slot = segment.slot(team.begin);
+  for (int64_t begin = 0; begin < nbytes; begin += segment.slot_bytes()) {
+    int64_t len = std::min(segment.slot_bytes(), nbytes - begin);
+    if (team.is_root()) {
+      std::memcpy(root_slot, src + begin, len);
+    }
+    team.Sync();
+    if (!team.is_root()) {
+      std::memcpy(dst + begin, root_slot, len);
+    }
+    team.Sync();
+  }
+  if (team.is_root() && src != dst) {
+    std::memcpy(dst, src, nbytes);
+  }
+}
+
+void ScatterFromWorker0(Optional<NDArray> send, bool in_group, NDArray recv) {
+  CHECK(recv.defined()) << "ValueError: buffer `recv` must not be None";
+  ShmCCLContext* ctx = ShmCCLContext::GetInitialized();
+  Team team = ctx->GetTeam(in_group);
+  const char* src = nullptr;
+  if (team.is_root()) {
+    CHECK(send.defined()) << "ValueError: buffer `send` must be provided when worker_id == 0.";
+    NDArray buffer = send.value();
+    int64_t numel = buffer.Shape()->Product();
+    CHECK_EQ(numel % team.size, 0) << "ValueError: Scattering evenly requires that the number "
+                                      "of elements in the buffer to be "
+                                      "divisible by the number of workers, but got numel = "
+                                   << numel << " and " << team.size << " workers.";
+    CHECK_EQ(numel / team.size, recv.Shape()->Product())
+        << "ValueError: The number of elements in buffer `recv` must be the same as each shard "
+           "of buffer `send`. `send.size` is "
+        << numel << ", but `recv.size` is " << recv.Shape()->Product() << ".";
+    src = GetDataPtr(buffer);
+  } else if (send.defined()) {
+    LOG(WARNING) << "ValueError: buffer `send` must be None when (worker_id != 0 && !in_group) "
+                    "or (worker_id % group_size != 0 && in_group). However, got send = "
+                 << send.get() << ". This will be ignored.";
+  }
+  char* dst = GetDataPtr(recv);
+  int64_t shard_bytes = GetNumBytes(recv);
+  const ShmSegment& segment = *ctx->segment;
+  for (int64_t begin = 0; begin < shard_bytes; begin += segment.slot_bytes()) {
+    int64_t len = std::min(segment.slot_bytes(), shard_bytes - begin);
+    if (team.is_root()) {
+      for (int k = 0; k < team.size; ++k) {
+        std::memcpy(segment.slot(team.begin + k), src + k * shard_bytes + begin, len);
+      }
+    }
+    team.Sync();
+    std::memcpy(dst + begin, segment.slot(team.begin + team.rank), len);
+    team.Sync();
+  }
+}
+
+void GatherToWorker0(NDArray send, bool in_group, Optional<NDArray> recv) {
+  CHECK(send.defined()) << "ValueError: buffer `send` must not be None";
+  ShmCCLContext* ctx = ShmCCLContext::GetInitialized();
+  Team team = ctx->GetTeam(in_group);
+  char* dst = nullptr;
+  if (team.is_root()) {
+    CHECK(recv.defined()) << "ValueError: buffer `recv` must be provided when worker_id == 0.";
+    NDArray buffer = recv.value();
+    int64_t numel = buffer.Shape()->Product();
+    CHECK_EQ(numel % team.size, 0) << "ValueError: Gathering evenly requires that the number "
+                                      "of elements in the buffer to be "
+                                      "divisible by the number of workers, but got numel = "
+                                   << numel << " and " << team.size << " workers.";
+    CHECK_EQ(numel / team.size, send.Shape()->Product())
+        << "ValueError: The number of elements in buffer `send` must be the same as each shard "
+           "of buffer `recv`. `recv.size` is "
+        << numel << ", but `send.size` is " << send.Shape()->Product() << ".";
+    dst = GetDataPtr(buffer);
+  } else if (recv.defined()) {
+    LOG(WARNING) << "ValueError: buffer `recv` must be None when (worker_id != 0 && !in_group) "
+                    "or (worker_id % group_size != 0 && in_group). However, got recv = "
+                 << recv.get() << ". This will be ignored.";
+  }
+  const char* src = GetDataPtr(send);
+  int64_t shard_bytes = GetNumBytes(send);
+  const ShmSegment& segment = *ctx->segment;
+  for (int64_t begin = 0; begin < shard_bytes; begin += segment.slot_bytes()) {
+    int64_t len = std::min(segment.slot_bytes(), shard_bytes - begin);
+    std::memcpy(segment.slot(team.begin + team.rank), src + begin, len);
+    team.Sync();
+    if (team.is_root()) {
+      for (int k = 0; k < team.size; ++k) {
+        std::memcpy(dst + k * shard_bytes + begin, segment.slot(team.begin + k), len);
+      }
+    }
+    team.Sync();
+  }
+}
+
+void SendToWorker(NDArray buffer, int receiver_id) {
+  ShmCCLContext* ctx = ShmCCLContext::GetInitialized();
+  int worker_id = ctx->worker->worker_id;
+  CHECK(receiver_id >= 0 && receiver_id < ctx->worker->num_workers)
+      << "Invalid receiver id " << receiver_id << ". The world size is "
+      << ctx->worker->num_workers;
+  CHECK_NE(worker_id, receiver_id) << "Cannot send to worker itself.";
+  const char* src = GetDataPtr(buffer);
+  int64_t nbytes = GetNumBytes(buffer);
+  const ShmSegment& segment = *ctx->segment;
+  ChannelFlags* flags = segment.channel_flags(worker_id, receiver_id);
+  char* channel = segment.channel(worker_id, receiver_id);
+  for (int64_t begin = 0; begin < nbytes; begin += segment.channel_bytes()) {
+    int64_t len = std::min(segment.channel_bytes(), nbytes - begin);
+    // Wait until the receiver has consumed the previous chunk.
+    SpinWait([&]() {
+      return flags->consumed.load(std::memory_order_acquire) ==
+             flags->posted.load(std::memory_order_relaxed);
+    });
+    std::memcpy(channel, src + begin, len);
+    flags->posted.fetch_add(1, std::memory_order_release);
+  }
+}
+
+void RecvFromWorker(NDArray buffer, int sender_id) {
+  ShmCCLContext* ctx = ShmCCLContext::GetInitialized();
+  int worker_id = ctx->worker->worker_id;
+  CHECK(sender_id >= 0 && sender_id < ctx->worker->num_workers)
+      << "Invalid sender id " << sender_id << ". The world size is " << ctx->worker->num_workers;
+  CHECK_NE(worker_id, sender_id) << "Cannot receive from the worker itself.";
+  char* dst = GetDataPtr(buffer);
+  int64_t nbytes = GetNumBytes(buffer);
+  const ShmSegment& segment = *ctx->segment;
+  ChannelFlags* flags = segment.channel_flags(sender_id, worker_id);
+  const char* channel = segment.channel(sender_id, worker_id);
+  for (int64_t begin = 0; begin < nbytes; begin += segment.channel_bytes()) {
+    int64_t len = std::min(segment.channel_bytes(), nbytes - begin);
+    SpinWait([&]() {
+      return flags->posted.load(std::memory_order_acquire) !=
+             flags->consumed.load(std::memory_order_relaxed);
+    });
+    std::memcpy(dst + begin, channel, len);
+    flags->consumed.fetch_add(1, std::memory_order_release);
+  }
+}
+
+void RecvFromWorker0(NDArray buffer) {
+  ShmCCLContext* ctx = ShmCCLContext::GetInitialized();
+  CHECK_NE(ctx->worker->worker_id, 0)
+      << "ValueError: Worker 0 is not allowed to call RecvFromWorker0.";
+  shm::RecvFromWorker(buffer, 0);
+}
+
+void SendToNextGroup(NDArray buffer) {
+  ShmCCLContext* ctx = ShmCCLContext::GetInitialized();
+  int group_size = ctx->worker->num_workers / ctx->worker->num_groups;
+  int receiver_id = ctx->worker->worker_id + group_size;
+  CHECK_LT(receiver_id, ctx->worker->num_workers)
+      << "The current group is already the last group and there is no such a next group.";
+  shm::SendToWorker(buffer, receiver_id);
+}
+
+void RecvFromPrevGroup(NDArray buffer) {
+  ShmCCLContext* ctx = ShmCCLContext::GetInitialized();
+  int group_size = ctx->worker->num_workers / ctx->worker->num_groups;
+  int sender_id = ctx->worker->worker_id - group_size;
+  CHECK_GE(sender_id, 0)
+      << "The current group is already the first group and there is no such a previous group.";
+  shm::RecvFromWorker(buffer, sender_id);
+}
+
+void SyncWorker() {
+  // Every transfer has completed by the time its call returns.
+  ICHECK(ShmCCLContext::Get()->worker != nullptr);
+}
+
+TVM_REGISTER_GLOBAL("runtime.disco.shm.init_ccl").set_body_typed(InitCCL);
+TVM_REGISTER_GLOBAL("runtime.disco.shm.init_ccl_per_worker").set_body_typed(InitCCLPerWorker);
+TVM_REGISTER_GLOBAL("runtime.disco.shm.allreduce")
+    .set_body_typed([](NDArray send, int kind, bool in_group, NDArray recv) {
+      CHECK(0 <= kind && kind <= 4) << "ValueError: Unknown ReduceKind: " << kind;
+      shm::AllReduce(send, static_cast<ReduceKind>(kind), in_group, recv);
+    });
+TVM_REGISTER_GLOBAL("runtime.disco.shm.allgather")
+    .set_body_typed([](NDArray send, bool in_group, NDArray recv) {
+      shm::AllGather(send, in_group, recv);
+    });
+TVM_REGISTER_GLOBAL("runtime.disco.shm.broadcast_from_worker0")
+    .set_body_typed(BroadcastFromWorker0);
+TVM_REGISTER_GLOBAL("runtime.disco.shm.scatter_from_worker0").set_body_typed(ScatterFromWorker0);
+TVM_REGISTER_GLOBAL("runtime.disco.shm.gather_to_worker0").set_body_typed(GatherToWorker0);
+TVM_REGISTER_GLOBAL("runtime.disco.shm.recv_from_worker0").set_body_typed(RecvFromWorker0);
+TVM_REGISTER_GLOBAL("runtime.disco.shm.send_to_next_group").set_body_typed(SendToNextGroup);
+TVM_REGISTER_GLOBAL("runtime.disco.shm.recv_from_prev_group").set_body_typed(RecvFromPrevGroup);
+TVM_REGISTER_GLOBAL("runtime.disco.shm.send_to_worker").set_body_typed(SendToWorker);
+TVM_REGISTER_GLOBAL("runtime.disco.shm.recv_from_worker").set_body_typed(RecvFromWorker);
+TVM_REGISTER_GLOBAL("runtime.disco.shm.sync_worker").set_body_typed(SyncWorker);
+
+TVM_REGISTER_GLOBAL("runtime.disco.shm.test_send_to_next_group_recv_from_prev_group")
+    .set_body_typed([](NDArray buffer) {
+      ShmCCLContext* ctx = ShmCCLContext::GetInitialized();
+      CHECK_EQ(ctx->worker->num_workers, 4) << "The test requires the world size to be 4.";
+      CHECK_EQ(ctx->worker->num_groups, 2) << "The test requires the group size to be 2.";
+      int group_size = ctx->worker->num_workers / ctx->worker->num_groups;
+      int group_id = ctx->worker->worker_id / group_size;
+      if (group_id == 0) {
+        shm::SendToNextGroup(buffer);
+      } else {
+        shm::RecvFromPrevGroup(buffer);
+      }
+    });
+
+TVM_REGISTER_GLOBAL("runtime.disco.shm.test_worker2_sends_to_worker0")
+    .set_body_typed([](NDArray buffer) {
+      ShmCCLContext* ctx = ShmCCLContext::GetInitialized();
+      CHECK_EQ(ctx->worker->num_workers, 4) << "The test requires the world size to be 4.";
+      CHECK_EQ(ctx->worker->num_groups, 2) << "The test requires the group size to be 2.";
+      if (ctx->worker->worker_id == 2) {
+        shm::SendToWorker(buffer, 0);
+      } else if (ctx->worker->worker_id == 0) {
+        shm::RecvFromWorker(buffer, 2);
+      }
+    });
+
+}  // namespace shm
+}  // namespace runtime
+}  // namespace tvm
@@ -0,0 +1,168 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include "./shm_channel.h"
+
+#include <tvm/runtime/logging.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace tvm {
+namespace runtime {
+
+/*!
+ * \brief The control block of a ring, followed by its data.
+ *
+ * `head` and `tail` count the bytes written and read since the creation of the ring, and are
+ * only stored by the writer and by the reader respectively. A side about to sleep sets its
+ * `waiting` flag, and the other side bumps the `seq` word it sleeps on and wakes it only then.
+ */
+struct ShmRing {
+  alignas(64) std::atomic<uint64_t> head{0};
+  alignas(64) std::atomic<uint64_t> tail{0};
+  alignas(64) std::atomic<uint32_t> data_seq{0};
+  std::atomic<uint32_t> reader_waiting{0};
+  alignas(64) std::atomic<uint32_t> space_seq{0};
+  std::atomic<uint32_t> writer_waiting{0};
+  alignas(64) uint64_t capacity;
+
+  explicit ShmRing(uint64_t capacity) : capacity(capacity) {}
+
+  char* data() { return reinterpret_cast<char*>(this + 1); }
+};
+
+namespace {
+
+/*! \brief How long to sleep on a futex before checking that the peer is still alive. */
+constexpr int64_t kPeerCheckIntervalUs = 100000;
+
+/*!
+ * \brief Wait until `ready` holds, sleeping on `seq` after a short spin.
+ * \return Whether `ready` holds, which is false only if the peer has exited.
+ */
+template <typename Pred>
+bool WaitUntil(Pred ready, std::atomic<uint32_t>* seq, std::atomic<uint32_t>* waiting,
+               const std::function<bool()>& peer_alive) {
+  for (int i = 0; i < kSharedMemorySpinCount; ++i) {
+    if (ready()) return true;
+  }
+  while (true) {
+    uint32_t expected = seq->load(std::memory_order_acquire);
+    waiting->store(1, std::memory_order_relaxed);
+    // Pairs with the fence in Notify: either the peer sees the flag, or we see its progress.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ready()) {
+      waiting->store(0, std::memory_order_relaxed);
+      return true;
+    }
+    FutexWait(seq, expected, kPeerCheckIntervalUs);
+    waiting->store(0, std::memory_order_relaxed);
+    if (ready()) return true;
+    if (peer_alive != nullptr && !peer_alive()) return ready();
+  }
+}
+
+/*! \brief Wake the peer after making progress, if it sleeps on `seq`. */
+void Notify(std::atomic<uint32_t>* seq, std::atomic<uint32_t>* waiting) {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiting->load(std::memory_order_relaxed) != 0) {
+    seq->fetch_add(1, std::memory_order_release);
+    FutexWake(seq);
+  }
+}
+
+}  // namespace
+
+size_t ShmRingStream::Read(void* data, size_t size) {
+  char* dst = static_cast<char*>(data);
+  const uint64_t capacity = ring_->capacity;
+  uint64_t tail = ring_->tail.load(std::memory_order_relaxed);
+  size_t nread = 0;
+  while (nread < size) {
+    uint64_t head = ring_->head.load(std::memory_order_acquire);
+    if (head == tail) {
+      bool ready = WaitUntil(
+          [&]() { return (head = ring_->head.load(std::memory_order_acquire)) != tail; },
+          &ring_->data_seq, &ring_->reader_waiting, peer_alive_);
+      if (!ready) break;
+    }
+    size_t n = std::min<uint64_t>(size - nread, head - tail);
+    size_t offset = tail % capacity;
+    size_t first = std::min<uint64_t>(n, capacity - offset);
+    std::memcpy(dst + nread, ring_->data() + offset, first);
+    std::memcpy(dst + nread + first, ring_->data(), n - first);
+    nread += n;
+    tail += n;
+    ring_->tail.store(tail, std::memory_order_release);
+    Notify(&ring_->space_seq, &ring_->writer_waiting);
+  }
+  return nread;
+}
+
+size_t ShmRingStream::Write(const void* data, size_t size) {
+  const char* src = static_cast<const char*>(data);
+  const uint64_t capacity = ring_->capacity;
+  uint64_t head = ring_->head.load(std::memory_order_relaxed);
+  size_t nwritten = 0;
+  while (nwritten < size) {
+    uint64_t tail = ring_->tail.load(std::memory_order_acquire);
+    if (head - tail == capacity) {
+      bool ready = WaitUntil(
+          [&]() { return head - (tail = ring_->tail.load(std::memory_order_acquire)) < capacity; },
+          &ring_->space_seq, &ring_->writer_waiting, peer_alive_);
+      CHECK(ready) << "The disco process at the other end of the shared memory channel has exited";
+    }
+    size_t n = std::min<uint64_t>(size - nwritten, capacity - (head - tail));
+    size_t offset = head % capacity;
+    size_t first = std::min<uint64_t>(n, capacity - offset);
+    std::memcpy(ring_->data() + offset, src + nwritten, first);
+    std::memcpy(ring_->data(), src + nwritten + first, n - first);
+    nwritten += n;
+    head += n;
+    ring_->head.store(head, std::memory_order_release);
+    Notify(&ring_->data_seq, &ring_->reader_waiting);
+  }
+  return nwritten;
+}
+
+std::unique_ptr<ShmChannelSegment> ShmChannelSegment::Create(size_t capacity) {
+  ICHECK_EQ(capacity % 64, 0) << "The capacity of a ring should be a multiple of 64";
+  size_t ring_bytes = sizeof(ShmRing) + capacity;
+  std::unique_ptr<SharedMemory> memory = SharedMemory::Create("tvm-disco-channel", 2 * ring_bytes);
+  new (memory->data()) ShmRing(capacity);
+  new (memory->data() + ring_bytes) ShmRing(capacity);
+  return std::unique_ptr<ShmChannelSegment>(new ShmChannelSegment(std::move(memory)));
+}
+
+std::unique_ptr<ShmChannelSegment> ShmChannelSegment::Open(const std::string& name) {
+  return std::unique_ptr<ShmChannelSegment>(new ShmChannelSegment(SharedMemory::Open(name)));
+}
+
+ShmChannelSegment::ShmChannelSegment(std::unique_ptr<SharedMemory> memory)
+    : memory_(std::move(memory)) {
+  size_t ring_bytes = memory_->size() / 2;
+  controller_to_worker_ = reinterpret_cast<ShmRing*>(memory_->data());
+  worker_to_controller_ = reinterpret_cast<ShmRing*>(memory_->data() + ring_bytes);
+  ICHECK_EQ(sizeof(ShmRing) + controller_to_worker_->capacity, ring_bytes)
+      << "The shared memory channel " << memory_->name() << " is corrupted";
+}
+
+}  // namespace runtime
+}  // namespace tvm
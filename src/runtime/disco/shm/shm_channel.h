@@ -0,0 +1,89 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file shm_channel.h
+ * \brief Byte streams between the controller and a worker process over shared memory rings.
+ */
+#ifndef TVM_RUNTIME_DISCO_SHM_SHM_CHANNEL_H_
+#define TVM_RUNTIME_DISCO_SHM_SHM_CHANNEL_H_
+
+#include <dmlc/io.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "./shared_memory.h"
+
+namespace tvm {
+namespace runtime {
+
+struct ShmRing;
+
+/*!
+ * \brief One direction of a single-producer single-consumer ring buffer in shared memory.
+ *
+ * Reads and writes block until they complete, polling briefly before sleeping on a futex, and
+ * a futex is only woken if the other side sleeps on it. So a message to a peer that is waiting
+ * for it costs two memcpys and no system call, unlike a pipe.
+ */
+class ShmRingStream : public dmlc::Stream {
+ public:
+  /*!
+   * \param ring The ring.
+   * \param peer_alive Checks whether the peer process is still alive, while blocked on it.
+   */
+  ShmRingStream(ShmRing* ring, std::function<bool()> peer_alive)
+      : ring_(ring), peer_alive_(std::move(peer_alive)) {}
+
+  /*! \brief Read `size` bytes, or less only if the peer has exited. */
+  size_t Read(void* data, size_t size) final;
+  /*! \brief Write `size` bytes. It is an error if the peer has exited. */
+  size_t Write(const void* data, size_t size) final;
+
+ private:
+  ShmRing* ring_;
+  std::function<bool()> peer_alive_;
+};
+
+/*! \brief A segment holding the rings of both directions between the controller and a worker. */
+class ShmChannelSegment {
+ public:
+  /*! \brief Create a segment with rings of `capacity` bytes, on the controller. */
+  static std::unique_ptr<ShmChannelSegment> Create(size_t capacity);
+  /*! \brief Open a segment by its name, on the worker. */
+  static std::unique_ptr<ShmChannelSegment> Open(const std::string& name);
+
+  SharedMemory* memory() const { return memory_.get(); }
+  ShmRing* controller_to_worker() const { return controller_to_worker_; }
+  ShmRing* worker_to_controller() const { return worker_to_controller_; }
+
+ private:
+  explicit ShmChannelSegment(std::unique_ptr<SharedMemory> memory);
+
+  std::unique_ptr<SharedMemory> memory_;
+  ShmRing* controller_to_worker_;
+  ShmRing* worker_to_controller_;
+};
+
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_DISCO_SHM_SHM_CHANNEL_H_
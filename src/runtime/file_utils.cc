@@ -28,6 +28,16 @@
 #include <tvm/runtime/registry.h>
 #include <tvm/runtime/serializer.h>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
 #include <fstream>
 #include <unordered_map>
 #include <vector>
@@ -127,6 +137,63 @@ void LoadBinaryFromFile(const std::string& file_name, std::string* data) {
   fs.read(&(*data)[0], size);
 }
 
+MappedFile MappedFile::Open(const std::string& file_name) {
+  ObjectPtr<MappedFileObj> n = make_object<MappedFileObj>();
+#ifndef _WIN32
+  int fd = open(file_name.c_str(), O_RDONLY);
+  ICHECK_GE(fd, 0) << "Cannot open " << file_name << ": " << std::strerror(errno);
+  struct stat st;
+  ICHECK_EQ(fstat(fd, &st), 0) << "Cannot stat " << file_name << ": " << std::strerror(errno);
+  n->size_ = static_cast<size_t>(st.st_size);
+  if (n->size_ != 0) {
+    void* addr = mmap(nullptr, n->size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ICHECK(addr != MAP_FAILED) << "Cannot map " << file_name << ": " << std::strerror(errno);
+    n->data_ = static_cast<char*>(addr);
+    n->mapped_ = true;
+  }
+  close(fd);
+#else
+  LoadBinaryFromFile(file_name, &n->buffer_);
+  n->data_ = n->buffer_.empty() ? nullptr : &n->buffer_[0];
+  n->size_ = n->buffer_.size();
+#endif
+  return MappedFile(n);
+}
+
+MappedFileObj::~MappedFileObj() {
+#ifndef _WIN32
+  if (mapped_) {
+    munmap(data_, size_);
+  }
+#endif
+}
+
+void MappedFileObj::Advise(size_t offset, size_t nbytes, Advice advice) const {
+#ifndef _WIN32
+  if (!mapped_ || offset >= size_) return;
+  // madvise requires a page-aligned start.
+  static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t begin = offset / page_size * page_size;
+  size_t end = std::min(offset + nbytes, size_);
+  int flag = MADV_NORMAL;
+  switch (advice) {
+    case Advice::kNormal:
+      flag = MADV_NORMAL;
+      break;
+    case Advice::kSequential:
+      flag = MADV_SEQUENTIAL;
+      break;
+    case Advice::kWillNeed:
+      flag = MADV_WILLNEED;
+      break;
+  }
+  // The advice is only a hint, failures are ignored.
+  madvise(data_ + begin, end - begin, flag);
+#endif
+}
+
+TVM_REGISTER_OBJECT_TYPE(MappedFileObj);
+
 void SaveBinaryToFile(const std::string& file_name, const std::string& data) {
   std::ofstream fs(file_name, std::ios::out | std::ios::binary);
   ICHECK(!fs.fail()) << "Cannot open " << file_name;
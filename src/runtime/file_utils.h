@@ -74,6 +74,62 @@ void LoadBinaryFromFile(const std::string& file_name, std::string* data);
  */
 void SaveBinaryToFile(const std::string& file_name, const std::string& data);
 
+/*!
+ * \brief A file mapped into memory with copy-on-write pages, so writes to the mapped memory never
+ *  reach the file. On platforms without mmap, the file is read into memory instead.
+ */
+class MappedFileObj : public Object {
+ public:
+  /*! \brief The access pattern hints of a mapped range. */
+  enum class Advice : int {
+    kNormal = 0,
+    kSequential = 1,
+    kWillNeed = 2,
+  };
+
+  ~MappedFileObj();
+
+  /*! \return The content of the file. */
+  char* data() const { return data_; }
+  /*! \return The size of the file. */
+  size_t size() const { return size_; }
+  /*! \return Whether the file is mapped rather than read into memory. */
+  bool is_mapped() const { return mapped_; }
+
+  /*!
+   * \brief Hint the access pattern of a range to the kernel. A no-op when the file is not mapped.
+   * \param offset The start of the range.
+   * \param nbytes The size of the range.
+   * \param advice The access pattern.
+   */
+  void Advise(size_t offset, size_t nbytes, Advice advice) const;
+
+  static constexpr const char* _type_key = "runtime.MappedFile";
+  TVM_DECLARE_FINAL_OBJECT_INFO(MappedFileObj, Object);
+
+ private:
+  char* data_{nullptr};
+  size_t size_{0};
+  bool mapped_{false};
+  /*! \brief The content when the file is read rather than mapped. */
+  std::string buffer_;
+
+  friend class MappedFile;
+};
+
+/*! \brief Reference to MappedFileObj. */
+class MappedFile : public ObjectRef {
+ public:
+  /*!
+   * \brief Map a file into memory.
+   * \param file_name The name of the file.
+   * \return The mapped file, which is unmapped once all the references are gone.
+   */
+  static MappedFile Open(const std::string& file_name);
+
+  TVM_DEFINE_OBJECT_REF_METHODS(MappedFile, ObjectRef, MappedFileObj);
+};
+
 /*!
  * \brief Save meta data to file.
  * \param file_name The name of the file.
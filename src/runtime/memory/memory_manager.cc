@@ -21,6 +21,8 @@
  * \file tvm/runtime/memory/memory_manager.cc
  * \brief Allocate and manage memory for the runtime.
  */
+#include <tvm/runtime/container/boxed_primitive.h>
+#include <tvm/runtime/container/map.h>
 #include <tvm/runtime/memory/memory_manager.h>
 #include <tvm/runtime/registry.h>
 
@@ -43,6 +45,22 @@ static void BufferDeleter(Object* obj) {
   delete ptr;
 }
 
+/*! \brief Whether the data pointer of a buffer on the device is an address in memory. */
+static bool DataIsAddress(DLDeviceType device_type) {
+  switch (device_type) {
+    case kDLCPU:
+    case kDLCUDA:
+    case kDLCUDAHost:
+    case kDLCUDAManaged:
+    case kDLROCM:
+    case kDLROCMHost:
+    case kDLHexagon:
+      return true;
+    default:
+      return false;
+  }
+}
+
 Storage::Storage(Buffer buffer, Allocator* allocator) {
   auto n = make_object<StorageObj>();
   n->buffer = std::move(buffer);
@@ -134,9 +152,10 @@ NDArray StorageObj::AllocNDArray(int64_t offset, ShapeTuple shape, DLDataType dt
   // buffer intact.
   container->manager_ctx = reinterpret_cast<void*>(this);
 
-  if (this->buffer.device.device_type == kDLHexagon) {
-    // For Hexagon, non-zero offset support simply requires adjusting the
-    // beginning of data pointer
+  if (DataIsAddress(this->buffer.device.device_type)) {
+    // Where the data is an address, non-zero offset support simply requires adjusting the
+    // beginning of data pointer, so that the compiled kernels, which expect no byte offset,
+    // accept the tensor.
     auto offset_ptr = reinterpret_cast<uint8_t*>(this->buffer.data) + offset;
     container->dl_tensor.data = reinterpret_cast<void*>(offset_ptr);
     container->dl_tensor.byte_offset = 0;
@@ -277,6 +296,13 @@ Buffer Allocator::Alloc(Device dev, ShapeTuple shape, DLDataType type_hint,
   return {};
 }
 
+AllocatorStats Allocator::Stats() const {
+  AllocatorStats stats;
+  stats.allocated_bytes = stats.reserved_bytes = UsedMemory();
+  stats.peak_allocated_bytes = stats.peak_reserved_bytes = stats.allocated_bytes;
+  return stats;
+}
+
 void Allocator::Clear() {
   // This function by default does nothing.
   // For naive allocator, no explicit manual clear is needed.
@@ -285,6 +311,24 @@ void Allocator::Clear() {
 
 TVM_REGISTER_GLOBAL("vm.builtin.memory_manager.clear").set_body_typed(MemoryManager::Clear);
 
+TVM_REGISTER_GLOBAL("vm.builtin.memory_manager.stats")
+    .set_body_typed([](Device dev, int allocator_type) {
+      AllocatorStats stats =
+          MemoryManager::GetAllocator(dev, static_cast<AllocatorType>(allocator_type))->Stats();
+      Map<String, ObjectRef> result;
+      result.Set("allocated_bytes", Int(stats.allocated_bytes));
+      result.Set("reserved_bytes", Int(stats.reserved_bytes));
+      result.Set("free_bytes", Int(stats.free_bytes));
+      result.Set("largest_free_block", Int(stats.largest_free_block));
+      result.Set("peak_allocated_bytes", Int(stats.peak_allocated_bytes));
+      result.Set("peak_reserved_bytes", Int(stats.peak_reserved_bytes));
+      result.Set("num_hits", Int(stats.num_hits));
+      result.Set("num_misses", Int(stats.num_misses));
+      result.Set("num_released_segments", Int(stats.num_released_segments));
+      result.Set("fragmentation", Float(stats.Fragmentation()));
+      return result;
+    });
+
 }  // namespace memory
 }  // namespace runtime
 }  // namespace tvm
@@ -25,6 +25,7 @@
 
 #include <tvm/runtime/device_api.h>
 #include <tvm/runtime/memory/memory_manager.h>
+#include <tvm/runtime/trace_event.h>
 
 #include <atomic>
 #include <string>
@@ -42,6 +43,7 @@ class NaiveAllocator final : public Allocator {
     buf.device = dev;
     buf.size = nbytes;
     buf.alloc_type = kNaive;
+    profiling::TraceScope trace_scope("memory", "device alloc", "bytes", nbytes);
     buf.data = DeviceAPI::Get(dev)->AllocDataSpace(dev, nbytes, alignment, type_hint);
     used_memory_.fetch_add(nbytes, std::memory_order_relaxed);
     DLOG(INFO) << "allocate " << nbytes << " B, used memory " << used_memory_ << " B";
@@ -66,6 +68,7 @@ class NaiveAllocator final : public Allocator {
     }
 
     buf.size = nbytes;
+    profiling::TraceScope trace_scope("memory", "device alloc", "bytes", nbytes);
     buf.data = DeviceAPI::Get(dev)->AllocDataSpace(dev, shape.size(), shape.data(), type_hint,
                                                    String(mem_scope));
     used_memory_.fetch_add(nbytes, std::memory_order_relaxed);
@@ -75,6 +78,7 @@ class NaiveAllocator final : public Allocator {
   }
 
   void Free(const Buffer& buffer) override {
+    profiling::TraceScope trace_scope("memory", "device free", "bytes", buffer.size);
     DeviceAPI::Get(buffer.device)->FreeDataSpace(buffer.device, buffer.data);
     used_memory_.fetch_sub(buffer.size, std::memory_order_relaxed);
     DLOG(INFO) << "free " << buffer.size << " B, used memory " << used_memory_ << " B";
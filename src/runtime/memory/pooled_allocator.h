@@ -19,16 +19,34 @@
 
 /*!
  * \file src/runtime/memory/pooled_allocator.h
+ * \brief A caching allocator that serves requests from the freed blocks with best fit.
+ *
+ *  Requests are rounded up to size classes, four classes per power of two above a page, so
+ *  that requests of similar sizes share the cached blocks. Each allocation from the device is a
+ *  segment. On devices whose data pointers support address arithmetic, a cached block larger
+ *  than the request is split, and freed neighbors in a segment are coalesced. On the other
+ *  devices a block is reused as a whole when it wastes less than half of itself.
+ *
+ *  When the reserved memory exceeds the high watermark, the fully free segments are released
+ *  to the device in least-recently-used order.
  */
 #ifndef TVM_RUNTIME_MEMORY_POOLED_ALLOCATOR_H_
 #define TVM_RUNTIME_MEMORY_POOLED_ALLOCATOR_H_
 
 #include <tvm/runtime/device_api.h>
 #include <tvm/runtime/memory/memory_manager.h>
+#include <tvm/runtime/trace_event.h>
 
+#include <algorithm>
 #include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <vector>
 
@@ -39,38 +57,58 @@ namespace memory {
 class PooledAllocator : public Allocator {
  public:
   static constexpr size_t kDefaultPageSize = 4096;
+  /*! \brief The number of size classes between two consecutive powers of two. */
+  static constexpr size_t kSizeClassesPerPowerOfTwo = 4;
 
-  explicit PooledAllocator(size_t page_size = kDefaultPageSize)
-      : Allocator(kPooled), page_size_(page_size), used_memory_(0) {}
+  /*!
+   * \brief Create a pooled allocator.
+   * \param page_size The granularity of the allocations.
+   * \param high_watermark The reserved bytes above which the idle segments are released.
+   *  Defaults to the environment variable TVM_POOLED_ALLOCATOR_HIGH_WATERMARK, or no limit.
+   */
+  explicit PooledAllocator(size_t page_size = kDefaultPageSize,
+                           size_t high_watermark = DefaultHighWatermark())
+      : Allocator(kPooled),
+        page_size_(page_size),
+        used_memory_(0),
+        high_watermark_(high_watermark) {}
 
-  ~PooledAllocator() { ReleaseAll(); }
+  ~PooledAllocator() {
+    ReleaseAll();
+    for (const auto& kv : segments_) {
+      for (Block* block = kv.second->head; block != nullptr;) {
+        Block* next = block->next;
+        delete block;
+        block = next;
+      }
+    }
+  }
 
   Buffer Alloc(Device dev, size_t nbytes, size_t alignment, DLDataType type_hint) override {
-    std::lock_guard<std::recursive_mutex> lock(mu_);
-    size_t size = ((nbytes + page_size_ - 1) / page_size_) * page_size_;
-    auto&& it = memory_pool_.find(size);
-    if (it != memory_pool_.end() && !it->second.empty()) {
-      auto&& pool = it->second;
-      auto ret = pool.back();
-      pool.pop_back();
-      return ret;
+    std::lock_guard<std::mutex> lock(mu_);
+    size_t size = RoundToSizeClass(nbytes);
+    if (Block* block = FindFreeBlock(dev, size, alignment)) {
+      ++stats_.num_hits;
+      return TakeBlock(block, size);
     }
-    Buffer buf;
-    buf.device = dev;
-    buf.size = size;
-    buf.alloc_type = kPooled;
+    ++stats_.num_misses;
+    size_t limit = high_watermark_.load(std::memory_order_relaxed);
+    if (used_memory_.load(std::memory_order_relaxed) + size > limit) {
+      ReleaseIdleSegments(used_memory_.load(std::memory_order_relaxed) + size - limit);
+    }
+    void* data = nullptr;
+    profiling::TraceScope trace_scope("memory", "device alloc", "bytes", size);
     try {
-      buf.data = DeviceAllocDataSpace(dev, size, alignment, type_hint);
+      data = DeviceAllocDataSpace(dev, size, alignment, type_hint);
     } catch (InternalError& err) {
       LOG(WARNING) << "PooledAllocator got InternalError during allocation: " << err.message();
       LOG(WARNING) << "Trying to release all unused memory and reallocate...";
-      ReleaseAll();
-      buf.data = DeviceAllocDataSpace(dev, size, alignment, type_hint);
+      ReleaseIdleSegments(std::numeric_limits<size_t>::max());
+      data = DeviceAllocDataSpace(dev, size, alignment, type_hint);
     }
-
-    used_memory_.fetch_add(size, std::memory_order_relaxed);
+    Block* block = AddSegment(dev, data, size, AllowSplit(dev), /*cached=*/true);
     VLOG(1) << "allocate " << size << " B, used memory " << used_memory_ << " B";
-    return buf;
+    return TakeBlock(block, size);
   }
 
   Buffer Alloc(Device dev, ShapeTuple shape, DLDataType type_hint,
@@ -83,18 +121,68 @@ class PooledAllocator : public Allocator {
   }
 
   void Free(const Buffer& buffer) override {
-    std::lock_guard<std::recursive_mutex> lock(mu_);
-    if (memory_pool_.find(buffer.size) == memory_pool_.end()) {
-      memory_pool_.emplace(buffer.size, std::vector<Buffer>{});
+    std::lock_guard<std::mutex> lock(mu_);
+    auto it = allocated_blocks_.find(buffer.data);
+    if (it == allocated_blocks_.end()) {
+      // A buffer allocated elsewhere is released to the device.
+      TrackAllocatedBuffer(buffer);
+      it = allocated_blocks_.find(buffer.data);
+    }
+    Block* block = it->second;
+    allocated_blocks_.erase(it);
+    block->allocated = false;
+    stats_.allocated_bytes -= block->size;
+    profiling::RecordTraceCounter("memory", "pooled allocated bytes", stats_.allocated_bytes);
+    block->segment->last_used = ++clock_;
+    block = Coalesce(block);
+    free_blocks_.insert(block);
+    if (!block->segment->cached) {
+      ReleaseSegment(block->segment);
+      return;
     }
-    memory_pool_.at(buffer.size).push_back(buffer);
     VLOG(1) << "reclaim buffer " << buffer.size;
+    size_t limit = high_watermark_.load(std::memory_order_relaxed);
+    if (used_memory_.load(std::memory_order_relaxed) > limit) {
+      ReleaseIdleSegments(used_memory_.load(std::memory_order_relaxed) - limit);
+    }
   }
 
   void Clear() override { ReleaseAll(); }
 
   size_t UsedMemory() const override { return used_memory_.load(std::memory_order_relaxed); }
 
+  AllocatorStats Stats() const override {
+    std::lock_guard<std::mutex> lock(mu_);
+    AllocatorStats stats = stats_;
+    stats.reserved_bytes = used_memory_.load(std::memory_order_relaxed);
+    stats.free_bytes = stats.reserved_bytes - stats.allocated_bytes;
+    stats.largest_free_block = free_blocks_.empty() ? 0 : (*free_blocks_.rbegin())->size;
+    return stats;
+  }
+
+  /*!
+   * \brief Set the high watermark of the reserved memory, and release the idle segments that
+   *  exceed it. The watermark is a soft limit, allocations exceeding it still succeed.
+   * \param high_watermark The reserved bytes above which the idle segments are released.
+   */
+  void SetHighWatermark(size_t high_watermark) {
+    std::lock_guard<std::mutex> lock(mu_);
+    high_watermark_.store(high_watermark, std::memory_order_relaxed);
+    size_t used = used_memory_.load(std::memory_order_relaxed);
+    if (used > high_watermark) {
+      ReleaseIdleSegments(used - high_watermark);
+    }
+  }
+
+  /*! \return The high watermark from TVM_POOLED_ALLOCATOR_HIGH_WATERMARK, in bytes. */
+  static size_t DefaultHighWatermark() {
+    const char* val = std::getenv("TVM_POOLED_ALLOCATOR_HIGH_WATERMARK");
+    if (val == nullptr || *val == '\0') {
+      return std::numeric_limits<size_t>::max();
+    }
+    return static_cast<size_t>(std::strtoull(val, nullptr, 10));
+  }
+
  protected:
   virtual void* DeviceAllocDataSpace(Device dev, size_t nbytes, size_t alignment,
                                      DLDataType type_hint) {
@@ -105,24 +193,231 @@ class PooledAllocator : public Allocator {
     DeviceAPI::Get(dev)->FreeDataSpace(dev, ptr);
   }
 
+  /*!
+   * \brief Whether the data pointers from DeviceAllocDataSpace support address arithmetic, so
+   *  that a cached block can be split into smaller buffers.
+   */
+  virtual bool AllowSplit(Device dev) const {
+    switch (dev.device_type) {
+      case kDLCPU:
+      case kDLCUDA:
+      case kDLCUDAHost:
+      case kDLCUDAManaged:
+      case kDLROCM:
+      case kDLROCMHost:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  /*! \brief Release all the cached free memory to the device. */
   virtual void ReleaseAll() {
-    std::lock_guard<std::recursive_mutex> lock(mu_);
-    for (auto const& it : memory_pool_) {
-      auto const& pool = it.second;
-      for (auto const& buf : pool) {
-        DeviceFreeDataSpace(buf.device, buf.data);
+    std::lock_guard<std::mutex> lock(mu_);
+    ReleaseIdleSegments(std::numeric_limits<size_t>::max());
+    VLOG(1) << "release all buffers";
+  }
+
+  /*!
+   * \brief Track a buffer that the pool did not allocate, so that it is accounted for until
+   *  freed. Such a buffer is not cached, since it may not be usable as a flat buffer. Requires
+   *  holding `mu_`.
+   */
+  void TrackAllocatedBuffer(const Buffer& buffer) {
+    Block* block = AddSegment(buffer.device, buffer.data, buffer.size, /*splittable=*/false,
+                              /*cached=*/false);
+    TakeBlock(block, block->size);
+  }
+
+  /*! \brief Round a request up to its size class. */
+  size_t RoundToSizeClass(size_t nbytes) const {
+    size_t size = ((std::max<size_t>(nbytes, 1) + page_size_ - 1) / page_size_) * page_size_;
+    if (size <= page_size_ * kSizeClassesPerPowerOfTwo) {
+      return size;
+    }
+    // The step is a quarter of the largest power of two not exceeding `size`.
+    size_t power = 1;
+    while (power <= size / 2) power <<= 1;
+    size_t step = std::max(power / kSizeClassesPerPowerOfTwo, page_size_);
+    return ((size + step - 1) / step) * step;
+  }
+
+ private:
+  struct Block;
+
+  /*! \brief A piece of memory allocated from the device. */
+  struct Segment {
+    Device device;
+    void* data;
+    size_t size;
+    bool splittable;
+    /*! \brief Whether the segment is cached when free, otherwise it is released. */
+    bool cached;
+    /*! \brief The clock of the last free in the segment, for the LRU release. */
+    uint64_t last_used{0};
+    /*! \brief The first block in the segment. */
+    Block* head{nullptr};
+  };
+
+  /*! \brief A contiguous part of a segment, either allocated or cached. */
+  struct Block {
+    Segment* segment;
+    size_t offset;
+    size_t size;
+    bool allocated{false};
+    Block* prev{nullptr};
+    Block* next{nullptr};
+
+    void* data() const { return static_cast<char*>(segment->data) + offset; }
+  };
+
+  /*! \brief Order the free blocks by size, then device, then address. */
+  struct BlockLess {
+    bool operator()(const Block* a, const Block* b) const {
+      auto key = [](const Block* block) {
+        return std::make_tuple(block->size, static_cast<int>(block->segment->device.device_type),
+                               block->segment->device.device_id,
+                               reinterpret_cast<uintptr_t>(block->segment->data), block->offset);
+      };
+      return key(a) < key(b);
+    }
+  };
+
+  /*! \brief Find the smallest free block on `dev` that can hold `size` bytes. */
+  Block* FindFreeBlock(Device dev, size_t size, size_t alignment) {
+    Segment probe{dev, nullptr, 0, false, false};
+    Block key{&probe, 0, size};
+    for (auto it = free_blocks_.lower_bound(&key); it != free_blocks_.end(); ++it) {
+      Block* block = *it;
+      const Segment* segment = block->segment;
+      if (segment->device.device_type != dev.device_type ||
+          segment->device.device_id != dev.device_id) {
+        continue;
+      }
+      if (!segment->splittable) {
+        // A block that cannot be split is only reused when it wastes less than half of itself.
+        if (block->size >= size * 2) break;
+        return block;
+      }
+      if (alignment == 0 || reinterpret_cast<uintptr_t>(block->data()) % alignment == 0) {
+        return block;
       }
     }
-    memory_pool_.clear();
-    used_memory_ = 0;
-    VLOG(1) << "release all buffers";
+    return nullptr;
+  }
+
+  /*! \brief Take a free block for a buffer of `size` bytes, splitting off the remainder. */
+  Buffer TakeBlock(Block* block, size_t size) {
+    free_blocks_.erase(block);
+    if (block->segment->splittable && block->size > size) {
+      Block* rest = new Block{block->segment, block->offset + size, block->size - size};
+      rest->prev = block;
+      rest->next = block->next;
+      if (block->next != nullptr) block->next->prev = rest;
+      block->next = rest;
+      block->size = size;
+      free_blocks_.insert(rest);
+    }
+    block->allocated = true;
+    allocated_blocks_[block->data()] = block;
+    stats_.allocated_bytes += block->size;
+    stats_.peak_allocated_bytes = std::max(stats_.peak_allocated_bytes, stats_.allocated_bytes);
+    profiling::RecordTraceCounter("memory", "pooled allocated bytes", stats_.allocated_bytes);
+    Buffer buf;
+    buf.device = block->segment->device;
+    buf.data = block->data();
+    buf.size = block->size;
+    buf.alloc_type = kPooled;
+    return buf;
+  }
+
+  /*! \brief Merge a freed block with its free neighbors. */
+  Block* Coalesce(Block* block) {
+    if (Block* prev = block->prev; prev != nullptr && !prev->allocated) {
+      free_blocks_.erase(prev);
+      prev->size += block->size;
+      prev->next = block->next;
+      if (block->next != nullptr) block->next->prev = prev;
+      delete block;
+      block = prev;
+    }
+    if (Block* next = block->next; next != nullptr && !next->allocated) {
+      free_blocks_.erase(next);
+      block->size += next->size;
+      block->next = next->next;
+      if (next->next != nullptr) next->next->prev = block;
+      delete next;
+    }
+    return block;
+  }
+
+  /*! \brief Record a new segment, returning its only block, which is free. */
+  Block* AddSegment(Device dev, void* data, size_t size, bool splittable, bool cached) {
+    auto segment =
+        std::make_unique<Segment>(Segment{dev, data, size, splittable, cached, ++clock_});
+    segment->head = new Block{segment.get(), 0, size};
+    free_blocks_.insert(segment->head);
+    Block* block = segment->head;
+    segments_.emplace(data, std::move(segment));
+    size_t used = used_memory_.fetch_add(size, std::memory_order_relaxed) + size;
+    stats_.peak_reserved_bytes = std::max(stats_.peak_reserved_bytes, used);
+    return block;
+  }
+
+  /*! \brief Release a fully free segment to the device. */
+  void ReleaseSegment(Segment* segment) {
+    free_blocks_.erase(segment->head);
+    {
+      profiling::TraceScope trace_scope("memory", "device free", "bytes", segment->size);
+      DeviceFreeDataSpace(segment->device, segment->data);
+    }
+    used_memory_.fetch_sub(segment->size, std::memory_order_relaxed);
+    delete segment->head;
+    segments_.erase(segment->data);
+  }
+
+  /*!
+   * \brief Release the fully free segments to the device, least recently used first, until at
+   *  least `nbytes` bytes are released or no idle segment remains.
+   */
+  void ReleaseIdleSegments(size_t nbytes) {
+    std::vector<Segment*> idle;
+    for (const auto& kv : segments_) {
+      Segment* segment = kv.second.get();
+      if (!segment->head->allocated && segment->head->next == nullptr) {
+        idle.push_back(segment);
+      }
+    }
+    std::sort(idle.begin(), idle.end(),
+              [](const Segment* a, const Segment* b) { return a->last_used < b->last_used; });
+    size_t released = 0;
+    for (Segment* segment : idle) {
+      if (released >= nbytes) break;
+      released += segment->size;
+      ++stats_.num_released_segments;
+      ReleaseSegment(segment);
+    }
   }
 
  protected:
   size_t page_size_;
+  /*! \brief The bytes reserved from the device, including the cached blocks. */
   std::atomic<size_t> used_memory_;
-  std::unordered_map<size_t, std::vector<Buffer>> memory_pool_;
-  std::recursive_mutex mu_;
+  /*! \brief The reserved bytes above which the idle segments are released. */
+  std::atomic<size_t> high_watermark_;
+  mutable std::mutex mu_;
+
+ private:
+  /*! \brief The segments, keyed by their data pointers. */
+  std::unordered_map<void*, std::unique_ptr<Segment>> segments_;
+  /*! \brief The cached blocks, ordered for the best-fit lookup. */
+  std::set<Block*, BlockLess> free_blocks_;
+  /*! \brief The allocated blocks, keyed by their data pointers. */
+  std::unordered_map<void*, Block*> allocated_blocks_;
+  /*! \brief The counters, the reserved and free bytes are computed on demand. */
+  AllocatorStats stats_;
+  /*! \brief A logical clock for the LRU release. */
+  uint64_t clock_{0};
 };
 
 }  // namespace memory
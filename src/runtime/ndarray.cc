@@ -26,6 +26,7 @@
 #include <tvm/runtime/logging.h>
 #include <tvm/runtime/ndarray.h>
 #include <tvm/runtime/registry.h>
+#include <tvm/runtime/trace_event.h>
 
 #include "runtime_base.h"
 #include "tvm/runtime/data_type.h"
@@ -328,6 +329,7 @@ void NDArray::CopyFromTo(const DLTensor* from, DLTensor* to, TVMStreamHandle str
   // api manager.
   Device dev = from->device.device_type != kDLCPU ? from->device : to->device;
 
+  profiling::TraceScope trace_scope("memory", "copy", "bytes", from_size);
   DeviceAPI::Get(dev)->CopyDataFromTo(const_cast<DLTensor*>(from), to, stream);
 }
 
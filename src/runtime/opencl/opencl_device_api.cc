@@ -26,6 +26,9 @@
 #include <tvm/runtime/registry.h>
 
 #include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "../memory/pooled_allocator.h"
 #include "opencl_common.h"
@@ -816,42 +819,28 @@ class OpenCLPooledAllocator final : public memory::PooledAllocator {
  public:
   explicit OpenCLPooledAllocator() : PooledAllocator() {}
 
+  ~OpenCLPooledAllocator() { ReleaseScopedBuffers(); }
+
   bool AllowMemoryScope(const std::string& mem_scope) const final {
     return ((mem_scope.find("texture") != std::string::npos) || mem_scope.empty() ||
             ("global" == mem_scope));
   }
 
-  Buffer Alloc(Device dev, size_t nbytes, size_t alignment, DLDataType type_hint) override {
-    std::lock_guard<std::recursive_mutex> lock(mu_);
-    size_t size = ((nbytes + page_size_ - 1) / page_size_) * page_size_;
-    auto&& it = memory_pool_.find(size);
-    if (it != memory_pool_.end() && !it->second.empty()) {
-      auto&& pool = it->second;
-      auto ret = pool.back();
-      pool.pop_back();
-      return ret;
-    }
-    Buffer buf;
-    buf.device = dev;
-    buf.size = size;
-    buf.alloc_type = AllocatorType::kPooled;
-    try {
-      buf.data = DeviceAllocDataSpace(dev, size, alignment, type_hint);
-    } catch (InternalError& err) {
-      LOG(WARNING) << "PooledAllocator got InternalError during allocation: " << err.message();
-      LOG(WARNING) << "Trying to release all unused memory and reallocate...";
-      ReleaseAll();
-      buf.data = DeviceAllocDataSpace(dev, size, alignment, type_hint);
-    }
-
-    used_memory_.fetch_add(size, std::memory_order_relaxed);
-    VLOG(1) << "allocate " << size << " B, used memory " << used_memory_ << " B";
-    return buf;
-  }
-
   Buffer Alloc(Device dev, ShapeTuple shape, DLDataType type_hint,
                const std::string& mem_scope) override {
     if (AllowMemoryScope(mem_scope)) {
+      // A scoped buffer, e.g. an image, is only reused for the same scope, shape and type, as it
+      // can't serve as a flat buffer of the same size.
+      std::ostringstream key;
+      key << mem_scope << ':' << DLDataType2String(type_hint) << ':' << shape;
+      std::lock_guard<std::mutex> lock(mu_);
+      std::vector<Buffer>& cached = scoped_pool_[key.str()];
+      if (!cached.empty()) {
+        Buffer buf = cached.back();
+        cached.pop_back();
+        scoped_keys_[buf.data] = key.str();
+        return buf;
+      }
       NDArray::Container container(nullptr, shape, type_hint, dev);
       size_t size = DeviceAPI::Get(dev)->GetDataSize(container.dl_tensor);
       Buffer buf;
@@ -864,6 +853,7 @@ class OpenCLPooledAllocator final : public memory::PooledAllocator {
         // All textures are backed by buffers - don't count in total memory
         used_memory_.fetch_add(size, std::memory_order_relaxed);
       }
+      scoped_keys_[buf.data] = key.str();
       DLOG(INFO) << "allocate " << size << " B, used memory " << used_memory_ << " B";
       return buf;
     }
@@ -872,12 +862,16 @@ class OpenCLPooledAllocator final : public memory::PooledAllocator {
   }
 
   void Free(const Buffer& buffer) override {
-    std::lock_guard<std::recursive_mutex> lock(mu_);
-    if (memory_pool_.find(buffer.size) == memory_pool_.end()) {
-      memory_pool_.emplace(buffer.size, std::vector<Buffer>{});
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      auto it = scoped_keys_.find(buffer.data);
+      if (it != scoped_keys_.end()) {
+        scoped_pool_[it->second].push_back(buffer);
+        scoped_keys_.erase(it);
+        return;
+      }
     }
-    memory_pool_.at(buffer.size).push_back(buffer);
-    VLOG(1) << "reclaim buffer " << buffer.size;
+    PooledAllocator::Free(buffer);
   }
 
   void* CreateView(const Buffer& buffer, ShapeTuple shape, DLDataType type_hint,
@@ -891,6 +885,33 @@ class OpenCLPooledAllocator final : public memory::PooledAllocator {
     OpenCLWorkspace* ws_ = OpenCLWorkspace::Global();
     return ws_->FreeDataSpaceView(dev, data);
   }
+
+ protected:
+  void ReleaseAll() final {
+    ReleaseScopedBuffers();
+    PooledAllocator::ReleaseAll();
+  }
+
+ private:
+  /*! \brief Release the cached scoped buffers to the device. */
+  void ReleaseScopedBuffers() {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (auto& [key, cached] : scoped_pool_) {
+      bool is_texture = key.find("texture") != std::string::npos;
+      for (const Buffer& buf : cached) {
+        DeviceAPI::Get(buf.device)->FreeDataSpace(buf.device, buf.data);
+        if (!is_texture) {
+          used_memory_.fetch_sub(buf.size, std::memory_order_relaxed);
+        }
+      }
+    }
+    scoped_pool_.clear();
+  }
+
+  /*! \brief The free scoped buffers, keyed by their scope, type and shape. */
+  std::unordered_map<std::string, std::vector<Buffer>> scoped_pool_;
+  /*! \brief The keys of the allocated scoped buffers, keyed by their data pointers. */
+  std::unordered_map<void*, std::string> scoped_keys_;
 };
 
 TVM_REGISTER_GLOBAL("DeviceAllocator.opencl").set_body([](TVMArgs args, TVMRetValue* rv) {
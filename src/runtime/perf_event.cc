@@ -0,0 +1,304 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file perf_event.cc
+ * \brief A metric collector for the hardware performance counters of the CPU, using the Linux
+ *  perf_event interface.
+ */
+#include <tvm/runtime/c_backend_api.h>
+#include <tvm/runtime/logging.h>
+#include <tvm/runtime/profiling.h>
+#include <tvm/runtime/registry.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+namespace profiling {
+
+/*! \brief An event that can be counted, and the column of its counts in the report. */
+struct PerfEventInfo {
+  /*! \brief The name of the event, as listed by `perf list`. */
+  const char* name;
+  /*! \brief The name of the metric in the report. */
+  const char* column;
+  uint32_t type;
+  uint64_t config;
+};
+
+#ifdef __linux__
+#define TVM_PERF_HW_CACHE_CONFIG(cache, op, result) ((cache) | ((op) << 8) | ((result) << 16))
+
+static const PerfEventInfo kPerfEvents[] = {
+    {"cycles", "Cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", "Instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"cache-references", "Cache References", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {"cache-misses", "Cache Misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branches", "Branches", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+    {"branch-misses", "Branch Misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"stalled-cycles-frontend", "Stalled Cycles Frontend", PERF_TYPE_HARDWARE,
+     PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+    {"stalled-cycles-backend", "Stalled Cycles Backend", PERF_TYPE_HARDWARE,
+     PERF_COUNT_HW_STALLED_CYCLES_BACKEND},
+    {"L1-dcache-load-misses", "L1D Load Misses", PERF_TYPE_HW_CACHE,
+     TVM_PERF_HW_CACHE_CONFIG(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                              PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"LLC-loads", "LLC Loads", PERF_TYPE_HW_CACHE,
+     TVM_PERF_HW_CACHE_CONFIG(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+                              PERF_COUNT_HW_CACHE_RESULT_ACCESS)},
+    {"LLC-load-misses", "LLC Load Misses", PERF_TYPE_HW_CACHE,
+     TVM_PERF_HW_CACHE_CONFIG(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+                              PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {"task-clock", "Task Clock (ns)", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"page-faults", "Page Faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {"context-switches", "Context Switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+};
+
+#undef TVM_PERF_HW_CACHE_CONFIG
+
+/*! \brief Open a counter of the event on a thread, or return -1 and set errno on failure. */
+static int OpenPerfEvent(const PerfEventInfo& event, pid_t tid, int group_fd) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = event.type;
+  attr.config = event.config;
+  // Only count user space, which is allowed with the default perf_event_paranoid level.
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, tid, -1, group_fd, 0));
+}
+
+/*! \return The ids of the threads of this process. */
+static std::vector<pid_t> ListThreads() {
+  std::vector<pid_t> tids;
+  DIR* dir = opendir("/proc/self/task");
+  if (dir == nullptr) {
+    return {static_cast<pid_t>(syscall(SYS_gettid))};
+  }
+  while (dirent* entry = readdir(dir)) {
+    if (entry->d_name[0] != '.') {
+      tids.push_back(static_cast<pid_t>(atoi(entry->d_name)));
+    }
+  }
+  closedir(dir);
+  return tids;
+}
+#endif
+
+/*! \brief Object that holds the counts of all threads at the start of a function call. */
+struct PerfEventValuesNode : public Object {
+  /*! \brief The counts of each event, summed over the threads. */
+  std::vector<double> start_values;
+
+  explicit PerfEventValuesNode(std::vector<double> start_values)
+      : start_values(std::move(start_values)) {}
+
+  static constexpr const char* _type_key = "runtime.profiling.PerfEventValues";
+  TVM_DECLARE_FINAL_OBJECT_INFO(PerfEventValuesNode, Object);
+};
+
+/*! \brief MetricCollectorNode for the perf_event counters of the CPU.
+ *
+ * The events are counted as one group per thread of the process, so that the
+ * counts of a group are comparable even when the kernel multiplexes the
+ * hardware counters. A thread pool worker runs the parallel tasks of the
+ * profiled calls on its own, so the counts of all threads are summed.
+ */
+struct PerfEventMetricCollectorNode final : public MetricCollectorNode {
+  explicit PerfEventMetricCollectorNode(Array<String> metrics) {
+    for (const String& metric : metrics) {
+      metric_names.push_back(metric);
+    }
+    if (metric_names.empty()) {
+      metric_names = {"cycles", "instructions", "LLC-load-misses", "branch-misses"};
+    }
+  }
+
+  void Init(Array<DeviceWrapper> devices) final {
+    bool has_cpu = false;
+    for (const DeviceWrapper& device : devices) {
+      has_cpu |= device->device.device_type == kDLCPU;
+    }
+    if (!has_cpu || !thread_fds.empty()) {
+      return;
+    }
+#ifdef __linux__
+    events.clear();
+    for (const std::string& name : metric_names) {
+      const PerfEventInfo* event = nullptr;
+      for (const PerfEventInfo& info : kPerfEvents) {
+        if (name == info.name) {
+          event = &info;
+          break;
+        }
+      }
+      if (event == nullptr) {
+        std::string supported;
+        for (const PerfEventInfo& info : kPerfEvents) {
+          supported += supported.empty() ? info.name : std::string(", ") + info.name;
+        }
+        LOG(FATAL) << "ValueError: Unknown perf event \"" << name << "\". Supported events are "
+                   << supported;
+      }
+      // Check that the event can be counted on this machine before opening it on all threads.
+      int fd = OpenPerfEvent(*event, 0, -1);
+      if (fd < 0) {
+        LOG(WARNING) << "Cannot count perf event \"" << name << "\": " << strerror(errno)
+                     << (errno == EACCES || errno == EPERM
+                             ? ". Try setting `sudo sh -c 'echo 2 "
+                               ">/proc/sys/kernel/perf_event_paranoid'`"
+                             : "");
+        continue;
+      }
+      close(fd);
+      events.push_back(event);
+    }
+    if (events.empty()) {
+      return;
+    }
+    // Start the workers of the thread pool, so that their counters are opened with the others.
+    TVMBackendParallelLaunch([](int, TVMParallelGroupEnv*, void*) { return 0; }, nullptr, 0);
+    for (pid_t tid : ListThreads()) {
+      std::vector<int> fds;
+      for (const PerfEventInfo* event : events) {
+        int fd = OpenPerfEvent(*event, tid, fds.empty() ? -1 : fds[0]);
+        if (fd < 0) {
+          break;
+        }
+        fds.push_back(fd);
+      }
+      if (fds.size() != events.size()) {
+        // The thread may have exited since it was listed.
+        for (int fd : fds) {
+          close(fd);
+        }
+        continue;
+      }
+      thread_fds.push_back(std::move(fds));
+    }
+#else
+    LOG(WARNING) << "The perf_event counters are only available on Linux";
+#endif
+  }
+
+  ObjectRef Start(Device dev) final {
+    if (dev.device_type != kDLCPU || thread_fds.empty()) {
+      return ObjectRef(nullptr);
+    }
+    return ObjectRef(make_object<PerfEventValuesNode>(ReadCounts()));
+  }
+
+  Map<String, ObjectRef> Stop(ObjectRef obj) final {
+    const PerfEventValuesNode* start = obj.as<PerfEventValuesNode>();
+    std::vector<double> end_values = ReadCounts();
+    Map<String, ObjectRef> reported_metrics;
+    for (size_t i = 0; i < events.size(); ++i) {
+      // The scaled counts of multiplexed events may decrease slightly between two reads.
+      double count = std::max(end_values[i] - start->start_values[i], 0.0);
+      reported_metrics.Set(events[i]->column,
+                           ObjectRef(make_object<CountNode>(static_cast<int64_t>(count + 0.5))));
+    }
+    return reported_metrics;
+  }
+
+  ~PerfEventMetricCollectorNode() final {
+#ifdef __linux__
+    for (const std::vector<int>& fds : thread_fds) {
+      for (int fd : fds) {
+        close(fd);
+      }
+    }
+#endif
+  }
+
+  /*! \brief The names of the requested events. */
+  std::vector<std::string> metric_names;
+  /*! \brief The events that are counted, which are the requested ones supported by the CPU. */
+  std::vector<const PerfEventInfo*> events;
+  /*! \brief The file descriptors of the counters of each thread, the group leader first. */
+  std::vector<std::vector<int>> thread_fds;
+
+  static constexpr const char* _type_key = "runtime.profiling.PerfEventMetricCollector";
+  TVM_DECLARE_FINAL_OBJECT_INFO(PerfEventMetricCollectorNode, MetricCollectorNode);
+
+ private:
+  /*! \brief Read the counts of each event, summed over the threads. */
+  std::vector<double> ReadCounts() {
+    std::vector<double> counts(events.size(), 0.0);
+#ifdef __linux__
+    // The layout of PERF_FORMAT_GROUP: nr, time_enabled, time_running, values[nr].
+    std::vector<uint64_t> buf(3 + events.size());
+    for (const std::vector<int>& fds : thread_fds) {
+      ssize_t size = read(fds[0], buf.data(), buf.size() * sizeof(uint64_t));
+      if (size != static_cast<ssize_t>(buf.size() * sizeof(uint64_t)) || buf[2] == 0) {
+        // The thread has not been scheduled since the counters were opened.
+        continue;
+      }
+      // Extrapolate the counts when the counters were multiplexed.
+      double scale = static_cast<double>(buf[1]) / static_cast<double>(buf[2]);
+      for (size_t i = 0; i < events.size(); ++i) {
+        counts[i] += static_cast<double>(buf[3 + i]) * scale;
+      }
+    }
+#endif
+    return counts;
+  }
+};
+
+/*! \brief Wrapper for `PerfEventMetricCollectorNode`. */
+class PerfEventMetricCollector : public MetricCollector {
+ public:
+  explicit PerfEventMetricCollector(Array<String> metrics) {
+    data_ = make_object<PerfEventMetricCollectorNode>(metrics);
+  }
+  TVM_DEFINE_MUTABLE_OBJECT_REF_METHODS(PerfEventMetricCollector, MetricCollector,
+                                        PerfEventMetricCollectorNode);
+};
+
+MetricCollector CreatePerfEventMetricCollector(Array<String> metrics) {
+  return PerfEventMetricCollector(metrics);
+}
+
+TVM_REGISTER_OBJECT_TYPE(PerfEventValuesNode);
+TVM_REGISTER_OBJECT_TYPE(PerfEventMetricCollectorNode);
+
+TVM_REGISTER_GLOBAL("runtime.profiling.PerfEventMetricCollector")
+    .set_body_typed(CreatePerfEventMetricCollector);
+
+}  // namespace profiling
+}  // namespace runtime
+}  // namespace tvm
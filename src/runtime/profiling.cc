@@ -577,6 +577,18 @@ String ReportNode::AsTable(bool sort, bool aggregate, bool compute_col_sums) con
     aggregated_calls.push_back(metrics);
   }
 
+  // instructions per cycle, from the counts of the perf_event metric collector
+  for (auto& row : aggregated_calls) {
+    auto cycles = row.find("Cycles");
+    auto instructions = row.find("Instructions");
+    if (cycles != row.end() && instructions != row.end() && (*cycles).second.as<CountNode>() &&
+        (*instructions).second.as<CountNode>() && (*cycles).second.as<CountNode>()->value > 0) {
+      double ipc = static_cast<double>((*instructions).second.as<CountNode>()->value) /
+                   (*cycles).second.as<CountNode>()->value;
+      row.Set("IPC", ObjectRef(make_object<RatioNode>(ipc)));
+    }
+  }
+
   // Table formatting
   std::set<std::string> unique_headers;
   for (auto row : aggregated_calls) {
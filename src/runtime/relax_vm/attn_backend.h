@@ -67,10 +67,11 @@ class PagedPrefillFunc : public AttnBackendFunc {
   explicit PagedPrefillFunc(PackedFunc attn_func, AttnKind attn_kind, AttnBackendKind backend_kind)
       : AttnBackendFunc(std::move(attn_func), attn_kind, backend_kind) {}
 
-  virtual void MHA(int depth, NDArray q, NDArray qo_indptr, NDArray pages, NDArray page_indptr,
-                   NDArray page_indices, NDArray length_info, NDArray q_rope_position,
-                   NDArray k_rope_pos_offset, bool causal, RoPEMode rope_mode, double rotary_scale,
-                   double rotary_theta, double sm_scale, NDArray attn_output, NDArray attn_lse,
+  virtual void MHA(int depth, NDArray q, NDArray qo_indptr, NDArray pages,
+                   Optional<NDArray> page_scales, NDArray page_indptr, NDArray page_indices,
+                   NDArray length_info, NDArray q_rope_position, NDArray k_rope_pos_offset,
+                   bool causal, RoPEMode rope_mode, double rotary_scale, double rotary_theta,
+                   double sm_scale, NDArray attn_output, NDArray attn_lse,
                    TVMStreamHandle compute_stream) {
     LOG(FATAL) << "MHA computation is not supported by the current backend";
   }
@@ -97,11 +98,20 @@ class TIRPagedPrefillFunc : public PagedPrefillFunc {
   explicit TIRPagedPrefillFunc(PackedFunc attn_func, AttnKind attn_kind)
       : PagedPrefillFunc(std::move(attn_func), attn_kind, AttnBackendKind::kTIR) {}
 
-  void MHA(int depth, NDArray q, NDArray qo_indptr, NDArray pages, NDArray page_indptr,
-           NDArray page_indices, NDArray length_info, NDArray q_rope_position,
-           NDArray k_rope_pos_offset, bool causal, RoPEMode rope_mode, double rotary_scale,
-           double rotary_theta, double sm_scale, NDArray attn_output, NDArray attn_lse,
-           TVMStreamHandle compute_stream) final {
+  void MHA(int depth, NDArray q, NDArray qo_indptr, NDArray pages, Optional<NDArray> page_scales,
+           NDArray page_indptr, NDArray page_indices, NDArray length_info,
+           NDArray q_rope_position, NDArray k_rope_pos_offset, bool causal, RoPEMode rope_mode,
+           double rotary_scale, double rotary_theta, double sm_scale, NDArray attn_output,
+           NDArray attn_lse, TVMStreamHandle compute_stream) final {
+    if (page_scales.defined()) {
+      // Quantized pages are passed along with their scales.
+      attn_func_(q, qo_indptr, pages, page_scales.value(), page_indptr, page_indices, length_info,
+                 k_rope_pos_offset, q_rope_position, attn_output, attn_lse,
+                 static_cast<int64_t>(causal),
+                 /*rotary_mode=*/static_cast<int64_t>(rope_mode == RoPEMode::kInline),
+                 rotary_scale, rotary_theta, sm_scale);
+      return;
+    }
     attn_func_(q, qo_indptr, pages, page_indptr, page_indices, length_info, k_rope_pos_offset,
                q_rope_position, attn_output, attn_lse, static_cast<int64_t>(causal),
                /*rotary_mode=*/static_cast<int64_t>(rope_mode == RoPEMode::kInline), rotary_scale,
@@ -124,11 +134,11 @@ class FlashInferPagedPrefillFunc : public PagedPrefillFunc {
       : PagedPrefillFunc(std::move(attn_func), attn_kind, AttnBackendKind::kFlashInfer),
         plan_func_(std::move(plan_func)) {}
 
-  void MHA(int depth, NDArray q, NDArray qo_indptr, NDArray pages, NDArray page_indptr,
-           NDArray page_indices, NDArray length_info, NDArray q_rope_position,
-           NDArray k_rope_pos_offset, bool causal, RoPEMode rope_mode, double rotary_scale,
-           double rotary_theta, double sm_scale, NDArray attn_output, NDArray attn_lse,
-           TVMStreamHandle compute_stream) final {
+  void MHA(int depth, NDArray q, NDArray qo_indptr, NDArray pages, Optional<NDArray> page_scales,
+           NDArray page_indptr, NDArray page_indices, NDArray length_info,
+           NDArray q_rope_position, NDArray k_rope_pos_offset, bool causal, RoPEMode rope_mode,
+           double rotary_scale, double rotary_theta, double sm_scale, NDArray attn_output,
+           NDArray attn_lse, TVMStreamHandle compute_stream) final {
     auto [float_workspace_buffer, int_workspace_buffer, page_locked_int_workspace_buffer,
           plan_info_vec] = cached_buffers_[depth];
     double rope_rcp_scale = 1 / rotary_scale;
@@ -290,10 +300,11 @@ class PagedDecodeFunc : public AttnBackendFunc {
   explicit PagedDecodeFunc(PackedFunc attn_func, AttnKind attn_kind, AttnBackendKind backend_kind)
       : AttnBackendFunc(std::move(attn_func), attn_kind, backend_kind) {}
 
-  virtual void MHA(int depth, NDArray q, NDArray pages, NDArray page_indptr, NDArray page_indices,
-                   NDArray length_info, NDArray k_rope_pos_offset, NDArray q_rope_position,
-                   RoPEMode rope_mode, double rotary_scale, double rotary_theta, double sm_scale,
-                   NDArray attn_output, NDArray attn_lse, TVMStreamHandle compute_stream) {
+  virtual void MHA(int depth, NDArray q, NDArray pages, Optional<NDArray> page_scales,
+                   NDArray page_indptr, NDArray page_indices, NDArray length_info,
+                   NDArray k_rope_pos_offset, NDArray q_rope_position, RoPEMode rope_mode,
+                   double rotary_scale, double rotary_theta, double sm_scale, NDArray attn_output,
+                   NDArray attn_lse, TVMStreamHandle compute_stream) {
     LOG(FATAL) << "MHA computation is not supported by the current backend";
   }
 
@@ -319,10 +330,19 @@ class TIRPagedDecodeFunc : public PagedDecodeFunc {
   explicit TIRPagedDecodeFunc(PackedFunc attn_func, AttnKind attn_kind)
       : PagedDecodeFunc(std::move(attn_func), attn_kind, AttnBackendKind::kTIR) {}
 
-  void MHA(int depth, NDArray q, NDArray pages, NDArray page_indptr, NDArray page_indices,
-           NDArray length_info, NDArray k_rope_pos_offset, NDArray q_rope_position,
-           RoPEMode rope_mode, double rotary_scale, double rotary_theta, double sm_scale,
-           NDArray attn_output, NDArray attn_lse, TVMStreamHandle compute_stream) final {
+  void MHA(int depth, NDArray q, NDArray pages, Optional<NDArray> page_scales,
+           NDArray page_indptr, NDArray page_indices, NDArray length_info,
+           NDArray k_rope_pos_offset, NDArray q_rope_position, RoPEMode rope_mode,
+           double rotary_scale, double rotary_theta, double sm_scale, NDArray attn_output,
+           NDArray attn_lse, TVMStreamHandle compute_stream) final {
+    if (page_scales.defined()) {
+      // Quantized pages are passed along with their scales.
+      attn_func_(q, pages, page_scales.value(), page_indptr, page_indices, length_info,
+                 k_rope_pos_offset, q_rope_position, attn_output, attn_lse,
+                 /*rotary_mode=*/static_cast<int64_t>(rope_mode == RoPEMode::kInline),
+                 rotary_scale, rotary_theta, sm_scale);
+      return;
+    }
     attn_func_(q, pages, page_indptr, page_indices, length_info, k_rope_pos_offset, q_rope_position,
                attn_output, attn_lse,
                /*rotary_mode=*/static_cast<int64_t>(rope_mode == RoPEMode::kInline), rotary_scale,
@@ -343,10 +363,11 @@ class FlashInferPagedDecodeFunc : public PagedDecodeFunc {
       : PagedDecodeFunc(std::move(attn_func), attn_kind, AttnBackendKind::kFlashInfer),
         plan_func_(std::move(plan_func)) {}
 
-  void MHA(int depth, NDArray q, NDArray pages, NDArray page_indptr, NDArray page_indices,
-           NDArray length_info, NDArray k_rope_pos_offset, NDArray q_rope_position,
-           RoPEMode rope_mode, double rotary_scale, double rotary_theta, double sm_scale,
-           NDArray attn_output, NDArray attn_lse, TVMStreamHandle compute_stream) final {
+  void MHA(int depth, NDArray q, NDArray pages, Optional<NDArray> page_scales,
+           NDArray page_indptr, NDArray page_indices, NDArray length_info,
+           NDArray k_rope_pos_offset, NDArray q_rope_position, RoPEMode rope_mode,
+           double rotary_scale, double rotary_theta, double sm_scale, NDArray attn_output,
+           NDArray attn_lse, TVMStreamHandle compute_stream) final {
     auto [float_workspace_buffer, int_workspace_buffer, page_locked_int_workspace_buffer,
           plan_info_vec] = cached_buffers_[depth];
     double rope_rcp_scale = 1 / rotary_scale;
@@ -391,11 +412,12 @@ class PagedPrefillTreeMaskFunc : public AttnBackendFunc {
                                     AttnBackendKind backend_kind)
       : AttnBackendFunc(std::move(attn_func), attn_kind, backend_kind) {}
 
-  virtual void MHA(NDArray q, NDArray qo_indptr, NDArray pages, NDArray page_indptr,
-                   NDArray page_indices, NDArray length_info, NDArray k_rope_pos_offset,
-                   NDArray q_rope_position, NDArray tree_attn_mn_indptr, NDArray tree_attn_mask,
-                   RoPEMode rope_mode, double rotary_scale, double rotary_theta, double sm_scale,
-                   NDArray attn_output, NDArray attn_lse, TVMStreamHandle compute_stream) {
+  virtual void MHA(NDArray q, NDArray qo_indptr, NDArray pages, Optional<NDArray> page_scales,
+                   NDArray page_indptr, NDArray page_indices, NDArray length_info,
+                   NDArray k_rope_pos_offset, NDArray q_rope_position, NDArray tree_attn_mn_indptr,
+                   NDArray tree_attn_mask, RoPEMode rope_mode, double rotary_scale,
+                   double rotary_theta, double sm_scale, NDArray attn_output, NDArray attn_lse,
+                   TVMStreamHandle compute_stream) {
     LOG(FATAL) << "MHA computation is not supported by the current backend";
   }
 
@@ -421,11 +443,20 @@ class TIRPagedPrefillTreeMaskFunc : public PagedPrefillTreeMaskFunc {
   explicit TIRPagedPrefillTreeMaskFunc(PackedFunc attn_func, AttnKind attn_kind)
       : PagedPrefillTreeMaskFunc(std::move(attn_func), attn_kind, AttnBackendKind::kTIR) {}
 
-  void MHA(NDArray q, NDArray qo_indptr, NDArray pages, NDArray page_indptr, NDArray page_indices,
-           NDArray length_info, NDArray k_rope_pos_offset, NDArray q_rope_position,
-           NDArray tree_attn_mn_indptr, NDArray tree_attn_mask, RoPEMode rope_mode,
-           double rotary_scale, double rotary_theta, double sm_scale, NDArray attn_output,
-           NDArray attn_lse, TVMStreamHandle compute_stream) final {
+  void MHA(NDArray q, NDArray qo_indptr, NDArray pages, Optional<NDArray> page_scales,
+           NDArray page_indptr, NDArray page_indices, NDArray length_info,
+           NDArray k_rope_pos_offset, NDArray q_rope_position, NDArray tree_attn_mn_indptr,
+           NDArray tree_attn_mask, RoPEMode rope_mode, double rotary_scale, double rotary_theta,
+           double sm_scale, NDArray attn_output, NDArray attn_lse,
+           TVMStreamHandle compute_stream) final {
+    if (page_scales.defined()) {
+      // Quantized pages are passed along with their scales.
+      attn_func_(q, qo_indptr, pages, page_scales.value(), page_indptr, page_indices, length_info,
+                 k_rope_pos_offset, q_rope_position, attn_output, attn_lse,
+                 /*rotary_mode=*/static_cast<int64_t>(rope_mode == RoPEMode::kInline),
+                 rotary_scale, rotary_theta, sm_scale, tree_attn_mn_indptr, tree_attn_mask);
+      return;
+    }
     attn_func_(q, qo_indptr, pages, page_indptr, page_indices, length_info, k_rope_pos_offset,
                q_rope_position, attn_output, attn_lse,
                /*rotary_mode=*/static_cast<int64_t>(rope_mode == RoPEMode::kInline), rotary_scale,
@@ -28,6 +28,8 @@
 
 #include <algorithm>
 #include <limits>
+#include <map>
+#include <memory>
 #include <utility>
 #include <vector>
 #if defined(OPENCL_ENABLE_HOST_PTR)
@@ -130,6 +132,11 @@ struct Block {
    * we do not allow appending new KV values to this block.
    */
   int external_ref_cnt = 0;
+  /*!
+   * \brief The slots in the offload store holding the pages of the block
+   * when the block is offloaded, in which case `page_ids` is empty.
+   */
+  std::vector<int64_t> offload_slots;
 
   explicit Block(int32_t index) : index(index) {}
 
@@ -142,6 +149,7 @@ struct Block {
     sliding_window_offset = 0;
     parent_idx = -1;
     external_ref_cnt = 0;
+    offload_slots.clear();
   }
 };
 
@@ -193,6 +201,11 @@ struct Sequence {
    * this sequence are committed
    */
   bool accepted_indices_committed = true;
+  /*!
+   * \brief A boolean denoting whether the pages used only by this
+   * sequence are offloaded out of device.
+   */
+  bool offloaded = false;
 
   explicit Sequence(std::vector<Block>* global_block_pool, int32_t last_block_idx) {
     ++global_block_pool->at(last_block_idx).external_ref_cnt;
@@ -223,6 +236,36 @@ struct Sequence {
   }
 };
 
+/*!
+ * \brief The node of the prefix tree in paged KV cache, which indexes the KV data of
+ * token prefixes so that sequences with a common prompt can share it.
+ * Each node other than the root holds one reference of a block, whose tokens label the
+ * edge from the parent node. Therefore the blocks along a path of the tree form a chain
+ * linked by the `parent_idx` field of Block.
+ */
+struct PrefixTreeNode {
+  /*! \brief The tokens in the block of the node, whose number is a multiple of page size. */
+  std::vector<int32_t> token_ids;
+  /*! \brief The global index of the block of the node, or -1 for the root. */
+  int32_t block_idx = -1;
+  /*! \brief The parent node, or nullptr for the root. */
+  PrefixTreeNode* parent = nullptr;
+  /*!
+   * \brief The child nodes, indexed by the tokens in their first pages.
+   * Since KV data is shared in pages, children can start with the same token.
+   */
+  std::map<std::vector<int32_t>, std::unique_ptr<PrefixTreeNode>> children;
+  /*! \brief The logical time when the node was last matched or inserted, for LRU eviction. */
+  int64_t last_access_time = 0;
+  /*!
+   * \brief Whether the block of the node is referenced by a block outside of the prefix tree,
+   * e.g. the block of a sequence that reuses the prefix.
+   */
+  bool pinned = false;
+  /*! \brief The number of pinned nodes in the subtree of the node, which is evictable when 0. */
+  int num_pinned_in_subtree = 0;
+};
+
 /*!
  * \brief For the given list of sequences, check the block trace of
  * each sequence, and return the blocks ids used by the sequences
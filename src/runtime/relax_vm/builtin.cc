@@ -611,6 +611,11 @@ TVM_DLL int TVMBackendAnyListResetItem(void* anylist, int index);
 TVM_DLL int TVMBackendAnyListMoveFromPackedReturn(void* anylist, int index, TVMValue* args,
                                                   int* type_codes, int ret_offset);
 
+// The "compiled_direct_tensors" exec mode of the VM TIR codegen reads the handle of an anylist
+// item as the TVMValue at twice the index of the item.
+static_assert(sizeof(tvm::runtime::TVMRetValue) == 2 * sizeof(TVMValue),
+              "A TVMRetValue is expected to span two TVMValues");
+
 int TVMBackendAnyListSetPackedArg(void* anylist, int index, TVMValue* args, int* type_codes,
                                   int arg_offset) {
   using namespace tvm::runtime;
@@ -22,12 +22,17 @@
  */
 
 #include <dmlc/memory_io.h>
+#include <tvm/runtime/device_api.h>
 #include <tvm/runtime/logging.h>
 #include <tvm/runtime/relax_vm/executable.h>
 #include <tvm/runtime/relax_vm/vm.h>
 
 #include <functional>
+#include <mutex>
 #include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "../file_utils.h"
 
@@ -52,6 +57,18 @@ enum ConstantType : int {
   ICHECK(val) << "Invalid VM file format in the " << section << " section." \
               << "\n";
 
+/*! \brief Align an offset in the serialized executable to kAllocAlignment. */
+inline size_t AlignConstantOffset(size_t offset) {
+  return (offset + kAllocAlignment - 1) / kAllocAlignment * kAllocAlignment;
+}
+
+/*! \brief The deleter of the NDArray constants aliasing a mapped executable. */
+void MappedConstantDeleter(Object* obj) {
+  auto* ptr = static_cast<NDArray::Container*>(obj);
+  delete static_cast<ObjectRef*>(ptr->manager_ctx);
+  delete ptr;
+}
+
 std::string VMExecutable::Stats() const {
   std::ostringstream oss;
   oss << "Relax VM executable statistics:" << std::endl;
@@ -60,10 +77,14 @@ std::string VMExecutable::Stats() const {
   // If the constant is an NDArray, get the shape of each of them.
   // If the constant is an DLDataType, get the data type of each of them.
   oss << "  Constant pool (# " << constants.size() << "): [";
-  for (const auto& it : constants) {
-    if (it.IsObjectRef<runtime::NDArray>()) {
-      const auto ndarray = it.operator tvm::runtime::NDArray();
-      const auto& shape = ndarray.Shape();
+  for (size_t i = 0; i < constants.size(); ++i) {
+    const TVMRetValue& it = constants[i];
+    auto lazy_it = lazy_constants_.find(i);
+    if (lazy_it != lazy_constants_.end() || it.IsObjectRef<runtime::NDArray>()) {
+      // The shape of a lazy constant is in its record, so it is not loaded.
+      ShapeTuple shape = lazy_it != lazy_constants_.end()
+                             ? lazy_it->second.shape
+                             : it.operator tvm::runtime::NDArray().Shape();
       // Scalar
       if (shape.empty()) {
         oss << "scalar, ";
@@ -173,7 +194,7 @@ void LoadHeader(dmlc::Stream* strm) {
   STREAM_CHECK(version == RELAX_VM_VERSION, "version");
 }
 
-void VMExecutable::SaveToBinary(dmlc::Stream* stream) {
+std::string VMExecutable::SaveToBytes() {
   std::string code;
   // Initialize the stream object.
   dmlc::MemoryStringStream strm(&code);
@@ -190,21 +211,19 @@ void VMExecutable::SaveToBinary(dmlc::Stream* stream) {
   // Code section.
   SaveCodeSection(&strm);
 
-  stream->Write(code);
+  return code;
 }
 
+void VMExecutable::SaveToBinary(dmlc::Stream* stream) { stream->Write(SaveToBytes()); }
+
 void VMExecutable::SaveToFile(const String& file_name, const String& format) {
-  std::string data;
-  dmlc::MemoryStringStream writer(&data);
-  dmlc::SeekStream* strm = &writer;
-  VMExecutable::SaveToBinary(strm);
-  runtime::SaveBinaryToFile(file_name, data);
+  // The file holds the serialized executable without a size prefix, so that the file is mapped
+  // with the alignment of the constants.
+  runtime::SaveBinaryToFile(file_name, SaveToBytes());
 }
 
-Module VMExecutable::LoadFromBinary(void* stream) {
-  std::string code;
-  static_cast<dmlc::Stream*>(stream)->Read(&code);
-  dmlc::MemoryStringStream strm(&code);
+Module VMExecutable::Load(ObjectRef storage, const char* data, size_t size) {
+  dmlc::MemoryFixedSizeStream strm(const_cast<char*>(data), size);
 
   ObjectPtr<VMExecutable> exec = make_object<VMExecutable>();
 
@@ -215,23 +234,67 @@ Module VMExecutable::LoadFromBinary(void* stream) {
   exec->LoadGlobalSection(&strm);
 
   // Constant section.
-  exec->LoadConstantSection(&strm);
+  exec->LoadConstantSection(&strm, size);
 
   // Code section.
   exec->LoadCodeSection(&strm);
 
+  if (exec->num_unloaded_constants_ != 0) {
+    exec->constant_storage_ = storage;
+    exec->constant_data_ = data;
+  }
   return Module(exec);
 }
 
+Module VMExecutable::LoadFromBinary(void* stream) {
+  std::string code;
+  static_cast<dmlc::Stream*>(stream)->Read(&code);
+  String storage(std::move(code));
+  return Load(storage, storage.data(), storage.size());
+}
+
 TVM_REGISTER_GLOBAL("runtime.module.loadbinary_relax.VMExecutable")
     .set_body_typed(VMExecutable::LoadFromBinary);
 
 Module VMExecutable::LoadFromFile(const String& file_name) {
-  std::string data;
-  runtime::LoadBinaryFromFile(file_name, &data);
-  dmlc::MemoryStringStream reader(&data);
-  dmlc::Stream* strm = &reader;
-  return VMExecutable::LoadFromBinary(reinterpret_cast<void*>(strm));
+  // The NDArray constants alias the mapped file, and are paged in on first use.
+  MappedFile file = MappedFile::Open(file_name);
+  return Load(file, file->data(), file->size());
+}
+
+TVMRetValue VMExecutable::GetConstant(Index index) {
+  auto it = lazy_constants_.find(index);
+  if (it == lazy_constants_.end()) {
+    return constants[index];
+  }
+  std::lock_guard<std::mutex> lock(constant_mutex_);
+  if (constants[index].type_code() == kTVMNullptr) {
+    constants[index] = LoadLazyConstant(it->second);
+    // The loaded constants keep the mapped file they alias, so the storage is released once it is
+    // no longer needed.
+    if (--num_unloaded_constants_ == 0) {
+      constant_storage_ = ObjectRef();
+      constant_data_ = nullptr;
+    }
+  }
+  return constants[index];
+}
+
+NDArray VMExecutable::LoadLazyConstant(const LazyConstant& constant) const {
+  const char* data = constant_data_ + constant.byte_offset;
+  Device cpu{kDLCPU, 0};
+  if (constant_storage_->IsInstance<MappedFileObj>() &&
+      reinterpret_cast<uintptr_t>(data) % kAllocAlignment == 0) {
+    // The mapping is copy-on-write, so the writes to the NDArray never reach the file.
+    NDArray::Container* container =
+        new NDArray::Container(const_cast<char*>(data), constant.shape, constant.dtype, cpu);
+    container->SetDeleter(MappedConstantDeleter);
+    container->manager_ctx = new ObjectRef(constant_storage_);
+    return NDArray(GetObjectPtr<Object>(container));
+  }
+  NDArray arr = NDArray::Empty(constant.shape, constant.dtype, cpu);
+  arr.CopyFromBytes(data, GetDataSize(*arr.operator->()));
+  return arr;
 }
 
 TVM_REGISTER_GLOBAL("runtime.module.loadfile_relax.VMExecutable")
@@ -263,12 +326,24 @@ bool VMFuncInfo::Load(dmlc::Stream* strm) {
 
 void VMExecutable::SaveGlobalSection(dmlc::Stream* strm) { strm->Write(func_table); }
 
-void VMExecutable::SaveConstantSection(dmlc::Stream* strm) {
+void VMExecutable::SaveConstantSection(dmlc::SeekStream* strm) {
+  // The data of the NDArrays follows the other constants, with each NDArray aligned in the
+  // serialized executable, so that the loader maps the NDArrays rather than copying them.
+  std::vector<NDArray> arrays;
+  uint64_t data_nbytes = 0;
   strm->Write(static_cast<uint64_t>(this->constants.size()));
-  for (const auto& it : this->constants) {
+  for (size_t i = 0; i < this->constants.size(); ++i) {
+    TVMRetValue it = this->GetConstant(i);
     if (it.IsObjectRef<runtime::NDArray>()) {
+      NDArray arr = it.operator NDArray();
+      ShapeTuple shape = arr.Shape();
+      data_nbytes = AlignConstantOffset(data_nbytes);
       strm->Write(ConstantType::kNDArray);
-      runtime::SaveDLTensor(strm, it.operator DLTensor*());
+      strm->Write(arr->dtype);
+      strm->Write(std::vector<int64_t>(shape.begin(), shape.end()));
+      strm->Write(data_nbytes);
+      data_nbytes += GetDataSize(*arr.operator->());
+      arrays.push_back(arr);
     } else if (it.IsObjectRef<ShapeTuple>()) {
       ShapeTuple shape = it.operator ShapeTuple();
       strm->Write(ConstantType::kShapeTuple);
@@ -299,6 +374,22 @@ void VMExecutable::SaveConstantSection(dmlc::Stream* strm) {
       }
     }
   }
+
+  // The data starts at an aligned offset even when there is no NDArray, as the loader expects.
+  static const char padding[kAllocAlignment] = {};
+  strm->Write(data_nbytes);
+  strm->Write(padding, AlignConstantOffset(strm->Tell()) - strm->Tell());
+  for (const NDArray& arr : arrays) {
+    strm->Write(padding, AlignConstantOffset(strm->Tell()) - strm->Tell());
+    size_t nbytes = GetDataSize(*arr.operator->());
+    if (arr->device.device_type == kDLCPU && arr.IsContiguous()) {
+      strm->Write(static_cast<const char*>(arr->data) + arr->byte_offset, nbytes);
+    } else {
+      std::string bytes(nbytes, '\0');
+      arr.CopyToBytes(bytes.data(), nbytes);
+      strm->Write(bytes.data(), nbytes);
+    }
+  }
 }
 
 void VMExecutable::SaveCodeSection(dmlc::Stream* strm) {
@@ -314,23 +405,26 @@ void VMExecutable::LoadGlobalSection(dmlc::Stream* strm) {
   }
 }
 
-void VMExecutable::LoadConstantSection(dmlc::Stream* strm) {
+void VMExecutable::LoadConstantSection(dmlc::SeekStream* strm, size_t stream_size) {
   uint64_t sz;
   // Load the number of constants.
   STREAM_CHECK(strm->Read(&sz, sizeof(sz)), "constant");
 
   size_t size = static_cast<size_t>(sz);
-  runtime::NDArray ndarray;
   DLDataType dtype;
   // Load each of the constants.
   for (size_t i = 0; i < size; i++) {
     int constant_type;
     STREAM_CHECK(strm->Read(&constant_type, sizeof(constant_type)), "constant");
     if (constant_type == ConstantType::kNDArray) {
-      ndarray.Load(strm);
-      TVMRetValue cell;
-      cell = ndarray;
-      this->constants.push_back(cell);
+      LazyConstant constant;
+      std::vector<int64_t> shape;
+      STREAM_CHECK(strm->Read(&constant.dtype), "constant");
+      STREAM_CHECK(strm->Read(&shape), "constant");
+      STREAM_CHECK(strm->Read(&constant.byte_offset), "constant");
+      constant.shape = ShapeTuple(shape);
+      lazy_constants_[i] = constant;
+      this->constants.push_back(TVMRetValue());
     } else if (constant_type == ConstantType::kShapeTuple) {
       uint64_t size;
       strm->Read(&size);
@@ -373,6 +467,24 @@ void VMExecutable::LoadConstantSection(dmlc::Stream* strm) {
                  << ArgTypeCode2Str(constant_type) << " when loading the VM constant pool.";
     }
   }
+
+  // Locate the data of the NDArrays, which is read on first use.
+  uint64_t data_nbytes;
+  STREAM_CHECK(strm->Read(&data_nbytes), "constant");
+  size_t data_begin = AlignConstantOffset(strm->Tell());
+  STREAM_CHECK(data_begin <= stream_size && data_nbytes <= stream_size - data_begin, "constant");
+  for (auto& [index, constant] : lazy_constants_) {
+    DLTensor tensor;
+    tensor.shape = const_cast<int64_t*>(constant.shape.data());
+    tensor.ndim = static_cast<int>(constant.shape.size());
+    tensor.dtype = constant.dtype;
+    STREAM_CHECK(constant.byte_offset <= data_nbytes &&
+                     GetDataSize(tensor) <= data_nbytes - constant.byte_offset,
+                 "constant");
+    constant.byte_offset += data_begin;
+  }
+  num_unloaded_constants_ = lazy_constants_.size();
+  strm->Seek(data_begin + data_nbytes);
 }
 
 void VMExecutable::LoadCodeSection(dmlc::Stream* strm) {
@@ -0,0 +1,144 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*! \file src/runtime/relax_vm/kv_offload.cc */
+
+#include "kv_offload.h"
+
+#include <tvm/runtime/logging.h>
+
+#include <cstdio>
+#include <utility>
+
+namespace tvm {
+namespace runtime {
+namespace relax_vm {
+
+KVPageOffloadStore::KVPageOffloadStore(std::vector<NDArray> pages, int64_t num_host_slots,
+                                       std::string file_path, TVMStreamHandle copy_stream)
+    : pages_(std::move(pages)),
+      copy_stream_(copy_stream),
+      num_host_slots_(num_host_slots),
+      file_path_(std::move(file_path)) {
+  ICHECK(!pages_.empty());
+  CHECK_GE(num_host_slots_, 0) << "ValueError: The number of host slots should be non-negative.";
+  device_ = pages_[0]->device;
+  int64_t slot_nbytes = 0;
+  for (const NDArray& data : pages_) {
+    page_nbytes_.push_back(GetDataSize(*data.operator->()) / data->shape[0]);
+    slot_nbytes += page_nbytes_.back();
+  }
+  Device host_device = GetPreferredHostDevice(device_);
+  if (num_host_slots_ > 0) {
+    host_pool_ = NDArray::Empty({num_host_slots_, slot_nbytes}, DataType::UInt(8), host_device);
+  }
+  staging_buffer_ = NDArray::Empty({slot_nbytes}, DataType::UInt(8), host_device);
+  for (int64_t slot = num_host_slots_ - 1; slot >= 0; --slot) {
+    free_host_slots_.push_back(slot);
+  }
+}
+
+KVPageOffloadStore::~KVPageOffloadStore() {
+  if (file_.is_open()) {
+    file_.close();
+    std::remove(file_path_.c_str());
+  }
+}
+
+int64_t KVPageOffloadStore::Store(int32_t page_id) {
+  int64_t slot_nbytes = staging_buffer_->shape[0];
+  if (!free_host_slots_.empty()) {
+    int64_t slot = free_host_slots_.back();
+    free_host_slots_.pop_back();
+    CopyPage(page_id, host_pool_, slot * slot_nbytes, /*to_host=*/true);
+    return slot;
+  }
+  CHECK(!file_path_.empty()) << "The host memory for offloading KV cache is full. Please "
+                                "enlarge it or offload KV cache to a file.";
+  int64_t slot;
+  if (!free_file_slots_.empty()) {
+    slot = free_file_slots_.back();
+    free_file_slots_.pop_back();
+  } else {
+    if (!file_.is_open()) {
+      file_.open(file_path_, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+      CHECK(file_.is_open()) << "Cannot open \"" << file_path_ << "\" to offload KV cache.";
+    }
+    slot = num_host_slots_ + num_file_slots_++;
+  }
+  CopyPage(page_id, staging_buffer_, 0, /*to_host=*/true);
+  DeviceAPI::Get(device_)->StreamSync(device_, copy_stream_);
+  file_.seekp((slot - num_host_slots_) * slot_nbytes);
+  file_.write(static_cast<const char*>(staging_buffer_->data), slot_nbytes);
+  CHECK(file_.good()) << "Failed to write the offloaded KV cache to \"" << file_path_ << "\".";
+  return slot;
+}
+
+void KVPageOffloadStore::Load(int64_t slot, int32_t page_id) {
+  int64_t slot_nbytes = staging_buffer_->shape[0];
+  if (slot < num_host_slots_) {
+    // The slot can be reused right away, since later copies to it are on the same stream.
+    CopyPage(page_id, host_pool_, slot * slot_nbytes, /*to_host=*/false);
+    Free(slot);
+    return;
+  }
+  file_.seekg((slot - num_host_slots_) * slot_nbytes);
+  file_.read(static_cast<char*>(staging_buffer_->data), slot_nbytes);
+  CHECK(file_.good()) << "Failed to read the offloaded KV cache from \"" << file_path_ << "\".";
+  CopyPage(page_id, staging_buffer_, 0, /*to_host=*/false);
+  DeviceAPI::Get(device_)->StreamSync(device_, copy_stream_);
+  Free(slot);
+}
+
+void KVPageOffloadStore::Free(int64_t slot) {
+  if (slot < num_host_slots_) {
+    free_host_slots_.push_back(slot);
+  } else {
+    free_file_slots_.push_back(slot);
+  }
+}
+
+void KVPageOffloadStore::CopyPage(int32_t page_id, const NDArray& host, int64_t host_offset,
+                                  bool to_host) {
+  for (size_t layer = 0; layer < pages_.size(); ++layer) {
+    int64_t shape[1] = {page_nbytes_[layer]};
+    // Flat byte views of the page on device and of its place in the host buffer.
+    DLTensor device_view = *pages_[layer].operator->();
+    device_view.ndim = 1;
+    device_view.shape = shape;
+    device_view.strides = nullptr;
+    device_view.dtype = DataType::UInt(8);
+    device_view.byte_offset += page_id * page_nbytes_[layer];
+    DLTensor host_view = *host.operator->();
+    host_view.ndim = 1;
+    host_view.shape = shape;
+    host_view.strides = nullptr;
+    host_view.byte_offset += host_offset;
+    if (to_host) {
+      NDArray::CopyFromTo(&device_view, &host_view, copy_stream_);
+    } else {
+      NDArray::CopyFromTo(&host_view, &device_view, copy_stream_);
+    }
+    host_offset += page_nbytes_[layer];
+  }
+}
+
+}  // namespace relax_vm
+}  // namespace runtime
+}  // namespace tvm
@@ -0,0 +1,110 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file src/runtime/relax_vm/kv_offload.h
+ * \brief The host memory and file store of KV cache pages swapped out of device.
+ */
+
+#ifndef TVM_RUNTIME_RELAX_VM_KV_OFFLOAD_H_
+#define TVM_RUNTIME_RELAX_VM_KV_OFFLOAD_H_
+
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/ndarray.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+namespace relax_vm {
+
+/*!
+ * \brief The store of KV cache pages swapped out of device, which holds each page of all
+ * layers in a slot. The slots are first taken from a pool in (pinned) host memory, and then
+ * from a file when the pool is exhausted.
+ *
+ * The copies between host memory and device are asynchronous on the given copy stream, so a
+ * page is safe to overwrite only after the compute stream waits for the copy stream. The
+ * copies from and to the file are synchronous.
+ */
+class KVPageOffloadStore {
+ public:
+  /*!
+   * \param pages The KV data of each layer, in layout `(num_pages, ...)`. It may also hold
+   * other per-page data such as the scales of quantized pages.
+   * \param num_host_slots The number of slots in host memory.
+   * \param file_path The path of the file to store the pages which do not fit in host memory,
+   * or empty to disallow it. The file is removed when the store is destructed.
+   * \param copy_stream The stream of the copies between host memory and device.
+   */
+  KVPageOffloadStore(std::vector<NDArray> pages, int64_t num_host_slots, std::string file_path,
+                     TVMStreamHandle copy_stream);
+  ~KVPageOffloadStore();
+
+  /*! \brief Copy a page from device to a new slot, and return the slot. */
+  int64_t Store(int32_t page_id);
+  /*! \brief Copy a slot to a page on device, and free the slot. */
+  void Load(int64_t slot, int32_t page_id);
+  /*! \brief Free a slot without loading it. */
+  void Free(int64_t slot);
+
+  /*! \brief The number of slots in use in host memory. */
+  int64_t GetNumHostSlotsInUse() const { return num_host_slots_ - free_host_slots_.size(); }
+  /*! \brief The number of slots in use in the file. */
+  int64_t GetNumFileSlotsInUse() const { return num_file_slots_ - free_file_slots_.size(); }
+
+ private:
+  /*! \brief Copy a page of all layers between device and a host buffer. */
+  void CopyPage(int32_t page_id, const NDArray& host, int64_t host_offset, bool to_host);
+
+  /*! \brief The KV data of each layer on device. */
+  std::vector<NDArray> pages_;
+  /*! \brief The number of bytes of a page in each of `pages_`. */
+  std::vector<int64_t> page_nbytes_;
+  /*! \brief The device of the KV data. */
+  Device device_;
+  /*! \brief The stream of the copies between host memory and device. */
+  TVMStreamHandle copy_stream_;
+
+  /*! \brief The host memory pool, in layout `(num_host_slots, slot_nbytes)`. */
+  NDArray host_pool_;
+  /*! \brief The number of slots in host memory. */
+  int64_t num_host_slots_;
+  /*! \brief The free slots in host memory. */
+  std::vector<int64_t> free_host_slots_;
+
+  /*! \brief The host buffer of a slot for the copies from and to the file. */
+  NDArray staging_buffer_;
+  /*! \brief The path of the file. */
+  std::string file_path_;
+  /*! \brief The file, opened when the host memory pool is first exhausted. */
+  std::fstream file_;
+  /*! \brief The number of slots ever allocated in the file. */
+  int64_t num_file_slots_ = 0;
+  /*! \brief The free slots in the file, numbered after the slots in host memory. */
+  std::vector<int64_t> free_file_slots_;
+};
+
+}  // namespace relax_vm
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_RELAX_VM_KV_OFFLOAD_H_
@@ -64,10 +64,24 @@ TVM_REGISTER_GLOBAL("vm.builtin.attention_kv_cache_enable_sliding_window_for_seq
     .set_body_method<AttentionKVCache>(&AttentionKVCacheObj::EnableSlidingWindowForSeq);
 TVM_REGISTER_GLOBAL("vm.builtin.attention_kv_cache_commit_accepted_token_tree_nodes")
     .set_body_method<AttentionKVCache>(&AttentionKVCacheObj::CommitAcceptedTokenTreeNodes);
+TVM_REGISTER_GLOBAL("vm.builtin.attention_kv_cache_add_sequence_with_prefix_cache")
+    .set_body_method<AttentionKVCache>(&AttentionKVCacheObj::AddSequenceWithPrefixCache);
+TVM_REGISTER_GLOBAL("vm.builtin.attention_kv_cache_commit_sequence_to_prefix_cache")
+    .set_body_method<AttentionKVCache>(&AttentionKVCacheObj::CommitSequenceToPrefixCache);
+TVM_REGISTER_GLOBAL("vm.builtin.attention_kv_cache_clear_prefix_cache")
+    .set_body_method<AttentionKVCache>(&AttentionKVCacheObj::ClearPrefixCache);
+TVM_REGISTER_GLOBAL("vm.builtin.attention_kv_cache_get_prefix_cache_stats")
+    .set_body_method<AttentionKVCache>(&AttentionKVCacheObj::GetPrefixCacheStats);
+TVM_REGISTER_GLOBAL("vm.builtin.attention_kv_cache_enable_offload")
+    .set_body_method<AttentionKVCache>(&AttentionKVCacheObj::EnableOffload);
+TVM_REGISTER_GLOBAL("vm.builtin.attention_kv_cache_offload_sequence")
+    .set_body_method<AttentionKVCache>(&AttentionKVCacheObj::OffloadSequence);
 TVM_REGISTER_GLOBAL("vm.builtin.attention_kv_cache_empty")
     .set_body_method<AttentionKVCache>(&AttentionKVCacheObj::Empty);
 TVM_REGISTER_GLOBAL("vm.builtin.attention_kv_cache_get_num_available_pages")
     .set_body_method<AttentionKVCache>(&AttentionKVCacheObj::GetNumAvailablePages);
+TVM_REGISTER_GLOBAL("vm.builtin.attention_kv_cache_get_page_nbytes")
+    .set_body_method<AttentionKVCache>(&AttentionKVCacheObj::GetPageNBytes);
 TVM_REGISTER_GLOBAL("vm.builtin.attention_kv_cache_get_total_sequence_length")
     .set_body_method<AttentionKVCache>(&AttentionKVCacheObj::GetTotalSequenceLength);
 TVM_REGISTER_GLOBAL("vm.builtin.attention_kv_cache_get_query_positions")
@@ -128,9 +128,23 @@ class AttentionKVCacheObj : public KVStateObj {
    * When the underlying KV cache implementation is not
    * paged KV cache, the function falls back to return the
    * number of remaining size (in terms of number of tokens).
+   * The pages of cached prefixes that can be evicted are counted as available.
    */
   virtual int32_t GetNumAvailablePages() const = 0;
 
+  /*!
+   * \brief Get the bytes of the memory that a page takes in all the layers, including the
+   * scales of quantized pages.
+   */
+  virtual int64_t GetPageNBytes() const = 0;
+
+  /*!
+   * \brief Get the statistics of the prefix cache, which are the number of
+   * queried tokens, the number of hit tokens, the number of cached pages
+   * and the number of evicted pages.
+   */
+  virtual IntTuple GetPrefixCacheStats() const = 0;
+
   /*! \brief Get the current total sequence length in the KV cache. */
   virtual int32_t GetTotalSequenceLength() const = 0;
 
@@ -157,6 +171,46 @@ class AttentionKVCacheObj : public KVStateObj {
   virtual void CommitAcceptedTokenTreeNodes(const IntTuple& seq_ids,
                                             const IntTuple& leaf_indices) = 0;
 
+  /*!
+   * \brief Add a new sequence to the KV cache, reusing the KV data of the
+   * longest prefix of its tokens cached in the prefix tree. The prefix is
+   * matched at page granularity, and its KV data is shared rather than copied.
+   * \param seq_id The id of the new sequence.
+   * \param token_ids The tokens of the new sequence.
+   * \return The length of the reused prefix, whose KV data needs no prefill.
+   */
+  virtual int64_t AddSequenceWithPrefixCache(int64_t seq_id, const IntTuple& token_ids) = 0;
+
+  /*!
+   * \brief Insert the KV data of a sequence into the prefix tree, so that later
+   * sequences with the same prefix can reuse it. The full pages of the sequence
+   * are cached. They stay cached after the sequence is removed, until they are
+   * evicted in LRU order when the KV cache runs out of pages.
+   * \param seq_id The id of the sequence to commit.
+   * \param token_ids The tokens of the sequence, which can be longer than the
+   * sequence length in the KV cache.
+   */
+  virtual void CommitSequenceToPrefixCache(int64_t seq_id, const IntTuple& token_ids) = 0;
+
+  /*! \brief Evict all the cached prefixes that are not used by any sequence. */
+  virtual void ClearPrefixCache() = 0;
+
+  /*!
+   * \brief Enable offloading the KV data of sequences out of device.
+   * \param num_host_pages The number of pages that can be offloaded to host memory.
+   * \param file_path The path of the file to offload the pages to when the host
+   * memory is full, or empty to disallow it.
+   */
+  virtual void EnableOffload(int64_t num_host_pages, const String& file_path) = 0;
+
+  /*!
+   * \brief Offload the KV data of the given sequence out of device, so that its
+   * pages can be used by other sequences. The pages shared with other sequences
+   * stay on device. The KV data is reloaded when the sequence is next forwarded.
+   * \param seq_id The id of the sequence to offload.
+   */
+  virtual void OffloadSequence(int64_t seq_id) = 0;
+
   /*! \brief Prepare for the disaggregation KV data receive for the specified sequence and length.*/
   virtual IntTuple DisaggPrepareRecv(int64_t seq_id, int length) = 0;
 
@@ -42,8 +42,14 @@
 #include <tvm/runtime/memory/memory_manager.h>
 #include <tvm/runtime/ndarray.h>
 #include <tvm/runtime/relax_vm/vm.h>
+#include <tvm/runtime/threading_backend.h>
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <vector>
 
 namespace tvm {
 namespace runtime {
@@ -617,6 +623,356 @@ void ApplySoftmaxWithTemperature(NDArray logits, double temperature) {
 TVM_REGISTER_GLOBAL("vm.builtin.apply_softmax_with_temperature")
     .set_body_typed(ApplySoftmaxWithTemperature);
 
+//-------------------------------------------
+// Batched sampling
+//-------------------------------------------
+namespace {
+
+/*! \brief The number of lanes the reductions over the vocabulary are split into, to vectorize. */
+constexpr int kSampleLanes = 16;
+
+/*!
+ * \brief exp(x) for x <= 0, as a polynomial the compiler can vectorize, unlike std::exp.
+ * Its relative error is about 1e-7, and it flushes to zero below exp(-87).
+ */
+inline float ExpNonPositive(float x) {
+  x = std::max(x, -87.0f);
+  // exp(x) = 2^n * exp(r), with |r| <= ln(2) / 2.
+  float t = x * 1.44269504f;
+  int32_t n = static_cast<int32_t>(t - 0.5f);
+  float fn = static_cast<float>(n);
+  float r = x - fn * 0.693359375f + fn * 2.12194440e-4f;
+  float p = 1.9875691500e-4f;
+  p = p * r + 1.3981999507e-3f;
+  p = p * r + 8.3334519073e-3f;
+  p = p * r + 4.1665795894e-2f;
+  p = p * r + 1.6666665459e-1f;
+  p = p * r + 5.0000001201e-1f;
+  p = p * r * r + r + 1.0f;
+  uint32_t bits = static_cast<uint32_t>(n + 127) << 23;
+  float scale;
+  std::memcpy(&scale, &bits, sizeof(scale));
+  return p * scale;
+}
+
+/*! \brief The max of the logits, ignoring NaNs. */
+float ReduceMax(const float* logits, int64_t n) {
+  float acc[kSampleLanes];
+  std::fill(acc, acc + kSampleLanes, -std::numeric_limits<float>::infinity());
+  int64_t i = 0;
+  for (; i + kSampleLanes <= n; i += kSampleLanes) {
+    for (int j = 0; j < kSampleLanes; ++j) {
+      acc[j] = acc[j] < logits[i + j] ? logits[i + j] : acc[j];
+    }
+  }
+  for (; i < n; ++i) {
+    acc[0] = acc[0] < logits[i] ? logits[i] : acc[0];
+  }
+  return *std::max_element(acc, acc + kSampleLanes);
+}
+
+/*! \brief The sum of exp((logits[i] - max_logit) * inv_temperature) over logits >= threshold. */
+float ReduceSumExp(const float* logits, int64_t n, float max_logit, float inv_temperature,
+                   float threshold) {
+  float acc[kSampleLanes] = {0.0f};
+  int64_t i = 0;
+  for (; i + kSampleLanes <= n; i += kSampleLanes) {
+    for (int j = 0; j < kSampleLanes; ++j) {
+      float e = ExpNonPositive((logits[i + j] - max_logit) * inv_temperature);
+      acc[j] += logits[i + j] >= threshold ? e : 0.0f;
+    }
+  }
+  for (; i < n; ++i) {
+    acc[0] += logits[i] >= threshold ? ExpNonPositive((logits[i] - max_logit) * inv_temperature)
+                                     : 0.0f;
+  }
+  float sum = 0.0f;
+  for (int j = 0; j < kSampleLanes; ++j) {
+    sum += acc[j];
+  }
+  return sum;
+}
+
+/*! \brief Map a float to an unsigned integer of the same order. */
+inline uint32_t OrderedBits(float x) {
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+
+/*!
+ * \brief The logits are bucketed by the top bits of OrderedBits for the radix selects, so that
+ * the buckets are ordered like the logits.
+ */
+constexpr int kRadixBits = 11;
+
+inline uint32_t RadixBucket(float x) { return OrderedBits(x) >> (32 - kRadixBits); }
+
+/*! \brief The scratch space of sampling, reused by each thread across calls. */
+struct SampleWorkspace {
+  /*! \brief The logits and token ids of the candidates. */
+  std::vector<std::pair<float, int32_t>> candidates;
+  /*! \brief The number of logits in each radix bucket. */
+  std::vector<int64_t> counts;
+  /*! \brief The unnormalized probability mass of each radix bucket. */
+  std::vector<float> masses;
+
+  static SampleWorkspace* ThreadLocal() {
+    static thread_local SampleWorkspace workspace;
+    return &workspace;
+  }
+};
+
+inline bool GreaterLogit(const std::pair<float, int32_t>& lhs,
+                         const std::pair<float, int32_t>& rhs) {
+  return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+}
+
+/*!
+ * \brief Sample from the candidates, which hold the unnormalized probabilities, by inverse
+ * transform sampling in the order of the vocabulary.
+ */
+int64_t SampleFromCandidates(std::vector<std::pair<float, int32_t>>* candidates,
+                             float uniform_sample) {
+  std::sort(candidates->begin(), candidates->end(),
+            [](const std::pair<float, int32_t>& lhs, const std::pair<float, int32_t>& rhs) {
+              return lhs.second < rhs.second;
+            });
+  float sum = 0.0f;
+  for (const auto& candidate : *candidates) {
+    sum += candidate.first;
+  }
+  float target = uniform_sample * sum;
+  float cum_sum = 0.0f;
+  for (const auto& candidate : *candidates) {
+    cum_sum += candidate.first;
+    if (target < cum_sum) return candidate.second;
+  }
+  return candidates->back().second;
+}
+
+/*!
+ * \brief Sample with top-k, and possibly min-p and top-p. The radix select on the counts of the
+ * buckets leaves only a few more candidates than k to select from.
+ */
+int64_t SampleTopK(const float* logits, int64_t vocab_size, float max_logit, float inv_temperature,
+                   float threshold, float top_p, int64_t top_k, float uniform_sample,
+                   SampleWorkspace* workspace) {
+  std::vector<int64_t>& counts = workspace->counts;
+  counts.assign(1 << kRadixBits, 0);
+  for (int64_t i = 0; i < vocab_size; ++i) {
+    ++counts[RadixBucket(logits[i])];
+  }
+  int64_t count = 0;
+  uint32_t bucket = counts.size();
+  while (bucket > 0 && count < top_k) {
+    count += counts[--bucket];
+  }
+  std::vector<std::pair<float, int32_t>>& candidates = workspace->candidates;
+  candidates.clear();
+  for (int64_t i = 0; i < vocab_size; ++i) {
+    if (logits[i] >= threshold && RadixBucket(logits[i]) >= bucket) {
+      candidates.emplace_back(logits[i], static_cast<int32_t>(i));
+    }
+  }
+  if (static_cast<int64_t>(candidates.size()) > top_k) {
+    std::nth_element(candidates.begin(), candidates.begin() + top_k, candidates.end(),
+                     GreaterLogit);
+    candidates.resize(top_k);
+  }
+  if (top_p < 1.0f) {
+    std::sort(candidates.begin(), candidates.end(), GreaterLogit);
+  }
+  // The logits become the unnormalized probabilities from here.
+  float sum = 0.0f;
+  for (auto& candidate : candidates) {
+    candidate.first = ExpNonPositive((candidate.first - max_logit) * inv_temperature);
+    sum += candidate.first;
+  }
+  if (top_p < 1.0f) {
+    float cum_sum = 0.0f;
+    size_t num_kept = 0;
+    while (num_kept < candidates.size() && cum_sum < top_p * sum) {
+      cum_sum += candidates[num_kept++].first;
+    }
+    candidates.resize(std::max<size_t>(num_kept, 1));
+  }
+  return SampleFromCandidates(&candidates, uniform_sample);
+}
+
+/*!
+ * \brief The smallest logit that top-p keeps among the logits >= threshold, found by a radix
+ * select on the probability mass of the buckets, which sorts a single bucket rather than the
+ * vocabulary.
+ * \param kept_sum The unnormalized probability mass that top-p keeps.
+ */
+float TopPThreshold(const float* logits, int64_t vocab_size, float max_logit,
+                    float inv_temperature, float threshold, float top_p,
+                    SampleWorkspace* workspace, float* kept_sum) {
+  std::vector<float>& masses = workspace->masses;
+  masses.assign(1 << kRadixBits, 0.0f);
+  int64_t i = 0;
+  float e[kSampleLanes];
+  for (; i + kSampleLanes <= vocab_size; i += kSampleLanes) {
+    for (int j = 0; j < kSampleLanes; ++j) {
+      e[j] = ExpNonPositive((logits[i + j] - max_logit) * inv_temperature);
+    }
+    for (int j = 0; j < kSampleLanes; ++j) {
+      if (logits[i + j] >= threshold) masses[RadixBucket(logits[i + j])] += e[j];
+    }
+  }
+  for (; i < vocab_size; ++i) {
+    if (logits[i] >= threshold) {
+      masses[RadixBucket(logits[i])] += ExpNonPositive((logits[i] - max_logit) * inv_temperature);
+    }
+  }
+  float total_sum = 0.0f;
+  for (float mass : masses) {
+    total_sum += mass;
+  }
+  float top_p_sum = top_p * total_sum;
+  // Find the bucket where the cumulative mass from the top reaches top_p.
+  float cum_sum = 0.0f;
+  uint32_t bucket = masses.size();
+  while (bucket > 0 && cum_sum + masses[bucket - 1] < top_p_sum) {
+    cum_sum += masses[--bucket];
+  }
+  if (bucket == 0) {
+    *kept_sum = cum_sum;
+    return threshold;
+  }
+  --bucket;
+  // Within the bucket, keep the largest logits until the mass reaches top_p.
+  std::vector<std::pair<float, int32_t>>& candidates = workspace->candidates;
+  candidates.clear();
+  for (i = 0; i < vocab_size; ++i) {
+    if (logits[i] >= threshold && RadixBucket(logits[i]) == bucket) {
+      candidates.emplace_back(logits[i], static_cast<int32_t>(i));
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(), GreaterLogit);
+  float cutoff = threshold;
+  for (const auto& candidate : candidates) {
+    if (cum_sum >= top_p_sum) break;
+    cum_sum += ExpNonPositive((candidate.first - max_logit) * inv_temperature);
+    cutoff = candidate.first;
+  }
+  *kept_sum = cum_sum;
+  return std::max(cutoff, threshold);
+}
+
+/*!
+ * \brief Sample a token from the logits of one sequence, by inverse transform sampling over the
+ * tokens that the filters keep, in the order of the vocabulary.
+ */
+int64_t SampleFromLogitsRow(const float* logits, int64_t vocab_size, float temperature,
+                            float top_p, int64_t top_k, float min_p, float uniform_sample) {
+  float max_logit = ReduceMax(logits, vocab_size);
+  CHECK(max_logit > -std::numeric_limits<float>::infinity())
+      << "The logits are all NaNs or -inf, can not sample from them";
+  if (temperature < 1e-6f || top_k == 1 || top_p <= 0.0f) {
+    return std::find(logits, logits + vocab_size, max_logit) - logits;
+  }
+  float inv_temperature = 1.0f / temperature;
+  SampleWorkspace* workspace = SampleWorkspace::ThreadLocal();
+  // The lowest finite threshold drops the -inf logits, which mask the tokens out.
+  float threshold = std::numeric_limits<float>::lowest();
+  if (min_p > 0.0f) {
+    // p / p_max >= min_p
+    threshold = std::max(threshold, max_logit + std::log(min_p) * temperature);
+  }
+  if (top_k > 0 && top_k < vocab_size) {
+    return SampleTopK(logits, vocab_size, max_logit, inv_temperature, threshold, top_p, top_k,
+                      uniform_sample, workspace);
+  }
+  // Otherwise the filters keep the logits above a threshold.
+  float sum;
+  if (top_p < 1.0f) {
+    threshold = TopPThreshold(logits, vocab_size, max_logit, inv_temperature, threshold, top_p,
+                              workspace, &sum);
+  } else {
+    sum = ReduceSumExp(logits, vocab_size, max_logit, inv_temperature, threshold);
+  }
+  float target = uniform_sample * sum;
+  float cum_sum = 0.0f;
+  // The sum is reduced in a different order than the scan, so the scan may fall short of the
+  // target by rounding, in which case the last kept token, which has mass, is sampled.
+  int64_t last_kept = std::find(logits, logits + vocab_size, max_logit) - logits;
+  for (int64_t i = 0; i < vocab_size; ++i) {
+    if (logits[i] >= threshold) {
+      cum_sum += ExpNonPositive((logits[i] - max_logit) * inv_temperature);
+      last_kept = i;
+      if (target < cum_sum) return i;
+    }
+  }
+  return last_kept;
+}
+
+}  // namespace
+
+/*!
+ * \brief Sample a token for each sequence of a batch from its logits, with temperature, top-k,
+ * top-p and min-p filters. This is the batched and faster counterpart of
+ * SampleTopPFromLogits, which parallelizes across the batch and avoids sorting the vocabulary.
+ * \param logits The logits, of shape (batch_size, vocab_size).
+ * \param temperatures The temperature of each sequence, of shape (batch_size,). A temperature
+ * of 0 samples the argmax.
+ * \param top_p The top-p of each sequence, which keeps the most probable tokens whose probability
+ * sums to top_p. 1 keeps all tokens.
+ * \param top_k The int32 top-k of each sequence, which keeps the k most probable tokens. 0 keeps
+ * all tokens.
+ * \param min_p The min-p of each sequence, which keeps the tokens whose probability is at least
+ * min_p times that of the most probable one. 0 keeps all tokens.
+ * \param uniform_samples The uniform random number in [0, 1) of each sequence.
+ * \return The sampled token ids, of shape (batch_size, 1) and of int64.
+ * \note Top-k and min-p apply to the probabilities after temperature, and top-p to the tokens
+ * they keep.
+ */
+NDArray BatchSampleFromLogits(NDArray logits, NDArray temperatures, NDArray top_p, NDArray top_k,
+                              NDArray min_p, NDArray uniform_samples) {
+  ICHECK(logits.IsContiguous());
+  ICHECK(logits.DataType() == DataType::Float(32)) << "Logits data type is not float32!";
+  ICHECK_EQ(logits->ndim, 2) << "The logits should be of shape (batch_size, vocab_size)";
+  if (logits->device.device_type != kDLCPU) {
+    logits = logits.CopyTo(DLDevice{kDLCPU, 0});
+  }
+  int64_t batch_size = logits->shape[0];
+  int64_t vocab_size = logits->shape[1];
+  auto check_param = [batch_size](const NDArray& param, DataType dtype, const char* name) {
+    ICHECK(param.IsContiguous());
+    ICHECK(param->device.device_type == kDLCPU) << name << " device must be CPU!";
+    ICHECK(param.DataType() == dtype) << name << " data type is not " << dtype << "!";
+    ICHECK_EQ(param.Shape()->Product(), batch_size)
+        << name << " should have an element for each sequence";
+  };
+  check_param(temperatures, DataType::Float(32), "temperatures");
+  check_param(top_p, DataType::Float(32), "top_p");
+  check_param(top_k, DataType::Int(32), "top_k");
+  check_param(min_p, DataType::Float(32), "min_p");
+  check_param(uniform_samples, DataType::Float(32), "uniform_samples");
+
+  const float* plogits = static_cast<const float*>(logits->data);
+  const float* ptemperatures = static_cast<const float*>(temperatures->data);
+  const float* ptop_p = static_cast<const float*>(top_p->data);
+  const int32_t* ptop_k = static_cast<const int32_t*>(top_k->data);
+  const float* pmin_p = static_cast<const float*>(min_p->data);
+  const float* psamples = static_cast<const float*>(uniform_samples->data);
+  NDArray result = NDArray::Empty({batch_size, 1}, DataType::Int(64), DLDevice{kDLCPU, 0});
+  int64_t* presult = static_cast<int64_t*>(result->data);
+  auto sample_row = [&](int64_t i) {
+    presult[i] = SampleFromLogitsRow(plogits + i * vocab_size, vocab_size, ptemperatures[i],
+                                     ptop_p[i], ptop_k[i], pmin_p[i], psamples[i]);
+  };
+  if (batch_size > 1) {
+    parallel_for_with_threading_backend(sample_row, 0, batch_size);
+  } else if (batch_size == 1) {
+    sample_row(0);
+  }
+  return result;
+}
+
+TVM_REGISTER_GLOBAL("vm.builtin.batch_sample_from_logits").set_body_typed(BatchSampleFromLogits);
+
 }  // namespace relax_vm
 }  // namespace runtime
 }  // namespace tvm
@@ -39,11 +39,22 @@
 #define __STDC_FORMAT_MACROS
 #endif
 #include <picojson.h>
+#include <tvm/runtime/device_api.h>
 #include <tvm/runtime/ndarray.h>
 #include <tvm/runtime/registry.h>
 #include <tvm/runtime/relax_vm/ndarray_cache_support.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "../../support/utils.h"
@@ -167,19 +178,68 @@ void CopyNDArrayFromBytes(NDArray param, const void* data, size_t nbytes,
 
 NDArray NDArrayCacheMetadata::FileRecord::ParamRecord::Load(
     Device device, const std::string* raw_data, Optional<NDArray>* staging_buffer) const {
-  NDArray arr = NDArray::Empty(shape, dtype, device);
-  if (dtype == DataType::Float(32) && format == "f32-to-bf16") {
+  return Load(device, raw_data->data(), staging_buffer);
+}
+
+/*!
+ * \brief Get the host bytes of a parameter, decoding its format if needed.
+ * \param param The parameter.
+ * \param raw_data The start of the raw data of the shard.
+ * \param decoded The buffer holding the decoded bytes.
+ * \return The pointer to the bytes and the number of bytes.
+ */
+std::pair<const void*, size_t> GetParamHostBytes(
+    const NDArrayCacheMetadata::FileRecord::ParamRecord& param, const char* raw_data,
+    std::vector<uint32_t>* decoded) {
+  if (param.dtype == DataType::Float(32) && param.format == "f32-to-bf16") {
     // decode bf16 to f32
-    std::vector<uint16_t> buffer(nbytes / 2);
-    std::vector<uint32_t> decoded(nbytes / 2);
-    std::memcpy(buffer.data(), raw_data->data() + byte_offset, nbytes);
+    std::vector<uint16_t> buffer(param.nbytes / 2);
+    decoded->resize(param.nbytes / 2);
+    std::memcpy(buffer.data(), raw_data + param.byte_offset, param.nbytes);
     for (size_t i = 0; i < buffer.size(); ++i) {
-      decoded[i] = static_cast<uint32_t>(buffer[i]) << 16;
+      (*decoded)[i] = static_cast<uint32_t>(buffer[i]) << 16;
     }
-    CopyNDArrayFromBytes(arr, decoded.data(), decoded.size() * sizeof(uint32_t), staging_buffer);
-  } else {
-    CopyNDArrayFromBytes(arr, raw_data->data() + byte_offset, nbytes, staging_buffer);
+    return {decoded->data(), decoded->size() * sizeof(uint32_t)};
   }
+  return {raw_data + param.byte_offset, param.nbytes};
+}
+
+NDArray NDArrayCacheMetadata::FileRecord::ParamRecord::Load(
+    Device device, const char* raw_data, Optional<NDArray>* staging_buffer) const {
+  NDArray arr = NDArray::Empty(shape, dtype, device);
+  std::vector<uint32_t> decoded;
+  auto [data, size] = GetParamHostBytes(*this, raw_data, &decoded);
+  CopyNDArrayFromBytes(arr, data, size, staging_buffer);
+  return arr;
+}
+
+/*! \brief The deleter of the NDArrays aliasing a mapped file, which keep the file mapped. */
+static void MappedNDArrayDeleter(Object* obj) {
+  auto* ptr = static_cast<NDArray::Container*>(obj);
+  delete static_cast<MappedFile*>(ptr->manager_ctx);
+  delete ptr;
+}
+
+/*!
+ * \brief Create a CPU NDArray aliasing the raw data of a parameter in a mapped shard, or return
+ * NullOpt if the parameter cannot alias the shard.
+ */
+Optional<NDArray> AliasMappedParam(const NDArrayCacheMetadata::FileRecord::ParamRecord& param,
+                                   const MappedFile& file, Device device) {
+  if (param.dtype == DataType::Float(32) && param.format == "f32-to-bf16") {
+    return NullOpt;
+  }
+  char* data = file->data() + param.byte_offset;
+  if (reinterpret_cast<uintptr_t>(data) % kAllocAlignment != 0) {
+    return NullOpt;
+  }
+  NDArray::Container* container =
+      new NDArray::Container(data, param.shape, param.dtype, device);
+  container->SetDeleter(MappedNDArrayDeleter);
+  container->manager_ctx = new MappedFile(file);
+  NDArray arr(GetObjectPtr<Object>(container));
+  CHECK_EQ(GetDataSize(*arr.operator->()), param.nbytes)
+      << "ValueError: The size of parameter " << param.name << " does not match its shape";
   return arr;
 }
 
@@ -201,6 +261,245 @@ TVM_DLL Array<NDArray> NDArrayCacheMetadata::FileRecord::Load(
   return result;
 }
 
+TVM_DLL Array<NDArray> NDArrayCacheMetadata::FileRecord::LoadMapped(
+    Device device,
+    const std::string& path_prefix,  //
+    Optional<NDArray>* staging_buffer) const {
+  CHECK_EQ(this->format, "raw-shard") << "ValueError: Only `raw-shard` format is supported";
+  MappedFile file = MappedFile::Open(path_prefix + "/" + this->data_path);
+  CHECK_EQ(this->nbytes, file->size())
+      << "ValueError: Encountered an corrupted parameter shard. It means it is not downloaded "
+         "completely or downloading is interrupted. Please try to download again.";
+  bool alias = device.device_type == kDLCPU;
+  // CPU parameters are paged in on first touch, so prefetch the whole shard in the background.
+  // Other devices read the shard once from the start to the end.
+  file->Advise(0, file->size(),
+               alias ? MappedFileObj::Advice::kWillNeed : MappedFileObj::Advice::kSequential);
+  Array<NDArray> result;
+  result.reserve(this->records.size());
+  for (const ParamRecord& nd_rec : this->records) {
+    Optional<NDArray> arr = alias ? AliasMappedParam(nd_rec, file, device) : NullOpt;
+    result.push_back(arr.defined() ? arr.value()
+                                   : nd_rec.Load(device, file->data(), staging_buffer));
+  }
+  return result;
+}
+
+/*!
+ * \brief Load the shards of an NDArray cache in a pipeline. Worker threads read or map the
+ * shards ahead of the calling thread, and decode the parameters. On CPU the workers also create
+ * the parameters. On the other devices the calling thread copies the parameters to the device
+ * in the order of the shards, overlapping with the reading of the next shards.
+ */
+class ShardLoadPipeline {
+ public:
+  ShardLoadPipeline(const NDArrayCacheMetadata& metadata, const std::string& cache_path,
+                    Device device, bool use_mmap, int num_threads)
+      : metadata_(metadata),
+        cache_path_(cache_path),
+        device_(device),
+        use_mmap_(use_mmap),
+        num_threads_(num_threads),
+        shards_(metadata.records.size()) {}
+
+  /*!
+   * \brief Load the shards.
+   * \param on_shard Called on the calling thread with the index and the parameters of each
+   * shard, in the order of the shards.
+   * \param progress The optional progress callback, called on the calling thread after each
+   * shard with the number of loaded shards, the number of shards, the loaded bytes, the total
+   * bytes and the elapsed seconds.
+   */
+  void Run(const std::function<void(int, const Array<NDArray>&)>& on_shard,
+           Optional<PackedFunc> progress) {
+    int num_shards = static_cast<int>(shards_.size());
+    int64_t total_bytes = 0;
+    for (const NDArrayCacheMetadata::FileRecord& shard_rec : metadata_.records) {
+      total_bytes += shard_rec.nbytes;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    // Stop and join the workers on all the exits, including the errors.
+    std::shared_ptr<void> join_workers(nullptr, [this, &workers](void*) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        aborted_ = true;
+      }
+      cv_.notify_all();
+      for (std::thread& worker : workers) {
+        worker.join();
+      }
+    });
+    for (int i = 0; i < std::min(num_threads_, num_shards); ++i) {
+      workers.emplace_back([this]() { this->RunWorker(); });
+    }
+    Optional<NDArray> staging_buffer;
+    int64_t loaded_bytes = 0;
+    for (int i = 0; i < num_shards; ++i) {
+      const NDArrayCacheMetadata::FileRecord& shard_rec = metadata_.records[i];
+      Shard shard;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this, i]() { return shards_[i].ready; });
+        shard = std::move(shards_[i]);
+      }
+      Array<NDArray> params;
+      try {
+        if (shard.error != nullptr) {
+          std::rethrow_exception(shard.error);
+        }
+        params = FinishShard(shard_rec, &shard, &staging_buffer);
+      } catch (const dmlc::Error& e) {
+        LOG(FATAL) << "ValueError: Error when loading parameters from " << shard_rec.data_path
+                   << ": " << e.what();
+      }
+      // Release the shard before the workers read more shards.
+      shard = Shard();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        num_finished_ = i + 1;
+      }
+      cv_.notify_all();
+      on_shard(i, params);
+      loaded_bytes += shard_rec.nbytes;
+      if (progress.defined()) {
+        double elapsed =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        progress.value()(i + 1, num_shards, loaded_bytes, total_bytes, elapsed);
+      }
+    }
+  }
+
+ private:
+  /*! \brief A shard prepared by a worker. */
+  struct Shard {
+    /*! \brief The mapped file, if mapped. */
+    MappedFile file;
+    /*! \brief The content of the file, if read. */
+    std::string buffer;
+    /*! \brief The parameters, if created by the worker. */
+    Array<NDArray> params;
+    /*! \brief The host bytes of each parameter, to be copied to the device. */
+    std::vector<std::pair<const void*, size_t>> host_bytes;
+    /*! \brief The decoded parameters referred to by host_bytes. */
+    std::vector<std::vector<uint32_t>> decoded;
+    /*! \brief The error during the preparation. */
+    std::exception_ptr error{nullptr};
+    /*! \brief Whether the shard is prepared. */
+    bool ready{false};
+  };
+
+  /*! \brief The main loop of a worker. */
+  void RunWorker() {
+    while (true) {
+      int index;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        // Bound the shards held in memory to one ahead of each worker.
+        cv_.wait(lock, [this]() {
+          return aborted_ || next_ >= static_cast<int>(shards_.size()) ||
+                 next_ <= num_finished_ + num_threads_;
+        });
+        if (aborted_ || next_ >= static_cast<int>(shards_.size())) return;
+        index = next_++;
+      }
+      Shard shard;
+      try {
+        PrepareShard(metadata_.records[index], &shard);
+      } catch (...) {
+        shard = Shard();
+        shard.error = std::current_exception();
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shards_[index] = std::move(shard);
+        shards_[index].ready = true;
+      }
+      cv_.notify_all();
+    }
+  }
+
+  /*! \brief Read or map a shard and decode its parameters, on a worker. */
+  void PrepareShard(const NDArrayCacheMetadata::FileRecord& shard_rec, Shard* shard) const {
+    CHECK_EQ(shard_rec.format, "raw-shard") << "ValueError: Only `raw-shard` format is supported";
+    std::string file_name = cache_path_ + "/" + shard_rec.data_path;
+    bool on_cpu = device_.device_type == kDLCPU;
+    if (use_mmap_) {
+      if (on_cpu) {
+        shard->params = shard_rec.LoadMapped(device_, cache_path_);
+        return;
+      }
+      shard->file = MappedFile::Open(file_name);
+      const MappedFileObj* file = shard->file.operator->();
+      file->Advise(0, file->size(), MappedFileObj::Advice::kSequential);
+      // Fault the pages in on the worker, so that the calling thread copies from memory.
+      static const size_t kPageSize = 4096;
+      volatile char sink = 0;
+      for (size_t offset = 0; offset < file->size(); offset += kPageSize) {
+        sink += file->data()[offset];
+      }
+      (void)sink;
+    } else {
+      LoadBinaryFromFile(file_name, &shard->buffer);
+    }
+    const char* raw_data = use_mmap_ ? shard->file->data() : shard->buffer.data();
+    size_t size = use_mmap_ ? shard->file->size() : shard->buffer.size();
+    CHECK_EQ(shard_rec.nbytes, size)
+        << "ValueError: Encountered an corrupted parameter shard. It means it is not downloaded "
+           "completely or downloading is interrupted. Please try to download again.";
+    if (on_cpu) {
+      Array<NDArray> params;
+      params.reserve(shard_rec.records.size());
+      for (const NDArrayCacheMetadata::FileRecord::ParamRecord& nd_rec : shard_rec.records) {
+        params.push_back(nd_rec.Load(device_, raw_data));
+      }
+      shard->params = std::move(params);
+      shard->buffer = std::string();
+      return;
+    }
+    shard->decoded.resize(shard_rec.records.size());
+    shard->host_bytes.reserve(shard_rec.records.size());
+    for (size_t i = 0; i < shard_rec.records.size(); ++i) {
+      shard->host_bytes.push_back(
+          GetParamHostBytes(shard_rec.records[i], raw_data, &shard->decoded[i]));
+    }
+  }
+
+  /*! \brief Copy the parameters of a prepared shard to the device, on the calling thread. */
+  Array<NDArray> FinishShard(const NDArrayCacheMetadata::FileRecord& shard_rec, Shard* shard,
+                             Optional<NDArray>* staging_buffer) const {
+    if (shard->host_bytes.empty()) {
+      return shard->params;
+    }
+    Array<NDArray> params;
+    params.reserve(shard_rec.records.size());
+    for (size_t i = 0; i < shard_rec.records.size(); ++i) {
+      const NDArrayCacheMetadata::FileRecord::ParamRecord& nd_rec = shard_rec.records[i];
+      NDArray arr = NDArray::Empty(nd_rec.shape, nd_rec.dtype, device_);
+      CopyNDArrayFromBytes(arr, shard->host_bytes[i].first, shard->host_bytes[i].second,
+                           staging_buffer);
+      params.push_back(arr);
+    }
+    return params;
+  }
+
+  const NDArrayCacheMetadata& metadata_;
+  std::string cache_path_;
+  Device device_;
+  bool use_mmap_;
+  int num_threads_;
+  /*! \brief The prepared shards, protected by mutex_. */
+  std::vector<Shard> shards_;
+  /*! \brief The next shard to prepare. */
+  int next_{0};
+  /*! \brief The number of shards finished by the calling thread. */
+  int num_finished_{0};
+  /*! \brief Whether the workers should stop. */
+  bool aborted_{false};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
 /*!
  * A NDArray cache to store pre-loaded arrays in the system.
  */
@@ -241,25 +540,29 @@ class NDArrayCache {
    * \param cache_path The cache to path.
    * \param device_type The type of device to be loaded.
    * \param device_id The device id.
+   * \param use_mmap Whether to map the shards into memory rather than reading them, see
+   * NDArrayCacheMetadata::FileRecord::LoadMapped.
+   * \param num_threads The number of threads reading the shards ahead, 0 for the default.
+   * \param progress The optional callback on the progress, see ShardLoadPipeline::Run.
    */
-  static void Load(const std::string& cache_path, int device_type, int device_id) {
+  static void Load(const std::string& cache_path, int device_type, int device_id,
+                   bool use_mmap = true, int num_threads = 0,
+                   Optional<PackedFunc> progress = NullOpt) {
     DLDevice device{static_cast<DLDeviceType>(device_type), device_id};
     NDArrayCacheMetadata metadata = NDArrayCacheMetadata::Load(cache_path);
-    Optional<NDArray> staging_buffer;
-    std::string raw_data;
-    Array<NDArray> params;
-    for (const NDArrayCacheMetadata::FileRecord& shard_rec : metadata.records) {
-      try {
-        params = shard_rec.Load(device, cache_path, &raw_data, &staging_buffer);
-      } catch (const dmlc::Error& e) {
-        LOG(FATAL) << "ValueError: Error when loading parameters from " << shard_rec.data_path
-                   << ": " << e.what();
-      }
-      int num_params = params.size();
-      for (int i = 0; i < num_params; ++i) {
-        Update(shard_rec.records[i].name, params[i], true);
-      }
+    if (num_threads <= 0) {
+      num_threads = std::max(1, std::min(4, static_cast<int>(std::thread::hardware_concurrency())));
     }
+    ShardLoadPipeline pipeline(metadata, cache_path, device, use_mmap, num_threads);
+    pipeline.Run(
+        [&metadata](int shard_index, const Array<NDArray>& params) {
+          const NDArrayCacheMetadata::FileRecord& shard_rec = metadata.records[shard_index];
+          int num_params = params.size();
+          for (int i = 0; i < num_params; ++i) {
+            Update(shard_rec.records[i].name, params[i], true);
+          }
+        },
+        progress);
   }
 
  private:
@@ -291,7 +594,16 @@ TVM_REGISTER_GLOBAL("vm.builtin.ndarray_cache.update").set_body([](TVMArgs args,
 });
 TVM_REGISTER_GLOBAL("vm.builtin.ndarray_cache.remove").set_body_typed(NDArrayCache::Remove);
 TVM_REGISTER_GLOBAL("vm.builtin.ndarray_cache.clear").set_body_typed(NDArrayCache::Clear);
-TVM_REGISTER_GLOBAL("vm.builtin.ndarray_cache.load").set_body_typed(NDArrayCache::Load);
+TVM_REGISTER_GLOBAL("vm.builtin.ndarray_cache.load").set_body([](TVMArgs args, TVMRetValue* rv) {
+  CHECK(args.size() >= 3 && args.size() <= 6);
+  bool use_mmap = args.size() > 3 ? args[3].operator bool() : true;
+  int num_threads = args.size() > 4 ? args[4].operator int() : 0;
+  Optional<PackedFunc> progress = NullOpt;
+  if (args.size() > 5) {
+    progress = args[5].operator Optional<PackedFunc>();
+  }
+  NDArrayCache::Load(args[0], args[1], args[2], use_mmap, num_threads, progress);
+});
 
 // This param module node can be useful to get param dict in RPC mode
 // when the remote already have loaded parameters from file.
@@ -28,13 +28,17 @@
 #include <tvm/runtime/registry.h>
 
 #include <algorithm>
+#include <limits>
+#include <memory>
 #include <numeric>
+#include <set>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "attn_backend.h"
 #include "attn_utils.h"
+#include "kv_offload.h"
 #include "kv_state.h"
 
 namespace tvm {
@@ -112,6 +116,11 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
 
   /*! \brief The KV cache dtype. */
   const DataType kv_dtype_;
+  /*!
+   * \brief The dtype of the KV data in pages, which is int8 or float8_e4m3fn when the pages are
+   * quantized, or the KV cache dtype otherwise.
+   */
+  const DataType page_dtype_;
   /*! \brief We fix int32 to be the index dtype of auxiliary data. */
   const DLDataType dtype_aux_ = DLDataType(DataType::Int(32, 1));
 
@@ -126,10 +135,18 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
    * Along on the "2" dimension, index 0 stands for K and 1 stands for V.
    */
   std::vector<NDArray> pages_;
+  /*!
+   * \brief The scales of the quantized pages of each layer, in layout (num_pages, 2, num_heads),
+   * or empty when the pages are not quantized. Each head of the K or V data in a page is stored
+   * divided by its scale, which grows as data is appended to the page.
+   */
+  std::vector<NDArray> page_scales_;
   /*! \brief The whole KV cache allocated by NVSHMEM*/
   NDArray nvshmem_pages_;
   /*! \brief The list of ids of released pages for page reuse. */
   std::vector<int32_t> free_page_ids_;
+  /*! \brief The store of offloaded pages, defined when offloading is enabled. */
+  std::unique_ptr<KVPageOffloadStore> offload_store_;
   /*! \brief The mapping from sequence ids to sequences. */
   std::unordered_map<int64_t, Sequence> seq_map_;
 
@@ -140,6 +157,25 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
   /*! \brief The list of free available blocks (in their indices). */
   std::vector<int32_t> free_block_idx_;
 
+  /********************* Prefix Cache *********************/
+
+  /*! \brief The root of the prefix tree, which has no tokens or block. */
+  PrefixTreeNode prefix_tree_root_;
+  /*! \brief The mapping from the blocks held by the prefix tree to their nodes. */
+  std::unordered_map<int32_t, PrefixTreeNode*> prefix_tree_nodes_;
+  /*! \brief The logical clock of prefix tree accesses, for LRU eviction. */
+  int64_t prefix_tree_clock_ = 0;
+  /*! \brief The leaves of the prefix tree that can be evicted, keyed by (access time, block). */
+  std::set<std::pair<int64_t, int32_t>> evictable_prefix_leaves_;
+  /*! \brief The number of pages in the prefix tree nodes whose subtrees can be evicted. */
+  int64_t num_evictable_prefix_pages_ = 0;
+  /*! \brief The total number of tokens queried in the prefix tree. */
+  int64_t prefix_cache_num_queried_tokens_ = 0;
+  /*! \brief The total number of tokens whose KV data is reused from the prefix tree. */
+  int64_t prefix_cache_num_hit_tokens_ = 0;
+  /*! \brief The total number of pages evicted from the prefix tree. */
+  int64_t prefix_cache_num_evicted_pages_ = 0;
+
   /*********** Current Batch Info & Auxiliary Arrays on Device ***********/
   //-------------------------------------------
   // The following fields are auxiliary arrays on device.
@@ -276,9 +312,10 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
       int64_t v_head_dim, std::vector<AttnKind> attn_kinds, int64_t reserved_num_seqs,
       int64_t num_total_pages, int64_t prefill_chunk_size, bool support_sliding_window,
       RoPEMode rope_mode, double rotary_scale, double rotary_theta,
-      Optional<NDArray> rope_ext_factors, bool enable_kv_transfer, DLDataType dtype, Device device,
-      Optional<PackedFunc> f_transpose_append_mha, Optional<PackedFunc> f_transpose_append_mla,
-      PackedFunc f_compact_copy, std::unique_ptr<RaggedPrefillFunc> f_attention_prefill_ragged,
+      Optional<NDArray> rope_ext_factors, bool enable_kv_transfer, DLDataType dtype,
+      DLDataType page_dtype, Device device, Optional<PackedFunc> f_transpose_append_mha,
+      Optional<PackedFunc> f_transpose_append_mla, PackedFunc f_compact_copy,
+      std::unique_ptr<RaggedPrefillFunc> f_attention_prefill_ragged,
       std::unique_ptr<PagedPrefillFunc> f_attention_prefill,
       std::unique_ptr<PagedDecodeFunc> f_attention_decode,
       std::unique_ptr<PagedPrefillFunc> f_attention_prefill_sliding_window,
@@ -305,6 +342,7 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
         rotary_theta_(rotary_theta),
         rope_ext_factors_(std::move(rope_ext_factors)),
         kv_dtype_(DataType(dtype)),
+        page_dtype_(DataType(page_dtype)),
         f_transpose_append_mha_(std::move(f_transpose_append_mha)),
         f_transpose_append_mla_(std::move(f_transpose_append_mla)),
         f_compact_copy_(std::move(f_compact_copy)),
@@ -327,6 +365,18 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
       CHECK(!support_sliding_window_) << "Sliding window not supported yet for MLA";
       CHECK(!enable_kv_transfer) << "KV transfer not supported yet for MLA";
     }
+    if (page_dtype_ != kv_dtype_) {
+      CHECK(page_dtype_ == DataType::Int(8) || page_dtype_.is_float8_e4m3fn())
+          << "ValueError: KV cache pages can only be quantized to int8 or float8_e4m3fn, but got "
+          << page_dtype_;
+      for (AttnKind attn_kind : attn_kinds_) {
+        CHECK(attn_kind == AttnKind::kMHA) << "Quantized KV cache is only supported for MHA";
+      }
+      CHECK(!support_sliding_window_) << "Sliding window not supported yet for quantized KV cache";
+      CHECK(!enable_kv_transfer) << "KV transfer not supported yet for quantized KV cache";
+      CHECK(!NeedKernelBeginForward())
+          << "Quantized KV cache is only supported by the TIR attention backend";
+    }
 
     pages_.reserve(num_layers);
     if (enable_kv_transfer) {
@@ -360,7 +410,12 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
         ShapeTuple kv_cache_shape =
             GetKVCacheShape(attn_kinds_[layer_id_begin_offset_ + i], num_total_pages,
                             reserved_num_seqs, num_kv_heads, page_size, qk_head_dim, v_head_dim);
-        pages_.push_back(NDArray::Empty(kv_cache_shape, dtype, device));
+        pages_.push_back(NDArray::Empty(kv_cache_shape, page_dtype_, device));
+        if (page_dtype_ != kv_dtype_) {
+          // The scales are initialized by the first append to each page.
+          page_scales_.push_back(
+              NDArray::Empty({num_total_pages, 2, num_kv_heads}, DataType::Float(32), device));
+        }
       }
     }
 
@@ -505,6 +560,19 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     for (int64_t page_id = num_total_pages_ - 1; page_id >= 0; --page_id) {
       free_page_ids_.push_back(page_id);
     }
+    prefix_tree_root_.children.clear();
+    prefix_tree_nodes_.clear();
+    prefix_tree_clock_ = 0;
+    evictable_prefix_leaves_.clear();
+    num_evictable_prefix_pages_ = 0;
+    prefix_cache_num_queried_tokens_ = 0;
+    prefix_cache_num_hit_tokens_ = 0;
+    prefix_cache_num_evicted_pages_ = 0;
+    for (const Block& block : global_block_pool_) {
+      for (int64_t slot : block.offload_slots) {
+        offload_store_->Free(slot);
+      }
+    }
     global_block_pool_.clear();
     free_block_idx_.clear();
     dirty_aux_data_device_ = false;
@@ -531,6 +599,9 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
       for (int32_t page_id : global_block_pool_[block_idx].page_ids) {
         free_page_ids_.push_back(page_id);
       }
+      for (int64_t slot : global_block_pool_[block_idx].offload_slots) {
+        offload_store_->Free(slot);
+      }
       free_block_idx_.push_back(block_idx);
       block_idx = global_block_pool_[block_idx].parent_idx;
     }
@@ -538,6 +609,7 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     if (block_idx != -1) {
       ICHECK_GT(global_block_pool_[block_idx].external_ref_cnt, 1);
       --global_block_pool_[block_idx].external_ref_cnt;
+      UpdatePrefixTreeNode(block_idx);
     }
     seq_map_.erase(it);
     dirty_aux_data_device_ = true;
@@ -556,6 +628,7 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     CHECK(parent_it->second.accepted_indices_committed)
         << "The parent sequence's token tree computed in the last round of forward has not been "
            "committed with accepted nodes.";
+    ReloadSequence(&parent_it->second);
 
     if (fork_pos == -1) {
       fork_pos = parent_it->second.seq_length;
@@ -605,33 +678,17 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
         int32_t parent_block_idx = global_block_pool_[forked_block_idx].parent_idx;
         if (parent_block_idx != -1) {
           ++global_block_pool_[parent_block_idx].external_ref_cnt;
+          UpdatePrefixTreeNode(parent_block_idx);
         }
         // Update child block start position and parent index
         global_block_pool_[child_block_idx].parent_idx = parent_block_idx;
       } else {
         // Forked at the second or latter page in block
-        int32_t parent_block_idx = GetFreeBlock();
-        // Insert new parent block before forked block and link child block
-        global_block_pool_[parent_block_idx].parent_idx =
-            global_block_pool_[forked_block_idx].parent_idx;
-        global_block_pool_[forked_block_idx].parent_idx = parent_block_idx;
+        // Move common leading pages to a new parent block and link child block
+        int32_t parent_block_idx = SplitBlock(forked_block_idx, moved_offset);
         global_block_pool_[child_block_idx].parent_idx = parent_block_idx;
-        global_block_pool_[parent_block_idx].external_ref_cnt = 2;
-
-        // Move common leading pages to new parent block
-        auto first_page = global_block_pool_[forked_block_idx].page_ids.begin();
-        auto last_page = global_block_pool_[forked_block_idx].page_ids.begin() + moved_pages;
-        global_block_pool_[parent_block_idx].page_ids = {first_page, last_page};
-        global_block_pool_[forked_block_idx].page_ids.erase(first_page, last_page);
-
-        // Update start position per blocks
-        global_block_pool_[parent_block_idx].start_pos =
-            global_block_pool_[forked_block_idx].start_pos;
-        global_block_pool_[forked_block_idx].start_pos += moved_offset;
-
-        // Update in-block sequence length per blocks
-        global_block_pool_[parent_block_idx].seq_length = moved_offset;
-        global_block_pool_[forked_block_idx].seq_length -= moved_offset;
+        ++global_block_pool_[parent_block_idx].external_ref_cnt;
+        UpdatePrefixTreeNode(parent_block_idx);
 
         // Update sliding window sink size if sliding window is enabled and the forked block is the
         // last block
@@ -665,7 +722,12 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     }
     for (int layer = 0; layer < num_layers_; ++layer) {
       NDArray page_layer_view = pages_[layer];
-      f_copy_single_page_(page_layer_view, src_page_id, tgt_page_id, copy_length);
+      if (page_scales_.empty()) {
+        f_copy_single_page_(page_layer_view, src_page_id, tgt_page_id, copy_length);
+      } else {
+        f_copy_single_page_(page_layer_view, page_scales_[layer], src_page_id, tgt_page_id,
+                            copy_length);
+      }
     }
     if (copy_stream_ != compute_stream_) {
       // Set the compute stream back.
@@ -696,8 +758,13 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     }
     ICHECK(f_compact_copy_.defined()) << "Function \"f_compact_copy\" is not defined.";
     for (int layer = 0; layer < num_layers_; ++layer) {
-      f_compact_copy_(pages_[layer], commit_copy_length_indptr_view,
-                      commit_copy_src_dst_pos_in_page_table_view, cur_batch_size_);
+      if (page_scales_.empty()) {
+        f_compact_copy_(pages_[layer], commit_copy_length_indptr_view,
+                        commit_copy_src_dst_pos_in_page_table_view, cur_batch_size_);
+      } else {
+        f_compact_copy_(pages_[layer], page_scales_[layer], commit_copy_length_indptr_view,
+                        commit_copy_src_dst_pos_in_page_table_view, cur_batch_size_);
+      }
     }
     if (copy_stream_ != compute_stream_) {
       // Set the compute stream back.
@@ -747,6 +814,7 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     if (n == 0) {
       return;
     }
+    ReloadSequence(&it->second);
 
     int32_t block_idx = it->second.last_block_idx;
     // The block should have at least one reference, which comes from the sequence.
@@ -796,6 +864,171 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     dirty_aux_data_device_ = true;
   }
 
+  int64_t AddSequenceWithPrefixCache(int64_t seq_id, const IntTuple& token_ids) final {
+    CHECK(seq_map_.find(seq_id) == seq_map_.end())
+        << "The sequence \"" << seq_id << "\" is already in the KV cache.";
+    // The last token is never reused, so that the logits of the sequence can be computed.
+    int64_t num_tokens = std::max<int64_t>(token_ids.size() - 1, 0);
+    ++prefix_tree_clock_;
+    PrefixTreeNode* node = &prefix_tree_root_;
+    int64_t prefix_length = 0;
+    while (prefix_length + page_size_ <= num_tokens) {
+      auto it = node->children.find(GetPrefixTreeKey(token_ids.begin() + prefix_length));
+      if (it == node->children.end()) {
+        break;
+      }
+      PrefixTreeNode* child = it->second.get();
+      int64_t edge_length = child->token_ids.size();
+      int64_t match_length = 0;
+      while (match_length < edge_length && prefix_length + match_length < num_tokens &&
+             child->token_ids[match_length] == token_ids[prefix_length + match_length]) {
+        ++match_length;
+      }
+      if (match_length < edge_length) {
+        // Only full pages can be shared, so split the node after the last matched full page.
+        match_length -= match_length % page_size_;
+        SplitBlock(child->block_idx, match_length);
+        child = child->parent;
+      }
+      TouchPrefixTreeNode(child);
+      node = child;
+      prefix_length += match_length;
+      if (match_length < edge_length) {
+        break;
+      }
+    }
+    prefix_cache_num_queried_tokens_ += token_ids.size();
+    prefix_cache_num_hit_tokens_ += prefix_length;
+
+    int32_t block_idx = GetFreeBlock();
+    if (node != &prefix_tree_root_) {
+      global_block_pool_[block_idx].parent_idx = node->block_idx;
+      global_block_pool_[block_idx].start_pos = prefix_length;
+      ++global_block_pool_[node->block_idx].external_ref_cnt;
+      UpdatePrefixTreeNode(node->block_idx);
+    }
+    seq_map_.insert({seq_id, Sequence(&global_block_pool_, block_idx)});
+    dirty_aux_data_device_ = true;
+    return prefix_length;
+  }
+
+  void CommitSequenceToPrefixCache(int64_t seq_id, const IntTuple& token_ids) final {
+    auto it = seq_map_.find(seq_id);
+    CHECK(it != seq_map_.end()) << "The sequence \"" << seq_id << "\" cannot be found in KV cache.";
+    const Sequence& seq = it->second;
+    CHECK_EQ(seq.sliding_window_size, -1)
+        << "The sequence \"" << seq_id
+        << "\" is enabled with sliding window and thus cannot be committed to the prefix cache.";
+    CHECK(seq.accepted_indices_committed)
+        << "The sequence's token tree computed in the last round of forward has not been "
+           "committed with accepted nodes.";
+    ReloadSequence(&it->second);
+    int64_t commit_length = std::min<int64_t>(token_ids.size(), seq.seq_length);
+    commit_length -= commit_length % page_size_;
+
+    ++prefix_tree_clock_;
+    std::vector<int32_t> trace = seq.GetBlockTrace(global_block_pool_);
+    PrefixTreeNode* node = &prefix_tree_root_;
+    int64_t length = 0;
+    size_t i = 0;
+    // Skip the leading blocks of the sequence which are already in the prefix tree.
+    for (; i < trace.size(); ++i) {
+      auto node_it = prefix_tree_nodes_.find(trace[i]);
+      if (node_it == prefix_tree_nodes_.end()) {
+        break;
+      }
+      node = node_it->second;
+      int64_t edge_length = node->token_ids.size();
+      CHECK(length + edge_length > static_cast<int64_t>(token_ids.size()) ||
+            std::equal(node->token_ids.begin(), node->token_ids.end(),
+                       token_ids.begin() + length))
+          << "The given tokens mismatch the cached prefix of sequence \"" << seq_id << "\".";
+      TouchPrefixTreeNode(node);
+      length += edge_length;
+    }
+    // Keep the existing prefix if the tokens were committed by another sequence.
+    if (length >= commit_length ||
+        node->children.count(GetPrefixTreeKey(token_ids.begin() + length))) {
+      return;
+    }
+
+    for (; length < commit_length; ++i) {
+      ICHECK_LT(i, trace.size());
+      int32_t block_idx = trace[i];
+      int64_t block_length = global_block_pool_[block_idx].seq_length;
+      if (length + block_length > commit_length || block_idx == seq.last_block_idx) {
+        // The last block of a sequence should stay unshared for the KV data to append,
+        // so its full pages are moved to a new block to cache.
+        block_length = commit_length - length;
+        block_idx = SplitBlock(block_idx, block_length);
+      }
+      auto child = std::make_unique<PrefixTreeNode>();
+      child->token_ids = {token_ids.begin() + length, token_ids.begin() + length + block_length};
+      child->block_idx = block_idx;
+      child->parent = node;
+      child->last_access_time = prefix_tree_clock_;
+      // The prefix tree holds a reference of the block of each node.
+      ++global_block_pool_[block_idx].external_ref_cnt;
+      prefix_tree_nodes_[block_idx] = child.get();
+      // The subtree of a new leaf is evictable until it is found pinned.
+      num_evictable_prefix_pages_ += global_block_pool_[block_idx].page_ids.size();
+      std::vector<int32_t> key = GetPrefixTreeKey(child->token_ids.begin());
+      node = child.get();
+      node->parent->children[std::move(key)] = std::move(child);
+      UpdatePrefixTreeNode(block_idx);
+      UpdatePrefixTreeNode(node->parent->block_idx);
+      length += block_length;
+    }
+    dirty_aux_data_device_ = true;
+  }
+
+  void ClearPrefixCache() final { EvictPrefixCache(std::numeric_limits<int64_t>::max()); }
+
+  void EnableOffload(int64_t num_host_pages, const String& file_path) final {
+    if (offload_store_ != nullptr) {
+      CHECK(offload_store_->GetNumHostSlotsInUse() == 0 &&
+            offload_store_->GetNumFileSlotsInUse() == 0)
+          << "The KV cache offloading cannot be reconfigured with sequences offloaded.";
+    }
+    // The scales of quantized pages are offloaded along with the pages.
+    std::vector<NDArray> offloaded_data = pages_;
+    offloaded_data.insert(offloaded_data.end(), page_scales_.begin(), page_scales_.end());
+    offload_store_ = std::make_unique<KVPageOffloadStore>(std::move(offloaded_data), num_host_pages,
+                                                          file_path, copy_stream_);
+  }
+
+  void OffloadSequence(int64_t seq_id) final {
+    CHECK(offload_store_ != nullptr)
+        << "The KV cache offloading is not enabled. Please enable it with \"EnableOffload\".";
+    auto it = seq_map_.find(seq_id);
+    CHECK(it != seq_map_.end()) << "The sequence \"" << seq_id << "\" cannot be found in KV cache.";
+    Sequence& seq = it->second;
+    CHECK(seq.accepted_indices_committed)
+        << "The sequence's token tree computed in the last round of forward has not been "
+           "committed with accepted nodes.";
+    if (seq.offloaded) {
+      return;
+    }
+    if (copy_stream_ != nullptr) {
+      // The copies read the KV data written on the compute stream.
+      DeviceAPI::Get(device_)->SyncStreamFromTo(device_, compute_stream_, copy_stream_);
+    }
+    // Offload the blocks used only by the sequence, which are those freed on removal.
+    int32_t block_idx = seq.last_block_idx;
+    while (block_idx != -1 && global_block_pool_[block_idx].external_ref_cnt == 1) {
+      Block& block = global_block_pool_[block_idx];
+      for (int32_t page_id : block.page_ids) {
+        block.offload_slots.push_back(offload_store_->Store(page_id));
+        free_page_ids_.push_back(page_id);
+      }
+      block.page_ids.clear();
+      block_idx = block.parent_idx;
+    }
+    seq.offloaded = true;
+    // The freed pages can be overwritten only after the compute stream waits for the copies.
+    dirty_aux_data_device_ = true;
+  }
+
   /************** Raw Info Query **************/
 
   bool Empty() const final {
@@ -804,7 +1037,32 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
            free_page_ids_.size() == static_cast<size_t>(num_total_pages_);
   }
 
-  int32_t GetNumAvailablePages() const final { return free_page_ids_.size(); }
+  int32_t GetNumAvailablePages() const final {
+    return free_page_ids_.size() + num_evictable_prefix_pages_;
+  }
+
+  int64_t GetPageNBytes() const final {
+    int64_t nbytes = 0;
+    for (size_t i = 0; i < pages_.size(); ++i) {
+      // The linear attention layers keep a state of each sequence rather than pages.
+      if (attn_kinds_[layer_id_begin_offset_ + i] != AttnKind::kLinearAttn) {
+        nbytes += GetDataSize(*pages_[i].operator->()) / pages_[i]->shape[0];
+      }
+    }
+    for (const NDArray& data : page_scales_) {
+      nbytes += GetDataSize(*data.operator->()) / data->shape[0];
+    }
+    return nbytes;
+  }
+
+  IntTuple GetPrefixCacheStats() const final {
+    int64_t num_cached_pages = 0;
+    for (const auto& [block_idx, node] : prefix_tree_nodes_) {
+      num_cached_pages += global_block_pool_[block_idx].page_ids.size();
+    }
+    return IntTuple{prefix_cache_num_queried_tokens_, prefix_cache_num_hit_tokens_,
+                    num_cached_pages, prefix_cache_num_evicted_pages_};
+  }
 
   int32_t GetTotalSequenceLength() const final {
     int32_t total_seq_len = 0;
@@ -830,6 +1088,14 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     cur_seq_ids_ = seq_ids;
     cur_append_lengths_ = append_lengths;
 
+    // - Reload the offloaded sequences, whose copies the compute stream waits for.
+    for (int64_t seq_id : seq_ids) {
+      auto it = seq_map_.find(seq_id);
+      if (it != seq_map_.end()) {
+        ReloadSequence(&it->second);
+      }
+    }
+
     // - Collect sequence/block/page information for attention.
     std::vector<Sequence*> sequences;
     std::vector<int32_t> last_block_length_before_append;
@@ -1184,9 +1450,8 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     int64_t local_layer_id = layer_id - layer_id_begin_offset_;
     CHECK_GE(local_layer_id, 0);
     CHECK_LT(local_layer_id, num_layers_);
-    NDArray pages = pages_[local_layer_id];
-    CHECK(qkv_data.DataType() == pages.DataType());
-    CHECK(o_data.DataType() == pages.DataType());
+    CHECK(qkv_data.DataType() == kv_dtype_);
+    CHECK(o_data.DataType() == kv_dtype_);
     CHECK(attn_kinds_[layer_id] == AttnKind::kMHA);
 
     // qkv_data: (num_total_length, num_qo_heads + 2 * num_kv_heads, qk_head_dim)
@@ -1245,8 +1510,7 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     // Part 3. Append k/v data to kv-cache if flag "append_before_attn" is set.
     CHECK(f_transpose_append_mha_.defined());
     if (append_before_attn_) {
-      f_transpose_append_mha_.value()(pages_[local_layer_id], k_data, v_data,
-                                      append_position_map_view_);
+      AppendKVToPages(local_layer_id, k_data, v_data);
     }
     // Part 4: KV transfer
     if (page_to_page_transfer_kv_) {
@@ -1273,8 +1537,7 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     AttentionInternal(layer_id, q_data, k_data, v_data, o_data_view, sm_scale);
     // Part 6. Append k/v data to kv-cache if flag "append_before_attn" is not set.
     if (!append_before_attn_) {
-      f_transpose_append_mha_.value()(pages_[local_layer_id], k_data, v_data,
-                                      append_position_map_view_);
+      AppendKVToPages(local_layer_id, k_data, v_data);
     }
   }
 
@@ -1284,11 +1547,10 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     int64_t local_layer_id = layer_id - layer_id_begin_offset_;
     CHECK_GE(local_layer_id, 0);
     CHECK_LT(local_layer_id, num_layers_);
-    NDArray pages = pages_[local_layer_id];
-    CHECK(q_data.DataType() == pages.DataType());
-    CHECK(k_data.DataType() == pages.DataType());
-    CHECK(v_data.DataType() == pages.DataType());
-    CHECK(o_data.DataType() == pages.DataType());
+    CHECK(q_data.DataType() == kv_dtype_);
+    CHECK(k_data.DataType() == kv_dtype_);
+    CHECK(v_data.DataType() == kv_dtype_);
+    CHECK(o_data.DataType() == kv_dtype_);
     AttnKind attn_kind = attn_kinds_[layer_id];
 
     // q_data: (num_total_length, num_qo_heads, qk_head_dim)
@@ -1327,9 +1589,8 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     int64_t local_layer_id = layer_id - layer_id_begin_offset_;
     CHECK_GE(local_layer_id, 0);
     CHECK_LT(local_layer_id, num_layers_);
-    NDArray pages = pages_[local_layer_id];
-    CHECK(q_data.DataType() == pages.DataType());
-    CHECK(o_data.DataType() == pages.DataType());
+    CHECK(q_data.DataType() == kv_dtype_);
+    CHECK(o_data.DataType() == kv_dtype_);
     AttnKind attn_kind = attn_kinds_[layer_id];
 
     // q_data: (num_total_length, num_qo_heads, qk_head_dim)
@@ -1366,8 +1627,7 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     int64_t local_layer_id = layer_id - layer_id_begin_offset_;
     CHECK_GE(local_layer_id, 0);
     CHECK_LT(local_layer_id, num_layers_);
-    NDArray pages = pages_[local_layer_id];
-    CHECK(kv_data.DataType() == pages.DataType());
+    CHECK(kv_data.DataType() == kv_dtype_);
     CHECK(attn_kinds_[layer_id] == AttnKind::kMLA);
 
     // kv_data: (num_total_length, qk_head_dim)
@@ -1505,7 +1765,8 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
         << "PageAttentionKVCache requires the `f_debug_get_kv` to be explicitly passed in when "
            "initialization. Please construct the KV cache with `f_debug_get_kv`.";
 
-    const Sequence& seq = seq_map_.at(seq_id);
+    Sequence& seq = seq_map_.at(seq_id);
+    ReloadSequence(&seq);
     CHECK_GE(start_pos, 0) << "DebugGetKV does not accept negative start_pos " << start_pos;
     CHECK_LE(end_pos, seq.seq_length) << "DebugGetKV does not accept out-of-range end_pos";
     CHECK_LT(start_pos, end_pos) << "DebugGetKV does not accept \"start_pos >= end_pos\"";
@@ -1546,7 +1807,12 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
         (end_pos - start_pos) * ((dtype_aux_.bits * dtype_aux_.lanes + 7) / 8));
     for (int64_t layer_id = 0; layer_id < num_layers_; ++layer_id) {
       CHECK(attn_kinds_[layer_id] == AttnKind::kMHA) << "Only MHA is supported for DebugGetKV";
-      f_debug_get_kv_.value()(pages_[layer_id], position_map_device, k_data, v_data, layer_id);
+      if (page_scales_.empty()) {
+        f_debug_get_kv_.value()(pages_[layer_id], position_map_device, k_data, v_data, layer_id);
+      } else {
+        f_debug_get_kv_.value()(pages_[layer_id], page_scales_[layer_id], position_map_device,
+                                k_data, v_data, layer_id);
+      }
     }
   }
 
@@ -1555,7 +1821,8 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
         << "PageAttentionKVCache requires the `f_debug_get_kv` to be explicitly passed in when "
            "initialization. Please construct the KV cache with `f_debug_get_kv`.";
 
-    const Sequence& seq = seq_map_.at(seq_id);
+    Sequence& seq = seq_map_.at(seq_id);
+    ReloadSequence(&seq);
     CHECK_GE(start_pos, 0) << "DebugGetKV does not accept negative start_pos " << start_pos;
     CHECK_LE(end_pos, seq.seq_length) << "DebugGetKV does not accept out-of-range end_pos";
     CHECK_LT(start_pos, end_pos) << "DebugGetKV does not accept \"start_pos >= end_pos\"";
@@ -1604,6 +1871,10 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
  private:
   /*! \brief Get a new free page and return its id. */
   int32_t GetFreePage() {
+    if (free_page_ids_.empty()) {
+      // Reclaim the pages of the least recently used prefix no sequence uses.
+      EvictPrefixCache(1);
+    }
     // Find a page from the free page pools.
     CHECK(!free_page_ids_.empty()) << "The KV cache is full. No page can be allocated.";
     int32_t page_id = free_page_ids_.back();
@@ -1626,6 +1897,159 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     return block_idx;
   }
 
+  /*! \brief Copy the offloaded KV data of a sequence back to device, if any. */
+  void ReloadSequence(Sequence* seq) {
+    if (!seq->offloaded) {
+      return;
+    }
+    int64_t num_pages = 0;
+    for (int32_t block_idx = seq->last_block_idx; block_idx != -1;
+         block_idx = global_block_pool_[block_idx].parent_idx) {
+      num_pages += global_block_pool_[block_idx].offload_slots.size();
+    }
+    CHECK_LE(num_pages, GetNumAvailablePages())
+        << "The KV cache is full. No page can be allocated to reload the offloaded sequence. "
+           "Please offload or remove other sequences first.";
+    for (int32_t block_idx = seq->last_block_idx; block_idx != -1;
+         block_idx = global_block_pool_[block_idx].parent_idx) {
+      Block& block = global_block_pool_[block_idx];
+      for (int64_t slot : block.offload_slots) {
+        int32_t page_id = GetFreePage();
+        offload_store_->Load(slot, page_id);
+        block.page_ids.push_back(page_id);
+      }
+      block.offload_slots.clear();
+    }
+    seq->offloaded = false;
+    dirty_aux_data_device_ = true;
+  }
+
+  /*! \brief Get the key of a prefix tree node, which is the tokens in its first page. */
+  template <typename TokenIter>
+  std::vector<int32_t> GetPrefixTreeKey(TokenIter first_token) const {
+    return std::vector<int32_t>(first_token, first_token + page_size_);
+  }
+
+  /*!
+   * \brief Move the leading `length` tokens of a block, which are full pages, to a new
+   * block inserted as its parent. The prefix tree node of the block is split likewise.
+   * \return The index of the new block, which is referenced by the given block (and
+   * the prefix tree).
+   */
+  int32_t SplitBlock(int32_t block_idx, int64_t length) {
+    ICHECK_GT(length, 0);
+    ICHECK_EQ(length % page_size_, 0);
+    int32_t parent_block_idx = GetFreeBlock();
+    Block& parent_block = global_block_pool_[parent_block_idx];
+    Block& block = global_block_pool_[block_idx];
+    ICHECK_LE(length, block.seq_length);
+    parent_block.parent_idx = block.parent_idx;
+    block.parent_idx = parent_block_idx;
+    parent_block.external_ref_cnt = 1;
+    auto last_page = block.page_ids.begin() + length / page_size_;
+    parent_block.page_ids = {block.page_ids.begin(), last_page};
+    block.page_ids.erase(block.page_ids.begin(), last_page);
+    parent_block.start_pos = block.start_pos;
+    block.start_pos += length;
+    parent_block.seq_length = length;
+    block.seq_length -= length;
+
+    auto it = prefix_tree_nodes_.find(block_idx);
+    if (it != prefix_tree_nodes_.end()) {
+      PrefixTreeNode* node = it->second;
+      ICHECK_LT(length, static_cast<int64_t>(node->token_ids.size()));
+      std::unique_ptr<PrefixTreeNode>& slot =
+          node->parent->children.at(GetPrefixTreeKey(node->token_ids.begin()));
+      auto parent_node = std::make_unique<PrefixTreeNode>();
+      parent_node->token_ids = {node->token_ids.begin(), node->token_ids.begin() + length};
+      parent_node->block_idx = parent_block_idx;
+      parent_node->parent = node->parent;
+      parent_node->last_access_time = node->last_access_time;
+      // The new node is referenced by the node only, so the pages moved to it stay as evictable
+      // as they were.
+      parent_node->num_pinned_in_subtree = node->num_pinned_in_subtree;
+      node->token_ids.erase(node->token_ids.begin(), node->token_ids.begin() + length);
+      node->parent = parent_node.get();
+      parent_node->children[GetPrefixTreeKey(node->token_ids.begin())] = std::move(slot);
+      slot = std::move(parent_node);
+      prefix_tree_nodes_[parent_block_idx] = slot.get();
+      ++parent_block.external_ref_cnt;
+    }
+    return parent_block_idx;
+  }
+
+  /*! \brief Mark a prefix tree node as accessed now, keeping the LRU order of the leaves. */
+  void TouchPrefixTreeNode(PrefixTreeNode* node) {
+    bool evictable = evictable_prefix_leaves_.erase({node->last_access_time, node->block_idx});
+    node->last_access_time = prefix_tree_clock_;
+    if (evictable) {
+      evictable_prefix_leaves_.insert({node->last_access_time, node->block_idx});
+    }
+  }
+
+  /*!
+   * \brief Update the eviction state of the prefix tree node of a block, after the references of
+   * the block or the children of the node change. Blocks outside of the prefix tree are ignored.
+   */
+  void UpdatePrefixTreeNode(int32_t block_idx) {
+    auto it = prefix_tree_nodes_.find(block_idx);
+    if (it == prefix_tree_nodes_.end()) {
+      return;
+    }
+    PrefixTreeNode* node = it->second;
+    // The block is referenced by the prefix tree and the blocks of the children only, unless
+    // pinned.
+    bool pinned = global_block_pool_[block_idx].external_ref_cnt >
+                  static_cast<int>(node->children.size()) + 1;
+    if (pinned != node->pinned) {
+      node->pinned = pinned;
+      // The pages of the ancestors stop or start being evictable along with their subtrees.
+      for (PrefixTreeNode* ancestor = node; ancestor != &prefix_tree_root_;
+           ancestor = ancestor->parent) {
+        int64_t num_pages = global_block_pool_[ancestor->block_idx].page_ids.size();
+        if (ancestor->num_pinned_in_subtree == 0) {
+          num_evictable_prefix_pages_ -= num_pages;
+        }
+        ancestor->num_pinned_in_subtree += pinned ? 1 : -1;
+        if (ancestor->num_pinned_in_subtree == 0) {
+          num_evictable_prefix_pages_ += num_pages;
+        }
+      }
+    }
+    // Only leaves can be evicted, since the block of a node is the parent of its children's.
+    if (node->children.empty() && !pinned) {
+      evictable_prefix_leaves_.insert({node->last_access_time, block_idx});
+    } else {
+      evictable_prefix_leaves_.erase({node->last_access_time, block_idx});
+    }
+  }
+
+  /*!
+   * \brief Evict the least recently used prefixes which no sequence uses, until
+   * `num_pages` pages are freed or there is no such prefix.
+   */
+  void EvictPrefixCache(int64_t num_pages) {
+    int64_t num_freed_pages = 0;
+    while (num_freed_pages < num_pages && !evictable_prefix_leaves_.empty()) {
+      PrefixTreeNode* victim = prefix_tree_nodes_.at(evictable_prefix_leaves_.begin()->second);
+      evictable_prefix_leaves_.erase(evictable_prefix_leaves_.begin());
+      Block& block = global_block_pool_[victim->block_idx];
+      num_freed_pages += block.page_ids.size();
+      prefix_cache_num_evicted_pages_ += block.page_ids.size();
+      num_evictable_prefix_pages_ -= block.page_ids.size();
+      free_page_ids_.insert(free_page_ids_.end(), block.page_ids.begin(), block.page_ids.end());
+      free_block_idx_.push_back(victim->block_idx);
+      if (block.parent_idx != -1) {
+        ICHECK_GT(global_block_pool_[block.parent_idx].external_ref_cnt, 1);
+        --global_block_pool_[block.parent_idx].external_ref_cnt;
+      }
+      PrefixTreeNode* parent = victim->parent;
+      prefix_tree_nodes_.erase(victim->block_idx);
+      parent->children.erase(GetPrefixTreeKey(victim->token_ids.begin()));
+      UpdatePrefixTreeNode(parent->block_idx);
+    }
+  }
+
   void ConstructTokenTreeMask(const std::vector<Sequence*>& sequences,
                               const IntTuple& token_tree_parent_ptr,
                               const std::vector<std::vector<int32_t>>& block_ids_on_depths,
@@ -1870,6 +2294,25 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
     dirty_aux_data_device_ = true;
   }
 
+  /*! \brief Return the scales of the pages of a layer, if the pages are quantized. */
+  Optional<NDArray> GetPageScales(int64_t local_layer_id) const {
+    if (page_scales_.empty()) {
+      return NullOpt;
+    }
+    return page_scales_[local_layer_id];
+  }
+
+  /*! \brief Append the K/V data to the pages of a layer, quantizing it if needed. */
+  void AppendKVToPages(int64_t local_layer_id, NDArray k_data, NDArray v_data) {
+    if (page_scales_.empty()) {
+      f_transpose_append_mha_.value()(pages_[local_layer_id], k_data, v_data,
+                                      append_position_map_view_);
+    } else {
+      f_transpose_append_mha_.value()(pages_[local_layer_id], page_scales_[local_layer_id], k_data,
+                                      v_data, append_position_map_view_);
+    }
+  }
+
   /*! \brief Check whether BeginForward for kernels is needed. */
   bool NeedKernelBeginForward() {
     std::vector<AttnBackendFunc*> funcs = {f_attention_prefill_.get(),
@@ -2062,25 +2505,26 @@ class PagedAttentionKVCacheObj : public AttentionKVCacheObj {
         ICHECK_NOTNULL(f_attention_prefill_with_tree_mask_paged_kv_);
         f_attention_prefill_with_tree_mask_paged_kv_->MHA(
             q_data, qo_indptr_on_depths_view_[d], pages_[local_layer_id],
-            page_indptr_on_depths_view_[d], page_indices_on_depths_view_[d],
-            length_info_on_depths_view_[d], k_rope_pos_offset_view_[d], q_rope_position_map_view_,
-            tree_attn_mn_indptr_view_[d], tree_attn_mask_view_[d], rope_mode_, rotary_scale_,
-            rotary_theta_, sm_scale, attn_output, attn_lse, compute_stream_);
+            GetPageScales(local_layer_id), page_indptr_on_depths_view_[d],
+            page_indices_on_depths_view_[d], length_info_on_depths_view_[d],
+            k_rope_pos_offset_view_[d], q_rope_position_map_view_, tree_attn_mn_indptr_view_[d],
+            tree_attn_mask_view_[d], rope_mode_, rotary_scale_, rotary_theta_, sm_scale,
+            attn_output, attn_lse, compute_stream_);
       } else if (use_decode_kernel_[d]) {
         // Use decode kernel for depth d
         ICHECK_NOTNULL(f_decode);
-        f_decode->MHA(d, q_data, pages_[local_layer_id], page_indptr_on_depths_view_[d],
-                      page_indices_on_depths_view_[d], length_info_on_depths_view_[d],
-                      k_rope_pos_offset_view_[d], q_rope_position_map_view_, rope_mode_,
-                      rotary_scale_, rotary_theta_, sm_scale, attn_output, attn_lse,
-                      compute_stream_);
+        f_decode->MHA(d, q_data, pages_[local_layer_id], GetPageScales(local_layer_id),
+                      page_indptr_on_depths_view_[d], page_indices_on_depths_view_[d],
+                      length_info_on_depths_view_[d], k_rope_pos_offset_view_[d],
+                      q_rope_position_map_view_, rope_mode_, rotary_scale_, rotary_theta_,
+                      sm_scale, attn_output, attn_lse, compute_stream_);
       } else {
         // Use prefill kernel for depth d
         ICHECK_NOTNULL(f_prefill);
         f_prefill->MHA(d, q_data, qo_indptr_on_depths_view_[d], pages_[local_layer_id],
-                       page_indptr_on_depths_view_[d], page_indices_on_depths_view_[d],
-                       length_info_on_depths_view_[d], q_rope_position_map_view_,
-                       k_rope_pos_offset_view_[d], /*causal=*/false,
+                       GetPageScales(local_layer_id), page_indptr_on_depths_view_[d],
+                       page_indices_on_depths_view_[d], length_info_on_depths_view_[d],
+                       q_rope_position_map_view_, k_rope_pos_offset_view_[d], /*causal=*/false,
                        /*rotary_mode=*/rope_mode_, rotary_scale_, rotary_theta_, sm_scale,
                        attn_output, attn_lse, compute_stream_);
       }
@@ -2281,7 +2725,6 @@ TVM_REGISTER_OBJECT_TYPE(PagedAttentionKVCacheObj);
 
 TVM_REGISTER_GLOBAL("vm.builtin.paged_attention_kv_cache_create")
     .set_body([](TVMArgs args, TVMRetValue* rv) {
-      // Todo: cuda graph arg
       CHECK(args.size() == 28 || args.size() == 29)
           << "Invalid number of KV cache constructor args: " << args.size();
       ShapeTuple cache_config = args[0];
@@ -2331,6 +2774,12 @@ TVM_REGISTER_GLOBAL("vm.builtin.paged_attention_kv_cache_create")
       PackedFunc f_copy_single_page = args[25];
       PackedFunc f_debug_get_kv = args[26];
       PackedFunc f_compact_copy = args[27];
+      // The optional args[28] is a tensor in the dtype of quantized KV cache pages.
+      DLDataType page_dtype = init->dtype;
+      if (args.size() == 29) {
+        NDArray page_init = args[28];
+        page_dtype = page_init->dtype;
+      }
 
       if (args[11].IsObjectRef<NDArray>()) {
         rope_ext_factors = args[11].AsObjectRef<NDArray>();
@@ -2369,7 +2818,7 @@ TVM_REGISTER_GLOBAL("vm.builtin.paged_attention_kv_cache_create")
           num_kv_heads, qk_head_dim, v_head_dim, attn_kinds_vec, reserved_num_seqs, num_total_pages,
           prefill_chunk_size, support_sliding_window, RoPEMode(rope_mode), rotary_scale,
           rotary_theta, std::move(rope_ext_factors), enable_kv_transfer,  //
-          init->dtype, init->device,                                      //
+          init->dtype, page_dtype, init->device,                          //
           std::move(f_transpose_append_mha), std::move(f_transpose_append_mla),
           std::move(f_compact_copy), std::move(f_attention_prefill_ragged),
           std::move(f_attention_prefill), std::move(f_attention_decode),
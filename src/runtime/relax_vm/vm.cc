@@ -26,9 +26,12 @@
 #include <tvm/runtime/packed_func.h>
 #include <tvm/runtime/profiling.h>
 #include <tvm/runtime/relax_vm/vm.h>
+#include <tvm/runtime/trace_event.h>
 
+#include <algorithm>
 #include <optional>
 #include <thread>
+#include <utility>
 
 namespace tvm {
 namespace runtime {
@@ -193,6 +196,59 @@ struct VMFrame {
   }
 };
 
+/*!
+ * \brief A call instruction decoded ahead of the execution.
+ *
+ * The arguments which are the same on every execution, i.e. the immediates, the constants,
+ * the functions and the special registers, are set once in the argument template. Only the
+ * arguments read from the registers are set on each execution.
+ */
+struct DecodedCall {
+  /*! \brief The callee, the implementation of the closure if the callee is a closure. */
+  PackedFunc callee;
+  /*! \brief Whether the callee is a closure, which takes the VM context as its first argument. */
+  bool is_closure{false};
+  /*! \brief The name of the NVTX range around a closure call. */
+  std::string nvtx_name;
+  /*! \brief The name of the callee in the trace. */
+  std::string trace_name;
+  /*! \brief The destination register. */
+  RegName dst;
+  /*! \brief The template of the argument values, including the VM context of a closure. */
+  std::vector<TVMValue> values;
+  /*! \brief The template of the argument type codes. */
+  std::vector<int> tcodes;
+  /*! \brief The positions of the arguments read from the registers, and their registers. */
+  std::vector<std::pair<int, RegName>> reg_args;
+  /*!
+   * \brief The positions of the constant arguments which are not loaded yet, and their indices
+   *  in the constant pool. They are set in the template on the first execution.
+   */
+  std::vector<std::pair<int, Index>> lazy_const_args;
+};
+
+/*! \brief An instruction decoded ahead of the execution. */
+struct DecodedInstr {
+  /*! \brief The kind of a decoded instruction, which selects its handler. */
+  enum class Kind : int {
+    /*! \brief A call reading some arguments from the registers. */
+    kCall,
+    /*! \brief A call whose arguments are all in the argument template. */
+    kCallStatic,
+    kRet,
+    kGoto,
+    kIf,
+  };
+  /*! \brief The kind of the instruction. */
+  Kind kind;
+  /*! \brief The result register of Ret, the condition register of If. */
+  RegName reg{0};
+  /*! \brief The pc offset of Goto, the false offset of If. */
+  Index offset{0};
+  /*! \brief The index of a call in the decoded calls. */
+  Index call_index{-1};
+};
+
 class VirtualMachineImpl : public VirtualMachine {
  public:
   //---------------------------------------------------
@@ -323,6 +379,43 @@ class VirtualMachineImpl : public VirtualMachine {
    * \brief Initialize function pool.
    */
   void InitFuncPool();
+  /*!
+   * \brief Decode the instructions of the executable ahead of the execution.
+   * \note The constant pool and the function pool must be initialized.
+   */
+  void DecodeInstructions();
+  /*!
+   * \brief Get a constant of the pool, loading it from the executable on first use.
+   * \param index The index of the constant.
+   * \return The constant.
+   */
+  TVM_ALWAYS_INLINE const TVMRetValue& GetConstant(Index index) {
+    if (num_unloaded_constants_ != 0 && const_unloaded_[index]) {
+      LoadConstant(index);
+    }
+    return const_pool_[index];
+  }
+  /*!
+   * \brief Load a lazy constant of the executable, and copy it to the device.
+   * \param index The index of the constant.
+   */
+  void LoadConstant(Index index);
+  /*!
+   * \brief Get a decoded call, setting its lazy constant arguments on the first execution.
+   * \param call_index The index of the decoded call.
+   * \return The decoded call.
+   */
+  TVM_ALWAYS_INLINE const DecodedCall& GetDecodedCall(Index call_index) {
+    DecodedCall& call = decoded_calls_[call_index];
+    if (!call.lazy_const_args.empty()) {
+      runtime::TVMArgsSetter setter(call.values.data(), call.tcodes.data());
+      for (const std::pair<int, Index>& const_arg : call.lazy_const_args) {
+        setter(const_arg.first, GetConstant(const_arg.second));
+      }
+      call.lazy_const_args.clear();
+    }
+    return call;
+  }
 
   /*!
    * \brief A RAII wrapper that pushes and pops VM frames.
@@ -399,6 +492,14 @@ class VirtualMachineImpl : public VirtualMachine {
    * \param inst The call instruction.
    */
   virtual void RunInstrCall(VMFrame* curr_frame, Instruction inst);
+  /*!
+   * \brief Run a decoded call instruction.
+   * \param curr_frame The current frame.
+   * \param call The decoded call.
+   * \tparam kReadRegisters Whether the call reads some arguments from the registers.
+   */
+  template <bool kReadRegisters>
+  TVM_ALWAYS_INLINE void RunDecodedCall(VMFrame* curr_frame, const DecodedCall& call);
 
   /*! \brief Run VM dispatch loop. */
   void RunLoop();
@@ -428,6 +529,13 @@ class VirtualMachineImpl : public VirtualMachine {
   ObjectPtr<VMExecutable> exec_;
   /*! \brief The global constant pool */
   std::vector<TVMRetValue> const_pool_;
+  /*!
+   * \brief Whether each constant is a lazy constant of the executable which is not loaded yet.
+   *  Its entry in the constant pool is null until GetConstant loads it.
+   */
+  std::vector<bool> const_unloaded_;
+  /*! \brief The number of the constants which are not loaded yet. */
+  size_t num_unloaded_constants_{0};
   /*!
    * \brief Function pool to cache functions in func_table
    */
@@ -460,6 +568,15 @@ class VirtualMachineImpl : public VirtualMachine {
   RegType return_value_;
   /*!\ brief instrument function. */
   PackedFunc instrument_ = nullptr;
+  /*! \brief The decoded instructions, in the order of the instructions of the executable. */
+  std::vector<DecodedInstr> decoded_instrs_;
+  /*! \brief The decoded call instructions. */
+  std::vector<DecodedCall> decoded_calls_;
+  /*!
+   * \brief Whether to run the call instructions from their decoded form, which is disabled by
+   * the subclasses which hook into RunInstrCall.
+   */
+  bool use_decoded_calls_{true};
 };
 
 void VirtualMachineImpl::LoadExecutable(ObjectPtr<VMExecutable> exec) {
@@ -478,17 +595,33 @@ void VirtualMachineImpl::Init(const std::vector<Device>& devices,
     this->devices.push_back(devices[i]);
     this->allocators.push_back(alloc);
   }
-  // Setup constant sections.
-  this->const_pool_.reserve(exec_->constants.size());
-  for (const auto& constant : exec_->constants) {
+  // Setup constant sections. The lazy constants are loaded and copied to the device on first use,
+  // so that the cold start only pays for the constants in use.
+  this->const_pool_.resize(exec_->constants.size());
+  this->const_unloaded_.assign(exec_->constants.size(), false);
+  for (size_t i = 0; i < exec_->constants.size(); ++i) {
+    if (exec_->IsLazyConstant(i)) {
+      this->const_unloaded_[i] = true;
+      ++this->num_unloaded_constants_;
+      continue;
+    }
+    const TVMRetValue& constant = exec_->constants[i];
     if (constant.type_code() != kTVMNDArrayHandle) {
-      this->const_pool_.push_back(constant);
+      this->const_pool_[i] = constant;
     } else {
-      this->const_pool_.push_back(ConvertRegToDevice(constant, devices[0], allocators[0]));
+      this->const_pool_[i] = ConvertRegToDevice(constant, devices[0], allocators[0]);
     }
   }
   // Setup function sections.
   this->InitFuncPool();
+  this->DecodeInstructions();
+}
+
+void VirtualMachineImpl::LoadConstant(Index index) {
+  this->const_pool_[index] =
+      ConvertRegToDevice(exec_->GetConstant(index), devices[0], allocators[0]);
+  this->const_unloaded_[index] = false;
+  --this->num_unloaded_constants_;
 }
 
 VMFuncInfo VirtualMachineImpl::LookupVMFuncInfo(const std::string& func_name) {
@@ -649,6 +782,10 @@ Optional<VMClosure> VirtualMachineImpl::GetClosureInternal(const String& func_na
       for (int64_t i = 0; i < finfo.num_args; ++i) {
         reg_file[i] = args[i + 1];
       }
+      // The compiled function reads the constant pool directly, so all the constants are loaded.
+      for (Index i = 0; this->num_unloaded_constants_ != 0; ++i) {
+        this->GetConstant(i);
+      }
       void* reg_anylist_handle = reg_file.data();
       void* const_anylist_handle = this->const_pool_.data();
       void* func_anylist_handle = this->func_pool_.data();
@@ -669,12 +806,14 @@ RegType VirtualMachineImpl::InvokeBytecode(Index gf_idx, const std::vector<RegTy
   ICHECK(gfunc.kind == VMFuncInfo::FuncKind::kVMFunc);
 
   // Get the curr instr which might be a potential caller.
-  Instruction curr_instr = exec_->GetInstruction(pc_);
+  Index caller_call_index = static_cast<size_t>(pc_) < decoded_instrs_.size()
+                               ? decoded_instrs_[pc_].call_index
+                               : -1;
   auto guard = PushFrame(this->pc_, gfunc);
   // Get new frame and set the caller info.
   VMFrame* curr_frame = frames_.back().get();
-  if (curr_instr.op == Opcode::Call) {
-    curr_frame->caller_return_register = curr_instr.dst;
+  if (caller_call_index >= 0) {
+    curr_frame->caller_return_register = decoded_calls_[caller_call_index].dst;
   }
 
   // load arguments to the register file
@@ -731,6 +870,142 @@ void VirtualMachineImpl::InitFuncPool() {
   }
 }
 
+void VirtualMachineImpl::DecodeInstructions() {
+  decoded_instrs_.clear();
+  decoded_calls_.clear();
+  decoded_instrs_.reserve(exec_->instr_offset.size());
+  for (size_t pc = 0; pc < exec_->instr_offset.size(); ++pc) {
+    Instruction instr = exec_->GetInstruction(pc);
+    DecodedInstr decoded;
+    switch (instr.op) {
+      case Opcode::Call: {
+        ICHECK_LT(static_cast<size_t>(instr.func_idx), this->func_pool_.size());
+        DecodedCall call;
+        ObjectRef func = func_pool_[instr.func_idx].AsObjectRef<ObjectRef>();
+        if (const auto* clo = func.as<VMClosureObj>()) {
+          call.callee = clo->impl;
+          call.is_closure = true;
+          call.nvtx_name = "RelaxVM: " + clo->func_name;
+        } else {
+          ICHECK(func.as<PackedFunc::ContainerType>() != nullptr)
+              << "Function expects a closure or PackedFunc ";
+          call.callee = Downcast<PackedFunc>(func);
+        }
+        call.trace_name = GetFuncName(instr.func_idx);
+        call.dst = instr.dst;
+        int args_begin_offset = call.is_closure ? 1 : 0;
+        call.values.resize(args_begin_offset + instr.num_args);
+        call.tcodes.resize(args_begin_offset + instr.num_args);
+        runtime::TVMArgsSetter setter(call.values.data(), call.tcodes.data());
+        if (call.is_closure) {
+          setter(0, static_cast<void*>(static_cast<VirtualMachine*>(this)));
+        }
+        for (Index i = 0; i < instr.num_args; ++i) {
+          Instruction::Arg arg = instr.args[i];
+          int arg_index = args_begin_offset + i;
+          switch (arg.kind()) {
+            case Instruction::ArgKind::kRegister: {
+              if (arg.value() < Instruction::kBeginSpecialReg) {
+                call.reg_args.emplace_back(arg_index, arg.value());
+              } else if (arg.value() == Instruction::kVoidRegister) {
+                setter(arg_index, nullptr);
+              } else {
+                ICHECK_EQ(arg.value(), Instruction::kVMRegister);
+                setter(arg_index, static_cast<void*>(static_cast<VirtualMachine*>(this)));
+              }
+              break;
+            }
+            case Instruction::ArgKind::kImmediate: {
+              setter(arg_index, arg.value());
+              break;
+            }
+            case Instruction::ArgKind::kConstIdx: {
+              if (const_unloaded_[arg.value()]) {
+                call.lazy_const_args.emplace_back(arg_index, arg.value());
+              } else {
+                setter(arg_index, this->const_pool_[arg.value()]);
+              }
+              break;
+            }
+            case Instruction::ArgKind::kFuncIdx: {
+              ICHECK_LT(static_cast<size_t>(arg.value()), this->func_pool_.size());
+              setter(arg_index, this->func_pool_[arg.value()]);
+              break;
+            }
+            default: {
+              LOG(FATAL) << "ValueError: Unknown argument kind: " << int(arg.kind());
+            }
+          }
+        }
+        decoded.kind = call.reg_args.empty() ? DecodedInstr::Kind::kCallStatic
+                                             : DecodedInstr::Kind::kCall;
+        decoded.call_index = decoded_calls_.size();
+        decoded_calls_.push_back(std::move(call));
+        break;
+      }
+      case Opcode::Ret: {
+        decoded.kind = DecodedInstr::Kind::kRet;
+        decoded.reg = instr.result;
+        break;
+      }
+      case Opcode::Goto: {
+        decoded.kind = DecodedInstr::Kind::kGoto;
+        decoded.offset = instr.pc_offset;
+        break;
+      }
+      case Opcode::If: {
+        ICHECK_GT(instr.false_offset, 1);
+        decoded.kind = DecodedInstr::Kind::kIf;
+        decoded.reg = instr.cond;
+        decoded.offset = instr.false_offset;
+        break;
+      }
+    }
+    decoded_instrs_.push_back(decoded);
+  }
+}
+
+template <bool kReadRegisters>
+void VirtualMachineImpl::RunDecodedCall(VMFrame* curr_frame, const DecodedCall& call) {
+  const TVMValue* values = call.values.data();
+  const int* tcodes = call.tcodes.data();
+  int num_args = static_cast<int>(call.values.size());
+  if (kReadRegisters) {
+    // Copy the template to the frame rather than filling it in place, since the callee may
+    // reenter the VM and run the same instruction while the arguments are in use.
+    if (curr_frame->call_arg_values.size() < call.values.size()) {
+      curr_frame->call_arg_values.resize(call.values.size());
+      curr_frame->call_arg_tcodes.resize(call.values.size());
+    }
+    std::copy(call.values.begin(), call.values.end(), curr_frame->call_arg_values.begin());
+    std::copy(call.tcodes.begin(), call.tcodes.end(), curr_frame->call_arg_tcodes.begin());
+    runtime::TVMArgsSetter setter(curr_frame->call_arg_values.data(),
+                                  curr_frame->call_arg_tcodes.data());
+    for (const std::pair<int, RegName>& reg_arg : call.reg_args) {
+      setter(reg_arg.first, curr_frame->register_file[reg_arg.second]);
+    }
+    values = curr_frame->call_arg_values.data();
+    tcodes = curr_frame->call_arg_tcodes.data();
+  }
+  TVMRetValue ret;
+  {
+    profiling::TraceScope trace_scope("vm", call.trace_name);
+    if (call.is_closure) {
+      NVTXScopedRange scope(call.nvtx_name);
+      call.callee.CallPacked(TVMArgs(values, tcodes, num_args), &ret);
+    } else {
+      call.callee.CallPacked(TVMArgs(values, tcodes, num_args), &ret);
+    }
+  }
+  // save the return value to the register
+  // saving to special register is a NOP
+  if (call.dst < Instruction::kBeginSpecialReg) {
+    ICHECK_LT(call.dst, curr_frame->register_file.size());
+    curr_frame->register_file[call.dst] = std::move(ret);
+  }
+  pc_++;
+}
+
 void VirtualMachineImpl::RunInstrCall(VMFrame* curr_frame, Instruction instr) {
   DLOG(INFO) << "\n  pc = " << pc_ << ", execute: " << GetFuncName(instr.func_idx);
   int args_begin_offset = instrument_ != nullptr ? 4 : 0;
@@ -758,7 +1033,7 @@ void VirtualMachineImpl::RunInstrCall(VMFrame* curr_frame, Instruction instr) {
         break;
       }
       case Instruction::ArgKind::kConstIdx: {
-        setter(arg_index, this->const_pool_[arg.value()]);
+        setter(arg_index, this->GetConstant(arg.value()));
         break;
       }
       case Instruction::ArgKind::kFuncIdx: {
@@ -778,6 +1053,7 @@ void VirtualMachineImpl::RunInstrCall(VMFrame* curr_frame, Instruction instr) {
   ICHECK_LT(static_cast<size_t>(instr.func_idx), this->func_pool_.size());
 
   if (instrument_ == nullptr) {
+    profiling::TraceScope trace_scope("vm", GetFuncName(instr.func_idx));
     this->InvokeClosurePacked(func_pool_[instr.func_idx], args, &ret);
   } else {
     // insert light-weight instrument callback
@@ -819,20 +1095,34 @@ void VirtualMachineImpl::RunInstrCall(VMFrame* curr_frame, Instruction instr) {
 
 void VirtualMachineImpl::RunLoop() {
   VMFrame* curr_frame = frames_.back().get();
+  const DecodedInstr* instrs = decoded_instrs_.data();
+  size_t num_instrs = decoded_instrs_.size();
 
   while (true) {
-    ICHECK_LT(static_cast<size_t>(pc_), exec_->instr_offset.size()) << "run into invalid section";
-    Instruction instr = exec_->GetInstruction(pc_);
-    switch (instr.op) {
-      case Opcode::Call: {
-        this->RunInstrCall(curr_frame, instr);
+    ICHECK_LT(static_cast<size_t>(pc_), num_instrs) << "run into invalid section";
+    const DecodedInstr& instr = instrs[pc_];
+    switch (instr.kind) {
+      case DecodedInstr::Kind::kCall: {
+        if (use_decoded_calls_ && instrument_ == nullptr) {
+          this->RunDecodedCall<true>(curr_frame, GetDecodedCall(instr.call_index));
+        } else {
+          this->RunInstrCall(curr_frame, exec_->GetInstruction(pc_));
+        }
         break;
       }
-      case Opcode::Ret: {
+      case DecodedInstr::Kind::kCallStatic: {
+        if (use_decoded_calls_ && instrument_ == nullptr) {
+          this->RunDecodedCall<false>(curr_frame, GetDecodedCall(instr.call_index));
+        } else {
+          this->RunInstrCall(curr_frame, exec_->GetInstruction(pc_));
+        }
+        break;
+      }
+      case DecodedInstr::Kind::kRet: {
         // If we have hit the point from which we started
         // running, we should return to the caller breaking
         // the dispatch loop.
-        return_value_ = ReadRegister(curr_frame, instr.result);
+        return_value_ = ReadRegister(curr_frame, instr.reg);
         RegName caller_return_register = curr_frame->caller_return_register;
         if (frames_.size() <= 1) {
           // directly return if no other frame in the call stack.
@@ -844,17 +1134,18 @@ void VirtualMachineImpl::RunLoop() {
         }
         return;
       }
-      case Opcode::Goto: {
-        pc_ += instr.pc_offset;
+      case DecodedInstr::Kind::kGoto: {
+        pc_ += instr.offset;
         break;
       }
-      case Opcode::If: {
-        int64_t cond_val = ReadRegister(curr_frame, instr.cond);
+      case DecodedInstr::Kind::kIf: {
+        int64_t cond_val = instr.reg < Instruction::kBeginSpecialReg
+                               ? curr_frame->register_file[instr.reg].operator int64_t()
+                               : ReadRegister(curr_frame, instr.reg).operator int64_t();
         if (cond_val != 0) {
           pc_++;
         } else {
-          ICHECK_GT(instr.false_offset, 1);
-          pc_ += instr.false_offset;
+          pc_ += instr.offset;
         }
         break;
       }
@@ -992,6 +1283,8 @@ PackedFunc VirtualMachineImpl::_LookupFunction(const String& name) {
  */
 class VirtualMachineProfiler : public VirtualMachineImpl {
  public:
+  VirtualMachineProfiler() { this->use_decoded_calls_ = false; }
+
   PackedFunc GetFunction(const String& name, const ObjectPtr<Object>& sptr_to_self) override {
     if (name == "profile") {
       return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
@@ -1064,7 +1357,7 @@ class VirtualMachineProfiler : public VirtualMachineImpl {
           auto reg = ReadRegister(curr_frame, arg.value());
           f_check_ndarray_arg(reg);
         } else if (arg.kind() == Instruction::ArgKind::kConstIdx) {
-          const auto& const_val = this->const_pool_[arg.value()];
+          const auto& const_val = this->GetConstant(arg.value());
           f_check_ndarray_arg(const_val);
         }
       }
@@ -33,12 +33,17 @@
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <cstring>
 #include <memory>
+#include <optional>
 #include <string>
+#include <tuple>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "../../support/arena.h"
+#include "../../support/lz4.h"
 #include "../../support/ring_buffer.h"
 #include "../../support/utils.h"
 #include "../object_internal.h"
@@ -716,39 +721,106 @@ RPCCode RPCEndpoint::HandleUntilReturnEvent(bool client_mode, RPCSession::FEncod
   return code;
 }
 
+void RPCEndpoint::FlushWriter() {
+  while (writer_.bytes_available() != 0) {
+    size_t n = writer_.ReadWithCallback(
+        [this](const void* data, size_t size) { return channel_->Send(data, size); },
+        writer_.bytes_available());
+    if (n == 0) break;
+  }
+}
+
+void RPCEndpoint::ReserveRequest(uint64_t packet_nbytes) {
+  CHECK(channel_) << "Expected connection to server " << name_
+                  << " to be active, but the connection was previously closed";
+  auto has_copy_from_remote = [this]() {
+    return std::any_of(inflight_requests_.begin(), inflight_requests_.end(),
+                       [](const InflightRequest& request) {
+                         return request.code == RPCCode::kCopyFromRemote;
+                       });
+  };
+  while (inflight_requests_.size() >= kMaxInflightRequests ||
+         (packet_nbytes > kMaxRequestBytesWithCopyInflight && has_copy_from_remote())) {
+    HandleNextReturn();
+  }
+}
+
+uint64_t RPCEndpoint::PushRequest(RPCCode code, RPCSession::FEncodeReturn encode_return,
+                                  void* to_bytes, uint64_t nbytes) {
+  // Send the request right away, so that the remote works on it while the next one is prepared.
+  FlushWriter();
+  if (encode_return == nullptr) {
+    encode_return = [](TVMArgs) {};
+  }
+  uint64_t request_id = next_request_id_++;
+  inflight_requests_.push_back(
+      InflightRequest{request_id, code, std::move(encode_return), to_bytes, nbytes});
+  return request_id;
+}
+
+void RPCEndpoint::HandleNextReturn() {
+  InflightRequest request = std::move(inflight_requests_.front());
+  inflight_requests_.pop_front();
+  try {
+    RPCCode code = HandleUntilReturnEvent(true, request.encode_return);
+    if (request.code == RPCCode::kCopyFromRemote) {
+      ICHECK(code == RPCCode::kCopyAck) << "code=" << RPCCodeToString(code);
+      handler_->ReadArray(static_cast<char*>(request.to_bytes), request.nbytes);
+      handler_->FinishCopyAck();
+    } else {
+      ICHECK(code == RPCCode::kReturn) << "code=" << RPCCodeToString(code);
+    }
+  } catch (const std::exception&) {
+    // Rethrown when the request is waited for, the returns of the later requests still follow.
+    request_errors_[request.id] = std::current_exception();
+  }
+}
+
+void RPCEndpoint::WaitRequest(uint64_t request_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ICHECK_LT(request_id, next_request_id_) << "Unknown RPC request " << request_id;
+  while (!inflight_requests_.empty() && inflight_requests_.front().id <= request_id) {
+    HandleNextReturn();
+  }
+  auto it = request_errors_.find(request_id);
+  if (it != request_errors_.end()) {
+    std::exception_ptr error = it->second;
+    request_errors_.erase(it);
+    std::rethrow_exception(error);
+  }
+}
+
 void RPCEndpoint::Init() {
   // callback to flush the writer.
-  auto flush_writer = [this]() {
-    while (writer_.bytes_available() != 0) {
-      size_t n = writer_.ReadWithCallback(
-          [this](const void* data, size_t size) { return channel_->Send(data, size); },
-          writer_.bytes_available());
-      if (n == 0) break;
-    }
-  };
+  auto flush_writer = [this]() { this->FlushWriter(); };
 
   // Event handler
   handler_ = std::make_shared<EventHandler>(&reader_, &writer_, name_, &remote_key_, flush_writer);
 
   // Quick function to for syscall remote.
   syscall_remote_ = PackedFunc([this](TVMArgs all_args, TVMRetValue* rv) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    RPCCode code = static_cast<RPCCode>(all_args[0].operator int());
-    TVMArgs args(all_args.values + 1, all_args.type_codes + 1, all_args.num_args - 1);
-
-    uint64_t packet_nbytes = sizeof(code) + handler_->PackedSeqGetNumBytes(
-                                                args.values, args.type_codes, args.num_args, true);
-
-    // All packet begins with packet nbytes
-    handler_->Write(packet_nbytes);
-    handler_->Write(code);
-    handler_->SendPackedSeq(args.values, args.type_codes, args.num_args, true);
-
-    code = HandleUntilReturnEvent(true, [rv](TVMArgs args) {
-      ICHECK_EQ(args.size(), 1);
-      *rv = args[0];
-    });
-    ICHECK(code == RPCCode::kReturn) << "code=" << static_cast<int>(code);
+    uint64_t request_id;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      RPCCode code = static_cast<RPCCode>(all_args[0].operator int());
+      TVMArgs args(all_args.values + 1, all_args.type_codes + 1, all_args.num_args - 1);
+
+      uint64_t packet_nbytes =
+          sizeof(code) +
+          handler_->PackedSeqGetNumBytes(args.values, args.type_codes, args.num_args, true);
+      ReserveRequest(packet_nbytes);
+
+      // All packet begins with packet nbytes
+      handler_->Write(packet_nbytes);
+      handler_->Write(code);
+      handler_->SendPackedSeq(args.values, args.type_codes, args.num_args, true);
+
+      request_id = PushRequest(code, [rv](TVMArgs args) {
+        ICHECK_EQ(args.size(), 1);
+        *rv = args[0];
+      });
+    }
+    WaitRequest(request_id);
   });
 }
 
@@ -828,30 +900,46 @@ int RPCEndpoint::ServerAsyncIOEventHandler(const std::string& in_bytes, int even
 }
 
 void RPCEndpoint::InitRemoteSession(TVMArgs args) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  RPCCode code = RPCCode::kInitServer;
-  std::string protocol_ver = kRPCProtocolVer;
-  uint64_t length = protocol_ver.length();
-
-  uint64_t packet_nbytes =
-      sizeof(code) + sizeof(length) + length +
-      handler_->PackedSeqGetNumBytes(args.values, args.type_codes, args.num_args, true);
+  uint64_t request_id;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    RPCCode code = RPCCode::kInitServer;
+    std::string protocol_ver = kRPCProtocolVer;
+    uint64_t length = protocol_ver.length();
 
-  // All packet begins with packet nbytes
-  handler_->Write(packet_nbytes);
-  handler_->Write(code);
-  handler_->Write(length);
-  handler_->WriteArray(protocol_ver.data(), length);
-  handler_->SendPackedSeq(args.values, args.type_codes, args.num_args, true);
+    uint64_t packet_nbytes =
+        sizeof(code) + sizeof(length) + length +
+        handler_->PackedSeqGetNumBytes(args.values, args.type_codes, args.num_args, true);
+    ReserveRequest(packet_nbytes);
 
-  code = HandleUntilReturnEvent(true, [](TVMArgs args) {});
-  ICHECK(code == RPCCode::kReturn) << "code=" << static_cast<int>(code);
+    // All packet begins with packet nbytes
+    handler_->Write(packet_nbytes);
+    handler_->Write(code);
+    handler_->Write(length);
+    handler_->WriteArray(protocol_ver.data(), length);
+    handler_->SendPackedSeq(args.values, args.type_codes, args.num_args, true);
+    request_id = PushRequest(code, nullptr);
+  }
+  WaitRequest(request_id);
 }
 
-// Get remote function with name
 void RPCEndpoint::CallFunc(RPCSession::PackedFuncHandle h, const TVMValue* arg_values,
                            const int* arg_type_codes, int num_args,
                            RPCSession::FEncodeReturn encode_return) {
+  WaitRequest(SendCallFunc(h, arg_values, arg_type_codes, num_args, encode_return));
+}
+
+void RPCEndpoint::CopyToRemote(void* from_bytes, DLTensor* to, uint64_t nbytes) {
+  WaitRequest(SendCopyToRemote(from_bytes, to, nbytes));
+}
+
+void RPCEndpoint::CopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes) {
+  WaitRequest(SendCopyFromRemote(from, to_bytes, nbytes));
+}
+
+uint64_t RPCEndpoint::SendCallFunc(RPCSession::PackedFuncHandle h, const TVMValue* arg_values,
+                                   const int* arg_type_codes, int num_args,
+                                   RPCSession::FEncodeReturn encode_return) {
   std::lock_guard<std::mutex> lock(mutex_);
 
   handler_->ValidateArguments(arg_values, arg_type_codes, num_args);
@@ -861,17 +949,16 @@ void RPCEndpoint::CallFunc(RPCSession::PackedFuncHandle h, const TVMValue* arg_v
   uint64_t packet_nbytes =
       sizeof(code) + sizeof(handle) +
       handler_->PackedSeqGetNumBytes(arg_values, arg_type_codes, num_args, true);
+  ReserveRequest(packet_nbytes);
 
   handler_->Write(packet_nbytes);
   handler_->Write(code);
   handler_->Write(handle);
   handler_->SendPackedSeq(arg_values, arg_type_codes, num_args, true);
-
-  code = HandleUntilReturnEvent(true, encode_return);
-  ICHECK(code == RPCCode::kReturn) << "code=" << RPCCodeToString(code);
+  return PushRequest(code, std::move(encode_return));
 }
 
-void RPCEndpoint::CopyToRemote(void* from_bytes, DLTensor* to, uint64_t nbytes) {
+uint64_t RPCEndpoint::SendCopyToRemote(void* from_bytes, DLTensor* to, uint64_t nbytes) {
   std::lock_guard<std::mutex> lock(mutex_);
   RPCCode code = RPCCode::kCopyToRemote;
 
@@ -882,16 +969,17 @@ void RPCEndpoint::CopyToRemote(void* from_bytes, DLTensor* to, uint64_t nbytes)
 
   uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(to, code, nbytes);
   uint64_t packet_nbytes = overhead + nbytes;
+  ReserveRequest(packet_nbytes);
 
   handler_->Write(packet_nbytes);
   handler_->Write(code);
   RPCReference::SendDLTensor(handler_, to);
   handler_->Write(nbytes);
   handler_->WriteArray(reinterpret_cast<char*>(from_bytes), nbytes);
-  ICHECK(HandleUntilReturnEvent(true, [](TVMArgs) {}) == RPCCode::kReturn);
+  return PushRequest(code, nullptr);
 }
 
-void RPCEndpoint::CopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes) {
+uint64_t RPCEndpoint::SendCopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes) {
   std::lock_guard<std::mutex> lock(mutex_);
   RPCCode code = RPCCode::kCopyFromRemote;
 
@@ -902,15 +990,13 @@ void RPCEndpoint::CopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes
 
   uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(from, code, nbytes);
   uint64_t packet_nbytes = overhead;
+  ReserveRequest(packet_nbytes);
 
   handler_->Write(packet_nbytes);
   handler_->Write(code);
   RPCReference::SendDLTensor(handler_, from);
   handler_->Write(nbytes);
-  ICHECK(HandleUntilReturnEvent(true, [](TVMArgs) {}) == RPCCode::kCopyAck);
-
-  handler_->ReadArray(reinterpret_cast<char*>(to_bytes), nbytes);
-  handler_->FinishCopyAck();
+  return PushRequest(code, nullptr, to_bytes, nbytes);
 }
 
 // SysCallEventHandler functions
@@ -1087,56 +1173,83 @@ class RPCClientSession : public RPCSession, public DeviceAPI {
     endpoint_->CallFunc(func, arg_values, arg_type_codes, num_args, fencode_return);
   }
 
+  std::function<void()> SubmitCallFunc(PackedFuncHandle func, const TVMValue* arg_values,
+                                       const int* arg_type_codes, int num_args,
+                                       FEncodeReturn fencode_return) final {
+    uint64_t request_id =
+        endpoint_->SendCallFunc(func, arg_values, arg_type_codes, num_args, fencode_return);
+    return [endpoint = endpoint_, request_id]() { endpoint->WaitRequest(request_id); };
+  }
+
   void CopyToRemote(void* local_from_bytes, DLTensor* remote_to, uint64_t nbytes) final {
-    RPCCode code = RPCCode::kCopyToRemote;
-    uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(remote_to, code, nbytes);
-    uint64_t rpc_max_size = GetRPCMaxTransferSize();
-    ICHECK_GT(rpc_max_size, overhead) << "CopyToRemote: Invalid block size!";
-    const uint64_t block_size = rpc_max_size - overhead;
-    uint64_t block_count = 0;
-    const uint64_t num_blocks = nbytes / block_size;
-    void* from_bytes;
-
-    for (block_count = 0; block_count < num_blocks; block_count++) {
-      remote_to->byte_offset = block_count * block_size;
-      from_bytes = reinterpret_cast<void*>(
-          (reinterpret_cast<uint8_t*>(local_from_bytes) + block_count * block_size));
-      endpoint_->CopyToRemote(from_bytes, remote_to, block_size);
+    const uint64_t block_size = GetCopyBlockSize(remote_to, RPCCode::kCopyToRemote, nbytes);
+    const bool encoded = UseEncodedTransfer();
+    std::vector<uint64_t> request_ids;
+    // The blocks that the remote is asked to copy from its cache, and whether it did.
+    std::vector<std::tuple<uint64_t, RPCContentHash, std::shared_ptr<bool>>> cached_blocks;
+    for (uint64_t offset = 0; offset < nbytes; offset += block_size) {
+      remote_to->byte_offset = offset;
+      void* from_bytes = static_cast<uint8_t*>(local_from_bytes) + offset;
+      uint64_t size = std::min(block_size, nbytes - offset);
+      if (!encoded) {
+        request_ids.push_back(endpoint_->SendCopyToRemote(from_bytes, remote_to, size));
+        continue;
+      }
+      RPCContentHash hash;
+      if (transfer_dedup_ && size >= kMinDedupBytes) {
+        hash = RPCHashContent(from_bytes, size);
+      }
+      if (hash.defined() && sent_blocks_.count(hash)) {
+        auto is_cached = std::make_shared<bool>(false);
+        request_ids.push_back(SendCachedBlock(remote_to, size, hash, is_cached));
+        cached_blocks.emplace_back(offset, hash, is_cached);
+      } else {
+        request_ids.push_back(SendEncodedBlock(from_bytes, remote_to, size, hash));
+      }
     }
-
-    const uint64_t remainder_bytes = nbytes % block_size;
-    if (remainder_bytes != 0) {
-      remote_to->byte_offset = block_count * block_size;
-      from_bytes = reinterpret_cast<void*>(
-          (reinterpret_cast<uint8_t*>(local_from_bytes) + block_count * block_size));
-      endpoint_->CopyToRemote(from_bytes, remote_to, remainder_bytes);
+    WaitRequests(request_ids);
+    // Send the blocks that the remote has evicted from its cache.
+    request_ids.clear();
+    for (const auto& block : cached_blocks) {
+      if (*std::get<2>(block)) continue;
+      uint64_t offset = std::get<0>(block);
+      remote_to->byte_offset = offset;
+      void* from_bytes = static_cast<uint8_t*>(local_from_bytes) + offset;
+      uint64_t size = std::min(block_size, nbytes - offset);
+      request_ids.push_back(SendEncodedBlock(from_bytes, remote_to, size, std::get<1>(block)));
     }
+    WaitRequests(request_ids);
   }
 
   void CopyFromRemote(DLTensor* remote_from, void* local_to_bytes, uint64_t nbytes) final {
-    RPCCode code = RPCCode::kCopyFromRemote;
-    uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(remote_from, code, nbytes);
-    uint64_t rpc_max_size = GetRPCMaxTransferSize();
-    ICHECK_GT(rpc_max_size, overhead) << "CopyFromRemote: Invalid block size!";
-    const uint64_t block_size = rpc_max_size - overhead;
-    uint64_t block_count = 0;
-    const uint64_t num_blocks = nbytes / block_size;
-    void* to_bytes;
-
-    for (block_count = 0; block_count < num_blocks; block_count++) {
-      remote_from->byte_offset = block_count * block_size;
-      to_bytes = reinterpret_cast<void*>(
-          (reinterpret_cast<uint8_t*>(local_to_bytes) + block_count * block_size));
-      endpoint_->CopyFromRemote(remote_from, to_bytes, block_size);
+    const uint64_t block_size = GetCopyBlockSize(remote_from, RPCCode::kCopyFromRemote, nbytes);
+    const bool encoded = UseEncodedTransfer() && transfer_codec_ != RPCTransferCodec::kRaw;
+    std::vector<uint64_t> request_ids;
+    // The errors of the blocks that cannot be decoded, which are not thrown while the return is
+    // handled by the endpoint.
+    auto decode_error = std::make_shared<std::string>();
+    for (uint64_t offset = 0; offset < nbytes; offset += block_size) {
+      remote_from->byte_offset = offset;
+      void* to_bytes = static_cast<uint8_t*>(local_to_bytes) + offset;
+      uint64_t size = std::min(block_size, nbytes - offset);
+      if (encoded) {
+        request_ids.push_back(SendEncodedBlockRequest(remote_from, to_bytes, size, decode_error));
+      } else {
+        request_ids.push_back(endpoint_->SendCopyFromRemote(remote_from, to_bytes, size));
+      }
     }
+    WaitRequests(request_ids);
+    ICHECK(decode_error->empty()) << "CopyFromRemote: " << *decode_error;
+  }
 
-    const uint64_t remainder_bytes = nbytes % block_size;
-    if (remainder_bytes != 0) {
-      remote_from->byte_offset = block_count * block_size;
-      to_bytes = reinterpret_cast<void*>(
-          (reinterpret_cast<uint8_t*>(local_to_bytes) + block_count * block_size));
-      endpoint_->CopyFromRemote(remote_from, to_bytes, remainder_bytes);
-    }
+  /*!
+   * \brief Set how the tensors are transferred.
+   * \param codec The codec that the transfers are compressed with.
+   * \param dedup Whether to skip sending the blocks that the server has already received.
+   */
+  void SetTransferOptions(RPCTransferCodec codec, bool dedup) {
+    transfer_codec_ = codec;
+    transfer_dedup_ = dedup;
   }
 
   void FreeHandle(void* handle, int type_code) final {
@@ -1212,34 +1325,182 @@ class RPCClientSession : public RPCSession, public DeviceAPI {
 
  private:
   uint64_t GetRPCMaxTransferSize() {
-    if (rpc_chunk_max_size_bytes_ > 0) {
-      return (uint64_t)rpc_chunk_max_size_bytes_;
+    if (rpc_chunk_max_size_bytes_ != 0) {
+      return rpc_chunk_max_size_bytes_;
     }
 
     PackedFuncHandle rpc_func = GetFunction("tvm.rpc.server.GetCRTMaxPacketSize");
     if (rpc_func == nullptr) {
-      rpc_chunk_max_size_bytes_ = (int64_t)kRPCMaxTransferSizeBytesDefault;
+      rpc_chunk_max_size_bytes_ = kRPCMaxTransferSizeBytesDefault;
     } else {
       CallFunc(rpc_func, nullptr, nullptr, 0, [this](TVMArgs args) {
         // Use args[1] as return value, args[0] is tcode
         // Look at RPCWrappedFunc in src/runtime/rpc/rpc_module.cc
-        rpc_chunk_max_size_bytes_ = (int64_t)args[1];
-        ICHECK_GT(rpc_chunk_max_size_bytes_, 0)
-            << "RPC max transfer size is <= 0! (remote value = " << rpc_chunk_max_size_bytes_
-            << ")";
+        int64_t max_size = args[1];
+        ICHECK_GT(max_size, 0) << "RPC max transfer size is <= 0! (remote value = " << max_size
+                               << ")";
+        rpc_chunk_max_size_bytes_ = static_cast<uint64_t>(max_size);
       });
     }
-    return (uint64_t)rpc_chunk_max_size_bytes_;
+    return rpc_chunk_max_size_bytes_;
+  }
+
+  /*! \brief The smallest blocks that are deduplicated, as smaller ones are cheaper to resend. */
+  static constexpr uint64_t kMinDedupBytes = 64 << 10;
+
+  // Whether the copies are encoded, which is only done when the server supports it.
+  bool UseEncodedTransfer() {
+    // The encoded blocks are little endian like the plain copies, which is not implemented for
+    // big endian clients.
+    if (!DMLC_IO_NO_ENDIAN_SWAP) return false;
+    if (transfer_codec_ == RPCTransferCodec::kRaw && !transfer_dedup_) return false;
+    // The packets of the encoded blocks are a bit larger than the ones of the plain copies.
+    if (GetRPCMaxTransferSize() != kRPCMaxTransferSizeBytesDefault) return false;
+    if (!transfer_funcs_found_.has_value()) {
+      copy_to_remote_encoded_ = GetFunction(kRPCCopyToRemoteEncoded);
+      copy_to_remote_cached_ = GetFunction(kRPCCopyToRemoteCached);
+      copy_from_remote_encoded_ = GetFunction(kRPCCopyFromRemoteEncoded);
+      transfer_funcs_found_ = copy_to_remote_encoded_ != nullptr &&
+                              copy_to_remote_cached_ != nullptr &&
+                              copy_from_remote_encoded_ != nullptr;
+      if (!transfer_funcs_found_.value()) {
+        LOG(INFO) << "The RPC server does not support encoded transfers, sending the raw bytes";
+      }
+    }
+    return transfer_funcs_found_.value();
+  }
+
+  // Send a block to copy to the remote, compressed when it makes it smaller, and cached by the
+  // remote when the hash is defined.
+  uint64_t SendEncodedBlock(void* from_bytes, DLTensor* remote_to, uint64_t nbytes,
+                            const RPCContentHash& hash) {
+    RPCTransferCodec codec = RPCTransferCodec::kRaw;
+    std::string compressed;
+    if (transfer_codec_ == RPCTransferCodec::kLZ4) {
+      support::LZ4Compress(from_bytes, nbytes, &compressed);
+      if (compressed.size() < nbytes) codec = RPCTransferCodec::kLZ4;
+    }
+    if (codec == RPCTransferCodec::kRaw && !hash.defined()) {
+      return endpoint_->SendCopyToRemote(from_bytes, remote_to, nbytes);
+    }
+    if (hash.defined()) {
+      sent_blocks_.insert(hash);
+    }
+    TVMByteArray payload;
+    payload.data = codec == RPCTransferCodec::kRaw ? static_cast<const char*>(from_bytes)
+                                                    : compressed.data();
+    payload.size = codec == RPCTransferCodec::kRaw ? nbytes : compressed.size();
+    TVMValue values[6];
+    int type_codes[6];
+    TVMArgsSetter setter(values, type_codes);
+    setter(0, remote_to);
+    setter(1, static_cast<int64_t>(nbytes));
+    setter(2, static_cast<int>(codec));
+    setter(3, payload);
+    setter(4, static_cast<int64_t>(hash.high));
+    setter(5, static_cast<int64_t>(hash.low));
+    return endpoint_->SendCallFunc(copy_to_remote_encoded_, values, type_codes, 6, nullptr);
+  }
+
+  // Ask the remote to copy a block from its cache, and set whether it did.
+  uint64_t SendCachedBlock(DLTensor* remote_to, uint64_t nbytes, const RPCContentHash& hash,
+                           std::shared_ptr<bool> is_cached) {
+    TVMValue values[4];
+    int type_codes[4];
+    TVMArgsSetter setter(values, type_codes);
+    setter(0, remote_to);
+    setter(1, static_cast<int64_t>(nbytes));
+    setter(2, static_cast<int64_t>(hash.high));
+    setter(3, static_cast<int64_t>(hash.low));
+    return endpoint_->SendCallFunc(copy_to_remote_cached_, values, type_codes, 4,
+                                   [is_cached](TVMArgs args) { *is_cached = args[1]; });
+  }
+
+  // Ask the remote for an encoded block, which is decoded to to_bytes when it is received.
+  uint64_t SendEncodedBlockRequest(DLTensor* remote_from, void* to_bytes, uint64_t nbytes,
+                                   std::shared_ptr<std::string> decode_error) {
+    TVMValue values[3];
+    int type_codes[3];
+    TVMArgsSetter setter(values, type_codes);
+    setter(0, remote_from);
+    setter(1, static_cast<int64_t>(nbytes));
+    setter(2, static_cast<int>(transfer_codec_));
+    auto decode = [to_bytes, nbytes, decode_error](TVMArgs args) {
+      auto* payload = static_cast<TVMByteArray*>(args.values[1].v_handle);
+      bool valid = false;
+      if (args.type_codes[1] == kTVMBytes && payload->size != 0) {
+        // The first byte is the codec of the rest.
+        auto codec = static_cast<RPCTransferCodec>(payload->data[0]);
+        const char* data = payload->data + 1;
+        size_t size = payload->size - 1;
+        if (codec == RPCTransferCodec::kRaw && size == nbytes) {
+          std::memcpy(to_bytes, data, nbytes);
+          valid = true;
+        } else if (codec == RPCTransferCodec::kLZ4) {
+          valid = support::LZ4Decompress(data, size, to_bytes, nbytes);
+        }
+      }
+      if (!valid && decode_error->empty()) {
+        *decode_error = "Cannot decode a block of " + std::to_string(nbytes) + " bytes";
+      }
+    };
+    return endpoint_->SendCallFunc(copy_from_remote_encoded_, values, type_codes, 3, decode);
+  }
+
+  /*!
+   * \brief The size of the blocks a copy is split into. The blocks are in flight together, so
+   *  that the remote copies a block while the next one is transferred, and neither side buffers
+   *  the whole array.
+   */
+  static constexpr uint64_t kCopyBlockBytes = 1 << 20;
+
+  uint64_t GetCopyBlockSize(DLTensor* tensor, RPCCode code, uint64_t nbytes) {
+    uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(tensor, code, nbytes);
+    uint64_t rpc_max_size = GetRPCMaxTransferSize();
+    ICHECK_GT(rpc_max_size, overhead) << RPCCodeToString(code) << ": Invalid block size!";
+    return std::min(rpc_max_size - overhead, kCopyBlockBytes);
+  }
+
+  // Wait for all the requests, and rethrow the first error.
+  void WaitRequests(const std::vector<uint64_t>& request_ids) {
+    std::exception_ptr error;
+    for (uint64_t request_id : request_ids) {
+      try {
+        endpoint_->WaitRequest(request_id);
+      } catch (const std::exception&) {
+        if (error == nullptr) error = std::current_exception();
+      }
+    }
+    if (error != nullptr) std::rethrow_exception(error);
   }
 
   std::shared_ptr<RPCEndpoint> endpoint_;
-  int64_t rpc_chunk_max_size_bytes_ = -1;
+  // The max transfer size of the remote, 0 until it is known.
+  uint64_t rpc_chunk_max_size_bytes_ = 0;
+  // The transfer options.
+  RPCTransferCodec transfer_codec_{RPCTransferCodec::kRaw};
+  bool transfer_dedup_{false};
+  // Whether the server functions of the encoded transfers are found, unset until looked up.
+  std::optional<bool> transfer_funcs_found_;
+  PackedFuncHandle copy_to_remote_encoded_{nullptr};
+  PackedFuncHandle copy_to_remote_cached_{nullptr};
+  PackedFuncHandle copy_from_remote_encoded_{nullptr};
+  // The hashes of the blocks sent to be cached by the remote.
+  std::unordered_set<RPCContentHash, RPCContentHasher> sent_blocks_;
 };
 
 std::shared_ptr<RPCSession> CreateClientSession(std::shared_ptr<RPCEndpoint> endpoint) {
   return std::make_shared<RPCClientSession>(endpoint);
 }
 
+void SetClientSessionTransferOptions(const std::shared_ptr<RPCSession>& sess,
+                                     RPCTransferCodec codec, bool dedup) {
+  auto* client_sess = dynamic_cast<RPCClientSession*>(sess.get());
+  CHECK(client_sess != nullptr)
+      << "ValueError: The transfer options can only be set on the client of a remote session";
+  client_sess->SetTransferOptions(codec, dedup);
+}
+
 uint64_t RemoteCopyCalculatePacketOverheadSize(DLTensor* tensor, RPCCode code, uint64_t nbytes) {
   uint64_t shape_bytes = tensor->ndim * sizeof(int64_t);
   uint64_t to_data = reinterpret_cast<uint64_t>(static_cast<uint8_t*>(tensor->data));
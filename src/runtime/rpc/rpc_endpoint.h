@@ -26,9 +26,12 @@
 
 #include <tvm/runtime/packed_func.h>
 
+#include <deque>
+#include <exception>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 #include "../../support/ring_buffer.h"
@@ -36,6 +39,7 @@
 #include "rpc_channel.h"
 #include "rpc_channel_logger.h"
 #include "rpc_session.h"
+#include "rpc_transfer.h"
 
 namespace tvm {
 namespace runtime {
@@ -163,6 +167,48 @@ class RPCEndpoint {
    */
   void CopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes);
 
+  /*!
+   * \brief Send a call to a remote function without waiting for its return, so that several
+   *  requests can be in flight over the connection.
+   *
+   *  The remote handles the requests in the order they are sent, so the returns arrive in the
+   *  same order and are matched with the requests by their ids.
+   *
+   * \param handle The function handle
+   * \param arg_values The argument values.
+   * \param arg_type_codes the type codes of the argument.
+   * \param num_args Number of arguments.
+   * \param encode_return The function to receive return value encodings, which must stay valid
+   *  until the request is waited for.
+   * \return The id of the request, to be passed to WaitRequest.
+   */
+  uint64_t SendCallFunc(RPCSession::PackedFuncHandle handle, const TVMValue* arg_values,
+                        const int* arg_type_codes, int num_args,
+                        RPCSession::FEncodeReturn encode_return);
+  /*!
+   * \brief Send a copy of bytes into remote array content without waiting for its completion.
+   * \param from_bytes The source host data, which is sent before the function returns.
+   * \param to The target array.
+   * \param nbytes The size of the memory in bytes.
+   * \return The id of the request, to be passed to WaitRequest.
+   */
+  uint64_t SendCopyToRemote(void* from_bytes, DLTensor* to, uint64_t nbytes);
+  /*!
+   * \brief Send a copy of bytes from remote array content without waiting for its completion.
+   * \param from The source array.
+   * \param to_bytes The target host data, which must stay valid until the request is waited for.
+   * \param nbytes The size of the memory in bytes.
+   * \return The id of the request, to be passed to WaitRequest.
+   */
+  uint64_t SendCopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes);
+  /*!
+   * \brief Wait for the completion of a request, handling the returns of the requests sent before
+   *  it. Each request must be waited for once.
+   * \param request_id The id of the request.
+   * \throw The error of the request if it failed on the remote.
+   */
+  void WaitRequest(uint64_t request_id);
+
   /*!
    * \brief Call a remote defined system function with arguments.
    * \param fcode The function code.
@@ -191,6 +237,44 @@ class RPCEndpoint {
   RPCCode HandleUntilReturnEvent(bool client_mode, RPCSession::FEncodeReturn setreturn);
   // Initalization
   void Init();
+  // Flush the written bytes to the channel.
+  void FlushWriter();
+  // Make room for a request of the given size before it is written, see kMaxInflightRequests.
+  void ReserveRequest(uint64_t packet_nbytes);
+  // Flush the request that has been written, and record it as in flight.
+  uint64_t PushRequest(RPCCode code, RPCSession::FEncodeReturn encode_return,
+                       void* to_bytes = nullptr, uint64_t nbytes = 0);
+  // Handle the return of the oldest request in flight.
+  void HandleNextReturn();
+
+  /*! \brief A request that is waiting for its return. */
+  struct InflightRequest {
+    uint64_t id;
+    RPCCode code;
+    // The function to receive the return values of a call.
+    RPCSession::FEncodeReturn encode_return;
+    // The destination of a copy from the remote.
+    void* to_bytes;
+    uint64_t nbytes;
+  };
+  /*!
+   * \brief The maximum number of requests in flight. A request is only sent after the returns
+   *  of the earlier ones are handled, so that the remote is not blocked on sending the returns
+   *  while this endpoint is blocked on sending a request.
+   */
+  static constexpr size_t kMaxInflightRequests = 64;
+  /*!
+   * \brief Requests larger than this are not sent while the large returns of copies from the
+   *  remote are in flight, as each side could block on sending to the other.
+   */
+  static constexpr uint64_t kMaxRequestBytesWithCopyInflight = 64 << 10;
+
+  // The requests in flight, in the order they are sent.
+  std::deque<InflightRequest> inflight_requests_;
+  // The id of the next request.
+  uint64_t next_request_id_{0};
+  // The errors of the completed requests that have not been waited for.
+  std::unordered_map<uint64_t, std::exception_ptr> request_errors_;
   // Internal channel.
   std::unique_ptr<RPCChannel> channel_;
 
@@ -217,6 +301,18 @@ class RPCEndpoint {
  */
 std::shared_ptr<RPCSession> CreateClientSession(std::shared_ptr<RPCEndpoint> endpoint);
 
+/*!
+ * \brief Set how an RPC client session transfers the tensors.
+ *
+ *  The options only take effect when the server supports them, otherwise the raw bytes are sent.
+ *
+ * \param sess The session, which is created by CreateClientSession.
+ * \param codec The codec that the transfers are compressed with.
+ * \param dedup Whether to skip sending the blocks of tensors that the server has already received.
+ */
+void SetClientSessionTransferOptions(const std::shared_ptr<RPCSession>& sess,
+                                     RPCTransferCodec codec, bool dedup);
+
 // implementation of inline functions
 template <typename... Args>
 inline TVMRetValue RPCEndpoint::SysCallRemote(RPCCode code, Args&&... args) {
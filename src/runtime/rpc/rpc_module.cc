@@ -30,6 +30,7 @@
 #include <cstring>
 #include <memory>
 #include <thread>
+#include <unordered_map>
 #if defined(_M_X64) || defined(__x86_64__)
 #include <immintrin.h>
 #endif
@@ -86,9 +87,72 @@ class RPCWrappedFunc : public Object {
   RPCWrappedFunc(void* handle, std::shared_ptr<RPCSession> sess) : handle_(handle), sess_(sess) {}
 
   void operator()(TVMArgs args, TVMRetValue* rv) const {
-    std::vector<TVMValue> values(args.values, args.values + args.size());
-    std::vector<int> type_codes(args.type_codes, args.type_codes + args.size());
+    RemoteArgs remote_args = ToRemoteArgs(args);
+    auto set_return = [this, rv](TVMArgs args) { this->WrapRemoteReturnToValue(args, rv); };
+    sess_->CallFunc(handle_, remote_args.values.data(), remote_args.type_codes.data(),
+                    args.size(), set_return);
+  }
+
+  /*!
+   * \brief Send a call without waiting for its return.
+   * \param self The wrapped function, which is kept alive by the returned function.
+   * \param args The arguments.
+   * \return A function that waits for the call and returns its return value.
+   */
+  static PackedFunc Submit(std::shared_ptr<RPCWrappedFunc> self, TVMArgs args) {
+    RemoteArgs remote_args = self->ToRemoteArgs(args);
+    auto rv = std::make_shared<TVMRetValue>();
+    // Only hold a weak reference in the pending request, as the session owns the request and
+    // the function owns the session.
+    std::weak_ptr<RPCWrappedFunc> weak_self = self;
+    auto set_return = [weak_self, rv](TVMArgs args) {
+      if (std::shared_ptr<RPCWrappedFunc> self = weak_self.lock()) {
+        self->WrapRemoteReturnToValue(args, rv.get());
+      }
+    };
+    auto fwait = std::make_shared<std::function<void()>>(
+        self->sess_->SubmitCallFunc(self->handle_, remote_args.values.data(),
+                                    remote_args.type_codes.data(), args.size(), set_return));
+    return PackedFunc([self, fwait, rv](TVMArgs args, TVMRetValue* ret) {
+      if (*fwait != nullptr) {
+        // Only the first call waits, and rethrows the error of the call if any.
+        std::function<void()> f = std::move(*fwait);
+        *fwait = nullptr;
+        f();
+      }
+      *ret = *rv;
+    });
+  }
+
+  ~RPCWrappedFunc() {
+    try {
+      sess_->FreeHandle(handle_, kTVMPackedFuncHandle);
+    } catch (const Error& e) {
+      // fault tolerance to remote close
+    }
+  }
+
+ private:
+  /*! \brief The arguments converted to their remote variant. */
+  struct RemoteArgs {
+    std::vector<TVMValue> values;
+    std::vector<int> type_codes;
+    // The remote views of the tensors.
     std::vector<std::unique_ptr<DLTensor>> temp_dltensors;
+  };
+
+  // remote function handle
+  void* handle_{nullptr};
+  // pointer to the session.
+  std::shared_ptr<RPCSession> sess_;
+
+  // convert the arguments to their remote variant.
+  RemoteArgs ToRemoteArgs(TVMArgs args) const {
+    RemoteArgs remote_args;
+    std::vector<TVMValue>& values = remote_args.values;
+    std::vector<int>& type_codes = remote_args.type_codes;
+    values.assign(args.values, args.values + args.size());
+    type_codes.assign(args.type_codes, args.type_codes + args.size());
 
     // scan and check whether we need rewrite these arguments
     // to their remote variant.
@@ -111,7 +175,7 @@ class RPCWrappedFunc : public Object {
           dptr->device = RemoveSessMask(dptr->device);
           dptr->data = static_cast<RemoteSpace*>(dptr->data)->data;
           values[i].v_handle = dptr.get();
-          temp_dltensors.emplace_back(std::move(dptr));
+          remote_args.temp_dltensors.emplace_back(std::move(dptr));
           break;
         }
         case kDLDevice: {
@@ -125,24 +189,9 @@ class RPCWrappedFunc : public Object {
         }
       }
     }
-    auto set_return = [this, rv](TVMArgs args) { this->WrapRemoteReturnToValue(args, rv); };
-    sess_->CallFunc(handle_, values.data(), type_codes.data(), args.size(), set_return);
-  }
-
-  ~RPCWrappedFunc() {
-    try {
-      sess_->FreeHandle(handle_, kTVMPackedFuncHandle);
-    } catch (const Error& e) {
-      // fault tolerance to remote close
-    }
+    return remote_args;
   }
 
- private:
-  // remote function handle
-  void* handle_{nullptr};
-  // pointer to the session.
-  std::shared_ptr<RPCSession> sess_;
-
   // unwrap a remote value to the underlying handle.
   void* UnwrapRemoteValueToHandle(const TVMArgValue& arg) const;
   // wrap a remote return via Set
@@ -231,6 +280,24 @@ class RPCModuleNode final : public ModuleNode {
     remote_import_module_(GetRef<Module>(this), other);
   }
 
+  /*!
+   * \brief Send a call to a global function of the remote without waiting for its return.
+   * \param name The name of the function.
+   * \param args The arguments.
+   * \return A function that waits for the call and returns its return value.
+   */
+  PackedFunc SubmitCall(const std::string& name, TVMArgs args) {
+    CHECK(module_handle_ == nullptr)
+        << "ValueError: Only the global functions of an RPC session can be submitted";
+    auto it = submitted_funcs_.find(name);
+    if (it == submitted_funcs_.end()) {
+      RPCSession::PackedFuncHandle handle = sess_->GetFunction(name);
+      CHECK(handle != nullptr) << "ValueError: Cannot find remote function " << name;
+      it = submitted_funcs_.emplace(name, std::make_shared<RPCWrappedFunc>(handle, sess_)).first;
+    }
+    return RPCWrappedFunc::Submit(it->second, args);
+  }
+
   const std::shared_ptr<RPCSession>& sess() { return sess_; }
 
   void* module_handle() const { return module_handle_; }
@@ -254,6 +321,8 @@ class RPCModuleNode final : public ModuleNode {
   void* module_handle_{nullptr};
   // The local channel
   std::shared_ptr<RPCSession> sess_;
+  // The remote functions that calls are submitted to, so that they are only looked up once.
+  std::unordered_map<std::string, std::shared_ptr<RPCWrappedFunc>> submitted_funcs_;
   // remote function to get time evaluator
   TypedPackedFunc<PackedFunc(Optional<Module>, std::string, int, int, int, int, int, int, int, int,
                              int, std::string)>
@@ -450,6 +519,15 @@ TVM_REGISTER_GLOBAL("rpc.ImportRemoteModule").set_body_typed([](Module parent, M
   static_cast<RPCModuleNode*>(parent.operator->())->ImportModule(child);
 });
 
+TVM_REGISTER_GLOBAL("rpc.SubmitRemoteCall").set_body([](TVMArgs args, TVMRetValue* rv) {
+  Module m = args[0];
+  std::string tkey = m->type_key();
+  ICHECK_EQ(tkey, "rpc");
+  std::string name = args[1];
+  *rv = static_cast<RPCModuleNode*>(m.operator->())
+            ->SubmitCall(name, TVMArgs(args.values + 2, args.type_codes + 2, args.size() - 2));
+});
+
 TVM_REGISTER_GLOBAL("rpc.SessTableIndex").set_body([](TVMArgs args, TVMRetValue* rv) {
   Module m = args[0];
   std::string tkey = m->type_key();
@@ -457,6 +535,14 @@ TVM_REGISTER_GLOBAL("rpc.SessTableIndex").set_body([](TVMArgs args, TVMRetValue*
   *rv = static_cast<RPCModuleNode*>(m.operator->())->sess()->table_index();
 });
 
+TVM_REGISTER_GLOBAL("rpc.SetTransferOptions")
+    .set_body_typed([](Module m, std::string codec, bool dedup) {
+      std::string tkey = m->type_key();
+      ICHECK_EQ(tkey, "rpc");
+      SetClientSessionTransferOptions(static_cast<RPCModuleNode*>(m.operator->())->sess(),
+                                      RPCTransferCodecFromString(codec), dedup);
+    });
+
 TVM_REGISTER_GLOBAL("tvm.rpc.NDArrayFromRemoteOpaqueHandle")
     .set_body_typed([](Module mod, void* remote_array, DLTensor* template_tensor, Device dev,
                        void* ndarray_handle) -> NDArray {
@@ -27,6 +27,8 @@
 #include <tvm/runtime/packed_func.h>
 
 #include <array>
+#include <exception>
+#include <functional>
 #include <mutex>
 
 namespace tvm {
@@ -41,6 +43,18 @@ void RPCSession::SendException(FAsyncCallback callback, const char* msg) {
   callback(RPCCode::kException, TVMArgs(&value, &tcode, 1));
 }
 
+std::function<void()> RPCSession::SubmitCallFunc(PackedFuncHandle func, const TVMValue* arg_values,
+                                                 const int* arg_type_codes, int num_args,
+                                                 FEncodeReturn fencode_return) {
+  try {
+    this->CallFunc(func, arg_values, arg_type_codes, num_args, fencode_return);
+  } catch (const std::exception&) {
+    std::exception_ptr error = std::current_exception();
+    return [error]() { std::rethrow_exception(error); };
+  }
+  return []() {};
+}
+
 void RPCSession::AsyncCallFunc(PackedFuncHandle func, const TVMValue* arg_values,
                                const int* arg_type_codes, int num_args, FAsyncCallback callback) {
   try {
@@ -125,6 +125,26 @@ class RPCSession {
                         const int* arg_type_codes, int num_args,
                         const FEncodeReturn& fencode_return) = 0;
 
+  /*!
+   * \brief Send a call into a remote Packed function without waiting for its return, so that
+   *  several calls can be in flight.
+   *
+   *  The calling convention is the same as CallFunc. The sessions that forward the calls to a
+   *  remote endpoint pipeline them, the others make the call before returning.
+   *
+   * \param func The function handle.
+   * \param arg_values The argument values, which can be released once the function returns.
+   * \param arg_type_codes the type codes of the argument.
+   * \param num_args Number of arguments.
+   * \param fencode_return The function to set the return value, called at the latest by the
+   *  wait function.
+   * \return The function to wait for the return of the call, which rethrows its error if any.
+   *  It must be called once.
+   */
+  virtual std::function<void()> SubmitCallFunc(PackedFuncHandle func, const TVMValue* arg_values,
+                                               const int* arg_type_codes, int num_args,
+                                               FEncodeReturn fencode_return);
+
   /*!
    * \brief Copy bytes into remote array content.
    * \param local_from_bytes The source host data.
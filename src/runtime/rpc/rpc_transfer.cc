@@ -0,0 +1,227 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file rpc_transfer.cc
+ * \brief The server side of the compressed and deduplicated tensor transfers of RPC.
+ */
+#include "rpc_transfer.h"
+
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/registry.h>
+#include <tvm/runtime/serializer.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "../../support/lz4.h"
+
+namespace tvm {
+namespace runtime {
+
+RPCTransferCodec RPCTransferCodecFromString(const std::string& name) {
+  if (name == "none") return RPCTransferCodec::kRaw;
+  CHECK_EQ(name, "lz4") << "ValueError: Unknown RPC transfer codec " << name
+                        << ", the supported codecs are \"none\" and \"lz4\"";
+  return RPCTransferCodec::kLZ4;
+}
+
+namespace {
+
+/*!
+ * \brief The blocks written by the clients, by the hash of their content, so that a client does
+ *  not send them again. The least recently used blocks are evicted when the cache is full.
+ */
+class RPCTransferCache {
+ public:
+  static RPCTransferCache* Global() {
+    static RPCTransferCache* inst = new RPCTransferCache();
+    return inst;
+  }
+
+  /*!
+   * \brief Get a cached block.
+   * \return The block, or nullptr when it is not cached.
+   */
+  std::shared_ptr<const std::string> Get(const RPCContentHash& hash, uint64_t nbytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = blocks_.find(hash);
+    if (it == blocks_.end() || it->second->second->size() != nbytes) return nullptr;
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+  }
+
+  /*! \brief Cache a block. */
+  void Put(const RPCContentHash& hash, std::string data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (data.size() > max_bytes_ || blocks_.count(hash)) return;
+    total_bytes_ += data.size();
+    lru_.emplace_front(hash, std::make_shared<const std::string>(std::move(data)));
+    blocks_[hash] = lru_.begin();
+    while (total_bytes_ > max_bytes_) {
+      total_bytes_ -= lru_.back().second->size();
+      blocks_.erase(lru_.back().first);
+      lru_.pop_back();
+    }
+  }
+
+ private:
+  RPCTransferCache() {
+    if (const char* env = std::getenv("TVM_RPC_TRANSFER_CACHE_BYTES")) {
+      max_bytes_ = std::strtoull(env, nullptr, 10);
+    }
+  }
+
+  using Entry = std::pair<RPCContentHash, std::shared_ptr<const std::string>>;
+
+  std::mutex mutex_;
+  // The blocks, from the most to the least recently used.
+  std::list<Entry> lru_;
+  std::unordered_map<RPCContentHash, std::list<Entry>::iterator, RPCContentHasher> blocks_;
+  uint64_t total_bytes_{0};
+  // 256 MiB by default.
+  uint64_t max_bytes_{uint64_t(256) << 20};
+};
+
+/*! \brief View the bytes of a tensor at its byte offset as a flat tensor of bytes. */
+struct FlatBytes {
+  FlatBytes(void* data, Device device, uint64_t byte_offset, uint64_t nbytes)
+      : shape(static_cast<int64_t>(nbytes)) {
+    tensor.data = data;
+    tensor.device = device;
+    tensor.ndim = 1;
+    tensor.dtype = DLDataType{kDLUInt, 8, 1};
+    tensor.shape = &shape;
+    tensor.strides = nullptr;
+    tensor.byte_offset = byte_offset;
+  }
+  int64_t shape;
+  DLTensor tensor;
+};
+
+// Swap the bytes of the elements to the little endian order of the transfers, or back.
+void SwapBytesIfNeeded(const DLTensor* tensor, void* data, uint64_t nbytes) {
+  if (!DMLC_IO_NO_ENDIAN_SWAP) {
+    size_t elem_bytes = (tensor->dtype.bits * tensor->dtype.lanes + 7) / 8;
+    dmlc::ByteSwap(data, elem_bytes, nbytes / elem_bytes);
+  }
+}
+
+void WriteToTensor(const std::string& bytes, DLTensor* to) {
+  std::string swapped;
+  const std::string* data = &bytes;
+  if (!DMLC_IO_NO_ENDIAN_SWAP) {
+    swapped = bytes;
+    SwapBytesIfNeeded(to, &swapped[0], swapped.size());
+    data = &swapped;
+  }
+  if (to->device.device_type == kDLCPU) {
+    std::memcpy(static_cast<char*>(to->data) + to->byte_offset, data->data(), data->size());
+    return;
+  }
+  FlatBytes from(const_cast<char*>(data->data()), Device{kDLCPU, 0}, 0, data->size());
+  FlatBytes dst(to->data, to->device, to->byte_offset, data->size());
+  DeviceAPI* api = DeviceAPI::Get(to->device);
+  api->CopyDataFromTo(&from.tensor, &dst.tensor, nullptr);
+  api->StreamSync(to->device, nullptr);
+}
+
+void ReadFromTensor(DLTensor* from, uint64_t nbytes, std::string* bytes) {
+  bytes->resize(nbytes);
+  if (from->device.device_type == kDLCPU) {
+    std::memcpy(&(*bytes)[0], static_cast<const char*>(from->data) + from->byte_offset, nbytes);
+  } else {
+    FlatBytes src(from->data, from->device, from->byte_offset, nbytes);
+    FlatBytes to(&(*bytes)[0], Device{kDLCPU, 0}, 0, nbytes);
+    DeviceAPI* api = DeviceAPI::Get(from->device);
+    api->CopyDataFromTo(&src.tensor, &to.tensor, nullptr);
+    api->StreamSync(from->device, nullptr);
+  }
+  SwapBytesIfNeeded(from, &(*bytes)[0], nbytes);
+}
+
+}  // namespace
+
+TVM_REGISTER_GLOBAL(kRPCCopyToRemoteEncoded).set_body([](TVMArgs args, TVMRetValue* rv) {
+  DLTensor* to = args[0];
+  uint64_t nbytes = args[1].operator int64_t();
+  auto codec = static_cast<RPCTransferCodec>(args[2].operator int());
+  ICHECK_EQ(args[3].type_code(), kTVMBytes);
+  TVMByteArray* payload = args[3].ptr<TVMByteArray>();
+  RPCContentHash hash{static_cast<uint64_t>(args[4].operator int64_t()),
+                      static_cast<uint64_t>(args[5].operator int64_t())};
+  std::string bytes;
+  if (codec == RPCTransferCodec::kRaw) {
+    ICHECK_EQ(payload->size, nbytes);
+    bytes.assign(payload->data, payload->size);
+  } else {
+    ICHECK(codec == RPCTransferCodec::kLZ4) << "Unknown codec " << static_cast<int>(codec);
+    bytes.resize(nbytes);
+    ICHECK(support::LZ4Decompress(payload->data, payload->size, &bytes[0], nbytes))
+        << "Corrupted LZ4 block";
+  }
+  WriteToTensor(bytes, to);
+  if (hash.defined()) {
+    RPCTransferCache::Global()->Put(hash, std::move(bytes));
+  }
+});
+
+TVM_REGISTER_GLOBAL(kRPCCopyToRemoteCached).set_body([](TVMArgs args, TVMRetValue* rv) {
+  DLTensor* to = args[0];
+  uint64_t nbytes = args[1].operator int64_t();
+  RPCContentHash hash{static_cast<uint64_t>(args[2].operator int64_t()),
+                      static_cast<uint64_t>(args[3].operator int64_t())};
+  std::shared_ptr<const std::string> bytes = RPCTransferCache::Global()->Get(hash, nbytes);
+  if (bytes != nullptr) {
+    WriteToTensor(*bytes, to);
+  }
+  *rv = bytes != nullptr;
+});
+
+TVM_REGISTER_GLOBAL(kRPCCopyFromRemoteEncoded).set_body([](TVMArgs args, TVMRetValue* rv) {
+  DLTensor* from = args[0];
+  uint64_t nbytes = args[1].operator int64_t();
+  auto codec = static_cast<RPCTransferCodec>(args[2].operator int());
+  std::string bytes;
+  ReadFromTensor(from, nbytes, &bytes);
+  std::string compressed;
+  if (codec == RPCTransferCodec::kLZ4) {
+    support::LZ4Compress(bytes.data(), bytes.size(), &compressed);
+  }
+  // Send the raw bytes when they do not compress.
+  if (codec == RPCTransferCodec::kRaw || compressed.size() >= bytes.size()) {
+    codec = RPCTransferCodec::kRaw;
+    compressed = std::move(bytes);
+  }
+  std::string payload(1, static_cast<char>(codec));
+  payload.append(compressed);
+  TVMByteArray arr;
+  arr.data = payload.data();
+  arr.size = payload.size();
+  *rv = arr;
+});
+
+}  // namespace runtime
+}  // namespace tvm
@@ -0,0 +1,139 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file rpc_transfer.h
+ * \brief Compressed and deduplicated tensor transfers of RPC.
+ *
+ *  The transfers are implemented by server functions that the client looks up when they are
+ *  enabled, and the client falls back to the plain copies of the protocol when the server does
+ *  not have them, so that the protocol itself is unchanged.
+ */
+#ifndef TVM_RUNTIME_RPC_RPC_TRANSFER_H_
+#define TVM_RUNTIME_RPC_RPC_TRANSFER_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace tvm {
+namespace runtime {
+
+/*! \brief The codecs of the tensor transfers. */
+enum class RPCTransferCodec : int {
+  kRaw = 0,
+  kLZ4 = 1,
+};
+
+/*!
+ * \brief Get the codec of the name.
+ * \param name The name, "none" or "lz4".
+ * \return The codec.
+ */
+RPCTransferCodec RPCTransferCodecFromString(const std::string& name);
+
+/*!
+ * \brief The server function that writes an encoded block to a tensor.
+ *
+ *  Its arguments are the tensor, the number of bytes, the codec, the encoded bytes and the two
+ *  halves of the hash of the block, which is cached by the server when it is not zero.
+ */
+constexpr const char* kRPCCopyToRemoteEncoded = "tvm.rpc.server.copy_to_remote_encoded";
+
+/*!
+ * \brief The server function that writes a block cached by the server to a tensor.
+ *
+ *  Its arguments are the tensor, the number of bytes and the two halves of the hash of the block,
+ *  and it returns whether the block is cached.
+ */
+constexpr const char* kRPCCopyToRemoteCached = "tvm.rpc.server.copy_to_remote_cached";
+
+/*!
+ * \brief The server function that reads an encoded block from a tensor.
+ *
+ *  Its arguments are the tensor, the number of bytes and the codec, and it returns the bytes of
+ *  the block prefixed by the codec they are actually encoded with.
+ */
+constexpr const char* kRPCCopyFromRemoteEncoded = "tvm.rpc.server.copy_from_remote_encoded";
+
+/*! \brief The 128-bit hash of the content of a block. */
+struct RPCContentHash {
+  uint64_t high{0};
+  uint64_t low{0};
+
+  bool defined() const { return high != 0 || low != 0; }
+  bool operator==(const RPCContentHash& other) const {
+    return high == other.high && low == other.low;
+  }
+};
+
+/*! \brief The hasher of RPCContentHash for the unordered containers. */
+struct RPCContentHasher {
+  size_t operator()(const RPCContentHash& hash) const { return static_cast<size_t>(hash.low); }
+};
+
+/*!
+ * \brief Hash the content of a block.
+ *
+ *  The hash is not cryptographic, which is fine as the blocks are sent by the client that reads
+ *  them back, and the chance of an accidental collision of its 128 bits is negligible.
+ *
+ * \param data The bytes of the block.
+ * \param nbytes The number of bytes.
+ * \return The hash, which is never zero.
+ */
+inline RPCContentHash RPCHashContent(const void* data, uint64_t nbytes) {
+  constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+  constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+  auto rotl = [](uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+  // The final mix of MurmurHash3.
+  auto mix = [](uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+  };
+  const char* ptr = static_cast<const char*>(data);
+  // Four independent lanes, so that the multiplications are pipelined.
+  uint64_t acc[4] = {kPrime1 + kPrime2, kPrime2, 0, 0 - kPrime1};
+  uint64_t i = 0;
+  for (; i + 32 <= nbytes; i += 32) {
+    for (int lane = 0; lane < 4; ++lane) {
+      uint64_t word;
+      std::memcpy(&word, ptr + i + lane * 8, sizeof(word));
+      acc[lane] = rotl(acc[lane] + word * kPrime2, 31) * kPrime1;
+    }
+  }
+  uint64_t tail[4] = {0, 0, 0, 0};
+  std::memcpy(tail, ptr + i, nbytes - i);
+  for (int lane = 0; lane < 4; ++lane) {
+    acc[lane] = rotl(acc[lane] + tail[lane] * kPrime2, 31) * kPrime1;
+  }
+  RPCContentHash hash;
+  hash.high = mix(acc[0] ^ rotl(acc[1], 17) ^ rotl(acc[2], 31) ^ rotl(acc[3], 47) ^ nbytes);
+  hash.low = mix(acc[3] ^ rotl(acc[2], 13) ^ rotl(acc[1], 29) ^ rotl(acc[0], 43) ^ ~nbytes);
+  if (!hash.defined()) hash.low = 1;
+  return hash;
+}
+
+}  // namespace runtime
+}  // namespace tvm
+#endif  // TVM_RUNTIME_RPC_RPC_TRANSFER_H_
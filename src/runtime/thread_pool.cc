@@ -29,6 +29,7 @@
 #include <tvm/runtime/packed_func.h>
 #include <tvm/runtime/registry.h>
 #include <tvm/runtime/threading_backend.h>
+#include <tvm/runtime/trace_event.h>
 #if TVM_THREADPOOL_USE_OPENMP
 #include <omp.h>
 #endif
@@ -38,6 +39,7 @@
 #include <cstring>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
 #include <sstream>
 #include <string>
 #include <thread>
@@ -60,13 +62,24 @@ uint32_t GetSpinCount() {
   return atoi(val);
 }
 
+int GetTasksPerThread() {
+  const char* val = getenv("TVM_THREAD_POOL_TASKS_PER_THREAD");
+  if (!val) {
+    return 1;
+  }
+  return std::max(atoi(val), 1);
+}
+
 }  // namespace
 
 // stride in the page, fit to cache line.
 constexpr int kSyncStride = 64 / sizeof(std::atomic<int>);
 
 /*!
- * \brief Thread local main environment.
+ * \brief State of one parallel launch.
+ *
+ *  A launcher is owned by the thread that calls Launch. Nested launches use a
+ *  fresh launcher per nesting level, see ThreadPoolLocalState.
  */
 class ParallelLauncher {
  public:
@@ -80,12 +93,13 @@ class ParallelLauncher {
     // reshape
     if (static_cast<size_t>(num_task) > par_errors_.size()) {
       par_errors_.resize(num_task + 1);
-      if (need_sync) {
+    }
+    if (need_sync) {
+      if (num_task > sync_capacity_) {
         delete[] sync_counter_;
         sync_counter_ = new std::atomic<int>[num_task * kSyncStride];
+        sync_capacity_ = num_task;
       }
-    }
-    if (need_sync) {
       for (int i = 0; i < num_task; ++i) {
         sync_counter_[i * kSyncStride].store(0, std::memory_order_relaxed);
       }
@@ -95,11 +109,10 @@ class ParallelLauncher {
     }
   }
   ~ParallelLauncher() { delete[] sync_counter_; }
-  // Wait n jobs to finish
-  int WaitForJobs() {
-    while (num_pending_.load() != 0) {
-      tvm::runtime::threading::Yield();
-    }
+  // Whether all the jobs have finished.
+  bool Finished() const { return num_pending_.load(std::memory_order_acquire) == 0; }
+  // Collect the errors of finished jobs.
+  int CollectErrors() {
     if (!has_error_.load()) return 0;
     std::ostringstream os;
     for (size_t i = 0; i < par_errors_.size(); ++i) {
@@ -111,25 +124,40 @@ class ParallelLauncher {
     TVMAPISetLastError(os.str().c_str());
     return -1;
   }
-  // Signal that one job has finished.
+  // Signal that one job has finished with error.
+  // The launcher may be reused by its owner as soon as the counter is
+  // decremented, so the error has to be recorded before that.
   void SignalJobError(int task_id) {
-    num_pending_.fetch_sub(1);
     par_errors_[task_id] = TVMGetLastError();
     has_error_.store(true);
+    num_pending_.fetch_sub(1, std::memory_order_release);
   }
   // Signal that one job has finished.
-  void SignalJobFinish() { num_pending_.fetch_sub(1); }
-  // Get thread local version of the store.
-  static ParallelLauncher* ThreadLocal() { return dmlc::ThreadLocalStore<ParallelLauncher>::Get(); }
+  void SignalJobFinish() { num_pending_.fetch_sub(1, std::memory_order_release); }
+  // Run one job of the launch.
+  // num_free_workers is incremented before the job is signaled as finished, so that the next
+  // launch of the owner can reserve the thread again.
+  void RunTask(int task_id, std::atomic<int>* num_free_workers = nullptr) {
+    int ret;
+    {
+      profiling::TraceScope trace_scope("thread_pool", "parallel task", "task_id", task_id);
+      ret = (*flambda)(task_id, &env, cdata);
+    }
+    if (num_free_workers != nullptr) {
+      num_free_workers->fetch_add(1);
+    }
+    if (ret == 0) {
+      SignalJobFinish();
+    } else {
+      SignalJobError(task_id);
+    }
+  }
   // The parallel lambda
   FTVMParallelLambda flambda;
   // The closure data
   void* cdata;
   // Local env
   TVMParallelGroupEnv env;
-  // Whether this thread is worker of the pool.
-  // used to prevent recursive launch.
-  bool is_worker{false};
 
  private:
   // The pending jobs.
@@ -138,125 +166,189 @@ class ParallelLauncher {
   std::atomic<bool> has_error_;
   // The counter page.
   std::atomic<int32_t>* sync_counter_{nullptr};
+  // Number of tasks the counter page can serve.
+  int sync_capacity_{0};
   // The error message
   std::vector<std::string> par_errors_;
 };
 
-/*! \brief Lock-free single-producer-single-consumer queue for each thread */
-class SpscTaskQueue {
+/*!
+ * \brief Lock-free work-stealing deque (Chase-Lev).
+ *
+ *  The owner thread pushes and pops tasks at the bottom, other threads steal
+ *  from the top. The ring buffer grows when full; retired buffers are kept
+ *  alive until the deque is destroyed since a thief may still read from them.
+ *
+ *  See "Correct and Efficient Work-Stealing for Weak Memory Models",
+ *  Le et al., PPoPP 2013.
+ */
+class TaskDeque {
  public:
   /*! \brief The task entry */
   struct Task {
     ParallelLauncher* launcher;
     int32_t task_id;
   };
+  /*! \brief Result of a steal attempt. */
+  enum class StealResult : int { kEmpty, kAbort, kSuccess };
 
-  SpscTaskQueue() : buffer_(new Task[kRingSize]), head_(0), tail_(0) {}
-
-  ~SpscTaskQueue() { delete[] buffer_; }
+  TaskDeque() {
+    rings_.emplace_back(std::make_unique<Ring>(kInitialCapacity));
+    ring_.store(rings_.back().get(), std::memory_order_relaxed);
+  }
 
   /*!
-   * \brief Push a task into the queue and notify the comsumer if it is on wait.
-   * \param input The task to be dequeued.
+   * \brief Push a task to the bottom, only called by the owner.
+   * \param task The task to be pushed.
    */
-  void Push(const Task& input) {
-    while (!Enqueue(input)) {
-      tvm::runtime::threading::Yield();
-    }
-    if (pending_.fetch_add(1) == -1) {
-      std::unique_lock<std::mutex> lock(mutex_);
-      cv_.notify_one();
+  void Push(const Task& task) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    Ring* ring = ring_.load(std::memory_order_relaxed);
+    if (bottom - top > ring->mask) {
+      ring = Grow(ring, top, bottom);
     }
+    ring->Put(bottom, task);
+    bottom_.store(bottom + 1, std::memory_order_release);
   }
 
   /*!
-   * \brief Pop a task out of the queue and condition wait if no tasks.
-   * \param output The pointer to the task to be dequeued.
-   * \param spin_count The number of iterations to spin before sleep.
-   * \return Whether pop is successful (true) or we need to exit now (false).
+   * \brief Pop a task from the bottom, only called by the owner.
+   * \param floor Only tasks pushed at position >= floor are popped.
+   * \param output The popped task.
+   * \return Whether a task is popped.
    */
-  bool Pop(Task* output, uint32_t spin_count) {
-    // Busy wait a bit when the queue is empty.
-    // If a new task comes to the queue quickly, this wait avoid the worker from sleeping.
-    // The default spin count is set by following the typical omp convention
-    for (uint32_t i = 0; i < spin_count && pending_.load() == 0; ++i) {
-      tvm::runtime::threading::Yield();
-    }
-    if (pending_.fetch_sub(1) == 0) {
-      std::unique_lock<std::mutex> lock(mutex_);
-      cv_.wait(lock, [this] { return pending_.load() >= 0 || exit_now_.load(); });
-    }
-    if (exit_now_.load(std::memory_order_relaxed)) {
+  bool Pop(int64_t floor, Task* output) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    if (bottom < floor) return false;
+    Ring* ring = ring_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      // empty
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
       return false;
     }
-    const uint32_t head = head_.load(std::memory_order_relaxed);
-    // sanity check if the queue is empty
-    ICHECK(tail_.load(std::memory_order_acquire) != head);
-    *output = buffer_[head];
-    head_.store((head + 1) % kRingSize, std::memory_order_release);
+    *output = ring->Get(bottom);
+    if (top == bottom) {
+      // the last task, race against thieves
+      bool won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                              std::memory_order_relaxed);
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return won;
+    }
     return true;
   }
 
   /*!
-   * \brief Signal to terminate the worker.
+   * \brief Steal a task from the top, can be called by any thread.
+   * \param output The stolen task.
+   * \return The steal result, kAbort means a concurrent operation won the race.
    */
-  void SignalForKill() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    exit_now_.store(true);
-    cv_.notify_all();
+  StealResult Steal(Task* output) {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom) return StealResult::kEmpty;
+    Ring* ring = ring_.load(std::memory_order_acquire);
+    *output = ring->Get(top);
+    if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                      std::memory_order_relaxed)) {
+      return StealResult::kAbort;
+    }
+    return StealResult::kSuccess;
   }
 
- protected:
-  /*!
-   * \brief Lock-free enqueue.
-   * \param input The task to be enqueued.
-   * \return Whether the task is enqueued.
-   */
-  bool Enqueue(const Task& input) {
-    if (exit_now_.load(std::memory_order_relaxed)) return false;
+  /*! \return The current bottom position, only meaningful to the owner. */
+  int64_t Bottom() const { return bottom_.load(std::memory_order_relaxed); }
 
-    const uint32_t tail = tail_.load(std::memory_order_relaxed);
+ private:
+  /*! \brief Ring buffer of tasks. Fields are atomic since thieves read them racily. */
+  struct Ring {
+    explicit Ring(int64_t capacity) : mask(capacity - 1), slots(new Slot[capacity]) {}
+    void Put(int64_t index, const Task& task) {
+      Slot& slot = slots[index & mask];
+      slot.launcher.store(task.launcher, std::memory_order_relaxed);
+      slot.task_id.store(task.task_id, std::memory_order_relaxed);
+    }
+    Task Get(int64_t index) const {
+      const Slot& slot = slots[index & mask];
+      return Task{slot.launcher.load(std::memory_order_relaxed),
+                  slot.task_id.load(std::memory_order_relaxed)};
+    }
+    struct Slot {
+      std::atomic<ParallelLauncher*> launcher{nullptr};
+      std::atomic<int32_t> task_id{0};
+    };
+    const int64_t mask;
+    std::unique_ptr<Slot[]> slots;
+  };
 
-    if ((tail + 1) % kRingSize != (head_.load(std::memory_order_acquire))) {
-      buffer_[tail] = input;
-      tail_.store((tail + 1) % kRingSize, std::memory_order_release);
-      return true;
+  Ring* Grow(Ring* ring, int64_t top, int64_t bottom) {
+    rings_.emplace_back(std::make_unique<Ring>((ring->mask + 1) * 2));
+    Ring* new_ring = rings_.back().get();
+    for (int64_t i = top; i < bottom; ++i) {
+      new_ring->Put(i, ring->Get(i));
     }
-    return false;
+    ring_.store(new_ring, std::memory_order_release);
+    return new_ring;
   }
 
-  // the cache line paddings are used for avoid false sharing between atomic variables
-  typedef char cache_line_pad_t[kL1CacheBytes];
-  cache_line_pad_t pad0_;
-  // size of the queue, the queue can host size_ - 1 items at most
-  // define it as a constant for better compiler optimization
-  static constexpr const int kRingSize = 2;
-  // pointer to access the item
-  Task* const buffer_;
-
-  cache_line_pad_t pad1_;
-  // queue head, where one gets a task from the queue
-  std::atomic<uint32_t> head_;
-
-  cache_line_pad_t pad2_;
-  // queue tail, when one puts a task to the queue
-  std::atomic<uint32_t> tail_;
-
-  cache_line_pad_t pad3_;
-  // pending tasks in the queue
-  std::atomic<int8_t> pending_{0};
+  static constexpr const int64_t kInitialCapacity = 64;
+  alignas(kL1CacheBytes) std::atomic<int64_t> top_{0};
+  alignas(kL1CacheBytes) std::atomic<int64_t> bottom_{0};
+  alignas(kL1CacheBytes) std::atomic<Ring*> ring_{nullptr};
+  // all the rings ever allocated, only touched by the owner.
+  std::vector<std::unique_ptr<Ring>> rings_;
+};
 
-  cache_line_pad_t pad4_;
-  // signal for exit now
-  std::atomic<bool> exit_now_{false};
+class ThreadPool;
 
-  // internal mutex
-  std::mutex mutex_;
-  // cv for consumer
-  std::condition_variable cv_;
+/*!
+ * \brief Thread local view of the thread pools.
+ *
+ *  Records whether the thread is a worker of a pool, the deque slot the thread
+ *  uses when it launches jobs, the launchers of the (possibly nested) launches
+ *  in flight and the private pool created by threading::Configure.
+ */
+struct ThreadPoolLocalState {
+  ~ThreadPoolLocalState();
+  // Get thread local version of the store.
+  static ThreadPoolLocalState* ThreadLocal() {
+    return dmlc::ThreadLocalStore<ThreadPoolLocalState>::Get();
+  }
+  // The pool this thread is a worker of, nullptr for user threads.
+  ThreadPool* worker_pool{nullptr};
+  // The pool the slot below belongs to.
+  ThreadPool* slot_pool{nullptr};
+  // The generation of slot_pool when the slot was acquired.
+  uint64_t slot_generation{0};
+  // The index of the deque owned by this thread in slot_pool.
+  int slot{-1};
+  // Number of launches in flight on this thread.
+  size_t launch_depth{0};
+  // One launcher per nesting level.
+  std::vector<std::unique_ptr<ParallelLauncher>> launchers;
+  // Pool configured for this thread via threading::Configure.
+  std::unique_ptr<ThreadPool> private_pool;
+  // State of the random victim selection.
+  uint32_t rand_state{0};
 };
 
-// The thread pool
+/*!
+ * \brief Work-stealing thread pool.
+ *
+ *  Every worker, as well as every user thread that launches jobs, owns a
+ *  TaskDeque. A launch pushes its tasks to the deque of the launching thread,
+ *  runs task 0 itself and then keeps popping its own tasks while idle workers
+ *  steal the rest. Launches can be nested inside a task and can be issued
+ *  concurrently from multiple user threads, which then share the workers.
+ *
+ *  The tasks of a launch that may call TVMBackendParallelBarrier must all run
+ *  at the same time, so such a launch only pushes as many tasks as there are
+ *  idle workers not claimed by other pending tasks, see num_free_workers_.
+ */
 class ThreadPool {
  public:
   ThreadPool() : num_workers_(tvm::runtime::threading::MaxConcurrency()) {
@@ -267,112 +359,357 @@ class ThreadPool {
     Init();
   }
 
-  ~ThreadPool() {
-    for (std::unique_ptr<SpscTaskQueue>& q : queues_) {
-      q->SignalForKill();
-    }
-    threads_.reset();
-  }
+  ~ThreadPool() { Shutdown(); }
 
   void Reset() {
-    for (std::unique_ptr<SpscTaskQueue>& q : queues_) {
-      q->SignalForKill();
-    }
-    // Destroy threads before we destory the shared queue, otherwise we segfault on MacOS
-    threads_.reset();
-    queues_.clear();
+    std::unique_lock<std::shared_mutex> lock(launch_mutex_);
+    Shutdown();
     Init();
   }
 
   int Launch(FTVMParallelLambda flambda, void* cdata, int num_task, int need_sync) {
-    ParallelLauncher* launcher = ParallelLauncher::ThreadLocal();
-    ICHECK(!launcher->is_worker)
-        << "Cannot launch parallel job inside worker, consider fuse then parallel";
+    ThreadPoolLocalState* state = ThreadPoolLocalState::ThreadLocal();
+    // Launches from the user threads exclude Reset, the nested ones are
+    // covered by the launch they are nested in.
+    std::shared_lock<std::shared_mutex> lock;
+    if (state->worker_pool != this) {
+      lock = std::shared_lock<std::shared_mutex>(launch_mutex_);
+    }
+    int num_workers_used = num_workers_used_.load(std::memory_order_relaxed);
+    bool fixed_num_task = num_task != 0;
     if (num_task == 0) {
-      num_task = num_workers_used_;
-    }
-    if (need_sync != 0) {
-      ICHECK_LE(num_task, num_workers_used_)
-          << "Request parallel sync task larger than number of threads used "
-          << " workers=" << num_workers_used_ << " request=" << num_task;
-    }
-    launcher->Init(flambda, cdata, num_task, need_sync != 0);
-    SpscTaskQueue::Task tsk;
-    tsk.launcher = launcher;
-    // if worker0 is taken by the main, queues_[0] is abandoned
-    for (int i = exclude_worker0_; i < num_task; ++i) {
-      tsk.task_id = i;
-      queues_[i]->Push(tsk);
-    }
-    // use the main thread to run task 0
-    if (exclude_worker0_) {
-      TVMParallelGroupEnv* penv = &(tsk.launcher->env);
-      if ((*tsk.launcher->flambda)(0, penv, cdata) == 0) {
-        tsk.launcher->SignalJobFinish();
+      num_task = num_workers_used * tasks_per_thread_;
+    }
+    int slot = AcquireSlot(state);
+    if (slot < 0) {
+      // Ran out of deque slots for user threads, run the job on the calling thread.
+      return RunInline(flambda, cdata);
+    }
+    // if worker0 is taken by the main, the launching thread runs task 0.
+    // Workers always take part in their nested launches.
+    bool run_task0 = exclude_worker0_ || state->worker_pool == this;
+    int num_pushed = num_task - static_cast<int>(run_task0);
+    // BSP barrier requires all the tasks to run concurrently, so every pushed
+    // task needs an idle worker of its own. Nested launches and the launches of
+    // other user threads may hold some of the workers: the job is then split in
+    // fewer tasks, or in the worst case run on the calling thread alone.
+    bool sync = need_sync != 0 && num_task <= num_workers_used;
+    if (sync) {
+      int num_reserved = ReserveWorkers(fixed_num_task ? num_pushed : 0, num_pushed);
+      if (num_reserved < 0) {
+        // The number of tasks is fixed by the caller, give them threads of their own.
+        return RunOnOwnThreads(state, flambda, cdata, num_task);
+      }
+      if (num_reserved == 0 && !fixed_num_task) {
+        return RunInline(flambda, cdata);
+      }
+      num_pushed = num_reserved;
+      num_task = num_reserved + static_cast<int>(run_task0);
+    } else {
+      num_free_workers_.fetch_sub(num_pushed);
+    }
+    ParallelLauncher* launcher = PushLauncher(state);
+    launcher->Init(flambda, cdata, num_task, sync);
+    TaskDeque* deque = deques_[slot].get();
+    int64_t floor = deque->Bottom();
+    for (int i = num_task - 1; i >= static_cast<int>(run_task0); --i) {
+      deque->Push(TaskDeque::Task{launcher, i});
+    }
+    NotifyWorkers();
+    if (run_task0) {
+      launcher->RunTask(0);
+    }
+    // Help with the tasks of this launch that are not stolen yet. Do not
+    // steal tasks of other launches here: they may wait in a barrier for a
+    // task that sits below us in the stack.
+    TaskDeque::Task task;
+    while (!launcher->Finished()) {
+      if (run_task0 && deque->Pop(floor, &task)) {
+        task.launcher->RunTask(task.task_id, &num_free_workers_);
       } else {
-        tsk.launcher->SignalJobError(tsk.task_id);
+        tvm::runtime::threading::Yield();
       }
     }
-    int res = launcher->WaitForJobs();
+    int res = launcher->CollectErrors();
+    PopLauncher(state);
     return res;
   }
 
-  static ThreadPool* ThreadLocal() { return dmlc::ThreadLocalStore<ThreadPool>::Get(); }
+  // The pool used by the current thread.
+  static ThreadPool* ThreadLocal() {
+    ThreadPoolLocalState* state = ThreadPoolLocalState::ThreadLocal();
+    if (state->worker_pool != nullptr) return state->worker_pool;
+    if (state->private_pool != nullptr) return state->private_pool.get();
+    return Global();
+  }
+
+  // The pool shared by all the user threads.
+  static ThreadPool* Global() {
+    static ThreadPool inst;
+    return &inst;
+  }
 
   void UpdateWorkerConfiguration(threading::ThreadGroup::AffinityMode mode, int nthreads,
                                  const std::vector<unsigned int>& cpus) {
     // this will also reset the affinity of the ThreadGroup
     // may use less than the MaxConcurrency number of workers
-    num_workers_used_ = threads_->Configure(mode, nthreads, exclude_worker0_, cpus);
+    int num_workers_used = threads_->Configure(mode, nthreads, exclude_worker0_, cpus);
     // if MaxConcurrency restricted the number of workers (e.g., due to
     // hyperthreading), respect the restriction
-    num_workers_used_ = std::min(num_workers_, num_workers_used_);
+    num_workers_used = std::min(num_workers_, num_workers_used);
+    num_free_workers_.fetch_add(num_workers_used - num_workers_used_.exchange(num_workers_used));
+    // wake up the workers that are parked or unparked by the new configuration.
+    NotifyWorkers();
   }
 
-  int32_t NumThreads() const { return num_workers_used_; }
+  int32_t NumThreads() const { return num_workers_used_.load(); }
+
+  // Release the deque slot of a user thread.
+  void ReleaseSlot(int slot, uint64_t generation) {
+    std::shared_lock<std::shared_mutex> lock(launch_mutex_);
+    ReleaseSlotNoLock(slot, generation);
+  }
 
  private:
   // Shared initialization code
   void Init() {
-    for (int i = 0; i < num_workers_; ++i) {
-      // The SpscTaskQueue only hosts ONE item at a time
-      queues_.emplace_back(std::make_unique<SpscTaskQueue>());
+    ++generation_;
+    exit_now_.store(false);
+    deques_.clear();
+    for (int i = 0; i < num_workers_ + kMaxUserThreads; ++i) {
+      deques_.emplace_back(std::make_unique<TaskDeque>());
     }
+    slot_in_use_ = std::make_unique<std::atomic<bool>[]>(kMaxUserThreads);
+    for (int i = 0; i < kMaxUserThreads; ++i) {
+      slot_in_use_[i].store(false);
+    }
+    num_active_deques_.store(num_workers_);
     threads_ = std::make_unique<tvm::runtime::threading::ThreadGroup>(
         num_workers_, [this](int worker_id) { this->RunWorker(worker_id); },
         exclude_worker0_ /* include_main_thread */);
-    num_workers_used_ = threads_->Configure(threading::ThreadGroup::kBig, 0, exclude_worker0_);
+    num_workers_used_.store(
+        threads_->Configure(threading::ThreadGroup::kBig, 0, exclude_worker0_));
+    num_free_workers_.store(num_workers_used_.load() - static_cast<int>(exclude_worker0_));
+  }
+
+  void Shutdown() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      exit_now_.store(true);
+      cv_.notify_all();
+    }
+    // Destroy threads before we destory the shared deques, otherwise we segfault on MacOS
+    threads_.reset();
+  }
+
+  // Run the job in the calling thread as a single task.
+  static int RunInline(FTVMParallelLambda flambda, void* cdata) {
+    std::atomic<int32_t> sync_counter{0};
+    TVMParallelGroupEnv env;
+    env.num_task = 1;
+    env.sync_handle = &sync_counter;
+    return (*flambda)(0, &env, cdata);
+  }
+
+  // Run the job on threads created for it, so that its tasks run concurrently
+  // even when the workers are taken by other launches.
+  static int RunOnOwnThreads(ThreadPoolLocalState* state, FTVMParallelLambda flambda,
+                             void* cdata, int num_task) {
+    ParallelLauncher* launcher = PushLauncher(state);
+    launcher->Init(flambda, cdata, num_task, true);
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_task; ++i) {
+      threads.emplace_back([launcher, i]() { launcher->RunTask(i); });
+    }
+    launcher->RunTask(0);
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+    int res = launcher->CollectErrors();
+    PopLauncher(state);
+    return res;
+  }
+
+  // Reserve between min_count and count idle workers for the tasks of a
+  // launch, as many as possible. Return -1 if fewer than min_count are free.
+  int ReserveWorkers(int min_count, int count) {
+    int num_free = num_free_workers_.load();
+    while (true) {
+      int num_reserved = std::min(count, std::max(num_free, 0));
+      if (num_reserved < min_count) return -1;
+      if (num_free_workers_.compare_exchange_weak(num_free, num_free - num_reserved)) {
+        return num_reserved;
+      }
+    }
+  }
+
+  // Get the deque slot of the calling thread, -1 if none is available.
+  int AcquireSlot(ThreadPoolLocalState* state) {
+    if (state->slot_pool == this && state->slot_generation == generation_) {
+      return state->slot;
+    }
+    if (state->slot_pool == this) {
+      ReleaseSlotNoLock(state->slot, state->slot_generation);
+    } else if (state->slot_pool != nullptr) {
+      state->slot_pool->ReleaseSlot(state->slot, state->slot_generation);
+    }
+    state->slot_pool = nullptr;
+    for (int i = 0; i < kMaxUserThreads; ++i) {
+      bool expected = false;
+      if (!slot_in_use_[i].load(std::memory_order_relaxed) &&
+          slot_in_use_[i].compare_exchange_strong(expected, true)) {
+        int slot = num_workers_ + i;
+        // make the deque visible to the thieves.
+        int num_active = num_active_deques_.load();
+        while (num_active < slot + 1 &&
+               !num_active_deques_.compare_exchange_weak(num_active, slot + 1)) {
+        }
+        state->slot_pool = this;
+        state->slot_generation = generation_;
+        state->slot = slot;
+        return slot;
+      }
+    }
+    return -1;
+  }
+
+  void ReleaseSlotNoLock(int slot, uint64_t generation) {
+    if (generation != generation_.load()) return;
+    slot_in_use_[slot - num_workers_].store(false, std::memory_order_release);
+  }
+
+  static ParallelLauncher* PushLauncher(ThreadPoolLocalState* state) {
+    if (state->launch_depth == state->launchers.size()) {
+      state->launchers.emplace_back(std::make_unique<ParallelLauncher>());
+    }
+    return state->launchers[state->launch_depth++].get();
+  }
+
+  static void PopLauncher(ThreadPoolLocalState* state) { --state->launch_depth; }
+
+  // Signal the workers that new tasks are available.
+  void NotifyWorkers() {
+    epoch_.fetch_add(1);
+    if (num_sleeping_.load() != 0) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      cv_.notify_all();
+    }
+  }
+
+  // Try to steal a task from a random victim.
+  bool Steal(int self, ThreadPoolLocalState* state, TaskDeque::Task* task) {
+    int num_deques = num_active_deques_.load(std::memory_order_acquire);
+    // xorshift
+    uint32_t x = state->rand_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state->rand_state = x;
+    int start = static_cast<int>(x % static_cast<uint32_t>(num_deques));
+    bool contended = true;
+    while (contended) {
+      contended = false;
+      for (int i = 0; i < num_deques; ++i) {
+        int victim = (start + i) % num_deques;
+        if (victim == self) continue;
+        switch (deques_[victim]->Steal(task)) {
+          case TaskDeque::StealResult::kSuccess:
+            return true;
+          case TaskDeque::StealResult::kAbort:
+            contended = true;
+            break;
+          case TaskDeque::StealResult::kEmpty:
+            break;
+        }
+      }
+    }
+    return false;
   }
 
   // Internal worker function.
   void RunWorker(int worker_id) {
-    SpscTaskQueue* queue = queues_[worker_id].get();
-    SpscTaskQueue::Task task;
-    ParallelLauncher::ThreadLocal()->is_worker = true;
+    ThreadPoolLocalState* state = ThreadPoolLocalState::ThreadLocal();
+    state->worker_pool = this;
+    state->slot_pool = this;
+    state->slot_generation = generation_;
+    state->slot = worker_id;
+    state->rand_state = static_cast<uint32_t>(worker_id) * 2654435761U + 1;
+    profiling::SetTraceThreadName("thread pool worker " + std::to_string(worker_id));
     // Initialize the spin count (from envvar TVM_THREAD_POOL_SPIN_COUNT) on
     // the global first use of the ThreadPool.
     // TODO(tulloch): should we make this configurable via standard APIs?
     static size_t spin_count = GetSpinCount();
-    while (queue->Pop(&task, spin_count)) {
-      ICHECK(task.launcher != nullptr);
-      TVMParallelGroupEnv* penv = &(task.launcher->env);
-      void* cdata = task.launcher->cdata;
-      if ((*task.launcher->flambda)(task.task_id, penv, cdata) == 0) {
-        task.launcher->SignalJobFinish();
-      } else {
-        task.launcher->SignalJobError(task.task_id);
+    TaskDeque::Task task;
+    while (!exit_now_.load(std::memory_order_relaxed)) {
+      uint64_t epoch = epoch_.load();
+      if (worker_id < num_workers_used_.load(std::memory_order_relaxed)) {
+        if (Steal(worker_id, state, &task)) {
+          ICHECK(task.launcher != nullptr);
+          task.launcher->RunTask(task.task_id, &num_free_workers_);
+          continue;
+        }
+        // Busy wait a bit when there is no task.
+        // If new tasks come quickly, this wait avoid the worker from sleeping.
+        // The default spin count is set by following the typical omp convention
+        for (size_t i = 0; i < spin_count && epoch_.load() == epoch && !exit_now_.load(); ++i) {
+          tvm::runtime::threading::Yield();
+        }
+        if (epoch_.load() != epoch) continue;
       }
+      std::unique_lock<std::mutex> lock(mutex_);
+      num_sleeping_.fetch_add(1);
+      cv_.wait(lock, [&] { return epoch_.load() != epoch || exit_now_.load(); });
+      num_sleeping_.fetch_sub(1);
     }
   }
+
+  // Maximum number of user threads that can launch jobs concurrently.
+  static constexpr const int kMaxUserThreads = 64;
   int num_workers_;
   // number of workers used (can be restricted with affinity pref)
-  int num_workers_used_;
+  std::atomic<int> num_workers_used_{0};
+  // number of stealing workers minus the number of tasks waiting in the
+  // deques, i.e. the idle workers that no pending task has claimed yet.
+  // Every pushed task decrements it and gives it back once run. It can go
+  // negative for the launches without barrier, a launch with barrier only
+  // pushes its tasks while it stays non-negative.
+  std::atomic<int> num_free_workers_{0};
+  // number of tasks per used worker when the launch does not specify it.
+  // More than one task per worker lets idle workers steal the leftover tasks
+  // of unbalanced jobs, at the price of disabling TVMBackendParallelBarrier.
+  int tasks_per_thread_{GetTasksPerThread()};
   // if or not to exclude worker 0 and use main to run task 0
   bool exclude_worker0_{true};
-  std::vector<std::unique_ptr<SpscTaskQueue>> queues_;
+  // incremented whenever the deques and threads are re-created
+  std::atomic<uint64_t> generation_{0};
+  // deques of the workers, followed by the deques of the user threads
+  std::vector<std::unique_ptr<TaskDeque>> deques_;
+  // number of deques thieves have to look at
+  std::atomic<int> num_active_deques_{0};
+  // whether a user thread deque is taken
+  std::unique_ptr<std::atomic<bool>[]> slot_in_use_;
+  // incremented whenever new tasks are pushed or the configuration changes
+  std::atomic<uint64_t> epoch_{0};
+  // number of workers waiting on cv_
+  std::atomic<int> num_sleeping_{0};
+  // signal for exit now
+  std::atomic<bool> exit_now_{false};
+  // internal mutex
+  std::mutex mutex_;
+  // cv for the sleeping workers
+  std::condition_variable cv_;
+  // excludes Reset with the launches from user threads
+  std::shared_mutex launch_mutex_;
   std::unique_ptr<tvm::runtime::threading::ThreadGroup> threads_;
 };
 
+ThreadPoolLocalState::~ThreadPoolLocalState() {
+  if (slot_pool != nullptr && worker_pool == nullptr) {
+    slot_pool->ReleaseSlot(slot, slot_generation);
+  }
+  private_pool.reset();
+}
+
 /*!
  * \brief args[0] is the AffinityMode, args[1] is the number of threads.
  *  args2 is a list of CPUs which is used to set the CPU affinity.
@@ -461,7 +798,13 @@ TVM_DLL void Configure(tvm::runtime::threading::ThreadGroup::AffinityMode mode,
                        std::vector<unsigned int> cpus) {
   tvm::runtime::threading::SetMaxConcurrency(cpus.size());
 #if !TVM_THREADPOOL_USE_OPENMP
-  tvm::runtime::ThreadPool::ThreadLocal()->UpdateWorkerConfiguration(mode, nthreads, cpus);
+  // The configuration only applies to the calling thread, which from now on
+  // launches its jobs on a pool of its own instead of the shared one.
+  ThreadPoolLocalState* state = ThreadPoolLocalState::ThreadLocal();
+  if (state->private_pool == nullptr) {
+    state->private_pool = std::make_unique<ThreadPool>();
+  }
+  state->private_pool->UpdateWorkerConfiguration(mode, nthreads, cpus);
 #else
   ConfigureOMP(mode, nthreads, cpus);
 #endif
@@ -503,6 +846,10 @@ int TVMBackendParallelBarrier(int task_id, TVMParallelGroupEnv* penv) {
 #pragma omp barrier
 #else
   using tvm::runtime::kSyncStride;
+  ICHECK(penv->sync_handle != nullptr)
+      << "TVMBackendParallelBarrier requires the parallel job to have no more tasks than threads, "
+      << "num_task=" << penv->num_task << ", threads=" << tvm::runtime::threading::NumThreads()
+      << ". Unset TVM_THREAD_POOL_TASKS_PER_THREAD for jobs that synchronize.";
   int num_task = penv->num_task;
   std::atomic<int>* sync_counter = reinterpret_cast<std::atomic<int>*>(penv->sync_handle);
   int old_counter = sync_counter[task_id * kSyncStride].fetch_add(1, std::memory_order_release);
@@ -0,0 +1,313 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file trace_event.cc
+ * \brief The per-thread buffers of the trace events, and the Chrome trace writer.
+ */
+#include <tvm/runtime/logging.h>
+#include <tvm/runtime/registry.h>
+#include <tvm/runtime/trace_event.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../support/process_id.h"
+
+namespace tvm {
+namespace runtime {
+namespace profiling {
+
+namespace detail {
+std::atomic<bool> trace_enabled{false};
+}  // namespace detail
+
+namespace {
+
+/*! \brief A recorded event. */
+struct TraceEvent {
+  /*! \brief The phase of the event, 'X' for complete events and 'C' for counters. */
+  char phase;
+  const char* category;
+  std::string name;
+  int64_t ts_ns;
+  int64_t dur_ns;
+  const char* arg_name;
+  int64_t arg_value;
+};
+
+/*!
+ * \brief The events recorded by a thread.
+ *
+ *  Only the owner thread appends events, to a list of chunks. It publishes each event with a
+ *  release store of the chunk size, so that the writer of the trace can read the published
+ *  events of a running thread. When tracing is restarted, the owner drops its events on its
+ *  next append, and the writer skips the buffers that have not been reset yet.
+ */
+class ThreadTraceBuffer {
+ public:
+  ThreadTraceBuffer(int64_t tid, uint64_t generation)
+      : tid_(tid), head_(new Chunk()), tail_(head_), generation_(generation) {}
+
+  ~ThreadTraceBuffer() { FreeChunks(head_); }
+
+  /*! \brief Append an event, called by the owner thread. */
+  void Append(TraceEvent event, uint64_t generation) {
+    if (generation_.load(std::memory_order_relaxed) != generation) {
+      FreeChunks(head_->next.load(std::memory_order_relaxed));
+      head_->next.store(nullptr, std::memory_order_relaxed);
+      head_->size.store(0, std::memory_order_relaxed);
+      tail_ = head_;
+      generation_.store(generation, std::memory_order_release);
+    }
+    size_t size = tail_->size.load(std::memory_order_relaxed);
+    if (size == kChunkSize) {
+      Chunk* chunk = new Chunk();
+      tail_->next.store(chunk, std::memory_order_release);
+      tail_ = chunk;
+      size = 0;
+    }
+    tail_->events[size] = std::move(event);
+    tail_->size.store(size + 1, std::memory_order_release);
+  }
+
+  /*! \brief Visit the published events, if they are recorded in the given generation. */
+  template <typename FVisit>
+  void Visit(uint64_t generation, FVisit fvisit) const {
+    if (generation_.load(std::memory_order_acquire) != generation) return;
+    for (const Chunk* chunk = head_; chunk != nullptr;
+         chunk = chunk->next.load(std::memory_order_acquire)) {
+      size_t size = chunk->size.load(std::memory_order_acquire);
+      for (size_t i = 0; i < size; ++i) {
+        fvisit(chunk->events[i]);
+      }
+    }
+  }
+
+  int64_t tid() const { return tid_; }
+
+  /*! \brief The name of the thread, guarded by the mutex of the registry. */
+  std::string name;
+  /*! \brief Whether the owner thread has exited, after which the buffer can be freed. */
+  std::atomic<bool> exited{false};
+
+ private:
+  static constexpr size_t kChunkSize = 1024;
+
+  struct Chunk {
+    TraceEvent events[kChunkSize];
+    std::atomic<size_t> size{0};
+    std::atomic<Chunk*> next{nullptr};
+  };
+
+  static void FreeChunks(Chunk* chunk) {
+    while (chunk != nullptr) {
+      Chunk* next = chunk->next.load(std::memory_order_relaxed);
+      delete chunk;
+      chunk = next;
+    }
+  }
+
+  int64_t tid_;
+  Chunk* head_;
+  Chunk* tail_;
+  std::atomic<uint64_t> generation_;
+};
+
+/*! \brief The buffers of all the threads. */
+struct TraceRegistry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadTraceBuffer>> buffers;
+  /*! \brief Incremented on each start, to drop the events recorded before. */
+  std::atomic<uint64_t> generation{0};
+  int64_t next_tid{1};
+
+  static TraceRegistry* Global() {
+    // Leaked, since threads may record events while the static objects are destroyed.
+    static TraceRegistry* inst = new TraceRegistry();
+    return inst;
+  }
+};
+
+/*!
+ * \brief The buffer of a thread, created on its first event so that idle threads take no memory,
+ *  and marked as exited when the thread exits.
+ */
+struct ThreadTraceBufferHolder {
+  ThreadTraceBuffer* buffer{nullptr};
+  /*! \brief The name of the thread, set before the buffer is created. */
+  std::string name;
+
+  ~ThreadTraceBufferHolder() {
+    if (buffer != nullptr) {
+      buffer->exited.store(true, std::memory_order_release);
+    }
+  }
+};
+
+ThreadTraceBufferHolder* LocalHolder() {
+  thread_local ThreadTraceBufferHolder holder;
+  return &holder;
+}
+
+ThreadTraceBuffer* LocalBuffer() {
+  ThreadTraceBufferHolder* holder = LocalHolder();
+  if (holder->buffer == nullptr) {
+    TraceRegistry* registry = TraceRegistry::Global();
+    std::lock_guard<std::mutex> lock(registry->mutex);
+    registry->buffers.emplace_back(new ThreadTraceBuffer(
+        registry->next_tid++, registry->generation.load(std::memory_order_relaxed)));
+    holder->buffer = registry->buffers.back().get();
+    holder->buffer->name = holder->name;
+  }
+  return holder->buffer;
+}
+
+void Record(TraceEvent event) {
+  uint64_t generation = TraceRegistry::Global()->generation.load(std::memory_order_relaxed);
+  LocalBuffer()->Append(std::move(event), generation);
+}
+
+void WriteJSONString(std::ostream& os, const std::string& str) {
+  os << '"';
+  for (unsigned char c : str) {
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (c < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+      os << buf;
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+
+/*! \brief Write a time in nanoseconds as microseconds, the time unit of Chrome traces. */
+void WriteMicroseconds(std::ostream& os, int64_t ns) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.3f", ns / 1000.0);
+  os << buf;
+}
+
+}  // namespace
+
+void StartTrace() {
+  TraceRegistry* registry = TraceRegistry::Global();
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  // The buffers of the exited threads are not referenced by any thread anymore.
+  std::vector<std::unique_ptr<ThreadTraceBuffer>> live_buffers;
+  for (std::unique_ptr<ThreadTraceBuffer>& buffer : registry->buffers) {
+    if (!buffer->exited.load(std::memory_order_acquire)) {
+      live_buffers.push_back(std::move(buffer));
+    }
+  }
+  registry->buffers = std::move(live_buffers);
+  registry->generation.fetch_add(1, std::memory_order_relaxed);
+  detail::trace_enabled.store(true, std::memory_order_release);
+}
+
+void StopTrace() { detail::trace_enabled.store(false, std::memory_order_release); }
+
+void WriteTrace(std::ostream& os) {
+  TraceRegistry* registry = TraceRegistry::Global();
+  std::lock_guard<std::mutex> lock(registry->mutex);
+  uint64_t generation = registry->generation.load(std::memory_order_relaxed);
+  int64_t pid = support::GetProcessId();
+  bool first = true;
+  auto begin_event = [&](const char* phase, int64_t tid) {
+    os << (first ? "\n" : ",\n") << "{\"ph\":\"" << phase << "\",\"pid\":" << pid
+       << ",\"tid\":" << tid;
+    first = false;
+  };
+  os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  for (const std::unique_ptr<ThreadTraceBuffer>& buffer : registry->buffers) {
+    int64_t tid = buffer->tid();
+    if (!buffer->name.empty()) {
+      begin_event("M", tid);
+      os << ",\"name\":\"thread_name\",\"args\":{\"name\":";
+      WriteJSONString(os, buffer->name);
+      os << "}}";
+    }
+    buffer->Visit(generation, [&](const TraceEvent& event) {
+      begin_event(event.phase == 'X' ? "X" : "C", tid);
+      os << ",\"cat\":\"" << event.category << "\",\"name\":";
+      WriteJSONString(os, event.name);
+      os << ",\"ts\":";
+      WriteMicroseconds(os, event.ts_ns);
+      if (event.phase == 'X') {
+        os << ",\"dur\":";
+        WriteMicroseconds(os, event.dur_ns);
+      }
+      if (event.arg_name != nullptr) {
+        os << ",\"args\":{\"" << event.arg_name << "\":" << event.arg_value << "}";
+      }
+      os << "}";
+    });
+  }
+  os << "\n]}\n";
+}
+
+int64_t TraceNow() {
+  // The steady clock is shared by the processes on a machine, so that the traces of the Disco
+  // workers can be merged.
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void RecordTraceComplete(const char* category, std::string name, int64_t begin_ns, int64_t end_ns,
+                         const char* arg_name, int64_t arg_value) {
+  Record(TraceEvent{'X', category, std::move(name), begin_ns, end_ns - begin_ns, arg_name,
+                    arg_value});
+}
+
+void RecordTraceCounter(const char* category, std::string name, int64_t value) {
+  if (!TraceEnabled()) return;
+  // The value of a counter is shown as a series named after the counter.
+  Record(TraceEvent{'C', category, std::move(name), TraceNow(), 0, "value", value});
+}
+
+void SetTraceThreadName(std::string name) {
+  ThreadTraceBufferHolder* holder = LocalHolder();
+  holder->name = std::move(name);
+  if (holder->buffer != nullptr) {
+    std::lock_guard<std::mutex> lock(TraceRegistry::Global()->mutex);
+    holder->buffer->name = holder->name;
+  }
+}
+
+TVM_REGISTER_GLOBAL("runtime.profiling.StartTrace").set_body_typed(StartTrace);
+TVM_REGISTER_GLOBAL("runtime.profiling.StopTrace").set_body_typed(StopTrace);
+TVM_REGISTER_GLOBAL("runtime.profiling.WriteTrace").set_body_typed([](std::string path) {
+  std::ofstream os(path);
+  CHECK(os) << "ValueError: Cannot open " << path << " to write the trace";
+  WriteTrace(os);
+});
+
+}  // namespace profiling
+}  // namespace runtime
+}  // namespace tvm
@@ -0,0 +1,226 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file lz4.h
+ * \brief A fast compressor and decompressor of the LZ4 block format.
+ *
+ *  The blocks are compatible with the LZ4_compress_default and LZ4_decompress_safe functions of
+ *  the reference implementation. The compressor is a plain greedy matcher, which trades some of
+ *  the compression ratio for speed, as it is used for the transfers over the network.
+ */
+#ifndef TVM_SUPPORT_LZ4_H_
+#define TVM_SUPPORT_LZ4_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace tvm {
+namespace support {
+namespace lz4 {
+// The minimum length of a match.
+constexpr size_t kMinMatch = 4;
+// The last bytes of a block are always literals.
+constexpr size_t kLastLiterals = 5;
+// The last match starts at least this many bytes before the end of the block.
+constexpr size_t kMatchStartLimit = 12;
+// The largest offset of a match.
+constexpr size_t kMaxOffset = 65535;
+// The number of bits of the hash table of the compressor.
+constexpr int kHashLog = 16;
+
+inline uint32_t Read32(const uint8_t* ptr) {
+  uint32_t value;
+  std::memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+inline uint64_t Read64(const uint8_t* ptr) {
+  uint64_t value;
+  std::memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+// Hash the first 5 bytes of the sequence, which finds longer matches than hashing the 4 bytes of
+// the shortest match.
+inline uint32_t Hash(uint64_t sequence) {
+  return static_cast<uint32_t>(((sequence << 24) * 889523592379ULL) >> (64 - kHashLog));
+}
+
+// Write the extra bytes of a length that does not fit in the 4 bits of the token.
+inline uint8_t* WriteLength(uint8_t* op, size_t length) {
+  for (; length >= 255; length -= 255) {
+    *op++ = 255;
+  }
+  *op++ = static_cast<uint8_t>(length);
+  return op;
+}
+
+// Read the extra bytes of a length, return false when the input ends first.
+inline bool ReadLength(const uint8_t** ip, const uint8_t* iend, size_t* length) {
+  uint8_t byte;
+  do {
+    if (*ip == iend) return false;
+    byte = *(*ip)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+// Write a sequence of literals followed by a match, the match is omitted when match_length is 0.
+inline uint8_t* WriteSequence(uint8_t* op, const uint8_t* literals, size_t num_literals,
+                              size_t offset, size_t match_length) {
+  uint8_t* token = op++;
+  *token = static_cast<uint8_t>((num_literals < 15 ? num_literals : 15) << 4);
+  if (num_literals >= 15) {
+    op = WriteLength(op, num_literals - 15);
+  }
+  if (num_literals != 0) {
+    std::memcpy(op, literals, num_literals);
+    op += num_literals;
+  }
+  if (match_length != 0) {
+    *op++ = static_cast<uint8_t>(offset);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    size_t length = match_length - kMinMatch;
+    *token |= static_cast<uint8_t>(length < 15 ? length : 15);
+    if (length >= 15) {
+      op = WriteLength(op, length - 15);
+    }
+  }
+  return op;
+}
+}  // namespace lz4
+
+/*!
+ * \brief The largest size of the compressed block of the given number of bytes.
+ * \param nbytes The number of bytes to compress.
+ * \return The bound.
+ */
+inline size_t LZ4CompressBound(size_t nbytes) { return nbytes + nbytes / 255 + 16; }
+
+/*!
+ * \brief Compress bytes to an LZ4 block.
+ * \param data The bytes to compress.
+ * \param nbytes The number of bytes.
+ * \param out The compressed block.
+ */
+inline void LZ4Compress(const void* data, size_t nbytes, std::string* out) {
+  using namespace lz4;
+  const uint8_t* src = static_cast<const uint8_t*>(data);
+  out->resize(LZ4CompressBound(nbytes));
+  uint8_t* op = reinterpret_cast<uint8_t*>(&(*out)[0]);
+  uint8_t* const ostart = op;
+  size_t anchor = 0;
+  if (nbytes > kMatchStartLimit) {
+    std::vector<uint32_t> table(size_t(1) << kHashLog, 0);
+    const size_t match_start_end = nbytes - kMatchStartLimit;
+    const size_t match_end = nbytes - kLastLiterals;
+    size_t ip = 0;
+    // The number of positions searched since the last match.
+    size_t num_searched = 0;
+    while (ip < match_start_end) {
+      uint64_t sequence = Read64(src + ip);
+      uint32_t& entry = table[Hash(sequence)];
+      size_t candidate = entry;
+      entry = static_cast<uint32_t>(ip);
+      if (candidate >= ip || ip - candidate > kMaxOffset ||
+          Read32(src + candidate) != static_cast<uint32_t>(sequence)) {
+        // Skip faster over the bytes that do not compress.
+        ip += 1 + (num_searched++ >> 6);
+        continue;
+      }
+      while (ip > anchor && candidate > 0 && src[ip - 1] == src[candidate - 1]) {
+        --ip;
+        --candidate;
+      }
+      size_t length = kMinMatch;
+      while (ip + length < match_end && src[ip + length] == src[candidate + length]) {
+        ++length;
+      }
+      op = WriteSequence(op, src + anchor, ip - anchor, ip - candidate, length);
+      ip += length;
+      anchor = ip;
+      num_searched = 0;
+      if (ip < match_start_end) {
+        table[Hash(Read64(src + ip - 2))] = static_cast<uint32_t>(ip - 2);
+      }
+    }
+  }
+  op = WriteSequence(op, src + anchor, nbytes - anchor, 0, 0);
+  out->resize(op - ostart);
+}
+
+/*!
+ * \brief Decompress an LZ4 block.
+ * \param data The compressed block.
+ * \param nbytes The number of bytes of the compressed block.
+ * \param out The buffer of the decompressed bytes.
+ * \param out_nbytes The number of decompressed bytes.
+ * \return Whether the block is valid and decompresses to exactly out_nbytes bytes.
+ */
+inline bool LZ4Decompress(const void* data, size_t nbytes, void* out, size_t out_nbytes) {
+  using namespace lz4;
+  const uint8_t* ip = static_cast<const uint8_t*>(data);
+  const uint8_t* const iend = ip + nbytes;
+  uint8_t* op = static_cast<uint8_t*>(out);
+  uint8_t* const ostart = op;
+  uint8_t* const oend = op + out_nbytes;
+  while (ip != iend) {
+    const uint8_t token = *ip++;
+    size_t num_literals = token >> 4;
+    if (num_literals == 15 && !ReadLength(&ip, iend, &num_literals)) return false;
+    if (num_literals > static_cast<size_t>(iend - ip) ||
+        num_literals > static_cast<size_t>(oend - op)) {
+      return false;
+    }
+    std::memcpy(op, ip, num_literals);
+    ip += num_literals;
+    op += num_literals;
+    // The last sequence has no match.
+    if (ip == iend) break;
+    if (iend - ip < 2) return false;
+    size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+    ip += 2;
+    size_t length = token & 15;
+    if (length == 15 && !ReadLength(&ip, iend, &length)) return false;
+    length += kMinMatch;
+    if (offset == 0 || offset > static_cast<size_t>(op - ostart) ||
+        length > static_cast<size_t>(oend - op)) {
+      return false;
+    }
+    // The match overlaps the output when it repeats a short pattern, in which case the bytes from
+    // the start of the match are periodic, and can be copied in chunks of growing size.
+    const uint8_t* match = op - offset;
+    while (length != 0) {
+      size_t chunk = std::min(length, static_cast<size_t>(op - match));
+      std::memcpy(op, match, chunk);
+      op += chunk;
+      length -= chunk;
+    }
+  }
+  return op == oend;
+}
+
+}  // namespace support
+}  // namespace tvm
+#endif  // TVM_SUPPORT_LZ4_H_
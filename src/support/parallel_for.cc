@@ -23,8 +23,14 @@
  */
 #include <tvm/runtime/logging.h>
 #include <tvm/support/parallel_for.h>
+#include <tvm/support/task_pool.h>
 
-#include <future>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
 #include <thread>
 #include <utility>
 #include <vector>
@@ -47,94 +53,120 @@ std::vector<std::vector<int>> rr_partitioner(int begin, int end, int step, int n
   return ret;
 }
 
-void parallel_for(int begin, int end, const std::function<void(int)>& f, int step,
-                  const PartitionerFuncType partitioner) {
-  static bool GLOBAL_PARALLEL_FOR_FLAG{false};
-  static std::mutex M_GLOBAL_PARALLEL_FOR_FLAG;
-  {
-    std::unique_lock<std::mutex> l(M_GLOBAL_PARALLEL_FOR_FLAG);
-    ICHECK(!GLOBAL_PARALLEL_FOR_FLAG) << "There's another parallel_for running. Maybe you're "
-                                      << "currently inside another parallel_for loop.";
-    GLOBAL_PARALLEL_FOR_FLAG = true;
-  }
+namespace {
 
-  int default_num_threads = std::thread::hardware_concurrency();
-  const auto& run_partitions = partitioner(begin, end, step, default_num_threads);
+/*!
+ * \brief The state of a parallel loop shared by the calling thread and the helper jobs it
+ *  enqueues to the task pool. Helper jobs may start after the loop has finished, so they
+ *  hold the state by shared pointer and check `closed` before touching the loop body.
+ */
+struct ParallelLoopState {
+  explicit ParallelLoopState(int begin) : counter(begin) {}
+  /*! \brief The next task to run. */
+  std::atomic<int> counter;
+  /*! \brief Protects the fields below. */
+  std::mutex mutex;
+  /*! \brief Signals that a helper has finished. */
+  std::condition_variable cv;
+  /*! \brief The number of helpers running the loop. */
+  int num_running{0};
+  /*! \brief Whether the loop is finished, helpers that have not started yet do nothing. */
+  bool closed{false};
+  /*! \brief The first error thrown by the loop body. */
+  std::exception_ptr error{nullptr};
+};
 
-  std::vector<std::thread> threads;
-  threads.reserve(run_partitions.size());
-  std::vector<std::future<void>> res_vec;
-  res_vec.reserve(run_partitions.size());
-  for (const auto& run_partition : run_partitions) {
-    std::packaged_task<void(const std::vector<int>&, const std::function<void(int)>&)> task(
-        [](const std::vector<int>& run_partition, const std::function<void(int)>& f) {
-          for (const auto& i : run_partition) {
-            f(i);
-          }
-        });
-    res_vec.emplace_back(task.get_future());
-    threads.emplace_back(std::move(task), run_partition, f);
+/*!
+ * \brief Run the tasks in [begin, end) with the calling thread as participant 0 and up to
+ *  `num_threads - 1` helpers from the task pool. Rethrows the first error of the loop body.
+ */
+void RunParallelLoop(int begin, int end, int num_threads,
+                     const std::function<void(int thread_id, int task_id)>& f,
+                     const CancellationToken* token) {
+  auto state = std::make_shared<ParallelLoopState>(begin);
+  auto worker = [end, &f, token](ParallelLoopState* state, int thread_id) {
+    try {
+      for (int task_id; (task_id = state->counter++) < end;) {
+        if (token != nullptr && token->IsCancelled()) {
+          break;
+        }
+        f(thread_id, task_id);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (state->error == nullptr) {
+        state->error = std::current_exception();
+      }
+      // skip the tasks not started yet
+      state->counter.store(end);
+    }
+  };
+  TaskPool* pool = TaskPool::Global();
+  num_threads = std::min(num_threads, end - begin);
+  for (int thread_id = 1; thread_id < num_threads; ++thread_id) {
+    pool->Enqueue([state, worker, thread_id]() {
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (state->closed) return;
+        ++state->num_running;
+      }
+      worker(state.get(), thread_id);
+      {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        --state->num_running;
+      }
+      state->cv.notify_all();
+    });
   }
-
-  for (auto&& thread : threads) {
-    thread.join();
+  // The calling thread takes part in the loop, so the loop makes progress even when all the
+  // pool threads are busy, e.g. when the loop is nested in another parallel loop.
+  worker(state.get(), 0);
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->closed = true;
+  state->cv.wait(lock, [&state]() { return state->num_running == 0; });
+  std::exception_ptr error = std::move(state->error);
+  lock.unlock();
+  if (error != nullptr) {
+    std::rethrow_exception(error);
   }
-  {
-    std::unique_lock<std::mutex> l(M_GLOBAL_PARALLEL_FOR_FLAG);
-    ICHECK(GLOBAL_PARALLEL_FOR_FLAG);
-    GLOBAL_PARALLEL_FOR_FLAG = false;
+}
+
+}  // namespace
+
+void parallel_for(int begin, int end, const std::function<void(int)>& f, int step,
+                  const PartitionerFuncType partitioner) {
+  int default_num_threads = std::thread::hardware_concurrency();
+  const auto& run_partitions = partitioner(begin, end, step, default_num_threads);
+  int num_partitions = static_cast<int>(run_partitions.size());
+  if (num_partitions == 0) {
+    return;
   }
   try {
-    for (auto&& i : res_vec) {
-      i.get();
-    }
+    RunParallelLoop(
+        0, num_partitions, num_partitions,
+        [&run_partitions, &f](int thread_id, int task_id) {
+          for (const auto& i : run_partitions[task_id]) {
+            f(i);
+          }
+        },
+        nullptr);
   } catch (const std::exception& e) {
     LOG(FATAL) << "Parallel_for error with " << e.what();
   }
 }
 
 void parallel_for_dynamic(int begin, int end, int num_threads,
-                          const std::function<void(int thread_id, int task_id)>& f) {
+                          const std::function<void(int thread_id, int task_id)>& f,
+                          const CancellationToken* token) {
   // Step 1. Sanity checks
   if (begin == end) {
     return;
   }
   CHECK_LE(begin, end) << "ValueError: The interval [begin, end) requires `begin <= end`";
   CHECK_GT(num_threads, 0) << "ValueError: `num_threads` should be positive";
-  // Step 2. Launch threads
-  // Step 2.1. Launch worker 1 to worker `num_threads - 1`
-  std::atomic<int> counter{begin};
-  std::vector<std::future<void>> futures;
-  std::vector<std::thread> threads;
-  futures.reserve(num_threads - 1);
-  threads.reserve(num_threads - 1);
-  auto worker = [end, &counter, &f](int thread_id) -> void {
-    for (int task_id; (task_id = counter++) < end;) {
-      f(thread_id, task_id);
-    }
-  };
-  for (int thread_id = 1; thread_id < num_threads; ++thread_id) {
-    std::packaged_task<void(int)> task(worker);
-    futures.emplace_back(task.get_future());
-    threads.emplace_back(std::move(task), thread_id);
-  }
-  // Step 2.2. Launch worker 0 inplace
+  // Step 2. Run the loop on the calling thread and the task pool
   try {
-    worker(0);
-  } catch (const std::exception& e) {
-    for (auto&& thread : threads) {
-      thread.join();
-    }
-    LOG(FATAL) << "RuntimeError: parallel_for_dynamic error with " << e.what();
-  }
-  // Step 3. Join threads and check exceptions
-  for (auto&& thread : threads) {
-    thread.join();
-  }
-  try {
-    for (auto&& future : futures) {
-      future.get();
-    }
+    RunParallelLoop(begin, end, num_threads, f, token);
   } catch (const std::exception& e) {
     LOG(FATAL) << "RuntimeError: parallel_for_dynamic error with " << e.what();
   }
@@ -0,0 +1,100 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file task_pool.cc
+ * \brief A persistent pool of threads for the compiler-side parallel loops.
+ */
+#include <tvm/runtime/logging.h>
+#include <tvm/support/task_pool.h>
+
+#include <algorithm>
+
+#include "./process_id.h"
+
+namespace tvm {
+namespace support {
+
+/*! \brief The pool the current thread belongs to. */
+static thread_local const TaskPool* current_pool = nullptr;
+
+TaskPool::TaskPool(int num_threads) {
+  ICHECK_GE(num_threads, 1) << "ValueError: A TaskPool needs at least one thread";
+  threads_.reserve(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    threads_.emplace_back([this]() { this->RunWorker(); });
+  }
+}
+
+TaskPool::~TaskPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    exit_ = true;
+  }
+  cv_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+TaskPool* TaskPool::Global() {
+  static std::mutex mutex;
+  static TaskPool* pool = nullptr;
+  static int64_t owner_pid = -1;
+  std::lock_guard<std::mutex> lock(mutex);
+  int64_t pid = GetProcessId();
+  if (pool == nullptr || owner_pid != pid) {
+    // The threads of the parent process do not exist in a forked child, the pool of the parent
+    // is leaked on purpose since its threads cannot be joined.
+    int num_threads = std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+    pool = new TaskPool(num_threads);
+    owner_pid = pid;
+  }
+  return pool;
+}
+
+bool TaskPool::IsPoolThread() const { return current_pool == this; }
+
+void TaskPool::Enqueue(std::function<void()> job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.push_back(std::move(job));
+  }
+  cv_.notify_one();
+}
+
+void TaskPool::RunWorker() {
+  current_pool = this;
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return exit_ || !jobs_.empty(); });
+      if (jobs_.empty()) {
+        return;
+      }
+      job = std::move(jobs_.front());
+      jobs_.pop_front();
+    }
+    job();
+  }
+}
+
+}  // namespace support
+}  // namespace tvm
@@ -0,0 +1,179 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file compile_cache.cc
+ * \brief A persistent cache of the code compiled by the codegens, on the local disk.
+ */
+#include "compile_cache.h"
+
+#include <tvm/ir/transform.h>
+#include <tvm/node/structural_hash.h>
+#include <tvm/runtime/registry.h>
+#include <tvm/tir/function.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../support/process_id.h"
+
+namespace tvm {
+namespace codegen {
+
+TVM_REGISTER_PASS_CONFIG_OPTION("target.compile_cache_dir", String);
+
+std::atomic<int64_t> CompileCache::hits{0};
+std::atomic<int64_t> CompileCache::misses{0};
+
+namespace {
+
+// The 64-bit FNV-1a hash, which is the same on every platform.
+uint64_t HashBytes(const std::string& data, uint64_t hash = 0xCBF29CE484222325ULL) {
+  for (char c : data) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+std::string ToHex(uint64_t value) {
+  std::ostringstream os;
+  os << std::hex << std::setw(16) << std::setfill('0') << value;
+  return os.str();
+}
+
+// Create a directory and its parents.
+bool MakeDirectories(const std::string& dir) {
+  for (size_t pos = dir.find('/', 1);; pos = dir.find('/', pos + 1)) {
+    std::string prefix = dir.substr(0, pos);
+#ifdef _WIN32
+    int ret = _mkdir(prefix.c_str());
+#else
+    int ret = mkdir(prefix.c_str(), 0755);
+#endif
+    if (ret != 0 && errno != EEXIST) return false;
+    if (pos == std::string::npos) return true;
+  }
+}
+
+}  // namespace
+
+CompileCache* CompileCache::Current() {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, std::unique_ptr<CompileCache>> caches;
+  Optional<String> dir =
+      transform::PassContext::Current()->GetConfig<String>("target.compile_cache_dir");
+  if (!dir || dir.value().empty()) return nullptr;
+  std::lock_guard<std::mutex> lock(mutex);
+  std::unique_ptr<CompileCache>& cache = caches[dir.value()];
+  if (cache == nullptr) {
+    CHECK(MakeDirectories(dir.value()))
+        << "ValueError: Cannot create the directory of the compile cache " << dir.value();
+    cache.reset(new CompileCache(dir.value()));
+  }
+  return cache.get();
+}
+
+std::string CompileCache::EntryPath(const std::string& key) const {
+  return dir_ + "/" + ToHex(HashBytes(key)) + ".bin";
+}
+
+bool CompileCache::Get(const std::string& key, std::string* data) {
+  // The entry starts with its key, which is checked against the hash collisions of the file
+  // names.
+  std::ifstream fs(EntryPath(key), std::ios::in | std::ios::binary);
+  std::string content;
+  if (fs) {
+    content.assign(std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>());
+  }
+  if (!fs.bad() && content.size() > key.size() && content.compare(0, key.size(), key) == 0 &&
+      content[key.size()] == '\0') {
+    data->assign(content, key.size() + 1, std::string::npos);
+    ++hits;
+    return true;
+  }
+  ++misses;
+  return false;
+}
+
+void CompileCache::Put(const std::string& key, const std::string& data) {
+  // Write to a temporary file first, so that the other processes never read a partial entry.
+  static std::atomic<int64_t> counter{0};
+  std::string path = EntryPath(key);
+  std::string temp_path = path + ".tmp." + std::to_string(support::GetProcessId()) + "." +
+                          std::to_string(counter++);
+  {
+    std::ofstream fs(temp_path, std::ios::out | std::ios::binary);
+    fs.write(key.data(), key.size());
+    fs.put('\0');
+    fs.write(data.data(), data.size());
+    if (!fs) {
+      std::remove(temp_path.c_str());
+      return;
+    }
+  }
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    std::remove(temp_path.c_str());
+  }
+}
+
+std::string CompileCacheHash(const IRModule& mod) {
+  // The functions are hashed in the order of their names, with the free variables mapped by
+  // their order, so that the hash does not depend on the addresses of the objects.
+  std::vector<std::pair<std::string, BaseFunc>> funcs;
+  for (const auto& [gvar, func] : mod->functions) {
+    funcs.emplace_back(gvar->name_hint, func);
+  }
+  std::sort(funcs.begin(), funcs.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+  uint64_t hash = HashBytes(ToHex(SHashHandlerDefault().Hash(mod->attrs, true)));
+  for (const auto& [name, func] : funcs) {
+    hash = HashBytes(name, hash);
+    hash = HashBytes(ToHex(SHashHandlerDefault().Hash(func, true)), hash);
+  }
+  return ToHex(hash);
+}
+
+std::string CompileCacheHash(const std::string& data) { return ToHex(HashBytes(data)); }
+
+TVM_REGISTER_GLOBAL("target.CompileCacheStats").set_body_typed([]() {
+  return Map<String, Integer>{{"hits", Integer(CompileCache::hits.load())},
+                              {"misses", Integer(CompileCache::misses.load())}};
+});
+
+TVM_REGISTER_GLOBAL("target.ResetCompileCacheStats").set_body_typed([]() {
+  CompileCache::hits = 0;
+  CompileCache::misses = 0;
+});
+
+}  // namespace codegen
+}  // namespace tvm
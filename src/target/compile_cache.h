@@ -0,0 +1,105 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file compile_cache.h
+ * \brief A persistent cache of the code compiled by the codegens, on the local disk.
+ *
+ *  The cache is enabled by the pass config option "target.compile_cache_dir", the directory of
+ *  the cache. The codegens key the entries on everything that their output depends on, such as
+ *  the structural hash of the PrimFuncs, the target and the version of the compiler, so that the
+ *  entries never need to be invalidated.
+ *
+ *  The hashes in the keys are 64-bit FNV-1a hashes (see CompileCacheHash), which are not
+ *  cryptographic: a collision, though unlikely, returns the code of another module, and a cache
+ *  directory shared with untrusted users can be poisoned. Each entry starts with its full key,
+ *  i.e. the target, the compiler and the full 64-bit hashes, which is compared on lookup, so the
+ *  collisions of the file names, which are hashes of the keys, are detected.
+ */
+#ifndef TVM_TARGET_COMPILE_CACHE_H_
+#define TVM_TARGET_COMPILE_CACHE_H_
+
+#include <tvm/ir/module.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace tvm {
+namespace codegen {
+
+/*! \brief A persistent cache of compiled code. */
+class CompileCache {
+ public:
+  /*!
+   * \brief Get the cache of the current PassContext.
+   * \return The cache, or nullptr when the cache is not enabled.
+   */
+  static CompileCache* Current();
+
+  /*!
+   * \brief Get an entry.
+   * \param key The key.
+   * \param data The data of the entry.
+   * \return Whether the entry is found.
+   */
+  bool Get(const std::string& key, std::string* data);
+
+  /*!
+   * \brief Put an entry. Errors are ignored, as the entry is only missed again.
+   * \param key The key.
+   * \param data The data of the entry.
+   */
+  void Put(const std::string& key, const std::string& data);
+
+  /*! \brief The number of hits and misses of all the caches. */
+  static std::atomic<int64_t> hits;
+  static std::atomic<int64_t> misses;
+
+ private:
+  explicit CompileCache(std::string dir) : dir_(std::move(dir)) {}
+
+  std::string EntryPath(const std::string& key) const;
+
+  /*! \brief The directory of the cache. */
+  std::string dir_;
+};
+
+/*!
+ * \brief Hash the functions of an IRModule and the attributes of the IRModule.
+ *
+ *  The hash does not depend on the order of the functions, or on the addresses of the objects,
+ *  so it is the same in every process. It is a 64-bit non-cryptographic hash.
+ *
+ * \param mod The IRModule.
+ * \return The hash, in hexadecimal.
+ */
+std::string CompileCacheHash(const IRModule& mod);
+
+/*!
+ * \brief Hash a string, for the keys of the content of generated code.
+ * \param data The string.
+ * \return The hash, in hexadecimal.
+ */
+std::string CompileCacheHash(const std::string& data);
+
+}  // namespace codegen
+}  // namespace tvm
+#endif  // TVM_TARGET_COMPILE_CACHE_H_
@@ -26,7 +26,9 @@
 #include <dmlc/io.h>
 #include <llvm/ADT/SmallString.h>
 #include <llvm/ADT/StringRef.h>
+#include <llvm/Bitcode/BitcodeReader.h>
 #include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Config/llvm-config.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 #include <llvm/ExecutionEngine/MCJIT.h>
 #include <llvm/ExecutionEngine/Orc/LLJIT.h>
@@ -54,6 +56,7 @@
 #include <llvm/Target/TargetOptions.h>
 #include <llvm/Transforms/Utils/Cloning.h>
 #include <tvm/ir/module.h>
+#include <tvm/ir/transform.h>
 #include <tvm/runtime/container/array.h>
 #include <tvm/runtime/container/string.h>
 #include <tvm/runtime/logging.h>
@@ -61,21 +64,28 @@
 #include <tvm/runtime/object.h>
 #include <tvm/runtime/packed_func.h>
 #include <tvm/runtime/registry.h>
+#include <tvm/runtime/threading_backend.h>
+#include <tvm/support/parallel_for.h>
 #include <tvm/support/with.h>
 #include <tvm/target/codegen.h>
 #include <tvm/target/target.h>
+#include <tvm/tir/stmt_functor.h>
 
 #include <algorithm>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <sstream>
 #include <string>
 #include <system_error>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "../../runtime/file_utils.h"
 #include "../../runtime/library_module.h"
+#include "../compile_cache.h"
 #include "codegen_blob.h"
 #include "codegen_cpu.h"
 #include "codegen_llvm.h"
@@ -88,6 +98,8 @@ using runtime::PackedFunc;
 using runtime::TVMArgs;
 using runtime::TVMRetValue;
 
+TVM_REGISTER_PASS_CONFIG_OPTION("llvm.codegen_threads", Integer);
+
 class LLVMModuleNode final : public runtime::ModuleNode {
  public:
   ~LLVMModuleNode();
@@ -108,6 +120,15 @@ class LLVMModuleNode final : public runtime::ModuleNode {
 
   void Init(const IRModule& mod, const Target& target);
   void Init(std::unique_ptr<llvm::Module> module, std::unique_ptr<LLVMInstance> llvm_instance);
+  /*!
+   * \brief Initialize the module from the partitions of an IRModule, generating the code of the
+   *  partitions in parallel, each in its own LLVM context.
+   * \param parts The partitions. This module generates the first one, and imports a module for
+   *  each of the others, which export_library saves and links like the other DSO modules.
+   * \param target The target.
+   * \param num_threads The number of threads.
+   */
+  void InitPartitioned(const std::vector<IRModule>& parts, const Target& target, int num_threads);
   void LoadIR(const std::string& file_name);
 
   bool ImplementsFunction(const String& name, bool query_imports) final;
@@ -120,6 +141,8 @@ class LLVMModuleNode final : public runtime::ModuleNode {
   bool IsCompatibleWithHost(const llvm::TargetMachine* tm) const;
   void* GetGlobalAddr(const std::string& name, const LLVMTarget& llvm_target) const;
   void* GetFunctionAddr(const std::string& name, const LLVMTarget& llvm_target) const;
+  void CodeGen(const IRModule& mod, LLVMTarget* llvm_target, CompileCache* cache);
+  bool LoadFromCache(const std::string& key, LLVMTarget* llvm_target, CompileCache* cache);
 
   // The LLVM scope object.
   std::unique_ptr<LLVMInstance> llvm_instance_;
@@ -136,6 +159,11 @@ class LLVMModuleNode final : public runtime::ModuleNode {
   /* \brief names of the external functions declared in this module */
   Array<String> function_names_;
   std::string jit_engine_;
+  // The other partitions of the IRModule, which are imported by this module.
+  std::vector<LLVMModuleNode*> partitions_;
+  // The module whose imports the JITed functions look up, when this module is a partition of
+  // another. Its functions are returned by the other module, which keeps it alive.
+  runtime::ModuleNode* context_module_{nullptr};
 };
 
 LLVMModuleNode::~LLVMModuleNode() {
@@ -195,7 +223,14 @@ PackedFunc LLVMModuleNode::GetFunction(const String& name, const ObjectPtr<Objec
   } else {
     faddr = reinterpret_cast<TVMBackendPackedCFunc>(GetFunctionAddr(name, *llvm_target));
   }
-  if (faddr == nullptr) return PackedFunc();
+  if (faddr == nullptr) {
+    for (LLVMModuleNode* partition : partitions_) {
+      if (partition->ImplementsFunction(name, false)) {
+        return partition->GetFunction(name, sptr_to_self);
+      }
+    }
+    return PackedFunc();
+  }
   return WrapPackedFunc(faddr, sptr_to_self);
 }
 
@@ -303,13 +338,21 @@ String LLVMModuleNode::GetSource(const String& format) {
         << "Cannot emit target CodeGenFileType::AssemblyFile";
 #endif
     pass.run(*m);
-    return rso.str().str();
+    std::string source = rso.str().str();
+    for (LLVMModuleNode* partition : partitions_) {
+      source += partition->GetSource(format);
+    }
+    return source;
   } else if (fmt == "" || fmt == "ll") {
     std::string type_str;
     llvm::raw_string_ostream rso(type_str);
     ICHECK(module_ != nullptr);
     module_->print(rso, nullptr);
-    return rso.str();
+    std::string source = rso.str();
+    for (LLVMModuleNode* partition : partitions_) {
+      source += partition->GetSource(format);
+    }
+    return source;
   } else {
     LOG(FATAL) << "Do not know how to get source code with format: " << format << "\'";
   }
@@ -319,8 +362,48 @@ String LLVMModuleNode::GetSource(const String& format) {
 void LLVMModuleNode::Init(const IRModule& mod, const Target& target) {
   llvm_instance_ = std::make_unique<LLVMInstance>();
   With<LLVMTarget> llvm_target(*llvm_instance_, target);
+  CodeGen(mod, llvm_target.get(), CompileCache::Current());
+}
+
+void LLVMModuleNode::InitPartitioned(const std::vector<IRModule>& parts, const Target& target,
+                                     int num_threads) {
+  std::vector<LLVMModuleNode*> nodes = {this};
+  std::vector<ObjectPtr<LLVMModuleNode>> others;
+  for (size_t i = 1; i < parts.size(); ++i) {
+    others.push_back(make_object<LLVMModuleNode>());
+    nodes.push_back(others.back().get());
+  }
+  // The LLVM targets apply the LLVM command line options of the target on construction, and
+  // revert them on destruction, so they are created on this thread, and destroyed in the
+  // reverse order.
+  std::vector<std::unique_ptr<LLVMTarget>> llvm_targets;
+  for (LLVMModuleNode* node : nodes) {
+    node->llvm_instance_ = std::make_unique<LLVMInstance>();
+    llvm_targets.push_back(std::make_unique<LLVMTarget>(*node->llvm_instance_, target));
+    llvm_targets.back()->GetOrCreateTargetMachine();
+  }
+  // The PassContext is thread local, so the cache is looked up on this thread.
+  CompileCache* cache = CompileCache::Current();
+  support::parallel_for_dynamic(0, static_cast<int>(nodes.size()), num_threads,
+                                [&](int thread_id, int task_id) {
+                                  nodes[task_id]->CodeGen(parts[task_id],
+                                                          llvm_targets[task_id].get(), cache);
+                                });
+  while (!llvm_targets.empty()) {
+    llvm_targets.pop_back();
+  }
+  for (const ObjectPtr<LLVMModuleNode>& other : others) {
+    for (const String& name : other->function_names_) {
+      function_names_.push_back(name);
+    }
+    other->context_module_ = this;
+    partitions_.push_back(other.get());
+    Import(runtime::Module(other));
+  }
+}
+
+void LLVMModuleNode::CodeGen(const IRModule& mod, LLVMTarget* llvm_target, CompileCache* cache) {
   llvm::TargetMachine* tm = llvm_target->GetOrCreateTargetMachine();
-  std::unique_ptr<CodeGenLLVM> cg = CodeGenLLVM::Create(llvm_target.get());
 
   std::string entry_func;
 
@@ -344,11 +427,23 @@ void LLVMModuleNode::Init(const IRModule& mod, const Target& target) {
       }
     }
   }
+  // The cached bitcode is the optimized module, with the metadata of the target, so it only needs
+  // to be parsed.
+  std::string key;
+  if (cache != nullptr) {
+    key = "llvm\n" + llvm_target->str() + "\n" LLVM_VERSION_STRING "\n" TVM_VERSION "\n" +
+          CompileCacheHash(mod);
+    if (LoadFromCache(key, llvm_target, cache)) {
+      return;
+    }
+  }
+
   // TODO(@jroesch): follow up on this condition.
   // ICHECK(funcs.size() > 0);
   // TODO(tqchen): remove the entry function behavior as it does not
   // makes sense when we start to use multiple modules.
-  cg->Init("TVMMod", llvm_target.get(), system_lib_prefix, system_lib_prefix.defined(), false);
+  std::unique_ptr<CodeGenLLVM> cg = CodeGenLLVM::Create(llvm_target);
+  cg->Init("TVMMod", llvm_target, system_lib_prefix, system_lib_prefix.defined(), false);
   cg->SetFastMathFlags(llvm_target->GetFastMathFlags());
 
   cg->AddFunctionsOrdered(mod->functions.begin(), mod->functions.end());
@@ -371,6 +466,36 @@ void LLVMModuleNode::Init(const IRModule& mod, const Target& target) {
 
   module_->addModuleFlag(llvm::Module::Override, "Dwarf Version",
                          tm->getTargetTriple().isOSDarwin() ? 2 : 4);
+
+  if (cache != nullptr) {
+    std::string bitcode;
+    llvm::raw_string_ostream os(bitcode);
+#if TVM_LLVM_VERSION <= 60
+    llvm::WriteBitcodeToFile(module_, os);
+#else
+    llvm::WriteBitcodeToFile(*module_, os);
+#endif
+    os.flush();
+    cache->Put(key, bitcode);
+  }
+}
+
+bool LLVMModuleNode::LoadFromCache(const std::string& key, LLVMTarget* llvm_target,
+                                   CompileCache* cache) {
+  std::string bitcode;
+  if (!cache->Get(key, &bitcode)) {
+    return false;
+  }
+  llvm::Expected<std::unique_ptr<llvm::Module>> module = llvm::parseBitcodeFile(
+      llvm::MemoryBufferRef(bitcode, "compile_cache"), *llvm_target->GetContext());
+  if (!module) {
+    LOG(WARNING) << "Cannot parse the cached bitcode: " << llvm::toString(module.takeError());
+    return false;
+  }
+  module_owning_ptr_ = std::move(module.get());
+  module_ = module_owning_ptr_.get();
+  jit_engine_ = llvm_target->GetJITEngine();
+  return true;
 }
 
 void LLVMModuleNode::Init(std::unique_ptr<llvm::Module> module,
@@ -437,7 +562,7 @@ void LLVMModuleNode::InitMCJIT() {
 
   if (void** ctx_addr =
           reinterpret_cast<void**>(GetGlobalAddr(runtime::symbol::tvm_module_ctx, *llvm_target))) {
-    *ctx_addr = this;
+    *ctx_addr = context_module_ != nullptr ? context_module_ : this;
   }
   runtime::InitContextFunctions(
       [this, &llvm_target](const char* name) { return GetGlobalAddr(name, *llvm_target); });
@@ -557,7 +682,7 @@ void LLVMModuleNode::InitORCJIT() {
 
   if (void** ctx_addr =
           reinterpret_cast<void**>(GetGlobalAddr(runtime::symbol::tvm_module_ctx, *llvm_target))) {
-    *ctx_addr = this;
+    *ctx_addr = context_module_ != nullptr ? context_module_ : this;
   }
   runtime::InitContextFunctions(
       [this, &llvm_target](const char* name) { return GetGlobalAddr(name, *llvm_target); });
@@ -614,10 +739,130 @@ void* LLVMModuleNode::GetFunctionAddr(const std::string& name,
   return nullptr;
 }
 
+namespace {
+
+/*!
+ * \brief Split the PrimFuncs of an IRModule into partitions of about the same size, whose code
+ *  can be generated independently.
+ *
+ *  The PrimFuncs that refer to each other, by GlobalVar or by global symbol, are kept in the same
+ *  partition. The entry function is always in the first partition.
+ *
+ * \param mod The IRModule.
+ * \param max_parts The maximum number of partitions.
+ * \return The partitions.
+ */
+std::vector<IRModule> PartitionForCodeGen(const IRModule& mod, int max_parts) {
+  std::vector<GlobalVar> gvars;
+  std::vector<PrimFunc> funcs;
+  std::unordered_map<const GlobalVarNode*, int> gvar_index;
+  std::unordered_map<std::string, int> symbol_index;
+  for (const auto& kv : mod->functions) {
+    if (const auto* func = kv.second.as<PrimFuncNode>()) {
+      gvar_index[kv.first.get()] = static_cast<int>(funcs.size());
+      if (auto global_symbol = func->GetAttr<String>(tvm::attr::kGlobalSymbol)) {
+        symbol_index[global_symbol.value()] = static_cast<int>(funcs.size());
+      }
+      gvars.push_back(kv.first);
+      funcs.push_back(GetRef<PrimFunc>(func));
+    }
+  }
+
+  // Union the functions that refer to each other, and estimate the size of each function by the
+  // number of its nodes.
+  std::vector<int> parent(funcs.size());
+  std::iota(parent.begin(), parent.end(), 0);
+  std::function<int(int)> find = [&](int i) {
+    return parent[i] == i ? i : parent[i] = find(parent[i]);
+  };
+  std::vector<int64_t> sizes(funcs.size(), 0);
+  int entry = -1;
+  for (size_t i = 0; i < funcs.size(); ++i) {
+    if (funcs[i]->HasNonzeroAttr(tir::attr::kIsEntryFunc)) {
+      entry = static_cast<int>(i);
+    }
+    tir::PostOrderVisit(funcs[i]->body, [&](const ObjectRef& node) {
+      ++sizes[i];
+      const auto* call = node.as<tir::CallNode>();
+      if (call == nullptr) {
+        return;
+      }
+      int callee = -1;
+      if (const auto* gvar = call->op.as<GlobalVarNode>()) {
+        auto it = gvar_index.find(gvar);
+        callee = it != gvar_index.end() ? it->second : -1;
+      } else if (call->args.size() > 0) {
+        if (const auto* name = call->args[0].as<tir::StringImmNode>()) {
+          auto it = symbol_index.find(name->value);
+          callee = it != symbol_index.end() ? it->second : -1;
+        }
+      }
+      if (callee != -1) {
+        parent[find(callee)] = find(static_cast<int>(i));
+      }
+    });
+  }
+
+  std::vector<std::vector<int>> components(funcs.size());
+  std::vector<int64_t> component_sizes(funcs.size(), 0);
+  for (size_t i = 0; i < funcs.size(); ++i) {
+    components[find(static_cast<int>(i))].push_back(static_cast<int>(i));
+    component_sizes[find(static_cast<int>(i))] += sizes[i];
+  }
+  std::vector<int> roots;
+  for (size_t i = 0; i < funcs.size(); ++i) {
+    if (!components[i].empty()) {
+      roots.push_back(static_cast<int>(i));
+    }
+  }
+  // Assign the largest components first, each to the partition that is the smallest so far.
+  std::stable_sort(roots.begin(), roots.end(),
+                   [&](int lhs, int rhs) { return component_sizes[lhs] > component_sizes[rhs]; });
+  int num_parts = std::min(max_parts, static_cast<int>(roots.size()));
+  std::vector<Map<GlobalVar, BaseFunc>> part_funcs(std::max(num_parts, 1));
+  std::vector<int64_t> part_sizes(part_funcs.size(), 0);
+  for (int root : roots) {
+    int part = static_cast<int>(std::min_element(part_sizes.begin(), part_sizes.end()) -
+                                part_sizes.begin());
+    if (entry != -1 && find(entry) == root) {
+      part = 0;
+    }
+    part_sizes[part] += component_sizes[root];
+    for (int i : components[root]) {
+      part_funcs[part].Set(gvars[i], funcs[i]);
+    }
+  }
+
+  std::vector<IRModule> parts;
+  for (const Map<GlobalVar, BaseFunc>& functions : part_funcs) {
+    if (parts.empty() || !functions.empty()) {
+      parts.push_back(IRModule(functions, mod->source_map, mod->attrs, mod->global_infos));
+    }
+  }
+  return parts;
+}
+
+}  // namespace
+
 TVM_REGISTER_GLOBAL("target.build.llvm")
     .set_body_typed([](IRModule mod, Target target) -> runtime::Module {
       auto n = make_object<LLVMModuleNode>();
-      n->Init(mod, target);
+      int num_threads = tvm::transform::PassContext::Current()
+                            ->GetConfig<Integer>("llvm.codegen_threads", Integer(1))
+                            .value()
+                            ->value;
+      if (num_threads <= 0) {
+        num_threads = runtime::threading::MaxConcurrency();
+      }
+      std::vector<IRModule> parts;
+      if (num_threads > 1) {
+        parts = PartitionForCodeGen(mod, num_threads);
+      }
+      if (parts.size() > 1) {
+        n->InitPartitioned(parts, target, num_threads);
+      } else {
+        n->Init(mod, target);
+      }
       return runtime::Module(n);
     });
 
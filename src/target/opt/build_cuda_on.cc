@@ -26,6 +26,7 @@
 #if defined(__linux__)
 #include <sys/stat.h>
 #endif
+#include <cuda.h>
 #include <cuda_runtime.h>
 #include <nvrtc.h>
 
@@ -34,6 +35,7 @@
 #include "../../runtime/cuda/cuda_common.h"
 #include "../../runtime/cuda/cuda_module.h"
 #include "../build_common.h"
+#include "../compile_cache.h"
 #include "../source/codegen_cuda.h"
 
 namespace tvm {
@@ -78,10 +80,8 @@ std::string FindCUDAIncludePath() {
   return cuda_include_path;
 }
 
-std::string NVRTCCompile(const std::string& code, bool include_path = false) {
-  std::vector<std::string> compile_params;
-  std::vector<const char*> param_cstrings{};
-  nvrtcProgram prog;
+// The compute capability of the device that NVRTC compiles for.
+std::string NVRTCComputeCapability() {
   std::string cc = "30";
   int major, minor;
   cudaError_t e1 = cudaDeviceGetAttribute(&major, cudaDevAttrComputeCapabilityMajor, 0);
@@ -93,6 +93,14 @@ std::string NVRTCCompile(const std::string& code, bool include_path = false) {
     LOG(WARNING) << "cannot detect compute capability from your device, "
                  << "fall back to compute_30.";
   }
+  return cc;
+}
+
+std::string NVRTCCompile(const std::string& code, const std::string& cc,
+                         bool include_path = false) {
+  std::vector<std::string> compile_params;
+  std::vector<const char*> param_cstrings{};
+  nvrtcProgram prog;
 
   compile_params.push_back("-arch=compute_" + cc);
 
@@ -155,18 +163,52 @@ runtime::Module BuildCUDA(IRModule mod, Target target) {
   }
   std::string fmt = "ptx";
   std::string ptx;
+  const auto* f_compile = Registry::Get("tvm_callback_cuda_compile");
+  std::string cc = f_compile == nullptr ? NVRTCComputeCapability() : "";
+  // The compiled code is keyed on the source, which is all that the compilers read besides the
+  // target, and on the version of the compiler and the architecture it compiles for. The
+  // callback reports them by tvm_callback_cuda_compile_version, without which its code is not
+  // cached.
+  CompileCache* cache = CompileCache::Current();
+  std::string compiler;
+  std::string key;
+  if (cache != nullptr) {
+    if (f_compile == nullptr) {
+      int nvrtc_major, nvrtc_minor;
+      NVRTC_CALL(nvrtcVersion(&nvrtc_major, &nvrtc_minor));
+      compiler = "nvrtc " + std::to_string(nvrtc_major) + "." + std::to_string(nvrtc_minor) +
+                 " cuda " + std::to_string(CUDA_VERSION) + " compute_" + cc;
+    } else if (const auto* f_version = Registry::Get("tvm_callback_cuda_compile_version")) {
+      compiler = "callback " + (*f_version)(target).operator std::string();
+    } else {
+      cache = nullptr;
+    }
+  }
+  if (cache != nullptr) {
+    key = "cuda\n" + target->str() + "\n" TVM_VERSION "\n" + compiler + "\n" +
+          CompileCacheHash(mod) + "\n" + CompileCacheHash(code);
+    std::string entry;
+    if (cache->Get(key, &entry)) {
+      size_t pos = entry.find('\n');
+      return CUDAModuleCreate(entry.substr(pos + 1), entry.substr(0, pos), ExtractFuncInfo(mod),
+                              code);
+    }
+  }
   const auto* f_enter = Registry::Get("target.TargetEnterScope");
   (*f_enter)(target);
-  if (const auto* f = Registry::Get("tvm_callback_cuda_compile")) {
-    ptx = (*f)(code, target).operator std::string();
+  if (f_compile != nullptr) {
+    ptx = (*f_compile)(code, target).operator std::string();
     // Dirty matching to check PTX vs cubin.
     // TODO(tqchen) more reliable checks
     if (ptx[0] != '/') fmt = "cubin";
   } else {
-    ptx = NVRTCCompile(code, cg.need_include_path());
+    ptx = NVRTCCompile(code, cc, cg.need_include_path());
   }
   const auto* f_exit = Registry::Get("target.TargetExitScope");
   (*f_exit)(target);
+  if (cache != nullptr) {
+    cache->Put(key, fmt + "\n" + ptx);
+  }
   return CUDAModuleCreate(ptx, fmt, ExtractFuncInfo(mod), code);
 }
 
@@ -20,7 +20,9 @@
 #include <gtest/gtest.h>
 #include <tvm/runtime/logging.h>
 #include <tvm/support/parallel_for.h>
+#include <tvm/support/task_pool.h>
 
+#include <atomic>
 #include <thread>
 #include <vector>
 
@@ -91,20 +93,17 @@ TEST(ParallelFor, NestedWithNormalForLoop) {
 }
 
 TEST(ParallelFor, NestedWithParallelFor) {
-  // Currently do not support using nested parallel_for
   using tvm::support::parallel_for;
 
-  bool exception = false;
-  try {
-    parallel_for(0, 100, [](int i) {
-      parallel_for(0, 100, [](int j) {
-        // Blank loop
-      });
-    });
-  } catch (const std::exception& e) {
-    exception = true;
+  std::vector<std::vector<int>> a(100, std::vector<int>(100, 0));
+  parallel_for(0, 100, [&a](int i) {
+    parallel_for(0, 100, [&a, i](int j) { a[i][j] = i * j; });
+  });
+  for (int i = 0; i < 100; i++) {
+    for (int j = 0; j < 100; j++) {
+      ICHECK_EQ(a[i][j], i * j);
+    }
   }
-  ICHECK(exception);
 }
 
 TEST(ParallelFor, Exception) {
@@ -157,3 +156,49 @@ TEST(ParallelForDynamic, ExceptionOnArbitrary) {
   }
   ICHECK(exception);
 }
+
+TEST(ParallelForDynamic, Nested) {
+  using tvm::support::parallel_for_dynamic;
+  int num_threads = std::thread::hardware_concurrency();
+  std::vector<std::atomic<int>> a(64);
+  parallel_for_dynamic(0, 64, num_threads, [&](int thread_id, int i) {
+    parallel_for_dynamic(0, 64, num_threads, [&a, i](int thread_id, int j) { a[i] += j; });
+  });
+  for (int i = 0; i < 64; i++) {
+    ICHECK_EQ(a[i].load(), 64 * 63 / 2);
+  }
+}
+
+TEST(ParallelForDynamic, Cancel) {
+  using tvm::support::CancellationToken;
+  using tvm::support::parallel_for_dynamic;
+  CancellationToken token;
+  std::atomic<int> num_run{0};
+  parallel_for_dynamic(
+      0, 1000, 1,
+      [&](int thread_id, int task_id) {
+        if (++num_run == 10) {
+          token.Cancel();
+        }
+      },
+      &token);
+  ICHECK_EQ(num_run.load(), 10);
+}
+
+TEST(TaskPool, Enqueue) {
+  using tvm::support::TaskPool;
+  TaskPool pool(2);
+  std::atomic<int> num_in_pool{0};
+  std::atomic<int> num_done{0};
+  for (int i = 0; i < 16; i++) {
+    pool.Enqueue([&]() {
+      num_in_pool += pool.IsPoolThread();
+      ++num_done;
+    });
+  }
+  while (num_done.load() != 16) {
+    std::this_thread::yield();
+  }
+  ICHECK_EQ(num_in_pool.load(), 16);
+  ICHECK(!pool.IsPoolThread());
+}
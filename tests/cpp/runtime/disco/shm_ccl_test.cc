@@ -0,0 +1,156 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifdef TVM_DISCO_SHM_ENABLED
+
+#include <gtest/gtest.h>
+#include <tvm/runtime/disco/builtin.h>
+#include <tvm/runtime/disco/disco_worker.h>
+#include <tvm/runtime/disco/session.h>
+#include <tvm/runtime/logging.h>
+#include <tvm/runtime/registry.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+
+namespace {
+
+TVM_REGISTER_GLOBAL("testing.shm_ccl.fill").set_body_typed([](NDArray array) {
+  float* data = static_cast<float*>(array->data);
+  int64_t numel = array.Shape()->Product();
+  for (int64_t i = 0; i < numel; ++i) {
+    data[i] = static_cast<float>(i % 7 + WorkerId());
+  }
+});
+
+TVM_REGISTER_GLOBAL("testing.shm_ccl.count_sum_mismatches").set_body_typed([](NDArray array) {
+  const float* data = static_cast<const float*>(array->data);
+  int64_t numel = array.Shape()->Product();
+  int64_t n = DiscoWorker::ThreadLocal()->num_workers;
+  int64_t num_mismatches = 0;
+  for (int64_t i = 0; i < numel; ++i) {
+    num_mismatches += data[i] != static_cast<float>(n * (i % 7) + n * (n - 1) / 2);
+  }
+  return num_mismatches;
+});
+
+Session CreateSession(int num_workers) {
+  Session sess = Session::ThreadedSession(num_workers, 1);
+  std::vector<int64_t> device_ids(num_workers, 0);
+  sess->InitCCL("shm", ShapeTuple(device_ids));
+  return sess;
+}
+
+DRef Empty(const Session& sess, int64_t numel) {
+  DRef func = sess->GetGlobalFunc("runtime.disco.empty");
+  ShapeTuple shape{numel};
+  return sess->CallPacked(func, shape, DataType::Float(32), Device{kDLCPU, 0}, false, false);
+}
+
+void SyncAll(const Session& sess) {
+  for (int i = 0; i < sess->GetNumWorkers(); ++i) {
+    sess->SyncWorker(i);
+  }
+}
+
+}  // namespace
+
+TEST(ShmCCL, AllReduceAcrossChunks) {
+  constexpr int kNumWorkers = 3;
+  // Larger than a slot, and not divisible by the number of workers.
+  constexpr int64_t kNumel = (3 << 20) + 5;
+  Session sess = CreateSession(kNumWorkers);
+  DRef send = Empty(sess, kNumel);
+  DRef recv = Empty(sess, kNumel);
+  sess->CallPacked(sess->GetGlobalFunc("testing.shm_ccl.fill"), send);
+  ShapeTuple sum{static_cast<int64_t>(ReduceKind::kSum)};
+  sess->CallPacked(sess->GetGlobalFunc("runtime.disco.allreduce"), send, sum, false, recv);
+  DRef mismatches =
+      sess->CallPacked(sess->GetGlobalFunc("testing.shm_ccl.count_sum_mismatches"), recv);
+  for (int i = 0; i < kNumWorkers; ++i) {
+    EXPECT_EQ(mismatches->DebugGetFromRemote(i).operator int64_t(), 0) << "worker " << i;
+  }
+  sess->Shutdown();
+}
+
+TEST(ShmCCL, AllReduceMismatchedDataTypes) {
+  const PackedFunc* allreduce = Registry::Get("runtime.disco.shm.allreduce");
+  ASSERT_NE(allreduce, nullptr);
+  NDArray send = NDArray::Empty({16}, DataType::Float(32), Device{kDLCPU, 0});
+  NDArray recv = NDArray::Empty({16}, DataType::Int(32), Device{kDLCPU, 0});
+  // The buffers are checked before the shared memory is used.
+  try {
+    (*allreduce)(send, static_cast<int>(ReduceKind::kSum), false, recv);
+    FAIL() << "The allreduce of mismatched data types should fail";
+  } catch (const Error& e) {
+    EXPECT_NE(std::string(e.what()).find("data type of buffer `recv`"), std::string::npos)
+        << e.what();
+  }
+}
+
+TEST(ShmCCL, DISABLED_BenchmarkBandwidth) {
+  // The number of workers, 4 by default.
+  const char* env = std::getenv("TVM_BENCHMARK_SHM_CCL_WORKERS");
+  int num_workers = env != nullptr ? std::atoi(env) : 4;
+  Session sess = CreateSession(num_workers);
+  DRef allreduce = sess->GetGlobalFunc("runtime.disco.allreduce");
+  DRef allgather = sess->GetGlobalFunc("runtime.disco.allgather");
+  DRef broadcast = sess->GetGlobalFunc("runtime.disco.broadcast_from_worker0");
+  ShapeTuple sum{static_cast<int64_t>(ReduceKind::kSum)};
+  for (int64_t nbytes = 4 << 10; nbytes <= 64 << 20; nbytes *= 4) {
+    int64_t numel = nbytes / sizeof(float);
+    DRef send = Empty(sess, numel);
+    DRef recv = Empty(sess, numel);
+    DRef gathered = Empty(sess, numel * num_workers);
+    int num_iters = static_cast<int>(std::max<int64_t>(4, (256 << 20) / nbytes));
+    for (const std::string& name : {"allreduce", "allgather", "broadcast"}) {
+      auto run = [&]() {
+        if (name == "allreduce") {
+          sess->CallPacked(allreduce, send, sum, false, recv);
+        } else if (name == "allgather") {
+          sess->CallPacked(allgather, send, false, gathered);
+        } else {
+          sess->CallPacked(broadcast, send, false, recv);
+        }
+      };
+      run();
+      SyncAll(sess);
+      auto start = std::chrono::high_resolution_clock::now();
+      for (int i = 0; i < num_iters; ++i) {
+        run();
+      }
+      SyncAll(sess);
+      auto end = std::chrono::high_resolution_clock::now();
+      double secs = std::chrono::duration<double>(end - start).count() / num_iters;
+      LOG(INFO) << name << " of " << nbytes << " bytes on " << num_workers
+                << " workers: " << secs * 1e6 << " us, " << nbytes / secs / 1e9 << " GB/s";
+    }
+  }
+  sess->Shutdown();
+}
+
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_DISCO_SHM_ENABLED
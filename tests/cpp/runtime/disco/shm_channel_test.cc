@@ -0,0 +1,136 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifdef TVM_DISCO_SHM_ENABLED
+
+#include <gtest/gtest.h>
+#include <tvm/runtime/logging.h>
+#include <tvm/runtime/registry.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../../../src/runtime/disco/shm/shm_channel.h"
+#include "../../../../src/support/pipe.h"
+
+namespace tvm {
+namespace runtime {
+
+TEST(ShmChannel, MessagesLargerThanTheRing) {
+  constexpr size_t kCapacity = 4096;
+  std::unique_ptr<ShmChannelSegment> segment = ShmChannelSegment::Create(kCapacity);
+  std::unique_ptr<ShmChannelSegment> peer = ShmChannelSegment::Open(segment->memory()->name());
+  segment->memory()->Unlink();
+  // Message sizes that wrap around the ring at various offsets.
+  std::vector<size_t> sizes = {1, 7, kCapacity - 1, kCapacity, kCapacity + 1, 5 * kCapacity + 3};
+  std::thread echo([&]() {
+    ShmRingStream reader(peer->controller_to_worker(), nullptr);
+    ShmRingStream writer(peer->worker_to_controller(), nullptr);
+    for (size_t size : sizes) {
+      std::string message(size, '\0');
+      ASSERT_EQ(reader.Read(message.data(), size), size);
+      writer.Write(message.data(), size);
+    }
+  });
+  ShmRingStream writer(segment->controller_to_worker(), nullptr);
+  ShmRingStream reader(segment->worker_to_controller(), nullptr);
+  for (size_t size : sizes) {
+    std::string message(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+      message[i] = static_cast<char>(i * 31 + size);
+    }
+    writer.Write(message.data(), size);
+    std::string echoed(size, '\0');
+    ASSERT_EQ(reader.Read(echoed.data(), size), size);
+    EXPECT_EQ(echoed, message);
+  }
+  echo.join();
+}
+
+TEST(ShmChannel, ReadFromExitedPeer) {
+  std::unique_ptr<ShmChannelSegment> segment = ShmChannelSegment::Create(4096);
+  segment->memory()->Unlink();
+  ShmRingStream writer(segment->controller_to_worker(), nullptr);
+  ShmRingStream reader(segment->controller_to_worker(), []() { return false; });
+  writer.Write("abc", 3);
+  // The bytes written before the peer exited are still read.
+  char buffer[8];
+  EXPECT_EQ(reader.Read(buffer, sizeof(buffer)), 3);
+  EXPECT_EQ(std::string(buffer, 3), "abc");
+  EXPECT_EQ(reader.Read(buffer, sizeof(buffer)), 0);
+}
+
+TEST(ShmChannel, DISABLED_BenchmarkRoundTrip) {
+  // The size of each message, 256 bytes by default, which is typical of a disco command.
+  const char* env = std::getenv("TVM_BENCHMARK_SHM_CHANNEL_BYTES");
+  size_t size = env != nullptr ? std::atoll(env) : 256;
+  constexpr int kNumRoundTrips = 20000;
+  std::string message(size, 'x');
+  auto benchmark = [&](const char* name, dmlc::Stream* writer, dmlc::Stream* reader,
+                       dmlc::Stream* peer_writer, dmlc::Stream* peer_reader) {
+    std::thread echo([&]() {
+      std::string buffer(size, '\0');
+      for (int i = 0; i < kNumRoundTrips; ++i) {
+        peer_reader->Read(buffer.data(), size);
+        peer_writer->Write(buffer.data(), size);
+      }
+    });
+    std::string buffer(size, '\0');
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < kNumRoundTrips; ++i) {
+      writer->Write(message.data(), size);
+      reader->Read(buffer.data(), size);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    echo.join();
+    LOG(INFO) << name << ": "
+              << std::chrono::duration<double, std::micro>(end - start).count() / kNumRoundTrips
+              << " us/round trip of " << size << " bytes";
+  };
+  {
+    int fds[2][2];
+    ASSERT_EQ(pipe(fds[0]), 0);
+    ASSERT_EQ(pipe(fds[1]), 0);
+    support::Pipe writer(fds[0][1]), peer_reader(fds[0][0]);
+    support::Pipe peer_writer(fds[1][1]), reader(fds[1][0]);
+    benchmark("pipe", &writer, &reader, &peer_writer, &peer_reader);
+    for (int i = 0; i < 2; ++i) {
+      close(fds[i][0]);
+      close(fds[i][1]);
+    }
+  }
+  {
+    std::unique_ptr<ShmChannelSegment> segment = ShmChannelSegment::Create(1 << 20);
+    segment->memory()->Unlink();
+    ShmRingStream writer(segment->controller_to_worker(), nullptr);
+    ShmRingStream peer_reader(segment->controller_to_worker(), nullptr);
+    ShmRingStream peer_writer(segment->worker_to_controller(), nullptr);
+    ShmRingStream reader(segment->worker_to_controller(), nullptr);
+    benchmark("shm", &writer, &reader, &peer_writer, &peer_reader);
+  }
+}
+
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_DISCO_SHM_ENABLED
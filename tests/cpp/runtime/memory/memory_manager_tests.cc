@@ -182,6 +182,107 @@ TEST_F(TvmVMMemoryManagerTest, PooledAllocWithShape) {
   }
 }
 
+/*! \brief A pooled allocator on CPU that counts the device allocations. */
+class CountingPooledAllocator : public PooledAllocator {
+ public:
+  using PooledAllocator::PooledAllocator;
+  using PooledAllocator::RoundToSizeClass;
+
+  int num_device_allocs = 0;
+  int num_device_frees = 0;
+
+ protected:
+  void* DeviceAllocDataSpace(Device dev, size_t nbytes, size_t alignment,
+                             DLDataType type_hint) final {
+    ++num_device_allocs;
+    return PooledAllocator::DeviceAllocDataSpace(dev, nbytes, alignment, type_hint);
+  }
+
+  void DeviceFreeDataSpace(Device dev, void* ptr) final {
+    ++num_device_frees;
+    PooledAllocator::DeviceFreeDataSpace(dev, ptr);
+  }
+};
+
+TEST_F(TvmVMMemoryManagerTest, PooledSizeClass) {
+  CountingPooledAllocator allocator;
+  size_t page_size = PooledAllocator::kDefaultPageSize;
+  EXPECT_EQ(allocator.RoundToSizeClass(1), page_size);
+  EXPECT_EQ(allocator.RoundToSizeClass(3 * page_size + 1), 4 * page_size);
+  EXPECT_EQ(allocator.RoundToSizeClass(5 * page_size - 1), 5 * page_size);
+  // Above four pages, there are four size classes per power of two.
+  EXPECT_EQ(allocator.RoundToSizeClass(65 * page_size), 80 * page_size);
+  EXPECT_EQ(allocator.RoundToSizeClass(100 * page_size), 112 * page_size);
+  // Sizes in the same class share the cached blocks.
+  Device dev = {kDLCPU, 0};
+  auto buff = allocator.Alloc(dev, 100 * page_size, 64, DataType::Float(32));
+  allocator.Free(buff);
+  buff = allocator.Alloc(dev, 110 * page_size, 64, DataType::Float(32));
+  allocator.Free(buff);
+  EXPECT_EQ(allocator.num_device_allocs, 1);
+  AllocatorStats stats = allocator.Stats();
+  EXPECT_EQ(stats.num_hits, 1);
+  EXPECT_EQ(stats.num_misses, 1);
+}
+
+TEST_F(TvmVMMemoryManagerTest, PooledSplitAndCoalesce) {
+  CountingPooledAllocator allocator;
+  Device dev = {kDLCPU, 0};
+  size_t page_size = PooledAllocator::kDefaultPageSize;
+  auto large = allocator.Alloc(dev, 16 * page_size, 64, DataType::Float(32));
+  allocator.Free(large);
+  // The cached block is split for the smaller requests.
+  auto a = allocator.Alloc(dev, 4 * page_size, 64, DataType::Float(32));
+  auto b = allocator.Alloc(dev, 8 * page_size, 64, DataType::Float(32));
+  EXPECT_EQ(allocator.num_device_allocs, 1);
+  EXPECT_EQ(static_cast<char*>(b.data) - static_cast<char*>(a.data), 4 * page_size);
+  AllocatorStats stats = allocator.Stats();
+  EXPECT_EQ(stats.allocated_bytes, 12 * page_size);
+  EXPECT_EQ(stats.reserved_bytes, 16 * page_size);
+  EXPECT_EQ(stats.free_bytes, 4 * page_size);
+  EXPECT_EQ(stats.peak_allocated_bytes, 16 * page_size);
+  // The freed blocks are coalesced back into the whole segment.
+  allocator.Free(a);
+  stats = allocator.Stats();
+  EXPECT_EQ(stats.largest_free_block, 4 * page_size);
+  EXPECT_DOUBLE_EQ(stats.Fragmentation(), 0.5);
+  allocator.Free(b);
+  stats = allocator.Stats();
+  EXPECT_EQ(stats.largest_free_block, 16 * page_size);
+  EXPECT_DOUBLE_EQ(stats.Fragmentation(), 0.0);
+  auto again = allocator.Alloc(dev, 16 * page_size, 64, DataType::Float(32));
+  EXPECT_EQ(again.data, large.data);
+  EXPECT_EQ(allocator.num_device_allocs, 1);
+  allocator.Free(again);
+}
+
+TEST_F(TvmVMMemoryManagerTest, PooledHighWatermark) {
+  size_t page_size = PooledAllocator::kDefaultPageSize;
+  CountingPooledAllocator allocator(page_size, 12 * page_size);
+  Device dev = {kDLCPU, 0};
+  auto a = allocator.Alloc(dev, 4 * page_size, 64, DataType::Float(32));
+  auto b = allocator.Alloc(dev, 4 * page_size, 64, DataType::Float(32));
+  allocator.Free(b);
+  allocator.Free(a);
+  EXPECT_EQ(allocator.UsedMemory(), 8 * page_size);
+  // Exceeding the watermark releases the least recently used idle segment, which is `b`.
+  auto c = allocator.Alloc(dev, 8 * page_size, 64, DataType::Float(32));
+  EXPECT_EQ(allocator.num_device_frees, 1);
+  EXPECT_EQ(allocator.UsedMemory(), 12 * page_size);
+  EXPECT_EQ(allocator.Stats().num_released_segments, 1);
+  auto d = allocator.Alloc(dev, 4 * page_size, 64, DataType::Float(32));
+  EXPECT_EQ(d.data, a.data);
+  allocator.Free(c);
+  EXPECT_EQ(allocator.num_device_frees, 1);
+  allocator.SetHighWatermark(4 * page_size);
+  EXPECT_EQ(allocator.num_device_frees, 2);
+  EXPECT_EQ(allocator.UsedMemory(), 4 * page_size);
+  allocator.Free(d);
+  allocator.SetHighWatermark(0);
+  EXPECT_EQ(allocator.UsedMemory(), 0);
+  EXPECT_EQ(allocator.Stats().peak_reserved_bytes, 12 * page_size);
+}
+
 }  // namespace memory
 }  // namespace runtime
 }  // namespace tvm
@@ -0,0 +1,103 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <tvm/runtime/profiling.h>
+
+#include <time.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+namespace tvm {
+namespace runtime {
+namespace profiling {
+
+namespace {
+
+constexpr int64_t kCPUTimeNs = 20000000;
+
+/*! \brief Spin for kCPUTimeNs of CPU time on the calling thread. */
+void Spin() {
+  timespec start, now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+  do {
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  } while ((now.tv_sec - start.tv_sec) * 1000000000 + (now.tv_nsec - start.tv_nsec) < kCPUTimeNs);
+}
+
+}  // namespace
+
+TEST(PerfEventMetricCollector, CountsAllThreads) {
+#ifndef __linux__
+  GTEST_SKIP() << "perf_event is only available on Linux";
+#endif
+  // A thread that exists before the collector is initialized, like a worker of the thread pool.
+  std::atomic<bool> go{false};
+  std::thread worker([&go]() {
+    while (!go.load()) {
+      std::this_thread::yield();
+    }
+    Spin();
+  });
+  // Software events, which are available on virtual machines as well.
+  MetricCollector collector = CreatePerfEventMetricCollector({"task-clock", "page-faults"});
+  collector->Init({DeviceWrapper(Device{kDLCPU, 0})});
+  EXPECT_FALSE(collector->Start(Device{kDLCUDA, 0}).defined());
+  ObjectRef start = collector->Start(Device{kDLCPU, 0});
+  if (!start.defined()) {
+    go.store(true);
+    worker.join();
+    GTEST_SKIP() << "perf_event_open is not permitted";
+  }
+  go.store(true);
+  worker.join();
+  Map<String, ObjectRef> metrics = collector->Stop(start);
+  ASSERT_EQ(metrics.size(), 2);
+  EXPECT_GE(metrics["Page Faults"].as<CountNode>()->value, 0);
+  // Counting only the calling thread would miss the time of the worker.
+  EXPECT_GE(metrics["Task Clock (ns)"].as<CountNode>()->value, kCPUTimeNs * 9 / 10);
+}
+
+TEST(PerfEventMetricCollector, UnknownEvent) {
+#ifndef __linux__
+  GTEST_SKIP() << "perf_event is only available on Linux";
+#endif
+  MetricCollector collector = CreatePerfEventMetricCollector({"not-an-event"});
+  EXPECT_THROW(collector->Init({DeviceWrapper(Device{kDLCPU, 0})}), Error);
+}
+
+TEST(PerfEventMetricCollector, TableShowsIPC) {
+  Map<String, ObjectRef> call = {
+      {"Name", String("matmul")},
+      {"Duration (us)", ObjectRef(make_object<DurationNode>(10.0))},
+      {"Count", ObjectRef(make_object<CountNode>(1))},
+      {"Cycles", ObjectRef(make_object<CountNode>(4000))},
+      {"Instructions", ObjectRef(make_object<CountNode>(6000))},
+  };
+  Report report({call, call}, {}, {});
+  std::string table = report->AsTable();
+  EXPECT_NE(table.find("IPC"), std::string::npos) << table;
+  EXPECT_NE(table.find("1.5"), std::string::npos) << table;
+}
+
+}  // namespace profiling
+}  // namespace runtime
+}  // namespace tvm
@@ -0,0 +1,153 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <dmlc/memory_io.h>
+#include <gtest/gtest.h>
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/memory/memory_manager.h>
+#include <tvm/runtime/registry.h>
+#include <tvm/runtime/relax_vm/executable.h>
+#include <tvm/runtime/relax_vm/vm.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+namespace relax_vm {
+
+namespace {
+
+TVM_REGISTER_GLOBAL("testing.vm_executable.sum").set_body_typed([](NDArray arr) {
+  double sum = 0;
+  for (int64_t i = 0; i < arr.Shape()[0]; ++i) {
+    sum += static_cast<const float*>(arr->data)[i];
+  }
+  return sum;
+});
+
+NDArray MakeArray(std::vector<float> values) {
+  NDArray arr = NDArray::Empty({static_cast<int64_t>(values.size())}, DataType::Float(32),
+                               Device{kDLCPU, 0});
+  arr.CopyFromBytes(values.data(), values.size() * sizeof(float));
+  return arr;
+}
+
+/*!
+ * \brief Create an executable with the constants [arr0, 7, arr1, "str"], whose main() returns the
+ *  sum of arr0.
+ */
+ObjectPtr<VMExecutable> MakeExecutable() {
+  ObjectPtr<VMExecutable> exec = make_object<VMExecutable>();
+  for (TVMRetValue value : {TVMRetValue(), TVMRetValue(), TVMRetValue(), TVMRetValue()}) {
+    exec->constants.push_back(value);
+  }
+  exec->constants[0] = MakeArray({1, 2, 3, 4});
+  exec->constants[1] = 7;
+  exec->constants[2] = MakeArray({5, 6, 7});
+  exec->constants[3] = String("str");
+
+  VMFuncInfo sum;
+  sum.kind = VMFuncInfo::FuncKind::kPackedFunc;
+  sum.name = "testing.vm_executable.sum";
+  VMFuncInfo main;
+  main.kind = VMFuncInfo::FuncKind::kVMFunc;
+  main.name = "main";
+  main.register_file_size = 1;
+  main.start_instr = 0;
+  main.end_instr = 2;
+  exec->func_table = {sum, main};
+  exec->func_map = {{"testing.vm_executable.sum", 0}, {"main", 1}};
+  // r0 = sum(c[0]); ret r0
+  exec->instr_offset = {0, 5};
+  exec->instr_data = {static_cast<ExecWord>(Opcode::Call), 0, 0, 1,
+                      Instruction::Arg::ConstIdx(0).data(), static_cast<ExecWord>(Opcode::Ret),
+                      0};
+  return exec;
+}
+
+double InvokeMain(ObjectPtr<VMExecutable> exec) {
+  ObjectPtr<VirtualMachine> vm = VirtualMachine::Create();
+  vm->LoadExecutable(exec);
+  vm->Init({Device{kDLCPU, 0}}, {memory::AllocatorType::kNaive});
+  TVMRetValue rv;
+  vm->InvokeClosurePacked(vm->GetClosure("main"), TVMArgs(nullptr, nullptr, 0), &rv);
+  return rv;
+}
+
+void ExpectArrayEq(NDArray arr, std::vector<float> values) {
+  ASSERT_EQ(arr.Shape()[0], static_cast<int64_t>(values.size()));
+  for (size_t i = 0; i < values.size(); ++i) {
+    EXPECT_EQ(static_cast<const float*>(arr->data)[i], values[i]);
+  }
+}
+
+}  // namespace
+
+TEST(VMExecutable, LazyConstantsFromFile) {
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "vm_executable_test.ex";
+  MakeExecutable()->SaveToFile(path.string(), "");
+  Module mod = VMExecutable::LoadFromFile(path.string());
+  std::filesystem::remove(path);
+  ObjectPtr<VMExecutable> exec =
+      GetObjectPtr<VMExecutable>(static_cast<VMExecutable*>(mod.operator->()));
+
+  EXPECT_TRUE(exec->IsLazyConstant(0));
+  EXPECT_FALSE(exec->IsLazyConstant(1));
+  EXPECT_TRUE(exec->IsLazyConstant(2));
+  EXPECT_EQ(exec->constants[1].operator int64_t(), 7);
+  EXPECT_EQ(exec->constants[3].operator String(), "str");
+  exec->Stats();
+  EXPECT_EQ(exec->constants[0].type_code(), kTVMNullptr);
+
+  // Running main only loads the constant it uses.
+  EXPECT_EQ(InvokeMain(exec), 10);
+  EXPECT_NE(exec->constants[0].type_code(), kTVMNullptr);
+  EXPECT_EQ(exec->constants[2].type_code(), kTVMNullptr);
+
+  // The constants alias the mapped file, with its alignment.
+  NDArray arr = exec->GetConstant(2);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(arr->data) % kAllocAlignment, 0);
+  ExpectArrayEq(arr, {5, 6, 7});
+  ExpectArrayEq(exec->GetConstant(0), {1, 2, 3, 4});
+}
+
+TEST(VMExecutable, LazyConstantsFromBinary) {
+  std::string data;
+  dmlc::MemoryStringStream writer(&data);
+  MakeExecutable()->SaveToBinary(&writer);
+  dmlc::MemoryStringStream reader(&data);
+  Module mod = VMExecutable::LoadFromBinary(&reader);
+  ObjectPtr<VMExecutable> exec =
+      GetObjectPtr<VMExecutable>(static_cast<VMExecutable*>(mod.operator->()));
+
+  EXPECT_EQ(InvokeMain(exec), 10);
+  ExpectArrayEq(exec->GetConstant(2), {5, 6, 7});
+
+  // An executable saved again keeps its constants.
+  std::string resaved;
+  dmlc::MemoryStringStream resave_writer(&resaved);
+  exec->SaveToBinary(&resave_writer);
+  EXPECT_EQ(resaved, data);
+}
+
+}  // namespace relax_vm
+}  // namespace runtime
+}  // namespace tvm
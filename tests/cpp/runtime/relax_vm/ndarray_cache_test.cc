@@ -0,0 +1,175 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <tvm/runtime/logging.h>
+#include <tvm/runtime/registry.h>
+#include <tvm/runtime/relax_vm/ndarray_cache_support.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+namespace relax_vm {
+
+namespace {
+
+struct TestParam {
+  std::string name;
+  std::string dtype;
+  int64_t num_elements;
+  int64_t byte_offset;
+  int64_t nbytes;
+};
+
+/*! \brief Write a cache of one shard, filling byte i of the shard with i % 251. */
+std::string WriteCache(const std::string& name, const std::vector<TestParam>& params,
+                       int64_t shard_nbytes) {
+  std::filesystem::path dir = std::filesystem::temp_directory_path() / name;
+  std::filesystem::create_directories(dir);
+  {
+    std::ofstream shard(dir / "params_shard_0.bin", std::ios::binary);
+    std::vector<char> chunk(1 << 20);
+    for (int64_t begin = 0; begin < shard_nbytes; begin += chunk.size()) {
+      int64_t n = std::min<int64_t>(chunk.size(), shard_nbytes - begin);
+      for (int64_t i = 0; i < n; ++i) {
+        chunk[i] = static_cast<char>((begin + i) % 251);
+      }
+      shard.write(chunk.data(), n);
+    }
+  }
+  std::ostringstream os;
+  os << "{\"records\": [{\"dataPath\": \"params_shard_0.bin\", \"format\": \"raw-shard\", "
+     << "\"nbytes\": " << shard_nbytes << ", \"records\": [";
+  for (size_t i = 0; i < params.size(); ++i) {
+    const TestParam& p = params[i];
+    os << (i == 0 ? "" : ", ") << "{\"name\": \"" << p.name << "\", \"shape\": ["
+       << p.num_elements << "], \"dtype\": \"" << p.dtype << "\", \"format\": \"raw\", "
+       << "\"nbytes\": " << p.nbytes << ", \"byteOffset\": " << p.byte_offset << "}";
+  }
+  os << "]}]}";
+  std::ofstream(dir / "ndarray-cache.json") << os.str();
+  return dir.string();
+}
+
+void ExpectShardBytes(const NDArray& arr, int64_t byte_offset, int64_t nbytes) {
+  const char* data = static_cast<const char*>(arr->data);
+  for (int64_t i = 0; i < nbytes; ++i) {
+    ASSERT_EQ(data[i], static_cast<char>((byte_offset + i) % 251));
+  }
+}
+
+/*! \return The resident set size of the process in MB, or -1 if unknown. */
+double ResidentMB() {
+  std::ifstream statm("/proc/self/statm");
+  int64_t size = 0, resident = -1;
+  statm >> size >> resident;
+  return resident < 0 ? -1 : resident * 4096.0 / (1 << 20);
+}
+
+/*! \brief Drop the pages of a file from the page cache, so that it is read from the disk again. */
+void DropPageCache(const std::string& file) {
+#ifdef __linux__
+  int fd = open(file.c_str(), O_RDONLY);
+  ASSERT_GE(fd, 0) << "Cannot open " << file;
+  // Only the clean pages can be dropped, so the written pages are flushed first.
+  fdatasync(fd);
+  EXPECT_EQ(posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED), 0);
+  close(fd);
+#else
+  LOG(WARNING) << "The page cache is not dropped on this platform, so the loads are warm";
+#endif
+}
+
+}  // namespace
+
+TEST(NDArrayCache, LoadMapped) {
+  std::vector<TestParam> params = {
+      {"aligned", "float32", 16, 0, 64},
+      {"small", "int8", 3, 64, 3},
+      {"unaligned", "float32", 4, 67, 16},
+  };
+  std::string path = WriteCache("tvm_ndarray_cache_load_mapped", params, 83);
+  NDArrayCacheMetadata metadata = NDArrayCacheMetadata::Load(path);
+  ASSERT_EQ(metadata.records.size(), 1);
+  Device cpu{kDLCPU, 0};
+  Array<NDArray> mapped = metadata.records[0].LoadMapped(cpu, path);
+  ASSERT_EQ(mapped.size(), params.size());
+  for (size_t i = 0; i < params.size(); ++i) {
+    ExpectShardBytes(mapped[i], params[i].byte_offset, params[i].nbytes);
+  }
+  // Writes to the parameters never reach the file.
+  std::memset(mapped[0]->data, 0, 64);
+  std::memset(mapped[2]->data, 0, 16);
+  std::string raw_data;
+  Array<NDArray> loaded = metadata.records[0].Load(cpu, path, &raw_data);
+  for (size_t i = 0; i < params.size(); ++i) {
+    ExpectShardBytes(loaded[i], params[i].byte_offset, params[i].nbytes);
+  }
+  std::filesystem::remove_all(path);
+}
+
+TEST(NDArrayCache, DISABLED_BenchmarkLoad) {
+  // The size of the synthetic cache in GB, 4 by default.
+  const char* env = std::getenv("TVM_BENCHMARK_NDARRAY_CACHE_GB");
+  int64_t num_gb = env != nullptr ? std::atoll(env) : 4;
+  constexpr int64_t kParamBytes = 64 << 20;
+  int64_t num_params = num_gb * (1 << 30) / kParamBytes;
+  std::vector<TestParam> params;
+  for (int64_t i = 0; i < num_params; ++i) {
+    params.push_back({"param_" + std::to_string(i), "float16", kParamBytes / 2, i * kParamBytes,
+                      kParamBytes});
+  }
+  std::string path = WriteCache("tvm_ndarray_cache_benchmark", params, num_params * kParamBytes);
+  const PackedFunc* fload = Registry::Get("vm.builtin.ndarray_cache.load");
+  const PackedFunc* fclear = Registry::Get("vm.builtin.ndarray_cache.clear");
+  ASSERT_NE(fload, nullptr);
+  // The shard is in the page cache after writing it, so it is dropped before each run to
+  // measure a cold start.
+  for (bool use_mmap : {false, true}) {
+    DropPageCache(path + "/params_shard_0.bin");
+    double rss_before = ResidentMB();
+    auto start = std::chrono::high_resolution_clock::now();
+    (*fload)(path, static_cast<int>(kDLCPU), 0, use_mmap);
+    auto end = std::chrono::high_resolution_clock::now();
+    double rss_after = ResidentMB();
+    LOG(INFO) << "use_mmap=" << use_mmap << " load " << num_gb << " GB: "
+              << std::chrono::duration<double, std::milli>(end - start).count()
+              << " ms, resident set grew by " << rss_after - rss_before << " MB";
+    (*fclear)();
+  }
+  std::filesystem::remove_all(path);
+}
+
+}  // namespace relax_vm
+}  // namespace runtime
+}  // namespace tvm
@@ -0,0 +1,261 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <tvm/runtime/logging.h>
+#include <tvm/runtime/ndarray.h>
+#include <tvm/runtime/registry.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+namespace relax_vm {
+
+namespace {
+
+template <typename T>
+NDArray MakeArray(const std::vector<T>& values, std::vector<int64_t> shape, DataType dtype) {
+  NDArray array = NDArray::Empty(shape, dtype, DLDevice{kDLCPU, 0});
+  array.CopyFromBytes(values.data(), values.size() * sizeof(T));
+  return array;
+}
+
+struct SampleParams {
+  float temperature;
+  float top_p;
+  int32_t top_k;
+  float min_p;
+};
+
+/*!
+ * \brief The interval of uniform samples that should pick `token`, or an empty one if the filters
+ * should drop it, computed naively in double.
+ */
+std::pair<double, double> ReferenceInterval(const std::vector<float>& logits, SampleParams params,
+                                            int64_t token) {
+  int64_t n = logits.size();
+  double max_logit = *std::max_element(logits.begin(), logits.end());
+  std::vector<std::pair<double, int64_t>> probs;
+  double sum = 0;
+  for (int64_t i = 0; i < n; ++i) {
+    double p = std::exp((logits[i] - max_logit) / params.temperature);
+    probs.emplace_back(p, i);
+    sum += p;
+  }
+  std::sort(probs.begin(), probs.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.first > rhs.first; });
+  if (params.top_k > 0 && params.top_k < n) {
+    probs.resize(params.top_k);
+  }
+  if (params.min_p > 0) {
+    double max_prob = probs[0].first;
+    while (probs.back().first < params.min_p * max_prob) {
+      probs.pop_back();
+    }
+  }
+  if (params.top_p < 1) {
+    double kept_sum = 0;
+    for (const auto& prob : probs) {
+      kept_sum += prob.first;
+    }
+    if (params.top_k == 0 && params.min_p == 0) {
+      kept_sum = sum;
+    }
+    double cum_sum = 0;
+    size_t num_kept = 0;
+    while (num_kept < probs.size() && cum_sum < params.top_p * kept_sum) {
+      cum_sum += probs[num_kept++].first;
+    }
+    probs.resize(num_kept);
+  }
+  std::sort(probs.begin(), probs.end(),
+            [](const auto& lhs, const auto& rhs) { return lhs.second < rhs.second; });
+  double kept_sum = 0;
+  for (const auto& prob : probs) {
+    kept_sum += prob.first;
+  }
+  double cum_sum = 0;
+  for (const auto& prob : probs) {
+    if (prob.second == token) {
+      return {cum_sum / kept_sum, (cum_sum + prob.first) / kept_sum};
+    }
+    cum_sum += prob.first;
+  }
+  return {1, 0};
+}
+
+}  // namespace
+
+TEST(BatchSampleFromLogits, MatchesReference) {
+  const PackedFunc* sample = Registry::Get("vm.builtin.batch_sample_from_logits");
+  ASSERT_NE(sample, nullptr);
+  constexpr int64_t kVocabSize = 1000;
+  std::vector<SampleParams> params = {
+      {1.0f, 1.0f, 0, 0.0f},    {0.7f, 0.9f, 0, 0.0f},   {1.0f, 0.5f, 0, 0.0f},
+      {1.3f, 1.0f, 40, 0.0f},   {1.0f, 1.0f, 0, 0.05f},  {0.8f, 0.8f, 20, 0.0f},
+      {1.0f, 0.95f, 0, 0.01f},  {1.0f, 0.9f, 50, 0.02f}, {1.0f, 0.99f, 0, 0.0f},
+      {2.0f, 1.0f, 999, 0.0f},  {1.0f, 1.0f, 1, 0.0f},   {0.0f, 1.0f, 0, 0.0f},
+  };
+  int64_t batch_size = params.size();
+  std::mt19937 rng(42);
+  std::normal_distribution<float> normal(0.0f, 3.0f);
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  for (int trial = 0; trial < 20; ++trial) {
+    std::vector<float> logits(batch_size * kVocabSize);
+    for (float& logit : logits) {
+      logit = normal(rng);
+    }
+    std::vector<float> temperatures, top_p, min_p, samples;
+    std::vector<int32_t> top_k;
+    for (const SampleParams& param : params) {
+      temperatures.push_back(param.temperature);
+      top_p.push_back(param.top_p);
+      top_k.push_back(param.top_k);
+      min_p.push_back(param.min_p);
+      samples.push_back(uniform(rng));
+    }
+    NDArray result = (*sample)(MakeArray(logits, {batch_size, kVocabSize}, DataType::Float(32)),
+                               MakeArray(temperatures, {batch_size}, DataType::Float(32)),
+                               MakeArray(top_p, {batch_size}, DataType::Float(32)),
+                               MakeArray(top_k, {batch_size}, DataType::Int(32)),
+                               MakeArray(min_p, {batch_size}, DataType::Float(32)),
+                               MakeArray(samples, {batch_size}, DataType::Float(32)));
+    ASSERT_EQ(result.Shape()->Product(), batch_size);
+    const int64_t* tokens = static_cast<const int64_t*>(result->data);
+    for (int64_t i = 0; i < batch_size; ++i) {
+      std::vector<float> row(logits.begin() + i * kVocabSize,
+                             logits.begin() + (i + 1) * kVocabSize);
+      if (params[i].temperature == 0.0f || params[i].top_k == 1) {
+        EXPECT_EQ(tokens[i], std::max_element(row.begin(), row.end()) - row.begin());
+        continue;
+      }
+      std::pair<double, double> interval = ReferenceInterval(row, params[i], tokens[i]);
+      EXPECT_LE(interval.first - 1e-5, samples[i]) << "sequence " << i << ", trial " << trial;
+      EXPECT_GE(interval.second + 1e-5, samples[i]) << "sequence " << i << ", trial " << trial;
+    }
+  }
+}
+
+TEST(BatchSampleFromLogits, MaskedTail) {
+  const PackedFunc* sample = Registry::Get("vm.builtin.batch_sample_from_logits");
+  ASSERT_NE(sample, nullptr);
+  constexpr int64_t kVocabSize = 200000;
+  constexpr int64_t kNumUnmasked = 100000;
+  std::vector<SampleParams> params = {
+      {1.0f, 1.0f, 0, 0.0f},
+      {1.0f, 0.9f, 0, 0.0f},
+      {1.0f, 1.0f, 1000, 0.0f},
+      {1.0f, 1.0f, 0, 1e-9f},
+  };
+  int64_t batch_size = params.size();
+  // One likely token and many unlikely ones, whose masses are lost when they are summed one by
+  // one after it, so that the scan falls short of the largest samples. The tail is masked out.
+  std::vector<float> logits(batch_size * kVocabSize, -std::numeric_limits<float>::infinity());
+  std::vector<float> temperatures, top_p, min_p;
+  std::vector<int32_t> top_k;
+  for (int64_t i = 0; i < batch_size; ++i) {
+    logits[i * kVocabSize] = 0.0f;
+    std::fill(logits.begin() + i * kVocabSize + 1, logits.begin() + i * kVocabSize + kNumUnmasked,
+              std::log(1e-8f));
+    temperatures.push_back(params[i].temperature);
+    top_p.push_back(params[i].top_p);
+    top_k.push_back(params[i].top_k);
+    min_p.push_back(params[i].min_p);
+  }
+  std::vector<float> samples(batch_size, 1.0f - 1e-7f);
+  NDArray result = (*sample)(MakeArray(logits, {batch_size, kVocabSize}, DataType::Float(32)),
+                             MakeArray(temperatures, {batch_size}, DataType::Float(32)),
+                             MakeArray(top_p, {batch_size}, DataType::Float(32)),
+                             MakeArray(top_k, {batch_size}, DataType::Int(32)),
+                             MakeArray(min_p, {batch_size}, DataType::Float(32)),
+                             MakeArray(samples, {batch_size}, DataType::Float(32)));
+  const int64_t* tokens = static_cast<const int64_t*>(result->data);
+  for (int64_t i = 0; i < batch_size; ++i) {
+    EXPECT_GE(tokens[i], 0) << "sequence " << i;
+    EXPECT_LT(tokens[i], kNumUnmasked) << "sequence " << i;
+  }
+}
+
+TEST(BatchSampleFromLogits, DISABLED_Benchmark) {
+  // The vocabulary size, 128k by default.
+  const char* env = std::getenv("TVM_BENCHMARK_SAMPLE_VOCAB_SIZE");
+  int64_t vocab_size = env != nullptr ? std::atoll(env) : 128000;
+  constexpr int64_t kBatchSize = 64;
+  constexpr int kRepeats = 5;
+  const PackedFunc* batch_sample = Registry::Get("vm.builtin.batch_sample_from_logits");
+  const PackedFunc* sample_top_p = Registry::Get("vm.builtin.sample_top_p_from_logits");
+  ASSERT_NE(batch_sample, nullptr);
+  ASSERT_NE(sample_top_p, nullptr);
+  std::mt19937 rng(0);
+  std::normal_distribution<float> normal(0.0f, 3.0f);
+  std::vector<float> logits(kBatchSize * vocab_size);
+  for (float& logit : logits) {
+    logit = normal(rng);
+  }
+  NDArray logits_array = MakeArray(logits, {kBatchSize, vocab_size}, DataType::Float(32));
+  std::vector<NDArray> rows;
+  for (int64_t i = 0; i < kBatchSize; ++i) {
+    rows.push_back(MakeArray(std::vector<float>(logits.begin() + i * vocab_size,
+                                                logits.begin() + (i + 1) * vocab_size),
+                             {1, vocab_size}, DataType::Float(32)));
+  }
+  auto time_ms = [&](auto f) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < kRepeats; ++r) {
+      f();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / kRepeats;
+  };
+  double baseline_ms = time_ms([&]() {
+    for (const NDArray& row : rows) {
+      (*sample_top_p)(row, 0.7, 0.9, 0.5);
+    }
+  });
+  LOG(INFO) << "sample_top_p_from_logits, top_p=0.9: " << baseline_ms << " ms/batch";
+  for (SampleParams params : {SampleParams{0.7f, 0.9f, 0, 0.0f}, SampleParams{0.7f, 1.0f, 50, 0.0f},
+                              SampleParams{0.7f, 0.9f, 50, 0.05f}}) {
+    NDArray temperatures = MakeArray(std::vector<float>(kBatchSize, params.temperature),
+                                     {kBatchSize}, DataType::Float(32));
+    NDArray top_p = MakeArray(std::vector<float>(kBatchSize, params.top_p), {kBatchSize},
+                              DataType::Float(32));
+    NDArray top_k = MakeArray(std::vector<int32_t>(kBatchSize, params.top_k), {kBatchSize},
+                              DataType::Int(32));
+    NDArray min_p = MakeArray(std::vector<float>(kBatchSize, params.min_p), {kBatchSize},
+                              DataType::Float(32));
+    NDArray samples =
+        MakeArray(std::vector<float>(kBatchSize, 0.5f), {kBatchSize}, DataType::Float(32));
+    double ms = time_ms([&]() {
+      (*batch_sample)(logits_array, temperatures, top_p, top_k, min_p, samples);
+    });
+    LOG(INFO) << "batch_sample_from_logits, top_p=" << params.top_p << " top_k=" << params.top_k
+              << " min_p=" << params.min_p << ": " << ms << " ms/batch";
+  }
+}
+
+}  // namespace relax_vm
+}  // namespace runtime
+}  // namespace tvm
@@ -0,0 +1,235 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <tvm/runtime/logging.h>
+#include <tvm/runtime/memory/memory_manager.h>
+#include <tvm/runtime/registry.h>
+#include <tvm/runtime/relax_vm/executable.h>
+#include <tvm/runtime/relax_vm/vm.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+namespace relax_vm {
+
+namespace {
+
+TVM_REGISTER_GLOBAL("testing.vm_dispatch.add").set_body_typed([](int64_t a, int64_t b) {
+  return a + b;
+});
+
+TVM_REGISTER_GLOBAL("testing.vm_dispatch.gt").set_body_typed([](int64_t a, int64_t b) {
+  return a > b;
+});
+
+TVM_REGISTER_GLOBAL("testing.vm_dispatch.dtype_bits").set_body_typed([](DataType dtype) {
+  return static_cast<int64_t>(dtype.bits());
+});
+
+TVM_REGISTER_GLOBAL("testing.vm_dispatch.nop").set_body([](TVMArgs args, TVMRetValue* rv) {});
+
+/*! \brief Write the bytecode of an executable, with the encoding of VMExecutable. */
+class BytecodeWriter {
+ public:
+  BytecodeWriter() : exec_(make_object<VMExecutable>()) {}
+
+  Index PackedFunc(const std::string& name) {
+    return AddFunc(VMFuncInfo::FuncKind::kPackedFunc, name, 0, 0);
+  }
+
+  Index Func(const std::string& name) const { return exec_->func_map.at(name); }
+
+  Index NextPc() const { return exec_->instr_offset.size(); }
+
+  void BeginFunction(const std::string& name, Index num_args, Index register_file_size) {
+    Index func_idx = AddFunc(VMFuncInfo::FuncKind::kVMFunc, name, num_args, register_file_size);
+    exec_->func_table[func_idx].start_instr = exec_->instr_offset.size();
+  }
+
+  void EndFunction(const std::string& name) {
+    exec_->func_table[exec_->func_map.at(name)].end_instr = exec_->instr_offset.size();
+  }
+
+  template <typename T>
+  Index Constant(T value) {
+    TVMRetValue rv;
+    rv = value;
+    exec_->constants.push_back(rv);
+    return exec_->constants.size() - 1;
+  }
+
+  Index Call(Index func_idx, const std::vector<Instruction::Arg>& args, RegName dst) {
+    Index pc = Begin(Opcode::Call);
+    exec_->instr_data.insert(exec_->instr_data.end(),
+                             {dst, func_idx, static_cast<ExecWord>(args.size())});
+    for (const Instruction::Arg& arg : args) {
+      exec_->instr_data.push_back(arg.data());
+    }
+    return pc;
+  }
+
+  Index Ret(RegName result) {
+    Index pc = Begin(Opcode::Ret);
+    exec_->instr_data.push_back(result);
+    return pc;
+  }
+
+  Index Goto(Index pc_offset) {
+    Index pc = Begin(Opcode::Goto);
+    exec_->instr_data.push_back(pc_offset);
+    return pc;
+  }
+
+  Index If(RegName cond, Index false_offset) {
+    Index pc = Begin(Opcode::If);
+    exec_->instr_data.insert(exec_->instr_data.end(), {cond, false_offset});
+    return pc;
+  }
+
+  /*! \brief Create a VM running the executable on CPU. */
+  ObjectPtr<VirtualMachine> CreateVM() {
+    ObjectPtr<VirtualMachine> vm = VirtualMachine::Create();
+    vm->LoadExecutable(exec_);
+    vm->Init({Device{kDLCPU, 0}}, {memory::AllocatorType::kNaive});
+    return vm;
+  }
+
+ private:
+  Index AddFunc(VMFuncInfo::FuncKind kind, const std::string& name, Index num_args,
+                Index register_file_size) {
+    VMFuncInfo info;
+    info.kind = kind;
+    info.name = name;
+    info.num_args = num_args;
+    info.register_file_size = register_file_size;
+    exec_->func_map[name] = exec_->func_table.size();
+    exec_->func_table.push_back(info);
+    return exec_->func_table.size() - 1;
+  }
+
+  Index Begin(Opcode op) {
+    exec_->instr_offset.push_back(exec_->instr_data.size());
+    exec_->instr_data.push_back(static_cast<ExecWord>(op));
+    return exec_->instr_offset.size() - 1;
+  }
+
+  ObjectPtr<VMExecutable> exec_;
+};
+
+using Arg = Instruction::Arg;
+
+int64_t Invoke(const ObjectPtr<VirtualMachine>& vm, const std::string& func_name,
+               std::vector<int64_t> inputs) {
+  std::vector<TVMValue> values(inputs.size());
+  std::vector<int> tcodes(inputs.size());
+  TVMArgsSetter setter(values.data(), tcodes.data());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    setter(i, inputs[i]);
+  }
+  TVMRetValue rv;
+  vm->InvokeClosurePacked(vm->GetClosure(func_name),
+                          TVMArgs(values.data(), tcodes.data(), inputs.size()), &rv);
+  return rv;
+}
+
+}  // namespace
+
+TEST(VMDispatch, ArgumentKinds) {
+  BytecodeWriter writer;
+  Index add = writer.PackedFunc("testing.vm_dispatch.add");
+  Index dtype_bits = writer.PackedFunc("testing.vm_dispatch.dtype_bits");
+  Index gt = writer.PackedFunc("testing.vm_dispatch.gt");
+  Index dtype = writer.Constant(DataType::Float(16));
+  // sum(n) = n + sum(n - 1) if n > 0 else 0, calling itself through a closure.
+  writer.BeginFunction("sum", 1, 4);
+  Index sum = writer.Func("sum");
+  writer.Call(gt, {Arg::Register(0), Arg::Immediate(0)}, 1);
+  writer.If(1, 5);
+  writer.Call(add, {Arg::Register(0), Arg::Immediate(-1)}, 2);
+  writer.Call(sum, {Arg::Register(2)}, 3);
+  writer.Call(add, {Arg::Register(0), Arg::Register(3)}, 3);
+  writer.Ret(3);
+  writer.Ret(0);
+  writer.EndFunction("sum");
+  // main(x) = sum(x + 1) + (2 + 3) + bits(float16)
+  writer.BeginFunction("main", 1, 5);
+  writer.Call(add, {Arg::Register(0), Arg::Immediate(1)}, 1);
+  writer.Call(add, {Arg::Immediate(2), Arg::Immediate(3)}, 2);
+  writer.Call(dtype_bits, {Arg::ConstIdx(dtype)}, 3);
+  writer.Call(sum, {Arg::Register(1)}, 4);
+  writer.Call(add, {Arg::Register(4), Arg::Register(2)}, 4);
+  writer.Call(add, {Arg::Register(4), Arg::Register(3)}, 4);
+  writer.Call(add, {Arg::Register(4), Arg::Immediate(0)}, Instruction::kVoidRegister);
+  writer.Ret(4);
+  writer.EndFunction("main");
+
+  ObjectPtr<VirtualMachine> vm = writer.CreateVM();
+  for (int64_t x : {-1, 0, 3, 10}) {
+    int64_t sum_x = (x + 1) * (x + 2) / 2;
+    EXPECT_EQ(Invoke(vm, "main", {x}), sum_x + 5 + 16);
+  }
+  EXPECT_EQ(Invoke(vm, "sum", {100}), 5050);
+}
+
+TEST(VMDispatch, DISABLED_BenchmarkDispatch) {
+  // The number of loop iterations, 1M by default.
+  const char* env = std::getenv("TVM_BENCHMARK_VM_DISPATCH_ITERS");
+  int64_t num_iters = env != nullptr ? std::atoll(env) : 1000000;
+  constexpr int kCallsPerIter = 16;
+  BytecodeWriter writer;
+  Index add = writer.PackedFunc("testing.vm_dispatch.add");
+  Index gt = writer.PackedFunc("testing.vm_dispatch.gt");
+  Index nop = writer.PackedFunc("testing.vm_dispatch.nop");
+  Index dtype = writer.Constant(DataType::Float(32));
+  for (bool read_registers : {true, false}) {
+    // loop(n, x): while n > 0 { nop(x, 1, float32) x kCallsPerIter; n = n - 1 }
+    std::string name = read_registers ? "loop_registers" : "loop_static";
+    writer.BeginFunction(name, 2, 4);
+    Index head = writer.Call(gt, {Arg::Register(0), Arg::Immediate(0)}, 2);
+    writer.If(2, kCallsPerIter + 3);
+    for (int i = 0; i < kCallsPerIter; ++i) {
+      Arg first = read_registers ? Arg::Register(1) : Arg::Immediate(1);
+      writer.Call(nop, {first, Arg::Immediate(1), Arg::ConstIdx(dtype)}, 3);
+    }
+    writer.Call(add, {Arg::Register(0), Arg::Immediate(-1)}, 0);
+    writer.Goto(head - writer.NextPc());
+    writer.Ret(0);
+    writer.EndFunction(name);
+  }
+  ObjectPtr<VirtualMachine> vm = writer.CreateVM();
+  for (const std::string& name : {"loop_registers", "loop_static"}) {
+    Invoke(vm, name, {num_iters / 100, 0});
+    auto start = std::chrono::high_resolution_clock::now();
+    Invoke(vm, name, {num_iters, 0});
+    auto end = std::chrono::high_resolution_clock::now();
+    double num_instrs = static_cast<double>(num_iters) * (kCallsPerIter + 4);
+    LOG(INFO) << name << ": "
+              << std::chrono::duration<double, std::nano>(end - start).count() / num_instrs
+              << " ns/instruction";
+  }
+}
+
+}  // namespace relax_vm
+}  // namespace runtime
+}  // namespace tvm
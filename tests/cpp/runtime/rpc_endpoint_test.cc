@@ -0,0 +1,305 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <tvm/runtime/logging.h>
+#include <tvm/runtime/registry.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../../src/runtime/rpc/rpc_channel.h"
+#include "../../../src/runtime/rpc/rpc_endpoint.h"
+#include "../../../src/runtime/rpc/rpc_session.h"
+
+namespace tvm {
+namespace runtime {
+
+TVM_REGISTER_GLOBAL("testing.rpc_endpoint.add_one").set_body_typed([](int x) { return x + 1; });
+
+TVM_REGISTER_GLOBAL("testing.rpc_endpoint.raise").set_body_typed([]() {
+  LOG(FATAL) << "ValueError: raised by the remote";
+});
+
+#ifndef _WIN32
+
+namespace {
+
+/*! \brief A channel over one end of a local socket pair. */
+class FdChannel final : public RPCChannel {
+ public:
+  explicit FdChannel(int fd, std::atomic<size_t>* bytes_sent = nullptr)
+      : fd_(fd), bytes_sent_(bytes_sent) {}
+  ~FdChannel() { close(fd_); }
+  size_t Send(const void* data, size_t size) final {
+    ssize_t n = write(fd_, data, size);
+    ICHECK_GE(n, 0) << "write failed";
+    if (bytes_sent_ != nullptr) *bytes_sent_ += n;
+    return static_cast<size_t>(n);
+  }
+  size_t Recv(void* data, size_t size) final {
+    ssize_t n = read(fd_, data, size);
+    ICHECK_GE(n, 0) << "read failed";
+    return static_cast<size_t>(n);
+  }
+
+ private:
+  int fd_;
+  std::atomic<size_t>* bytes_sent_;
+};
+
+/*! \brief A client session of a server that runs on a thread of the process. */
+class RPCLoopback {
+ public:
+  RPCLoopback() {
+    int fds[2];
+    ICHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    server_ = std::thread([fd = fds[1]]() {
+      RPCEndpoint::Create(std::make_unique<FdChannel>(fd), "server", "")->ServerLoop();
+    });
+    auto endpoint =
+        RPCEndpoint::Create(std::make_unique<FdChannel>(fds[0], &bytes_sent_), "client", "");
+    endpoint->InitRemoteSession(TVMArgs(nullptr, nullptr, 0));
+    sess_ = CreateClientSession(endpoint);
+    module_ = CreateRPCSessionModule(sess_);
+  }
+
+  ~RPCLoopback() {
+    // The client endpoint shuts down the server when it is destroyed.
+    module_ = Module();
+    sess_.reset();
+    server_.join();
+  }
+
+  template <typename... Args>
+  PackedFunc Submit(const std::string& name, Args... args) const {
+    const PackedFunc* fsubmit = Registry::Get("rpc.SubmitRemoteCall");
+    ICHECK(fsubmit != nullptr);
+    return (*fsubmit)(module_, name, args...);
+  }
+
+  const std::shared_ptr<RPCSession>& sess() const { return sess_; }
+  Module module() const { return module_; }
+  /*! \brief The number of bytes sent by the client. */
+  size_t bytes_sent() const { return bytes_sent_.load(); }
+
+ private:
+  std::atomic<size_t> bytes_sent_{0};
+  std::thread server_;
+  std::shared_ptr<RPCSession> sess_;
+  Module module_;
+};
+
+/*! \brief A remote array of bytes. */
+class RemoteBytes {
+ public:
+  RemoteBytes(const RPCLoopback& loopback, int64_t nbytes)
+      : sess_(loopback.sess()), shape_(nbytes) {
+    api_ = sess_->GetDeviceAPI(dev_);
+    tensor_ = DLTensor{api_->AllocDataSpace(dev_, nbytes, 64, dtype_), dev_, 1, dtype_, &shape_,
+                       nullptr, 0};
+  }
+  ~RemoteBytes() { api_->FreeDataSpace(dev_, tensor_.data); }
+
+  void Upload(const std::vector<uint8_t>& data) {
+    tensor_.byte_offset = 0;
+    sess_->CopyToRemote(const_cast<uint8_t*>(data.data()), &tensor_, data.size());
+  }
+
+  std::vector<uint8_t> Download() {
+    std::vector<uint8_t> data(shape_, 0);
+    tensor_.byte_offset = 0;
+    sess_->CopyFromRemote(&tensor_, data.data(), data.size());
+    return data;
+  }
+
+ private:
+  std::shared_ptr<RPCSession> sess_;
+  Device dev_{kDLCPU, 0};
+  DLDataType dtype_{kDLUInt, 8, 1};
+  DeviceAPI* api_;
+  int64_t shape_;
+  DLTensor tensor_;
+};
+
+// Bytes that are mostly zeros, like the weights of a pruned model, which compress well.
+std::vector<uint8_t> CompressibleBytes(int64_t nbytes, int seed) {
+  std::vector<uint8_t> data(nbytes);
+  uint32_t state = seed;
+  for (int64_t i = 0; i < nbytes; ++i) {
+    state = state * 1664525 + 1013904223;
+    data[i] = (state >> 28) == 0 ? static_cast<uint8_t>(state >> 20) : (i % 4 == 0 ? 1 : 0);
+  }
+  return data;
+}
+
+}  // namespace
+
+TEST(RPCEndpoint, SubmitManyCalls) {
+  // More calls than the requests that can be in flight at the same time.
+  constexpr int kNumCalls = 1000;
+  RPCLoopback loopback;
+  std::vector<PackedFunc> waits;
+  for (int i = 0; i < kNumCalls; ++i) {
+    waits.push_back(loopback.Submit("testing.rpc_endpoint.add_one", i));
+  }
+  // Waiting for the last call receives the returns of all the calls before it.
+  for (int i = kNumCalls - 1; i >= 0; --i) {
+    int ret = waits[i]();
+    EXPECT_EQ(ret, i + 1);
+  }
+  // The calls can be waited more than once, and the synchronous calls still work.
+  int ret = waits[0]();
+  EXPECT_EQ(ret, 1);
+  PackedFunc add_one = loopback.module().GetFunction("testing.rpc_endpoint.add_one");
+  ret = add_one(41);
+  EXPECT_EQ(ret, 42);
+}
+
+TEST(RPCEndpoint, SubmitErrorIsRaisedByItsWait) {
+  RPCLoopback loopback;
+  PackedFunc first = loopback.Submit("testing.rpc_endpoint.add_one", 1);
+  PackedFunc error = loopback.Submit("testing.rpc_endpoint.raise");
+  PackedFunc last = loopback.Submit("testing.rpc_endpoint.add_one", 2);
+  int ret = last();
+  EXPECT_EQ(ret, 3);
+  EXPECT_THROW(error(), Error);
+  ret = first();
+  EXPECT_EQ(ret, 2);
+  EXPECT_THROW(loopback.Submit("testing.rpc_endpoint.not_a_function", 1), Error);
+}
+
+TEST(RPCEndpoint, StreamLargeCopies) {
+  // Not a multiple of the size of the copy blocks.
+  constexpr int64_t kNumBytes = (8 << 20) + 3;
+  RPCLoopback loopback;
+  RemoteBytes remote(loopback, kNumBytes);
+  std::vector<uint8_t> data(kNumBytes);
+  for (int64_t i = 0; i < kNumBytes; ++i) {
+    data[i] = static_cast<uint8_t>(i * 7 + (i >> 20));
+  }
+  remote.Upload(data);
+  EXPECT_TRUE(remote.Download() == data);
+}
+
+TEST(RPCEndpoint, CompressedTransfers) {
+  constexpr int64_t kNumBytes = (4 << 20) + 5;
+  RPCLoopback loopback;
+  SetClientSessionTransferOptions(loopback.sess(), RPCTransferCodec::kLZ4, false);
+  RemoteBytes remote(loopback, kNumBytes);
+  std::vector<uint8_t> data = CompressibleBytes(kNumBytes, 0);
+  size_t bytes_sent = loopback.bytes_sent();
+  remote.Upload(data);
+  EXPECT_LT(loopback.bytes_sent() - bytes_sent, kNumBytes / 2);
+  EXPECT_TRUE(remote.Download() == data);
+  // Random bytes do not compress, and are sent raw.
+  std::mt19937 rng(0);
+  for (uint8_t& byte : data) byte = static_cast<uint8_t>(rng());
+  remote.Upload(data);
+  EXPECT_TRUE(remote.Download() == data);
+}
+
+TEST(RPCEndpoint, DedupTransfers) {
+  constexpr int64_t kNumBytes = 4 << 20;
+  RPCLoopback loopback;
+  SetClientSessionTransferOptions(loopback.sess(), RPCTransferCodec::kRaw, true);
+  RemoteBytes first(loopback, kNumBytes), second(loopback, kNumBytes);
+  std::vector<uint8_t> data = CompressibleBytes(kNumBytes, 1);
+  size_t bytes_sent = loopback.bytes_sent();
+  first.Upload(data);
+  EXPECT_GE(loopback.bytes_sent() - bytes_sent, kNumBytes);
+  // The same content is copied by the server from its cache, also to another array.
+  bytes_sent = loopback.bytes_sent();
+  second.Upload(data);
+  EXPECT_LT(loopback.bytes_sent() - bytes_sent, kNumBytes / 100);
+  EXPECT_TRUE(second.Download() == data);
+  // A changed block is sent again.
+  data[kNumBytes / 2] ^= 1;
+  bytes_sent = loopback.bytes_sent();
+  first.Upload(data);
+  EXPECT_LT(loopback.bytes_sent() - bytes_sent, kNumBytes / 2);
+  EXPECT_TRUE(first.Download() == data);
+}
+
+TEST(RPCEndpoint, DISABLED_BenchmarkTransfers) {
+  // The size of the array, 64MB by default.
+  const char* env = std::getenv("TVM_BENCHMARK_RPC_TRANSFER_BYTES");
+  int64_t nbytes = env != nullptr ? std::atoll(env) : (64 << 20);
+  std::vector<uint8_t> data = CompressibleBytes(nbytes, 2);
+  auto run = [&](const char* name, RPCTransferCodec codec, bool dedup) {
+    RPCLoopback loopback;
+    SetClientSessionTransferOptions(loopback.sess(), codec, dedup);
+    RemoteBytes remote(loopback, nbytes);
+    for (int i = 0; i < 2; ++i) {
+      size_t bytes_sent = loopback.bytes_sent();
+      auto start = std::chrono::high_resolution_clock::now();
+      remote.Upload(data);
+      auto end = std::chrono::high_resolution_clock::now();
+      double seconds = std::chrono::duration<double>(end - start).count();
+      LOG(INFO) << name << " upload " << i << ": " << nbytes / seconds / 1e6 << " MB/s, "
+                << (loopback.bytes_sent() - bytes_sent) / 1e6 << " MB sent";
+    }
+  };
+  run("raw", RPCTransferCodec::kRaw, false);
+  run("lz4", RPCTransferCodec::kLZ4, false);
+  run("lz4+dedup", RPCTransferCodec::kLZ4, true);
+}
+
+TEST(RPCEndpoint, DISABLED_BenchmarkSmallCalls) {
+  // The number of calls, 10K by default.
+  const char* env = std::getenv("TVM_BENCHMARK_RPC_CALLS");
+  int num_calls = env != nullptr ? std::atoi(env) : 10000;
+  RPCLoopback loopback;
+  PackedFunc add_one = loopback.module().GetFunction("testing.rpc_endpoint.add_one");
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < num_calls; ++i) {
+    add_one(i);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  double sync_us = std::chrono::duration<double, std::micro>(end - start).count() / num_calls;
+
+  start = std::chrono::high_resolution_clock::now();
+  std::vector<PackedFunc> waits;
+  for (int i = 0; i < num_calls; ++i) {
+    waits.push_back(loopback.Submit("testing.rpc_endpoint.add_one", i));
+  }
+  for (const PackedFunc& wait : waits) {
+    wait();
+  }
+  end = std::chrono::high_resolution_clock::now();
+  double pipelined_us = std::chrono::duration<double, std::micro>(end - start).count() / num_calls;
+  LOG(INFO) << "synchronous: " << sync_us << " us/call, " << 1e6 / sync_us << " calls/s";
+  LOG(INFO) << "pipelined: " << pipelined_us << " us/call, " << 1e6 / pipelined_us << " calls/s";
+}
+
+#endif  // _WIN32
+
+}  // namespace runtime
+}  // namespace tvm
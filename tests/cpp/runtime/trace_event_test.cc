@@ -0,0 +1,121 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <tvm/runtime/logging.h>
+#include <tvm/runtime/trace_event.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+namespace profiling {
+
+namespace {
+
+size_t CountOccurrences(const std::string& str, const std::string& pattern) {
+  size_t count = 0;
+  for (size_t pos = str.find(pattern); pos != std::string::npos;
+       pos = str.find(pattern, pos + 1)) {
+    ++count;
+  }
+  return count;
+}
+
+std::string TraceToString() {
+  std::ostringstream os;
+  WriteTrace(os);
+  return os.str();
+}
+
+}  // namespace
+
+TEST(TraceEvent, RecordsEventsOfAllThreads) {
+  constexpr int kNumThreads = 4;
+  // More events than a chunk of a thread buffer holds.
+  constexpr int kNumEvents = 3000;
+  StartTrace();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([i]() {
+      SetTraceThreadName("worker " + std::to_string(i));
+      for (int j = 0; j < kNumEvents; ++j) {
+        TraceScope scope("test", "event \"quoted\"", "index", j);
+      }
+      RecordTraceCounter("test", "counter", i);
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  StopTrace();
+  { TraceScope scope("test", "after stop"); }
+  std::string trace = TraceToString();
+  EXPECT_EQ(trace.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0);
+  EXPECT_EQ(CountOccurrences(trace, "\"ph\":\"X\""), kNumThreads * kNumEvents);
+  EXPECT_EQ(CountOccurrences(trace, "\"name\":\"event \\\"quoted\\\"\""),
+            kNumThreads * kNumEvents);
+  EXPECT_EQ(CountOccurrences(trace, "\"ph\":\"C\""), kNumThreads);
+  EXPECT_EQ(CountOccurrences(trace, "\"args\":{\"index\":2999}"), kNumThreads);
+  EXPECT_EQ(CountOccurrences(trace, "after stop"), 0);
+  for (int i = 0; i < kNumThreads; ++i) {
+    EXPECT_NE(trace.find("\"args\":{\"name\":\"worker " + std::to_string(i) + "\"}"),
+              std::string::npos);
+  }
+}
+
+TEST(TraceEvent, RestartDropsPreviousEvents) {
+  StartTrace();
+  { TraceScope scope("test", "first"); }
+  StartTrace();
+  { TraceScope scope("test", "second"); }
+  // The trace can be written while recording.
+  std::string trace = TraceToString();
+  StopTrace();
+  EXPECT_EQ(CountOccurrences(trace, "\"name\":\"first\""), 0);
+  EXPECT_EQ(CountOccurrences(trace, "\"name\":\"second\""), 1);
+}
+
+TEST(TraceEvent, DISABLED_BenchmarkOverhead) {
+  // The number of scopes, 10M by default.
+  const char* env = std::getenv("TVM_BENCHMARK_TRACE_EVENTS");
+  int64_t num_events = env != nullptr ? std::atoll(env) : 10000000;
+  auto time_ns = [&]() {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int64_t i = 0; i < num_events; ++i) {
+      TraceScope scope("test", "event");
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / num_events;
+  };
+  LOG(INFO) << "disabled: " << time_ns() << " ns/scope";
+  StartTrace();
+  double enabled_ns = time_ns();
+  StopTrace();
+  LOG(INFO) << "enabled: " << enabled_ns << " ns/scope";
+}
+
+}  // namespace profiling
+}  // namespace runtime
+}  // namespace tvm
@@ -0,0 +1,142 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <tvm/ir/module.h>
+#include <tvm/node/structural_hash.h>
+#include <tvm/relax/expr.h>
+#include <tvm/relax/struct_info.h>
+#include <tvm/runtime/logging.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace tvm;
+
+/*! \brief A chain of `num_bindings` elementwise ops on x, picking the ops by the bits of seed. */
+relax::Function MakeFunction(int num_bindings, int seed) {
+  relax::StructInfo sinfo = relax::TensorStructInfo(DataType::Float(32), 2);
+  relax::Var x("x", sinfo);
+  Array<relax::Binding> bindings;
+  relax::Expr prev = x;
+  for (int i = 0; i < num_bindings; ++i) {
+    relax::DataflowVar lv("lv" + std::to_string(i), sinfo);
+    Op op = Op::Get((seed >> (i % 16)) & 1 ? "relax.multiply" : "relax.add");
+    bindings.push_back(relax::VarBinding(lv, relax::Call(op, {prev, x})));
+    prev = lv;
+  }
+  relax::SeqExpr body({relax::DataflowBlock(bindings)}, prev);
+  return relax::Function({x}, body, sinfo);
+}
+
+}  // namespace
+
+TEST(StructuralHashCache, SameValues) {
+  relax::Function func = MakeFunction(32, 0x1234);
+  IRModule mod({{GlobalVar("main"), func}});
+  uint64_t func_hash = StructuralHash()(func);
+  uint64_t mod_hash = StructuralHash()(mod);
+  StructuralHashCache::EnterScope();
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(StructuralHash()(func), func_hash);
+    EXPECT_EQ(StructuralHash()(mod), mod_hash);
+  }
+  StructuralHashCache::ExitScope();
+  EXPECT_NE(StructuralHash()(MakeFunction(32, 0x4321)), func_hash);
+}
+
+TEST(StructuralHashCache, CopyOnWriteAfterHash) {
+  relax::Function func = MakeFunction(32, 0x1234);
+  const Object* func_ptr = func.get();
+  StructuralHashCache::EnterScope();
+  uint64_t func_hash = StructuralHash()(func);
+  // The cache shares the function, so CopyOnWrite copies it rather than mutating the cached one.
+  EXPECT_EQ(func.use_count(), 2);
+  func.CopyOnWrite()->body = relax::SeqExpr(func->params[0]);
+  EXPECT_NE(func.get(), func_ptr);
+  uint64_t new_hash = StructuralHash()(func);
+  EXPECT_NE(new_hash, func_hash);
+  StructuralHashCache::ExitScope();
+  EXPECT_EQ(func.use_count(), 1);
+  EXPECT_EQ(StructuralHash()(func), new_hash);
+}
+
+TEST(StructuralHashCache, AddressReuse) {
+  uint64_t expected_hash = StructuralHash()(relax::PrimValue::Int64(2));
+  StructuralHashCache::EnterScope();
+  for (int i = 0; i < 16; ++i) {
+    // Free a hashed expression, then build a different one of the same type in its place, which
+    // the allocator tends to put at the same address unless the cache keeps the first one alive.
+    StructuralHash()(relax::PrimValue::Int64(1));
+    EXPECT_EQ(StructuralHash()(relax::PrimValue::Int64(2)), expected_hash);
+  }
+  StructuralHashCache::ExitScope();
+}
+
+TEST(StructuralHashCache, ModuleNotCached) {
+  GlobalVar gvar("main");
+  IRModule mod({{gvar, MakeFunction(32, 0x1234)}});
+  const Object* mod_ptr = mod.get();
+  StructuralHashCache::EnterScope();
+  uint64_t mod_hash = StructuralHash()(mod);
+  mod.CopyOnWrite()->Update(gvar, MakeFunction(32, 0x4321));
+  EXPECT_EQ(mod.get(), mod_ptr);
+  EXPECT_NE(StructuralHash()(mod), mod_hash);
+  StructuralHashCache::ExitScope();
+}
+
+TEST(StructuralHashCache, DISABLED_BenchmarkPasses) {
+  // The number of passes to simulate, 64 by default.
+  const char* env = std::getenv("TVM_BENCHMARK_STRUCTURAL_HASH_PASSES");
+  int num_passes = env != nullptr ? std::atoi(env) : 64;
+  constexpr int kNumFunctions = 64;
+  constexpr int kNumBindings = 512;
+  for (bool use_cache : {false, true}) {
+    std::vector<GlobalVar> gvars;
+    IRModule mod;
+    for (int i = 0; i < kNumFunctions; ++i) {
+      gvars.push_back(GlobalVar("func" + std::to_string(i)));
+      mod->Add(gvars.back(), MakeFunction(kNumBindings, i));
+    }
+    if (use_cache) {
+      StructuralHashCache::EnterScope();
+    }
+    // Each pass rewrites one function, then hashes every function, e.g. to deduplicate them.
+    uint64_t checksum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int pass = 0; pass < num_passes; ++pass) {
+      int index = pass % kNumFunctions;
+      mod.CopyOnWrite()->Update(gvars[index], MakeFunction(kNumBindings, index + pass));
+      for (const auto& kv : mod->functions) {
+        checksum ^= StructuralHash()(kv.second);
+      }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    if (use_cache) {
+      StructuralHashCache::ExitScope();
+    }
+    LOG(INFO) << "use_cache=" << use_cache << ": "
+              << std::chrono::duration<double, std::milli>(end - start).count() / num_passes
+              << " ms/pass, checksum " << checksum;
+  }
+}
@@ -0,0 +1,81 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "../../../src/support/lz4.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace tvm {
+namespace support {
+namespace {
+
+std::string RoundTrip(const std::string& data) {
+  std::string compressed;
+  LZ4Compress(data.data(), data.size(), &compressed);
+  EXPECT_LE(compressed.size(), LZ4CompressBound(data.size()));
+  std::string out(data.size(), '\0');
+  EXPECT_TRUE(LZ4Decompress(compressed.data(), compressed.size(), &out[0], out.size()));
+  EXPECT_EQ(out, data);
+  return compressed;
+}
+
+TEST(LZ4, RoundTrip) {
+  std::mt19937 rng(0);
+  for (size_t size : {0, 1, 12, 13, 100, 65536, 1 << 20}) {
+    std::string random(size, '\0'), zeros(size, '\0'), periodic(size, '\0');
+    for (size_t i = 0; i < size; ++i) {
+      random[i] = static_cast<char>(rng());
+      periodic[i] = "abcabd"[i % 6];
+    }
+    RoundTrip(random);
+    RoundTrip(periodic);
+    std::string compressed = RoundTrip(zeros);
+    if (size >= 65536) {
+      EXPECT_LT(compressed.size(), size / 200);
+    }
+  }
+}
+
+TEST(LZ4, DecompressKnownBlock) {
+  // The literals "abc" followed by a match of 11 bytes at offset 3, and the last 5 literals.
+  const unsigned char block[] = {0x37, 'a', 'b', 'c', 0x03, 0x00, 0x50, 'c', 'a', 'b', 'c', 'a'};
+  std::string out(19, '\0');
+  ASSERT_TRUE(LZ4Decompress(block, sizeof(block), &out[0], out.size()));
+  EXPECT_EQ(out, "abcabcabcabcabcabca");
+}
+
+TEST(LZ4, RejectsInvalidBlocks) {
+  std::string data(4096, 'x');
+  std::string compressed;
+  LZ4Compress(data.data(), data.size(), &compressed);
+  std::string out(data.size(), '\0');
+  // The wrong size, a truncated block and an offset before the start of the output.
+  EXPECT_FALSE(LZ4Decompress(compressed.data(), compressed.size(), &out[0], out.size() - 1));
+  EXPECT_FALSE(LZ4Decompress(compressed.data(), compressed.size() - 1, &out[0], out.size()));
+  const unsigned char bad_offset[] = {0x10, 'a', 0x02, 0x00, 0x00};
+  EXPECT_FALSE(LZ4Decompress(bad_offset, sizeof(bad_offset), &out[0], 5));
+}
+
+}  // namespace
+}  // namespace support
+}  // namespace tvm
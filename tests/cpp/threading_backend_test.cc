@@ -23,6 +23,7 @@
 #include <tvm/runtime/threading_backend.h>
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <sstream>
 #include <thread>
@@ -192,3 +193,166 @@ TEST(ThreadingBackend, TVMBackendParallelForWithThreadingBackend) {
     EXPECT_EQ(vec[i], i);
   }
 }
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchNested) {
+  constexpr int kOuter = 8;
+  std::vector<std::atomic<size_t>> acc(kOuter);
+  tvm::runtime::parallel_for_with_threading_backend(
+      [&acc](int i) {
+        tvm::runtime::parallel_for_with_threading_backend(
+            [&acc, i](int j) { acc[i].fetch_add(j, std::memory_order_relaxed); }, 0, N);
+      },
+      0, kOuter);
+  for (int i = 0; i < kOuter; ++i) {
+    EXPECT_EQ(acc[i].load(std::memory_order_relaxed), N * (N - 1) / 2);
+  }
+}
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchMoreTasksThanThreads) {
+  // More tasks than threads are balanced across the workers by stealing.
+  int num_task = tvm::runtime::threading::NumThreads() * 8 + 3;
+  std::vector<std::atomic<int>> visits(num_task);
+  auto flambda = [](int task_id, TVMParallelGroupEnv* penv, void* cdata) -> int {
+    auto* visits = static_cast<std::vector<std::atomic<int>>*>(cdata);
+    EXPECT_EQ(penv->num_task, static_cast<int>(visits->size()));
+    (*visits)[task_id].fetch_add(1, std::memory_order_relaxed);
+    return 0;
+  };
+  if (tvm::runtime::threading::MaxConcurrency() == 1) return;
+  EXPECT_EQ(TVMBackendParallelLaunch(flambda, &visits, num_task), 0);
+  for (int i = 0; i < num_task; ++i) {
+    EXPECT_EQ(visits[i].load(), 1);
+  }
+}
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchConcurrentUserThreads) {
+  // User threads share the workers of one pool.
+  std::vector<std::thread> ts;
+  for (int t = 0; t < 4; ++t) {
+    ts.emplace_back([]() {
+      for (int j = 0; j < 100; ++j) {
+        std::atomic<size_t> acc(0);
+        TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0);
+        EXPECT_EQ(acc.load(std::memory_order_relaxed), N * (N - 1) / 2);
+      }
+    });
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+}
+
+// Checks that all the tasks reach the barrier before any of them leaves it.
+int barrier_task(int task_id, TVMParallelGroupEnv* penv, void* cdata) {
+  auto* arrived = static_cast<std::atomic<int>*>(cdata);
+  arrived->fetch_add(1);
+  TVMBackendParallelBarrier(task_id, penv);
+  EXPECT_EQ(arrived->load(), penv->num_task);
+  TVMBackendParallelBarrier(task_id, penv);
+  return 0;
+}
+
+TEST(ThreadingBackend, TVMBackendParallelBarrierNested) {
+  // The nested launches cannot get the workers, which all run the outer tasks.
+  std::atomic<int> done(0);
+  auto outer = [](int task_id, TVMParallelGroupEnv* penv, void* cdata) -> int {
+    TVMBackendParallelBarrier(task_id, penv);
+    std::atomic<int> arrived(0);
+    EXPECT_EQ(TVMBackendParallelLaunch(barrier_task, &arrived, 0), 0);
+    static_cast<std::atomic<int>*>(cdata)->fetch_add(1);
+    return 0;
+  };
+  EXPECT_EQ(TVMBackendParallelLaunch(outer, &done, 0), 0);
+  EXPECT_EQ(done.load(), tvm::runtime::threading::NumThreads());
+}
+
+TEST(ThreadingBackend, TVMBackendParallelBarrierConcurrentUserThreads) {
+  // User threads compete for the workers, with and without a fixed number of tasks.
+  int num_threads = tvm::runtime::threading::NumThreads();
+  std::vector<std::thread> ts;
+  for (int t = 0; t < 4; ++t) {
+    ts.emplace_back([t, num_threads]() {
+      for (int j = 0; j < 100; ++j) {
+        std::atomic<int> arrived(0);
+        int num_task = t % 2 == 0 ? 0 : num_threads;
+        EXPECT_EQ(TVMBackendParallelLaunch(barrier_task, &arrived, num_task), 0);
+        EXPECT_GE(arrived.load(), 1);
+        if (num_task != 0) EXPECT_EQ(arrived.load(), num_task);
+      }
+    });
+  }
+  for (auto& t : ts) {
+    t.join();
+  }
+}
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchError) {
+  if (tvm::runtime::threading::MaxConcurrency() == 1) return;
+  auto flambda = [](int task_id, TVMParallelGroupEnv* penv, void* cdata) -> int {
+    if (task_id == penv->num_task - 1) {
+      TVMAPISetLastError("fail in last task");
+      return -1;
+    }
+    return 0;
+  };
+  EXPECT_EQ(TVMBackendParallelLaunch(flambda, nullptr, 0), -1);
+  EXPECT_NE(std::string(TVMGetLastError()).find("fail in last task"), std::string::npos);
+  // the pool is still usable afterwards
+  std::atomic<size_t> acc(0);
+  EXPECT_EQ(TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0), 0);
+  EXPECT_EQ(acc.load(std::memory_order_relaxed), N * (N - 1) / 2);
+}
+
+// Microbenchmarks of the thread pool, run them with --gtest_also_run_disabled_tests.
+TEST(ThreadingBackend, DISABLED_BenchmarkLaunchLatency) {
+  auto fempty = [](int task_id, TVMParallelGroupEnv* penv, void* cdata) -> int { return 0; };
+  constexpr int kRepeat = 100000;
+  for (int i = 0; i < 1000; ++i) {
+    TVMBackendParallelLaunch(fempty, nullptr, 0);
+  }
+  auto start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < kRepeat; ++i) {
+    TVMBackendParallelLaunch(fempty, nullptr, 0);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - start).count() / kRepeat;
+  LOG(INFO) << "threads=" << tvm::runtime::threading::NumThreads()
+            << " empty launch latency: " << ns << " ns";
+}
+
+TEST(ThreadingBackend, DISABLED_BenchmarkImbalance) {
+  // Iteration i costs i units of work, so the static split gives the last
+  // thread about twice the average load.
+  struct Job {
+    int64_t extent;
+    std::atomic<uint64_t> sink{0};
+  };
+  auto fskewed = [](int task_id, TVMParallelGroupEnv* penv, void* cdata) -> int {
+    auto* job = static_cast<Job*>(cdata);
+    int64_t step = (job->extent + penv->num_task - 1) / penv->num_task;
+    int64_t begin = std::min(task_id * step, job->extent);
+    int64_t end = std::min(begin + step, job->extent);
+    uint64_t x = 0;
+    for (int64_t i = begin; i < end; ++i) {
+      for (int64_t k = 0; k < i * 64; ++k) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+      }
+    }
+    job->sink.fetch_add(x, std::memory_order_relaxed);
+    return 0;
+  };
+  int num_threads = tvm::runtime::threading::NumThreads();
+  for (int tasks_per_thread : {1, 4, 16}) {
+    Job job;
+    job.extent = 1024;
+    constexpr int kRepeat = 10;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < kRepeat; ++i) {
+      TVMBackendParallelLaunch(fskewed, &job, num_threads * tasks_per_thread);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(end - start).count() / kRepeat;
+    LOG(INFO) << "threads=" << num_threads << " tasks_per_thread=" << tasks_per_thread
+              << " skewed loop: " << ms << " ms";
+  }
+}
@@ -333,6 +333,75 @@ def test_multiple_func():
     tvm.testing.assert_allclose(c.numpy(), a.numpy() + b.numpy())
 
 
+@tvm.testing.requires_llvm
+def test_parallel_codegen():
+    n = te.size_var("n")
+    A = te.placeholder((n,), name="A")
+    B = te.compute((n,), lambda i: A[i] + 1.0, name="B")
+    func = te.create_prim_func([A, B])
+
+    @I.ir_module
+    class Subroutine:
+        @T.prim_func
+        def main(A: T.Buffer(1, dtype="float32")):
+            T.func_attr({"global_symbol": "main"})
+            Subroutine.subroutine(A.data)
+
+        @T.prim_func
+        def subroutine(A_data: T.handle("float32")):
+            T.func_attr({"global_symbol": "subroutine", "calling_conv": -1})
+            A = T.decl_buffer(1, dtype="float32", data=A_data)
+            A[0] = 42.0
+
+    # The functions that call each other are generated in the same partition.
+    funcs = {f"fadd{i}": func.with_attr("global_symbol", f"fadd{i}") for i in range(8)}
+    # Keep the GlobalVars of Subroutine, which its main calls through.
+    funcs.update(Subroutine.functions)
+    mod = tvm.IRModule(funcs)
+    with tvm.transform.PassContext(config={"llvm.codegen_threads": 4}):
+        f = tvm.tir.build(mod, target="llvm")
+    assert len(f.imported_modules) == 3
+
+    dev = tvm.cpu(0)
+    a = tvm.nd.array(np.random.uniform(size=10).astype(A.dtype), dev)
+    temp = utils.tempdir()
+    f.export_library(temp.relpath("lib.so"))
+    for built in [f, tvm.runtime.load_module(temp.relpath("lib.so"))]:
+        for i in range(8):
+            b = tvm.nd.array(np.zeros(10, dtype=B.dtype), dev)
+            built[f"fadd{i}"](a, b)
+            tvm.testing.assert_allclose(b.numpy(), a.numpy() + 1.0)
+        arr = tvm.nd.array(np.zeros([1], "float32"), device=dev)
+        built["main"](arr)
+        assert arr.numpy()[0] == 42.0
+
+
+@tvm.testing.requires_llvm
+def test_compile_cache():
+    n = te.size_var("n")
+    A = te.placeholder((n,), name="A")
+    B = te.compute((n,), lambda i: A[i] * 2.0, name="B")
+    mod = tvm.IRModule({"main": te.create_prim_func([A, B]).with_attr("global_symbol", "main")})
+
+    temp = utils.tempdir()
+    config = {"target.compile_cache_dir": temp.relpath("cache")}
+    tvm.target.codegen.reset_compile_cache_stats()
+    with tvm.transform.PassContext(config=config):
+        f_miss = tvm.tir.build(mod, target="llvm")
+    assert tvm.target.codegen.compile_cache_stats() == {"hits": 0, "misses": 1}
+    # The second build loads the bitcode of the first from the cache.
+    with tvm.transform.PassContext(config=config):
+        f_hit = tvm.tir.build(mod, target="llvm")
+    assert tvm.target.codegen.compile_cache_stats() == {"hits": 1, "misses": 1}
+
+    dev = tvm.cpu(0)
+    a = tvm.nd.array(np.random.uniform(size=10).astype(A.dtype), dev)
+    for f in [f_miss, f_hit]:
+        b = tvm.nd.array(np.zeros(10, dtype=B.dtype), dev)
+        f(a, b)
+        tvm.testing.assert_allclose(b.numpy(), a.numpy() * 2.0)
+
+
 @tvm.testing.requires_llvm
 def test_llvm_condition():
     def check_llvm(n, offset):
@@ -15,7 +15,7 @@
 # specific language governing permissions and limitations
 # under the License.
 # pylint: disable=missing-docstring
-"""Tests for NCCL/RCCL"""
+"""Tests for NCCL/RCCL and the shared memory CCL"""
 
 import tempfile
 
@@ -32,10 +32,13 @@ from tvm.runtime.relax_vm import VirtualMachine
 from tvm.script import relax as R
 
 _all_session_kinds = [di.ThreadedSession, di.ProcessSession]
-_ccl = [get_global_func("runtime.disco.compiled_ccl")()]
+_compiled_ccl = get_global_func("runtime.disco.compiled_ccl", allow_missing=True)
+_ccl = ["shm"] + ([_compiled_ccl()] if _compiled_ccl is not None else [])
 
 
 def create_device_target(ccl):
+    if ccl == "shm":
+        return (tvm.cpu(0), tvm.target.Target("llvm"))
     if ccl == "nccl":
         dev = tvm.cuda(0)
     else:
@@ -44,6 +47,18 @@ def create_device_target(ccl):
     return (dev, target)
 
 
+def apply_default_schedule(mod, target):
+    if target.kind.name == "llvm":
+        return mod
+    return dl.ApplyDefaultSchedule(  # pylint: disable=not-callable
+        dl.gpu.Matmul(),
+        dl.gpu.GEMV(),
+        dl.gpu.Reduction(),
+        dl.gpu.GeneralReduction(),
+        dl.gpu.Fallback(),
+    )(mod)
+
+
 @pytest.mark.parametrize("session_kind", _all_session_kinds)
 @pytest.mark.parametrize("ccl", _ccl)
 def test_init(session_kind, ccl):
@@ -78,6 +93,31 @@ def test_allreduce(session_kind, ccl):
         np.testing.assert_equal(result, expected)
 
 
+@pytest.mark.parametrize("session_kind", _all_session_kinds)
+@pytest.mark.parametrize("dtype", ["float16", "float64", "int32"])
+def test_shm_allreduce_across_chunks(session_kind, dtype):
+    devices = [0, 1, 2]
+    sess = session_kind(num_workers=len(devices))
+    sess.init_ccl("shm", *devices)
+
+    # Larger than the 4 MB each worker stages at a time, and not divisible by 3 workers.
+    shape = (1025, 2049)
+    arrays = [np.arange(np.prod(shape)).reshape(shape) % 5 + i for i in range(len(devices))]
+    arrays = [array.astype(dtype) for array in arrays]
+    d_array = sess.empty(shape, dtype)
+    for i, array in enumerate(arrays):
+        d_array.debug_copy_from(i, array)
+    for op, np_op in [  # pylint: disable=invalid-name
+        ("sum", np.add),
+        ("max", np.maximum),
+    ]:
+        dst_array = sess.empty(shape, dtype)
+        sess.allreduce(d_array, dst_array, op=op)
+        expected = np_op(np_op(arrays[0], arrays[1]), arrays[2])
+        for i in range(len(devices)):
+            np.testing.assert_equal(dst_array.debug_get_from_remote(i).numpy(), expected)
+
+
 @pytest.mark.parametrize("session_kind", _all_session_kinds)
 @pytest.mark.parametrize("ccl", _ccl)
 def test_group_allreduce(session_kind, ccl):
@@ -477,13 +517,7 @@ def test_mlp(session_kind, ccl):  # pylint: disable=too-many-locals
     def relax_build(mod, target):
         with target:
             mod = rx.get_pipeline("zero")(mod)  # pylint: disable=no-value-for-parameter
-            mod = dl.ApplyDefaultSchedule(  # pylint: disable=not-callable
-                dl.gpu.Matmul(),
-                dl.gpu.GEMV(),
-                dl.gpu.Reduction(),
-                dl.gpu.GeneralReduction(),
-                dl.gpu.Fallback(),
-            )(mod)
+            mod = apply_default_schedule(mod, target)
             return tvm.compile(mod, target=target)
 
     # pylint: disable=invalid-name
@@ -616,13 +650,7 @@ def test_attention(session_kind, ccl):  # pylint: disable=too-many-locals,too-ma
     def relax_build(mod, target):
         with target:
             mod = rx.get_pipeline("zero")(mod)  # pylint: disable=no-value-for-parameter
-            mod = dl.ApplyDefaultSchedule(  # pylint: disable=not-callable
-                dl.gpu.Matmul(),
-                dl.gpu.GEMV(),
-                dl.gpu.Reduction(),
-                dl.gpu.GeneralReduction(),
-                dl.gpu.Fallback(),
-            )(mod)
+            mod = apply_default_schedule(mod, target)
             return tvm.compile(mod, target=target)
 
     # pylint: disable=invalid-name
@@ -117,7 +117,13 @@ def create_socket_session(num_workers):
     return _SOCKET_SESSION_TESTER.sess
 
 
+def create_shm_process_session(num_workers):
+    return di.ProcessSession(num_workers=num_workers, channel="shm")
+
+
 _all_session_kinds = [di.ThreadedSession, di.ProcessSession, create_socket_session]
+if sys.platform != "win32":
+    _all_session_kinds.append(create_shm_process_session)
 
 
 @pytest.mark.parametrize("session_kind", _all_session_kinds)
@@ -165,6 +171,19 @@ def test_string(session_kind):
         assert result.debug_get_from_remote(i) == "hello_suffix"
 
 
+@pytest.mark.parametrize("session_kind", _all_session_kinds)
+def test_long_string(session_kind):
+    # Longer than the ring buffers of the shared memory channel
+    num_workers = 4
+    sess = session_kind(num_workers=num_workers)
+    func: di.DPackedFunc = sess.get_global_func("tests.disco.str")
+    value = "x" * (3 << 20) + "y"
+    result: di.DRef = func(value)
+
+    for i in range(num_workers):
+        assert result.debug_get_from_remote(i) == value + "_suffix"
+
+
 @pytest.mark.parametrize("session_kind", _all_session_kinds)
 def test_string_obj(session_kind):
     num_workers = 4
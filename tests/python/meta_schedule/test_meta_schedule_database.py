@@ -16,7 +16,9 @@
 # under the License.
 # pylint: disable=missing-module-docstring,missing-function-docstring,missing-class-docstring
 """Test Meta Schedule Database"""
+import os
 import os.path as osp
+import struct
 import tempfile
 from typing import Callable, List, Optional
 
@@ -582,6 +584,184 @@ def test_json_database_get_top_k(k, expected):
     assert result == expected
 
 
+def test_json_database_get_top_k_per_workload():
+    trace = _create_schedule(Matmul, _schedule_matmul).trace
+    with tempfile.TemporaryDirectory() as tmpdir:
+        database = _create_tmp_database(tmpdir)
+        for mod, run_secs_list in [
+            (Matmul, [[3.0], [1e10], [1.0], [2.0]]),
+            (MatmulRelu, [[0.5], [4.0]]),
+        ]:
+            workload = database.commit_workload(mod)
+            for run_secs in run_secs_list:
+                database.commit_tuning_record(
+                    ms.database.TuningRecord(
+                        trace,
+                        workload,
+                        run_secs,
+                        tvm.target.Target("llvm"),
+                        ms.arg_info.ArgInfo.from_prim_func(func=mod["main"]),
+                    )
+                )
+
+        def top_k(db, mod, k):  # pylint: disable=invalid-name
+            records = db.get_top_k(db.commit_workload(mod), k)
+            return [[v.value for v in record.run_secs] for record in records]
+
+        assert top_k(database, Matmul, 2) == [[1.0], [2.0]]
+        assert top_k(database, Matmul, 5) == [[1.0], [2.0], [3.0]]
+        assert top_k(database, MatmulRelu, 5) == [[0.5], [4.0]]
+        # Each commit is written to the files right away
+        with open(database.path_tuning_record, encoding="utf-8") as file:
+            assert len(file.readlines()) == 6
+        reloaded = ms.database.JSONDatabase(
+            path_workload=database.path_workload,
+            path_tuning_record=database.path_tuning_record,
+        )
+        assert len(reloaded) == 6
+        assert top_k(reloaded, Matmul, 5) == [[1.0], [2.0], [3.0]]
+
+
+@pytest.mark.skipif(os.geteuid() == 0, reason="root can write to read-only files")
+def test_json_database_read_only_files():
+    with tempfile.TemporaryDirectory() as tmpdir:
+        database = _create_tmp_database(tmpdir)
+        workload = database.commit_workload(Matmul)
+        database.commit_tuning_record(
+            ms.database.TuningRecord(
+                _create_schedule(Matmul, _schedule_matmul).trace,
+                workload,
+                [1.0],
+                tvm.target.Target("llvm"),
+                ms.arg_info.ArgInfo.from_prim_func(func=Matmul["main"]),
+            )
+        )
+        for path in [database.path_workload, database.path_tuning_record]:
+            os.chmod(path, 0o444)
+        # The files are only opened for writing on the first commit
+        reloaded = ms.database.JSONDatabase(
+            path_workload=database.path_workload,
+            path_tuning_record=database.path_tuning_record,
+            allow_missing=False,
+        )
+        assert len(reloaded) == 1
+        assert reloaded.has_workload(Matmul)
+        assert len(reloaded.get_top_k(workload, 1)) == 1
+
+
+def test_binary_database_json_round_trip():
+    trace = _create_schedule(Matmul, _schedule_matmul).trace
+    target = tvm.target.Target("llvm")
+
+    def make_record(workload, run_secs):  # pylint: disable=invalid-name
+        return ms.database.TuningRecord(
+            trace,
+            workload,
+            run_secs,
+            target,
+            ms.arg_info.ArgInfo.from_prim_func(func=Matmul["main"]),
+        )
+
+    def top_k(db, mod, k):  # pylint: disable=invalid-name
+        records = db.get_top_k(db.commit_workload(mod), k)
+        return [[v.value for v in record.run_secs] for record in records]
+
+    untuned = IRModule({"main": Matmul["main"].with_attr("untuned", True)})
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        json_database = _create_tmp_database(tmpdir)
+        for mod, run_secs_list in [
+            (Matmul, [[3.0], [1e10], [1.0], None, [2.0]]),
+            (MatmulRelu, [[0.5], [4.0]]),
+            (untuned, []),
+        ]:
+            workload = json_database.commit_workload(mod)
+            for run_secs in run_secs_list:
+                json_database.commit_tuning_record(make_record(workload, run_secs))
+        path = osp.join(tmpdir, "database.bin")
+        database = ms.database.BinaryDatabase.from_json(
+            json_database.path_workload, json_database.path_tuning_record, path
+        )
+        assert len(database) == 7
+        assert database.has_workload(Matmul)
+        assert database.has_workload(untuned)
+        assert top_k(database, Matmul, 5) == [[1.0], [2.0], [3.0]]
+        assert top_k(database, MatmulRelu, 1) == [[0.5]]
+        # Committed records are merged with the ones in the file until saved
+        database.commit_tuning_record(make_record(database.commit_workload(Matmul), [1.5]))
+        assert top_k(database, Matmul, 2) == [[1.0], [1.5]]
+        database.save()
+        reopened = ms.database.create("binary", path, allow_missing=False)
+        assert len(reopened) == 8
+        assert reopened.has_workload(untuned)
+        assert top_k(reopened, Matmul, 5) == [[1.0], [1.5], [2.0], [3.0]]
+        run_secs = [[v.value for v in r.run_secs or []] for r in reopened.get_all_tuning_records()]
+        assert run_secs[:6] == [[0.5], [1.0], [1.5], [2.0], [3.0], [4.0]]
+        converted = reopened.to_json(
+            osp.join(tmpdir, "converted_workloads.json"),
+            osp.join(tmpdir, "converted_tuning_records.json"),
+        )
+        assert len(converted) == 8
+        assert top_k(converted, MatmulRelu, 5) == [[0.5], [4.0]]
+        # The tuning records are in the file once to_json returns
+        with open(converted.path_tuning_record, encoding="utf-8") as file:
+            assert len(file.readlines()) == 8
+    with pytest.raises(ValueError):
+        ms.database.BinaryDatabase(path, allow_missing=False)
+
+
+def test_binary_database_log():
+    trace = _create_schedule(Matmul, _schedule_matmul).trace
+    target = tvm.target.Target("llvm")
+
+    def commit(db, mod, run_secs):  # pylint: disable=invalid-name
+        db.commit_tuning_record(
+            ms.database.TuningRecord(
+                trace,
+                db.commit_workload(mod),
+                run_secs,
+                target,
+                ms.arg_info.ArgInfo.from_prim_func(func=Matmul["main"]),
+            )
+        )
+
+    def top_k(db, mod, k):  # pylint: disable=invalid-name
+        records = db.get_top_k(db.commit_workload(mod), k)
+        return [[v.value for v in record.run_secs] for record in records]
+
+    with tempfile.TemporaryDirectory() as tmpdir:
+        path = osp.join(tmpdir, "database.bin")
+        database = ms.database.BinaryDatabase(path)
+        commit(database, Matmul, [2.0])
+        commit(database, MatmulRelu, [0.5])
+        del database
+        # The committed records are logged, so they survive the database without a save
+        reopened = ms.database.BinaryDatabase(path, allow_missing=False)
+        assert len(reopened) == 2
+        assert top_k(reopened, Matmul, 5) == [[2.0]]
+        commit(reopened, Matmul, [1.0])
+        reopened.save()
+        assert not osp.exists(path + ".log")
+        commit(reopened, Matmul, [3.0])
+        del reopened
+        # An interrupted append leaves an incomplete line, which is dropped
+        with open(path + ".log", "a", encoding="utf-8") as file:
+            file.write('[0, ["incomplete')
+        reopened = ms.database.BinaryDatabase(path, allow_missing=False)
+        assert len(reopened) == 4
+        assert top_k(reopened, Matmul, 5) == [[1.0], [2.0], [3.0]]
+        assert top_k(reopened, MatmulRelu, 5) == [[0.5]]
+        reopened.save()
+        del reopened
+        # Every entry of the file is checked when it is opened
+        with open(path, "r+b") as file:
+            num_workloads = struct.unpack("<Q", file.read(16)[8:])[0]
+            file.seek(40 + 48 * num_workloads)
+            file.write(struct.pack("<Q", 1 << 62))
+        with pytest.raises(ValueError, match="corrupted"):
+            ms.database.BinaryDatabase(path, allow_missing=False)
+
+
 def MatmulPrimFunc() -> IRModule:
     return Matmul
 
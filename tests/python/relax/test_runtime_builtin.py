@@ -188,6 +188,55 @@ def test_ndarray_cache():
         np.testing.assert_allclose(v.numpy(), v_np, atol=1e-6, rtol=1e-6)
 
 
+def test_ndarray_cache_mmap():
+    fload = tvm.get_global_func("vm.builtin.ndarray_cache.load")
+    fget_params = tvm.get_global_func("vm.builtin.param_array_from_cache")
+
+    param_dict = {
+        "x_0": np.arange(64, dtype="int32"),
+        "x_1": np.random.uniform(size=[10, 20]).astype("float32"),
+        "x_2": np.arange(3, dtype="int8"),
+    }
+
+    temp = utils.tempdir()
+    tvmjs.dump_ndarray_cache(param_dict, temp.path, encode_format="raw")
+    for use_mmap in [True, False]:
+        fload(str(temp.path), tvm.cpu().device_type, 0, use_mmap)
+        res = fget_params("x", -1)
+        for i, v in enumerate(res):
+            np.testing.assert_equal(v.numpy(), param_dict[f"x_{i}"])
+        # writing to a loaded parameter does not change the cache on disk
+        res[0].copyfrom(np.zeros(64, dtype="int32"))
+
+
+def test_ndarray_cache_pipelined():
+    fload = tvm.get_global_func("vm.builtin.ndarray_cache.load")
+    fget_params = tvm.get_global_func("vm.builtin.param_array_from_cache")
+
+    # two parameters per shard
+    param_dict = {f"x_{i}": np.random.uniform(size=[480, 480]).astype("float32") for i in range(6)}
+
+    temp = utils.tempdir()
+    tvmjs.dump_ndarray_cache(param_dict, temp.path, encode_format="f32-to-bf16", shard_cap_mb=1)
+    progress = []
+
+    def fprogress(loaded_shards, num_shards, loaded_bytes, total_bytes, elapsed):
+        progress.append((loaded_shards, num_shards, loaded_bytes, total_bytes))
+
+    for use_mmap in [True, False]:
+        progress.clear()
+        fload(str(temp.path), tvm.cpu().device_type, 0, use_mmap, 2, fprogress)
+        res = fget_params("x", -1)
+        for i, v in enumerate(res):
+            np.testing.assert_allclose(v.numpy(), param_dict[f"x_{i}"], atol=1e-2, rtol=1e-2)
+        num_shards = progress[-1][1]
+        assert num_shards > 1
+        assert [p[0] for p in progress] == list(range(1, num_shards + 1))
+        assert progress[-1][2] == progress[-1][3] == 6 * 480 * 480 * 2
+    # the other tests expect fewer parameters named "x_*" in the cache
+    tvm.get_global_func("vm.builtin.ndarray_cache.clear")()
+
+
 def test_ndarray_cache_update():
     fload = tvm.get_global_func("vm.builtin.ndarray_cache.load")
     fget_params = tvm.get_global_func("vm.builtin.param_array_from_cache")
@@ -25,15 +25,20 @@ import scipy.special
 import tvm
 import tvm.testing
 from tvm import dlight as dl
+from tvm.contrib import utils
 from tvm.relax.frontend.nn.llm.kv_cache import (
     AttnKind,
     _attention_decode_cpu,
     _attention_prefill_cpu,
     _attention_prefill_ragged_cpu,
     _compact_kv_copy_cpu,
+    _compact_kv_copy_quantized_cpu,
     _copy_single_page_cpu,
+    _copy_single_page_quantized_cpu,
     _kv_cache_debug_get_kv,
+    _kv_cache_debug_get_kv_quantized,
     _kv_cache_transpose_append,
+    _kv_cache_transpose_append_quantized,
     _merge_state_inplace_cpu,
     llama_rope_with_position_map,
     tree_attn_cpu,
@@ -68,6 +73,14 @@ fcommit_accepted_token_tree_nodes = None
 fattention_with_fuse_qkv = None
 fis_empty = None
 fdebug_get_kv = None
+fadd_sequence_with_prefix_cache = None
+fcommit_sequence_to_prefix_cache = None
+fclear_prefix_cache = None
+fget_prefix_cache_stats = None
+fget_num_available_pages = None
+fget_page_nbytes = None
+fenable_offload = None
+foffload_sequence = None
 
 ftranspose_append = None
 fcopy_cache = None
@@ -85,10 +98,13 @@ fcopy_single_page = None
 fcompact_copy = None
 
 
-def set_global_func(head_dim, dtype):
+def set_global_func(head_dim, dtype, page_dtype=None):
     global fclear, fadd_sequence, fremove_sequence, ffork_sequence, fenable_sliding_window_for_seq
     global fpopn, fbegin_forward, fend_forward, fcommit_accepted_token_tree_nodes
     global fattention_with_fuse_qkv, fis_empty, fdebug_get_kv
+    global fadd_sequence_with_prefix_cache, fcommit_sequence_to_prefix_cache
+    global fclear_prefix_cache, fget_prefix_cache_stats
+    global fget_num_available_pages, fget_page_nbytes, fenable_offload, foffload_sequence
     global ftranspose_append, fcopy_cache, fattn_prefill, fattn_decode
     global fattn_prefill_ragged, fattn_prefill_with_tree_mask, fattn_prefill_with_tree_mask_paged_kv_cache
     global fattn_prefill_sliding_window, fattn_decode_sliding_window
@@ -112,29 +128,70 @@ def set_global_func(head_dim, dtype):
     )
     fis_empty = tvm.get_global_func("vm.builtin.attention_kv_cache_empty")
     fdebug_get_kv = tvm.get_global_func("vm.builtin.attention_kv_cache_debug_get_kv")
+    fadd_sequence_with_prefix_cache = tvm.get_global_func(
+        "vm.builtin.attention_kv_cache_add_sequence_with_prefix_cache"
+    )
+    fcommit_sequence_to_prefix_cache = tvm.get_global_func(
+        "vm.builtin.attention_kv_cache_commit_sequence_to_prefix_cache"
+    )
+    fclear_prefix_cache = tvm.get_global_func("vm.builtin.attention_kv_cache_clear_prefix_cache")
+    fget_prefix_cache_stats = tvm.get_global_func(
+        "vm.builtin.attention_kv_cache_get_prefix_cache_stats"
+    )
+    fget_num_available_pages = tvm.get_global_func(
+        "vm.builtin.attention_kv_cache_get_num_available_pages"
+    )
+    fget_page_nbytes = tvm.get_global_func("vm.builtin.attention_kv_cache_get_page_nbytes")
+    fenable_offload = tvm.get_global_func("vm.builtin.attention_kv_cache_enable_offload")
+    foffload_sequence = tvm.get_global_func("vm.builtin.attention_kv_cache_offload_sequence")
+
+    if page_dtype is None:
+        transpose_append = _kv_cache_transpose_append(num_kv_heads, head_dim, dtype)
+        debug_get_kv = _kv_cache_debug_get_kv(num_layers, num_kv_heads, head_dim, dtype)
+        copy_single_page = _copy_single_page_cpu(num_kv_heads, page_size, head_dim, dtype)
+        compact_kv_copy = _compact_kv_copy_cpu(num_kv_heads, head_dim, dtype)
+    else:
+        transpose_append = _kv_cache_transpose_append_quantized(
+            num_kv_heads, head_dim, dtype, page_dtype
+        )
+        debug_get_kv = _kv_cache_debug_get_kv_quantized(
+            num_layers, num_kv_heads, head_dim, dtype, page_dtype
+        )
+        copy_single_page = _copy_single_page_quantized_cpu(
+            num_kv_heads, page_size, head_dim, page_dtype
+        )
+        compact_kv_copy = _compact_kv_copy_quantized_cpu(num_kv_heads, head_dim, page_dtype)
 
     target = tvm.target.Target.from_device(device)
     builts = []
     for tir_func in [
-        _kv_cache_transpose_append(num_kv_heads, head_dim, dtype),
-        _kv_cache_debug_get_kv(num_layers, num_kv_heads, head_dim, dtype),
-        _attention_prefill_cpu(num_kv_heads, num_qo_heads, head_dim, dtype, False, rope_scaling),
-        _attention_decode_cpu(num_kv_heads, num_qo_heads, head_dim, dtype, False, rope_scaling),
-        _attention_prefill_cpu(num_kv_heads, num_qo_heads, head_dim, dtype, True, rope_scaling),
-        _attention_decode_cpu(num_kv_heads, num_qo_heads, head_dim, dtype, True, rope_scaling),
+        transpose_append,
+        debug_get_kv,
+        _attention_prefill_cpu(
+            num_kv_heads, num_qo_heads, head_dim, dtype, False, rope_scaling, page_dtype=page_dtype
+        ),
+        _attention_decode_cpu(
+            num_kv_heads, num_qo_heads, head_dim, dtype, False, rope_scaling, page_dtype=page_dtype
+        ),
+        _attention_prefill_cpu(
+            num_kv_heads, num_qo_heads, head_dim, dtype, True, rope_scaling, page_dtype=page_dtype
+        ),
+        _attention_decode_cpu(
+            num_kv_heads, num_qo_heads, head_dim, dtype, True, rope_scaling, page_dtype=page_dtype
+        ),
         _attention_prefill_ragged_cpu(
             num_kv_heads, num_qo_heads, head_dim, head_dim, dtype, rope_scaling
         ),
         tree_attn_cpu(num_kv_heads, num_qo_heads, head_dim, dtype, rope_scaling),
         tree_attn_with_paged_kv_cache_cpu(
-            num_kv_heads, num_qo_heads, head_dim, dtype, rope_scaling
+            num_kv_heads, num_qo_heads, head_dim, dtype, rope_scaling, page_dtype
         ),
         _merge_state_inplace_cpu(dtype),
         llama_rope_with_position_map(
             rope_theta, rope_scale, head_dim, num_qo_heads, num_kv_heads, dtype, rope_scaling
         ),
-        _copy_single_page_cpu(num_kv_heads, page_size, head_dim, dtype),
-        _compact_kv_copy_cpu(num_kv_heads, head_dim, dtype),
+        copy_single_page,
+        compact_kv_copy,
     ]:
         mod = tvm.IRModule({"main": tir_func})
         with target:
@@ -159,9 +216,9 @@ def set_global_func(head_dim, dtype):
     ) = builts
 
 
-def create_kv_cache(head_dim, dtype, rope_mode, support_sliding_window):
+def create_kv_cache(head_dim, dtype, rope_mode, support_sliding_window, page_dtype=None):
     fcreate = tvm.get_global_func("vm.builtin.paged_attention_kv_cache_create")
-    cache = fcreate(
+    args = [
         tvm.runtime.ShapeTuple(
             [
                 reserved_nseq,
@@ -198,8 +255,10 @@ def create_kv_cache(head_dim, dtype, rope_mode, support_sliding_window):
         fcopy_single_page,
         fcopy_cache,
         fcompact_copy,
-    )
-    return cache
+    ]
+    if page_dtype is not None:
+        args.append(tvm.nd.empty((), page_dtype, device=device))
+    return fcreate(*args)
 
 
 class RopeMode(enum.IntEnum):
@@ -750,6 +809,203 @@ def test_paged_attention_kv_cache_popn(kv_cache_and_config):
     assert fis_empty(kv_cache), "The KV cache is not empty after removing all sequences"
 
 
+def test_paged_attention_kv_cache_prefix_cache(kv_cache_and_config):
+    kv_cache, rope_mode, support_sliding_window = kv_cache_and_config
+    if support_sliding_window and rope_mode == RopeMode.NORMAL:
+        return
+    fclear(kv_cache)
+
+    cached_k = {}
+    cached_v = {}
+    tokens = list(range(50))
+    assert fadd_sequence_with_prefix_cache(kv_cache, 0, ShapeTuple(tokens)) == 0
+    cached_k[0] = np.zeros((num_layers, 0, num_kv_heads, head_dim), dtype)
+    cached_v[0] = np.zeros((num_layers, 0, num_kv_heads, head_dim), dtype)
+    apply_attention(kv_cache, rope_mode, [(0, 50)], cached_k, cached_v)
+    fcommit_sequence_to_prefix_cache(kv_cache, 0, ShapeTuple(tokens))
+
+    # The prefix is reused in full pages, and the last token of a sequence is never reused.
+    prompts = [(1, tokens[:40] + [1000] * 20, 32), (2, tokens[:49], 48), (3, tokens, 48)]
+    for seq_id, prompt, expected_prefix_length in prompts:
+        prefix_length = fadd_sequence_with_prefix_cache(kv_cache, seq_id, ShapeTuple(prompt))
+        assert prefix_length == expected_prefix_length
+        cached_k[seq_id] = cached_k[0][:, :prefix_length]
+        cached_v[seq_id] = cached_v[0][:, :prefix_length]
+        apply_attention(
+            kv_cache, rope_mode, [(seq_id, len(prompt) - prefix_length)], cached_k, cached_v
+        )
+    # Decode.
+    for _ in range(3):
+        apply_attention(kv_cache, rope_mode, [(0, 1), (1, 1), (2, 1), (3, 1)], cached_k, cached_v)
+
+    # The prefix stays cached after the sequences are removed.
+    for seq_id in range(4):
+        fremove_sequence(kv_cache, seq_id)
+    assert list(fget_prefix_cache_stats(kv_cache)) == [209, 128, 3, 0]
+    assert fadd_sequence_with_prefix_cache(kv_cache, 4, ShapeTuple(tokens)) == 48
+    fremove_sequence(kv_cache, 4)
+    assert not fis_empty(kv_cache)
+    fclear_prefix_cache(kv_cache)
+    assert fis_empty(kv_cache), "The KV cache is not empty after clearing the prefix cache"
+
+
+def test_paged_attention_kv_cache_prefix_cache_eviction(kv_cache_and_config):
+    kv_cache, rope_mode, support_sliding_window = kv_cache_and_config
+    if support_sliding_window and rope_mode == RopeMode.NORMAL:
+        return
+    fclear(kv_cache)
+
+    cached_k = {}
+    cached_v = {}
+    prefix_length = 4 * page_size
+    # Cache three prefixes of 4 pages, and use the first one again, so that the second one is the
+    # least recently used.
+    prompts = [list(range(i * 1000, i * 1000 + prefix_length + 1)) for i in range(3)]
+    prefix_k = []
+    prefix_v = []
+    for seq_id, prompt in enumerate(prompts):
+        assert fadd_sequence_with_prefix_cache(kv_cache, seq_id, ShapeTuple(prompt)) == 0
+        cached_k[seq_id] = np.zeros((num_layers, 0, num_kv_heads, head_dim), dtype)
+        cached_v[seq_id] = np.zeros((num_layers, 0, num_kv_heads, head_dim), dtype)
+        apply_attention(kv_cache, rope_mode, [(seq_id, len(prompt))], cached_k, cached_v)
+        fcommit_sequence_to_prefix_cache(kv_cache, seq_id, ShapeTuple(prompt))
+        fremove_sequence(kv_cache, seq_id)
+        prefix_k.append(cached_k.pop(seq_id)[:, :prefix_length])
+        prefix_v.append(cached_v.pop(seq_id)[:, :prefix_length])
+    assert fadd_sequence_with_prefix_cache(kv_cache, 3, ShapeTuple(prompts[0])) == prefix_length
+    fremove_sequence(kv_cache, 3)
+
+    # Use all the free pages and 4 more, which evicts the least recently used prefix only.
+    num_pages = fget_num_available_pages(kv_cache) - 3 * 4 + 4
+    fill_lengths = [8 * page_size] * (num_pages // 8)
+    if num_pages % 8 != 0:
+        fill_lengths.append(num_pages % 8 * page_size)
+    fill_seq_ids = list(range(10, 10 + len(fill_lengths)))
+    for i in range(0, len(fill_seq_ids), 4):
+        batch = list(zip(fill_seq_ids[i : i + 4], fill_lengths[i : i + 4]))
+        apply_attention(kv_cache, rope_mode, batch, cached_k, cached_v)
+    assert fget_num_available_pages(kv_cache) == 2 * 4
+    # The cached and the evicted pages.
+    assert list(fget_prefix_cache_stats(kv_cache))[2:] == [2 * 4, 4]
+    verify_cached_kv(kv_cache, seq_ids=fill_seq_ids, expected_k=cached_k, expected_v=cached_v)
+    for seq_id in fill_seq_ids:
+        fremove_sequence(kv_cache, seq_id)
+        del cached_k[seq_id]
+        del cached_v[seq_id]
+
+    # The first and the third prefixes are still cached, and attend correctly.
+    for i, expected_prefix_length in enumerate([prefix_length, 0, prefix_length]):
+        seq_id = 4 + i
+        length = fadd_sequence_with_prefix_cache(kv_cache, seq_id, ShapeTuple(prompts[i]))
+        assert length == expected_prefix_length
+        cached_k[seq_id] = prefix_k[i][:, :length]
+        cached_v[seq_id] = prefix_v[i][:, :length]
+        apply_attention(kv_cache, rope_mode, [(seq_id, len(prompts[i]) - length)], cached_k, cached_v)
+    apply_attention(kv_cache, rope_mode, [(4, 1), (5, 1), (6, 1)], cached_k, cached_v)
+    verify_cached_kv(kv_cache, seq_ids=[4, 5, 6], expected_k=cached_k, expected_v=cached_v)
+
+    for seq_id in [4, 5, 6]:
+        fremove_sequence(kv_cache, seq_id)
+    fclear_prefix_cache(kv_cache)
+    assert fis_empty(kv_cache), "The KV cache is not empty after clearing the prefix cache"
+
+
+def test_paged_attention_kv_cache_offload(kv_cache_and_config):
+    kv_cache, rope_mode, support_sliding_window = kv_cache_and_config
+    if support_sliding_window and rope_mode == RopeMode.NORMAL:
+        return
+    fclear(kv_cache)
+    # Offload at most 4 pages to host memory, and the rest to a file.
+    temp = utils.tempdir()
+    fenable_offload(kv_cache, 4, temp.relpath("kv_cache.bin"))
+
+    cached_k = {}
+    cached_v = {}
+    apply_attention(kv_cache, rope_mode, [(0, 60), (1, 35), (2, 20)], cached_k, cached_v)
+    num_available_pages = fget_num_available_pages(kv_cache)
+    for seq_id in range(3):
+        foffload_sequence(kv_cache, seq_id)
+    assert fget_num_available_pages(kv_cache) == num_available_pages + 9
+    apply_attention(kv_cache, rope_mode, [(3, 100)], cached_k, cached_v)
+    # The offloaded sequences are reloaded when they are forwarded or forked.
+    apply_attention(kv_cache, rope_mode, [(0, 1), (1, 5), (3, 1)], cached_k, cached_v)
+    apply_attention(kv_cache, rope_mode, [((4, 2, 10), 5)], cached_k, cached_v)
+    foffload_sequence(kv_cache, 3)
+    verify_cached_kv(kv_cache, seq_ids=list(range(5)), expected_k=cached_k, expected_v=cached_v)
+
+    for seq_id in range(5):
+        foffload_sequence(kv_cache, seq_id)
+        fremove_sequence(kv_cache, seq_id)
+    assert fis_empty(kv_cache), "The KV cache is not empty after removing all sequences"
+
+
+@pytest.mark.parametrize("page_dtype", ["int8", "float8_e4m3fn"])
+def test_paged_attention_kv_cache_quantized_pages(page_dtype):
+    global head_dim, sm_scale, dtype
+    head_dim, dtype, rope_mode = 128, "float16", RopeMode.NORMAL
+    sm_scale = head_dim ** (-0.5)
+    set_global_func(head_dim, dtype)
+    kv_cache = create_kv_cache(head_dim, dtype, rope_mode, False)
+    set_global_func(head_dim, dtype, page_dtype)
+    quantized_kv_cache = create_kv_cache(head_dim, dtype, rope_mode, False, page_dtype)
+    kv_caches = [kv_cache, quantized_kv_cache]
+    # The quantization error is bounded by the page scale, so values in [-1.5, 1.5] after RoPE
+    # are compared with absolute tolerances.
+    output_atol, kv_atol = {"int8": (2e-2, 5e-2), "float8_e4m3fn": (1e-1, 2e-1)}[page_dtype]
+
+    def forward(batch):
+        seq_ids = [seq_id for seq_id, _ in batch]
+        append_lengths = [append_length for _, append_length in batch]
+        for cache in kv_caches:
+            fbegin_forward(cache, ShapeTuple(seq_ids), ShapeTuple(append_lengths), None)
+        for layer_id in range(num_layers):
+            qkv = np.random.rand(
+                sum(append_lengths), num_qo_heads + 2 * num_kv_heads, head_dim
+            ).astype(dtype)
+            outputs = []
+            for cache in kv_caches:
+                output = tvm.nd.empty((sum(append_lengths), num_qo_heads, head_dim), dtype, device)
+                fattention_with_fuse_qkv(cache, layer_id, sm_scale, tvm.nd.array(qkv, device), output)
+                outputs.append(output.numpy())
+            tvm.testing.assert_allclose(outputs[1], outputs[0], rtol=0, atol=output_atol)
+        for cache in kv_caches:
+            fend_forward(cache)
+
+    for cache in kv_caches:
+        fclear(cache)
+        for seq_id in range(3):
+            fadd_sequence(cache, seq_id)
+    np.random.seed(0)
+    forward([(0, 35), (1, 88), (2, 17)])
+    for cache in kv_caches:
+        ffork_sequence(cache, 1, 3, 40)
+        fadd_sequence(cache, 4)
+    forward([(3, 7), (4, 21), (0, 1)])
+    for _ in range(8):
+        forward([(0, 1), (1, 1), (2, 1), (3, 1), (4, 1)])
+    for cache in kv_caches:
+        fpopn(cache, 1, 30)
+        fremove_sequence(cache, 2)
+    forward([(1, 3), (3, 12), (4, 1)])
+
+    seq_lengths = {0: 44, 1: 69, 3: 67, 4: 30}
+    for seq_id, seq_length in seq_lengths.items():
+        kv = []
+        for cache in kv_caches:
+            keys = tvm.nd.empty((num_layers, seq_length, num_kv_heads, head_dim), dtype, device)
+            values = tvm.nd.empty((num_layers, seq_length, num_kv_heads, head_dim), dtype, device)
+            fdebug_get_kv(cache, seq_id, 0, seq_length, keys, values)
+            kv.append((keys.numpy(), values.numpy()))
+        tvm.testing.assert_allclose(kv[1][0], kv[0][0], rtol=0, atol=kv_atol)
+        tvm.testing.assert_allclose(kv[1][1], kv[0][1], rtol=0, atol=kv_atol)
+
+    # The pages and their scales take about half the memory of float16 pages.
+    fp16_page_nbytes = fget_page_nbytes(kv_cache)
+    quantized_page_nbytes = fget_page_nbytes(quantized_kv_cache)
+    assert fp16_page_nbytes == num_layers * 2 * num_kv_heads * page_size * head_dim * 2
+    assert quantized_page_nbytes <= 0.51 * fp16_page_nbytes
+
+
 def test_paged_attention_kv_cache_sliding_window(kv_cache_and_config):
     kv_cache, rope_mode, support_sliding_window = kv_cache_and_config
     if not support_sliding_window or rope_mode == RopeMode.NORMAL:
@@ -961,6 +1217,8 @@ if __name__ == "__main__":
         test_paged_attention_kv_cache_remove_sequence(cache_and_config)
         test_paged_attention_kv_cache_fork_sequence(cache_and_config)
         test_paged_attention_kv_cache_popn(cache_and_config)
+        test_paged_attention_kv_cache_prefix_cache(cache_and_config)
+        test_paged_attention_kv_cache_offload(cache_and_config)
         test_paged_attention_kv_cache_sliding_window(cache_and_config)
         test_paged_attention_kv_cache_tree_attn(cache_and_config)
         test_paged_attention_kv_cache_unlimited_depth(cache_and_config)
@@ -15,6 +15,7 @@
 # specific language governing permissions and limitations
 # under the License.
 
+import numpy as np
 import pytest
 
 import tvm
@@ -272,6 +273,151 @@ def test_different_dtype():
     tvm.ir.assert_structural_equal(mod, Expected)
 
 
+def test_arena_planner():
+    @tvm.script.ir_module
+    class Module:
+        @T.prim_func
+        def add(
+            A: T.Buffer((T.int64(16), T.int64(16)), "float32"),
+            B: T.Buffer((T.int64(16), T.int64(16)), "float32"),
+            C: T.Buffer((T.int64(16), T.int64(16)), "float32"),
+        ):
+            T.evaluate(0)
+
+        @T.prim_func
+        def add1(
+            A: T.Buffer((T.int64(16), T.int64(16)), "int32"),
+            B: T.Buffer((T.int64(16), T.int64(16)), "int32"),
+            C: T.Buffer((T.int64(16), T.int64(16)), "int32"),
+        ):
+            T.evaluate(0)
+
+        @T.prim_func
+        def mix(
+            A: T.Buffer((T.int64(16), T.int64(16)), "float32"),
+            B: T.Buffer((T.int64(16), T.int64(16)), "int32"),
+            C: T.Buffer((T.int64(16), T.int64(16)), "float32"),
+        ):
+            T.evaluate(0)
+
+        @R.function
+        def main(
+            x: R.Tensor((16, 16), dtype="float32"), y: R.Tensor((16, 16), dtype="int32")
+        ) -> R.Tensor((16, 16), dtype="float32"):
+            R.func_attr({"relax.force_pure": True})
+            cls = Module
+            alloc: R.Tensor((16, 16), dtype="float32") = R.builtin.alloc_tensor(
+                R.shape([16, 16]), dtype="float32", runtime_device_index=0
+            )
+            _: R.Tuple() = cls.add(x, x, alloc)
+            alloc1: R.Tensor((16, 16), dtype="float32") = R.builtin.alloc_tensor(
+                R.shape([16, 16]), dtype="float32", runtime_device_index=0
+            )
+            _1: R.Tuple() = cls.add(alloc, alloc, alloc1)
+            alloc2: R.Tensor((16, 16), dtype="int32") = R.builtin.alloc_tensor(
+                R.shape([16, 16]), dtype="int32", runtime_device_index=0
+            )
+            _2: R.Tuple() = cls.add1(y, y, alloc2)
+            alloc3: R.Tensor((16, 16), dtype="float32") = R.builtin.alloc_tensor(
+                R.shape([16, 16]), dtype="float32", runtime_device_index=0
+            )
+            _3: R.Tuple() = cls.mix(alloc1, alloc2, alloc3)
+            return alloc3
+
+    @tvm.script.ir_module
+    class Expected:
+        @T.prim_func
+        def add(
+            A: T.Buffer((T.int64(16), T.int64(16)), "float32"),
+            B: T.Buffer((T.int64(16), T.int64(16)), "float32"),
+            C: T.Buffer((T.int64(16), T.int64(16)), "float32"),
+        ):
+            T.evaluate(0)
+
+        @T.prim_func
+        def add1(
+            A: T.Buffer((T.int64(16), T.int64(16)), "int32"),
+            B: T.Buffer((T.int64(16), T.int64(16)), "int32"),
+            C: T.Buffer((T.int64(16), T.int64(16)), "int32"),
+        ):
+            T.evaluate(0)
+
+        @T.prim_func
+        def mix(
+            A: T.Buffer((T.int64(16), T.int64(16)), "float32"),
+            B: T.Buffer((T.int64(16), T.int64(16)), "int32"),
+            C: T.Buffer((T.int64(16), T.int64(16)), "float32"),
+        ):
+            T.evaluate(0)
+
+        @R.function
+        def main(
+            x: R.Tensor((16, 16), dtype="float32"), y: R.Tensor((16, 16), dtype="int32")
+        ) -> R.Tensor((16, 16), dtype="float32"):
+            R.func_attr({"relax.force_pure": True})
+            cls = Expected
+            storage: R.Object = R.memory.alloc_storage(
+                R.shape([2048]), virtual_device_index=0, storage_scope="global", dtype="uint8"
+            )
+            alloc: R.Tensor((16, 16), dtype="float32") = R.memory.alloc_tensor(
+                storage, 0, R.shape([16, 16]), dtype="float32"
+            )
+            _: R.Tuple() = cls.add(x, x, alloc)
+            alloc1: R.Tensor((16, 16), dtype="float32") = R.memory.alloc_tensor(
+                storage, 1024, R.shape([16, 16]), dtype="float32"
+            )
+            _1: R.Tuple() = cls.add(alloc, alloc, alloc1)
+            # The int32 tensor takes the bytes of the dead float32 tensor.
+            alloc2: R.Tensor((16, 16), dtype="int32") = R.memory.alloc_tensor(
+                storage, 0, R.shape([16, 16]), dtype="int32"
+            )
+            _2: R.Tuple() = cls.add1(y, y, alloc2)
+            alloc3: R.Tensor((16, 16), dtype="float32") = R.builtin.alloc_tensor(
+                R.shape([16, 16]), dtype="float32", runtime_device_index=0
+            )
+            _3: R.Tuple() = cls.mix(alloc1, alloc2, alloc3)
+            return alloc3
+
+    with tvm.transform.PassContext(config={"relax.StaticPlanBlockMemory.planner": "arena"}):
+        mod = relax.transform.StaticPlanBlockMemory()(Module)
+    tvm.ir.assert_structural_equal(mod, Expected)
+
+
+@tvm.testing.requires_llvm
+def test_arena_planner_execution():
+    @I.ir_module
+    class Module:
+        @R.function
+        def main(x: R.Tensor((16, 16), "float32"), y: R.Tensor((16, 16), "int32")):
+            with R.dataflow():
+                a = R.add(x, x)
+                b = R.multiply(a, a)
+                c = R.astype(R.add(y, y), "float32")
+                d = R.add(b, c)
+                R.output(d)
+            return d
+
+    x = np.random.rand(16, 16).astype("float32")
+    y = np.random.randint(0, 8, (16, 16)).astype("int32")
+    with tvm.transform.PassContext(config={"relax.StaticPlanBlockMemory.planner": "arena"}):
+        ex = relax.build(Module, "llvm")
+    vm = relax.VirtualMachine(ex, tvm.cpu())
+    out = vm["main"](tvm.nd.array(x), tvm.nd.array(y))
+    tvm.testing.assert_allclose(out.numpy(), (2 * x) ** 2 + 2 * y, rtol=1e-5)
+
+
+def test_invalid_planner():
+    @tvm.script.ir_module
+    class Module:
+        @R.function
+        def main(x: R.Tensor((2, 3), dtype="float32")) -> R.Tensor((2, 3), dtype="float32"):
+            return x
+
+    with tvm.transform.PassContext(config={"relax.StaticPlanBlockMemory.planner": "best"}):
+        with pytest.raises(ValueError):
+            relax.transform.StaticPlanBlockMemory()(Module)
+
+
 def test_dtype_bool():
     @tvm.script.ir_module
     class Module:
@@ -731,6 +877,75 @@ def test_symbolic_shape():
     tvm.ir.assert_structural_equal(mod, Expected)
 
 
+def test_symbolic_shape_reuse_larger_storage():
+    @tvm.script.ir_module
+    class Module:
+        @T.prim_func
+        def exp(var_A: T.handle, var_B: T.handle):
+            T.evaluate(0)
+
+        @R.function
+        def main(x: R.Tensor(("n", 8), "float32")):
+            R.func_attr({"relax.force_pure": True, "tir_non_negative_var": ["n"]})
+            n = T.int64()
+            alloc: R.Tensor((n, 8), dtype="float32") = R.builtin.alloc_tensor(
+                R.shape([n, 8]), dtype="float32", runtime_device_index=0
+            )
+            _ = Module.exp(x, alloc)
+            alloc1: R.Tensor((n, 8), dtype="float32") = R.builtin.alloc_tensor(
+                R.shape([n, 8]), dtype="float32", runtime_device_index=0
+            )
+            _1 = Module.exp(alloc, alloc1)
+            alloc2: R.Tensor((n, 4), dtype="float32") = R.builtin.alloc_tensor(
+                R.shape([n, 4]), dtype="float32", runtime_device_index=0
+            )
+            _2 = Module.exp(alloc1, alloc2)
+            alloc3: R.Tensor((n, 4), dtype="float32") = R.builtin.alloc_tensor(
+                R.shape([n, 4]), dtype="float32", runtime_device_index=0
+            )
+            _3 = Module.exp(alloc2, alloc3)
+            return alloc3
+
+    @tvm.script.ir_module
+    class Expected:
+        @T.prim_func
+        def exp(var_A: T.handle, var_B: T.handle):
+            T.evaluate(0)
+
+        @R.function
+        def main(x: R.Tensor(("n", 8), dtype="float32")) -> R.Tensor(("n", 4), dtype="float32"):
+            n = T.int64()
+            R.func_attr({"relax.force_pure": True, "tir_non_negative_var": ["n"]})
+            cls = Expected
+            storage: R.Object = R.memory.alloc_storage(
+                R.shape([32 * n]), R.prim_value(0), R.str("global"), R.dtype("float32")
+            )
+            alloc: R.Tensor((n, 8), dtype="float32") = R.memory.alloc_tensor(
+                storage, R.prim_value(0), R.shape([n, 8]), R.dtype("float32")
+            )
+            _: R.Tuple = cls.exp(x, alloc)
+            storage1: R.Object = R.memory.alloc_storage(
+                R.shape([32 * n]), R.prim_value(0), R.str("global"), R.dtype("float32")
+            )
+            alloc1: R.Tensor((n, 8), dtype="float32") = R.memory.alloc_tensor(
+                storage1, R.prim_value(0), R.shape([n, 8]), R.dtype("float32")
+            )
+            _1: R.Tuple = cls.exp(alloc, alloc1)
+            # The storage of 32 * n bytes is provably large enough for 16 * n bytes.
+            alloc2: R.Tensor((n, 4), dtype="float32") = R.memory.alloc_tensor(
+                storage, R.prim_value(0), R.shape([n, 4]), R.dtype("float32")
+            )
+            _2: R.Tuple = cls.exp(alloc1, alloc2)
+            alloc3: R.Tensor((n, 4), dtype="float32") = R.builtin.alloc_tensor(
+                R.shape([n, 4]), R.dtype("float32"), R.prim_value(0), R.str("global")
+            )
+            _3: R.Tuple = cls.exp(alloc2, alloc3)
+            return alloc3
+
+    mod = relax.transform.StaticPlanBlockMemory()(Module)
+    tvm.ir.assert_structural_equal(mod, Expected)
+
+
 def test_zero_reference():
     @tvm.script.ir_module
     class Module:
@@ -31,7 +31,7 @@ from tvm.script import relax as R, tir as T, ir as I
 from tvm.relax.testing.vm import check_saved_func
 from tvm.runtime import ShapeTuple
 
-EXEC_MODE = ["bytecode", "compiled"]
+EXEC_MODE = ["bytecode", "compiled", "compiled_direct_tensors"]
 
 
 @pytest.fixture(params=EXEC_MODE)
@@ -101,6 +101,46 @@ def test_tir_call():
     assert_structural_equal(expected, after)
 
 
+def test_tir_call_direct_tensors():
+    @tvm.script.ir_module
+    class Before:
+        @T.prim_func
+        def shape_func(H: T.Buffer(T.int64(4), "int64")):
+            T.func_attr({"global_symbol": "shape_func"})
+            # generated compute function
+            H[T.int64(0)] = H[T.int64(0)] + T.int64(1)
+
+        @R.function(pure=False)
+        def foo(x: R.Tensor([4], "int64")):
+            R.func_attr({"global_symbol": "foo"})
+            _ = Before.shape_func(x)
+            return x
+
+    @tvm.script.ir_module
+    class Expected:
+        @T.prim_func
+        def shape_func(H: T.Buffer(T.int64(4), "int64")):
+            T.func_attr({"global_symbol": "shape_func"})
+            # generated compute function
+            H[T.int64(0)] = H[T.int64(0)] + T.int64(1)
+
+        @T.prim_func
+        def __vmtir__foo(ctx_ptr: T.handle, r: T.handle, c: T.handle, f: T.handle):
+            T.func_attr({"global_symbol": "__vmtir__foo"})
+            T.call_cpacked(
+                "shape_func",
+                T.tvm_struct_get(r, 0, 12, "handle"),
+                T.reinterpret("handle", T.uint64(0)),
+            )
+            T.anylist_setitem_call_packed(
+                r, T.int32(1), "vm.builtin.copy", T.anylist_getitem(r, T.int32(0))
+            )
+
+    builder = relax.ExecBuilder()
+    after = relax.vm_build._vmcodegen(builder, Before, exec_mode="compiled_direct_tensors")
+    assert_structural_equal(Expected, after)
+
+
 def test_if_cond():
     @tvm.script.ir_module
     class Before:
@@ -131,6 +131,23 @@ def test_rpc_simple_wlog():
     check_remote()
 
 
+@tvm.testing.requires_rpc
+def test_rpc_submit():
+    server = rpc.Server(key="x1")
+    client = rpc.connect("127.0.0.1", server.port, key="x1")
+
+    def check_remote():
+        waits = [client.submit("rpc.test.addone", i) for i in range(200)]
+        failed = client.submit("rpc.test.except", "abc")
+        last = client.submit("rpc.test.strcat", "abc", 11)
+        assert last() == "abc:11"
+        assert [wait() for wait in waits] == [i + 1 for i in range(200)]
+        with pytest.raises(tvm._ffi.base.TVMError):
+            failed()
+
+    check_remote()
+
+
 @tvm.testing.requires_rpc
 def test_rpc_runtime_string():
     server = rpc.Server(key="x1")
@@ -179,6 +196,26 @@ def test_rpc_large_array():
     check_remote()
 
 
+@tvm.testing.requires_rpc
+@pytest.mark.parametrize("compression,dedup", [("lz4", False), ("none", True), ("lz4", True)])
+def test_rpc_transfer_options(compression, dedup):
+    server = rpc.Server()
+    remote = rpc.connect("127.0.0.1", server.port)
+    remote.set_transfer_options(compression=compression, dedup=dedup)
+
+    def check_remote():
+        dev = remote.cpu(0)
+        x = np.zeros((1024, 1024), dtype="float32")
+        x[::7, ::3] = np.random.uniform(size=x[::7, ::3].shape)
+        for _ in range(2):
+            a = tvm.nd.array(x, dev)
+            np.testing.assert_equal(a.numpy(), x)
+        with pytest.raises(ValueError):
+            remote.set_transfer_options(compression="gzip")
+
+    check_remote()
+
+
 @tvm.testing.skip_if_32bit(reason="skipping test for i386.")
 @tvm.testing.requires_rpc
 def test_rpc_echo():